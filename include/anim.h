@@ -0,0 +1,53 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdint.h>
+
+// Maximum number of animation jobs in flight at once
+#define ANIM_MAX_JOBS 8
+
+// Default typing rate (microseconds per character)
+#define ANIM_TYPE_RATE_US 10000
+
+// Cursor blink half-period (microseconds)
+#define ANIM_CURSOR_BLINK_US 250000
+
+// Keys that complete all pending animations immediately
+#define ANIM_SKIP_KEY     ' '
+#define ANIM_SKIP_KEY_ESC 0x1B
+
+// Initialize the animation engine (drops any queued jobs)
+void anim_init(void);
+
+// Queue a line of text to be typed at (x, y), starting delay_us from now.
+// Returns a job id, or -1 if the queue was full (text is then drawn at once).
+int anim_type_text(uint32_t x, uint32_t y, const char *msg, uint32_t color,
+                   uint32_t delay_us);
+
+// Same as anim_type_text with an explicit per-character rate
+int anim_type_text_rate(uint32_t x, uint32_t y, const char *msg, uint32_t color,
+                        uint32_t delay_us, uint32_t rate_us);
+
+// Queue a blinking block cursor at (x, y) for duration_us
+int anim_cursor(uint32_t x, uint32_t y, uint32_t color, uint32_t duration_us);
+
+// Advance all jobs to the current time. Never blocks; safe to call from
+// a polling loop or a timer interrupt.
+void anim_tick(void);
+
+// Finish every queued job immediately
+void anim_skip(void);
+
+// Non-zero while any job is still pending
+int anim_busy(void);
+
+// Non-zero once the skip key has been pressed
+int anim_skipped(void);
+
+// Cosmetic wait that keeps animations running; returns early on skip
+void anim_delay_ms(uint32_t milliseconds);
+
+// Run ticks until every queued job has completed
+void anim_sync(void);
+
+#endif // ANIM_H
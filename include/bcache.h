@@ -0,0 +1,53 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+#include "blockdev.h"
+
+// Write-through LRU cache of 512-byte blocks, indexed by absolute LBA.
+// Meant for filesystem metadata (MBR, FAT sectors, directories); bulk
+// reads pass BCACHE_BYPASS so they do not evict it.
+
+#define BCACHE_DEFAULT_ENTRIES  64
+#define BCACHE_MAX_ENTRIES      1024
+
+// Read flags
+#define BCACHE_BYPASS           (1 << 0)    // Read from the device, do not fill
+
+// Error codes (in addition to BLK_ERR_* and MMC_ERR_*)
+#define BCACHE_ERR_NOMEM       -32  // Cache could not be allocated
+#define BCACHE_ERR_FULL        -33  // Every entry is pinned
+
+typedef struct {
+    uint32_t entries;           // Configured size
+    uint32_t used;              // Entries holding a block
+    uint32_t pinned;            // Entries currently pinned
+    uint32_t hits;              // Blocks served from the cache
+    uint32_t misses;            // Blocks read from the device to fill
+    uint32_t evictions;
+    uint32_t bypass;            // Blocks read with BCACHE_BYPASS
+    uint32_t writes;            // Blocks written through
+} bcache_stats_t;
+
+// Allocate a cache of the given number of entries (0 = default),
+// dropping any previous contents
+int bcache_init(uint32_t entries);
+
+// Read count blocks through the cache
+int bcache_read(blockdev_t *dev, uint32_t lba, uint32_t count, uint8_t *buffer,
+                uint32_t flags);
+
+// Write count blocks to the device, updating cached copies
+int bcache_write(blockdev_t *dev, uint32_t lba, uint32_t count, const uint8_t *buffer);
+
+// Load a block and keep it resident until bcache_unpin. Returns the
+// cached data, or 0 on error. Pins nest.
+const uint8_t *bcache_pin(blockdev_t *dev, uint32_t lba);
+void bcache_unpin(const uint8_t *data);
+
+// Drop every unpinned entry
+void bcache_invalidate(void);
+
+const bcache_stats_t *bcache_get_stats(void);
+
+#endif // BCACHE_H
@@ -0,0 +1,77 @@
+#ifndef BIO_H
+#define BIO_H
+
+#include <stdint.h>
+#include "blockdev.h"
+
+// Block I/O request queue above the SD card driver.
+// Requests are queued and dispatched in the background as the queue is
+// polled; requests for adjacent blocks are merged into one multi-block
+// read, and sequential streams are followed by read-ahead.
+
+// Status of a request that has not completed yet
+#define BIO_PENDING 1
+
+// Read-ahead window limits (blocks)
+#define BIO_READAHEAD_MAX       64
+#define BIO_READAHEAD_DEFAULT   16
+
+struct bio;
+typedef void (*bio_done_fn)(struct bio *bio);
+
+typedef struct bio {
+    blockdev_t *dev;
+    uint32_t lba;               // Relative to dev
+    uint32_t count;             // Blocks
+    uint8_t *buffer;            // MMC_DMA_ALIGN aligned for DMA (else PIO)
+    volatile int status;        // BIO_PENDING, then BLK_OK or an error code
+    bio_done_fn done;           // Optional completion callback
+    void *ctx;                  // For the callback
+
+    // Queue state (owned by the queue while pending)
+    struct bio *next;
+    uint64_t queued_us;
+} bio_t;
+
+// Queue statistics
+typedef struct {
+    uint32_t submitted;         // Requests submitted
+    uint32_t completed;         // Requests completed (any status)
+    uint32_t commands;          // Read commands issued to the card
+    uint32_t merged;            // Requests that joined another's command
+    uint32_t ra_hits;           // Requests served from the read-ahead window
+    uint32_t ra_blocks;         // Blocks read ahead
+    uint32_t blocks;            // Blocks read from the card
+    uint32_t depth;             // Requests queued or in flight
+    uint32_t max_depth;
+    uint32_t depth_sum;         // Sum of depth at each submit
+    uint64_t busy_us;           // Time the card spent transferring
+    uint64_t stall_us;          // Time the card sat idle with requests waiting
+} bio_stats_t;
+
+// Reset the queue and statistics
+void bio_init(void);
+
+// Queue a read. Returns BLK_OK once queued (or completed from read-ahead),
+// or an error without queuing. The callback runs from bio_poll.
+int bio_submit(bio_t *bio);
+
+// Complete a finished transfer and start the next one; never blocks
+void bio_poll(void);
+
+// Poll until the request has completed; returns its status
+int bio_wait(bio_t *bio);
+
+// Poll until every queued request has completed
+void bio_drain(void);
+
+// Read-ahead window after sequential requests (0 disables, max BIO_READAHEAD_MAX)
+void bio_set_readahead(uint32_t blocks);
+
+// Drop the read-ahead window (call after writing to the card)
+void bio_invalidate(void);
+
+// Statistics since the last bio_init
+const bio_stats_t *bio_get_stats(void);
+
+#endif // BIO_H
@@ -0,0 +1,47 @@
+#ifndef BLOCKDEV_H
+#define BLOCKDEV_H
+
+#include <stdint.h>
+
+// Block size used by every device
+#define BLOCKDEV_BLOCK_SIZE 512
+
+// Error codes (MMC_ERR_* codes from the driver are passed through)
+#define BLK_OK               0
+#define BLK_ERR_RANGE      -16  // Request outside the device
+#define BLK_ERR_NODEV      -17  // Device not initialized
+
+struct blockdev;
+
+typedef int (*blockdev_read_fn)(struct blockdev *dev, uint32_t lba,
+                                uint32_t count, uint8_t *buffer);
+typedef int (*blockdev_write_fn)(struct blockdev *dev, uint32_t lba,
+                                 uint32_t count, const uint8_t *buffer);
+
+// A block device, or a window (e.g. a partition) onto one
+typedef struct blockdev {
+    const char *name;
+    uint32_t start;             // First block on the parent device
+    uint32_t num_blocks;
+    blockdev_read_fn read;      // Absolute LBA on the underlying medium
+    blockdev_write_fn write;
+} blockdev_t;
+
+// Initialize the SD card; returns BLK_OK or a negative error code
+int blockdev_init(void);
+
+// SD card device, or 0 if blockdev_init has not succeeded
+blockdev_t *blockdev_get_sd(void);
+
+// Create a window of num_blocks starting at start within parent
+int blockdev_sub(blockdev_t *sub, const blockdev_t *parent, const char *name,
+                 uint32_t start, uint32_t num_blocks);
+
+// Read/write count consecutive blocks (relative to the device start)
+int blockdev_read(blockdev_t *dev, uint32_t lba, uint32_t count, uint8_t *buffer);
+int blockdev_write(blockdev_t *dev, uint32_t lba, uint32_t count, const uint8_t *buffer);
+
+// Short description of an error code
+const char *blockdev_strerror(int err);
+
+#endif // BLOCKDEV_H
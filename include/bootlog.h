@@ -0,0 +1,93 @@
+#ifndef BOOTLOG_H
+#define BOOTLOG_H
+
+#include <stdint.h>
+#include "fat.h"
+
+// Persistent boot log
+// One record per boot: phase timings, the kernel chosen, the last error
+// and short timestamped notes. The record is built in RAM and written to
+// the card in one multi-block transfer when the boot ends (at the jump,
+// or on reaching the emergency shell), never per message.
+//
+// The log is a ring of fixed-size records in a preallocated file (the
+// BIOS does not allocate clusters). Each record carries a sequence
+// number and a CRC-32; a write torn by a reset only spoils the record
+// being written, and the next boot carries on after the newest intact one.
+
+#define BOOTLOG_PATH        "/retros.log"
+#define BOOTLOG_MAGIC       0x474F4C52  // "RLOG"
+#define BOOTLOG_RECORD_SIZE 1024
+#define BOOTLOG_MAX_RECORDS 256         // Larger files use the first 256 KB
+#define BOOTLOG_KERNEL_MAX  32
+
+// Errors
+#define BOOTLOG_ERR_NOFILE  -160        // BOOTLOG_PATH missing or too small
+
+// Record flags
+#define BOOTLOG_FLAG_BOOTED 0x01        // Jumped to a kernel
+#define BOOTLOG_FLAG_SHELL  0x02        // Ended in the emergency shell
+#define BOOTLOG_FLAG_ERROR  0x04        // An error was logged
+
+// Boot phases, timed from the end of the previous one
+#define BOOTLOG_PHASE_FIRMWARE  0       // Reset to BIOS entry
+#define BOOTLOG_PHASE_CONFIG    1       // Card mount and retros.cfg
+#define BOOTLOG_PHASE_DISPLAY   2       // Framebuffer, splash, beep
+#define BOOTLOG_PHASE_SCREEN    3       // Boot messages, memory test
+#define BOOTLOG_PHASE_CARD      4       // SD card setup, boot catalog
+#define BOOTLOG_PHASE_MENU      5       // Boot menu
+#define BOOTLOG_PHASE_LOAD      6       // Loading the next stage
+#define BOOTLOG_PHASES          8
+
+#define BOOTLOG_TEXT_MAX    (BOOTLOG_RECORD_SIZE - 96)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;                       // Counts up across boots
+    uint32_t crc;                       // CRC-32 of the record, this field 0
+    uint32_t flags;                     // BOOTLOG_FLAG_*
+    int32_t error;                      // Last error logged, 0 if none
+    uint32_t end_ms;                    // Reset to the write
+    uint32_t text_len;
+    uint32_t reserved;
+    uint32_t phase_us[BOOTLOG_PHASES];
+    char kernel[BOOTLOG_KERNEL_MAX];    // Next stage chosen
+    char text[BOOTLOG_TEXT_MAX];        // "[ms] note" lines
+} bootlog_record_t;
+
+// Start this boot's record (call once, right after timer_init)
+void bootlog_begin(void);
+
+// Find the log file on a mounted volume and the newest record in it, so
+// that bootlog_commit can write the next one
+int bootlog_attach(fat_volume_t *vol);
+
+// End a phase: the time since the previous mark is charged to it
+void bootlog_phase(int phase);
+
+// Append "[ms] what: detail" (detail may be 0); notes that do not fit
+// are dropped
+void bootlog_note(const char *what, const char *detail);
+
+// Record an error and note it
+void bootlog_error(const char *what, const char *detail, int err);
+
+// Name the next stage and set record flags
+void bootlog_kernel(const char *name);
+void bootlog_flag(uint32_t flag);
+
+// Write the record to the log, one transfer; may be called again later
+// in the same boot, which rewrites the same slot
+int bootlog_commit(void);
+
+// Read every intact record, oldest first. The array stays valid until
+// the next call; returns 0 with *count 0 if there is no log.
+const bootlog_record_t *bootlog_history(uint32_t *count);
+
+// Name of a BOOTLOG_PHASE_* value
+const char *bootlog_phase_name(int phase);
+
+// Short description of an error code
+const char *bootlog_strerror(int err);
+
+#endif // BOOTLOG_H
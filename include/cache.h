@@ -0,0 +1,28 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+// Data cache line size
+#if defined(BCM2836) || defined(BCM2837)
+#define CACHE_LINE_SIZE 64
+#else
+#define CACHE_LINE_SIZE 32
+#endif
+
+// Wait for outstanding memory accesses and cache operations (DSB)
+void cache_sync(void);
+
+// Write dirty lines covering [start, start + size) back to memory
+// (before a device reads the buffer)
+void cache_clean_range(const void *start, uint32_t size);
+
+// Discard lines covering the range (after a device wrote the buffer).
+// Partial lines at either end are discarded too, so device buffers
+// should be CACHE_LINE_SIZE aligned.
+void cache_invalidate_range(void *start, uint32_t size);
+
+// Write back, then discard
+void cache_clean_invalidate_range(void *start, uint32_t size);
+
+#endif // CACHE_H
@@ -0,0 +1,107 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdint.h>
+#include "fat.h"
+
+// Boot catalog (/retros.cat)
+// An index of the bootable files on the card: each entry carries the
+// file's directory entry location, first cluster, extent map, size and
+// CRC-32, so the chosen kernel opens without walking a directory or the
+// FAT. The catalog is checked at boot by re-reading the few directory
+// blocks it depends on; if anything moved it is rebuilt by a full scan
+// and written back in place.
+//
+// The scan covers the boot-order files and every file in CATALOG_DIR.
+// The BIOS never allocates clusters, so it can only save the catalog
+// into an existing file of at least CATALOG_SIZE bytes (any content);
+// without one catalog_load does not scan at all, and only an explicit
+// catalog_rebuild builds a catalog, for this boot.
+
+#define CATALOG_PATH        "/retros.cat"
+#define CATALOG_DIR         "/kernels"
+
+#define CATALOG_MAGIC       0x54414352  // "RCAT"
+#define CATALOG_VERSION     1
+#define CATALOG_RECORD_SIZE 256
+#define CATALOG_MAX_ENTRIES 15
+#define CATALOG_SIZE        (CATALOG_RECORD_SIZE * (CATALOG_MAX_ENTRIES + 1))
+
+#define CATALOG_NAME_MAX    32          // Menu label, including the NUL
+#define CATALOG_PATH_MAX    96
+#define CATALOG_EXTENTS     10          // Longer maps fall back to the FAT
+#define CATALOG_MAX_WATCH   4           // Directories checked for new files
+
+// Errors
+#define CATALOG_ERR_NOSPACE -128        // CATALOG_PATH missing or too small
+
+// One bootable file; all fields little-endian
+typedef struct {
+    char name[CATALOG_NAME_MAX];        // File name without extension
+    char path[CATALOG_PATH_MAX];
+    char short_name[16];                // 8.3 name in the directory entry
+    uint32_t first_cluster;
+    uint32_t size;
+    uint32_t crc;                       // CRC-32 of the whole file
+    uint32_t entry_lba;                 // Directory entry location
+    uint32_t entry_offset;
+    uint16_t mtime;
+    uint16_t mdate;
+    uint32_t num_extents;               // 0: map the chain at load time
+    fat_extent_t extents[CATALOG_EXTENTS];
+    uint32_t reserved;
+} catalog_entry_t;
+
+// Directory whose first cluster was checksummed when the catalog was built
+typedef struct {
+    uint32_t lba;
+    uint32_t blocks;
+    uint32_t crc;                       // Entries, access dates masked out
+} catalog_watch_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t crc;                       // CRC-32 of the catalog, this field 0
+    uint32_t data_lba;                  // Volume it was built for
+    uint32_t num_clusters;
+    uint32_t sources;                   // CRC-32 of the boot-order list
+    uint32_t watch_count;
+    catalog_watch_t watch[CATALOG_MAX_WATCH];
+    uint8_t reserved[CATALOG_RECORD_SIZE - 28 - CATALOG_MAX_WATCH * 12];
+} catalog_header_t;
+
+typedef struct {
+    int rebuilt;                        // Stored catalog was stale
+    int save_rc;                        // Writing it back: 0 or an error
+    const char *reason;                 // Why it was stale
+    uint32_t checksummed;               // Files read in full by the scan
+    uint64_t check_us;                  // Validating the stored catalog
+    uint64_t scan_us;                   // Rebuilding it
+} catalog_stats_t;
+
+// Load the catalog, rebuilding it if it no longer matches the volume.
+// sources is the comma-separated boot-order list. Returns the number of
+// entries or a negative error (CATALOG_ERR_NOSPACE, without a scan, if
+// the catalog could not be saved).
+int catalog_load(fat_volume_t *vol, const char *sources);
+
+// Rebuild by a full scan regardless of the stored catalog
+int catalog_rebuild(fat_volume_t *vol, const char *sources);
+
+// Entries in boot-order order, then CATALOG_DIR order
+const catalog_entry_t *catalog_entries(uint32_t *count);
+
+// Index of the entry with this name (case-insensitive), or -1
+int catalog_find(const char *name);
+
+// Open an entry from its saved extents
+int catalog_open(fat_volume_t *vol, const catalog_entry_t *entry, fat_file_t *file);
+
+const catalog_stats_t *catalog_get_stats(void);
+
+// Short description of an error code
+const char *catalog_strerror(int err);
+
+#endif // CATALOG_H
@@ -0,0 +1,78 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include "fat.h"
+
+// Boot configuration (retros.cfg on the boot partition)
+// One "key = value" per line; '#' starts a comment. The file is read once
+// into a fixed buffer and split in place: keys and values are pointers
+// into that buffer, kept in a table sorted by key for binary search.
+//
+// Keys read by the BIOS:
+//   resolution         native or WIDTHxHEIGHT
+//   boot-order         comma-separated files to try, e.g. /kernel.bin
+//   diag-timeout       ms to wait for the diagnostic key
+//   fast-boot          yes/no: skip the beep, memory test and delays
+//   baud               UART baud rate
+//   log-level          0-3, UART log level (see log.h)
+//   bad-sector-chance  percent chance of the bad sector warning
+//   warm-boot          yes/no: keep the loaded kernel for warm reboots
+//   splash             splash image file (default /splash.rspl)
+
+#define CONFIG_PATH         "/retros.cfg"
+#define CONFIG_MAX_SIZE     4096
+#define CONFIG_MAX_ENTRIES  48
+
+// Errors
+#define CONFIG_ERR_TOOBIG   -112    // File larger than CONFIG_MAX_SIZE
+#define CONFIG_ERR_FULL     -113    // More than CONFIG_MAX_ENTRIES keys
+
+// The parsed table is copied here for the next stage, which gets its
+// address in r3. It sits just past the loader's area.
+#define CONFIG_HANDOFF_ADDR 0x08000000
+#define CONFIG_HANDOFF_MAX  0x4000
+#define CONFIG_HANDOFF_MAGIC 0x47464352     // "RCFG"
+
+typedef struct {
+    const char *key;
+    const char *value;
+} config_entry_t;
+
+// Handoff block: header, then count pairs of 16-bit offsets (key, value)
+// from the start of the block, sorted by key, then the strings
+typedef struct {
+    uint32_t magic;
+    uint32_t size;              // Whole block in bytes
+    uint32_t count;
+    uint32_t reserved;
+    uint16_t offsets[];
+} config_handoff_t;
+
+// Read and parse a configuration file. Returns the number of keys, or a
+// negative error (CONFIG_ERR_*, FAT_ERR_*); the table is then empty.
+int config_load(fat_volume_t *vol, const char *path);
+
+// Lines that were not "key = value" in the last file loaded
+uint32_t config_bad_lines(void);
+
+// Value of key, or 0 if it is not set
+const char *config_get(const char *key);
+
+// Key as a number (decimal or 0x hex), or def if unset or malformed
+uint32_t config_get_uint(const char *key, uint32_t def);
+
+// Key as yes/no, on/off, true/false or 1/0, or def if unset or malformed
+int config_get_bool(const char *key, int def);
+
+// All keys in sorted order
+const config_entry_t *config_entries(uint32_t *count);
+
+// Build the handoff block at dest; returns its size, or 0 if it does not
+// fit in max bytes
+uint32_t config_handoff(void *dest, uint32_t max);
+
+// Short description of an error code
+const char *config_strerror(int err);
+
+#endif // CONFIG_H
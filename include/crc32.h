@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected, as used by GPT, zip and PNG).
+// Pass 0 to start and the previous result to continue over more data.
+uint32_t crc32(uint32_t crc, const void *data, uint32_t len);
+
+#endif // CRC32_H
@@ -0,0 +1,54 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdint.h>
+
+// Number of usable DMA channels (channel 15 lives elsewhere)
+#define DMA_CHANNELS 15
+
+// Control block, as read by the DMA engine (32-byte aligned)
+typedef struct {
+    uint32_t ti;                // Transfer information
+    uint32_t source_ad;         // Bus address
+    uint32_t dest_ad;           // Bus address
+    uint32_t txfr_len;          // Bytes
+    uint32_t stride;
+    uint32_t nextconbk;         // Bus address of next block, 0 = last
+    uint32_t reserved[2];
+} __attribute__((aligned(32))) dma_cb_t;
+
+// Transfer information bits
+#define DMA_TI_INTEN            (1 << 0)
+#define DMA_TI_WAIT_RESP        (1 << 3)
+#define DMA_TI_DEST_INC         (1 << 4)
+#define DMA_TI_DEST_WIDTH       (1 << 5)    // 128-bit writes
+#define DMA_TI_DEST_DREQ        (1 << 6)
+#define DMA_TI_SRC_INC          (1 << 8)
+#define DMA_TI_SRC_WIDTH        (1 << 9)    // 128-bit reads
+#define DMA_TI_SRC_DREQ         (1 << 10)
+#define DMA_TI_BURST(n)         ((uint32_t)(n) << 12)
+#define DMA_TI_PERMAP(n)        ((uint32_t)(n) << 16)
+#define DMA_TI_NO_WIDE_BURSTS   (1 << 26)
+
+// Peripheral DREQ numbers
+#define DMA_DREQ_EMMC 11
+
+// Channel status
+#define DMA_DONE     0
+#define DMA_BUSY     1
+#define DMA_ERROR   -1
+
+// Enable and reset a channel
+void dma_init(uint32_t channel);
+
+// Start a chain of count contiguous control blocks (written back from the
+// data cache first; the chain must be linked through nextconbk)
+void dma_start(uint32_t channel, const dma_cb_t *cb, uint32_t count);
+
+// DMA_BUSY, DMA_DONE or DMA_ERROR
+int dma_status(uint32_t channel);
+
+// Stop the channel and drop the rest of the chain
+void dma_abort(uint32_t channel);
+
+#endif // DMA_H
@@ -0,0 +1,16 @@
+#ifndef ED25519_H
+#define ED25519_H
+
+#include <stdint.h>
+
+// Ed25519 signature verification (RFC 8032, pure Ed25519)
+
+#define ED25519_PUBLIC_KEY_SIZE 32
+#define ED25519_SIGNATURE_SIZE  64
+
+// Returns 0 if sig is a valid signature of msg under pk, -1 otherwise
+int ed25519_verify(const uint8_t sig[ED25519_SIGNATURE_SIZE],
+                   const void *msg, uint32_t len,
+                   const uint8_t pk[ED25519_PUBLIC_KEY_SIZE]);
+
+#endif // ED25519_H
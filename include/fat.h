@@ -0,0 +1,147 @@
+#ifndef FAT_H
+#define FAT_H
+
+#include <stdint.h>
+#include "blockdev.h"
+
+// Read-only FAT16/FAT32 driver
+// Metadata (boot sector, FAT, directories) goes through the block cache;
+// file data is read straight from the device, one multi-block transfer
+// per contiguous extent.
+
+// Error codes (device errors are passed through)
+#define FAT_OK                0
+#define FAT_ERR_NOFS        -48  // No FAT boot sector
+#define FAT_ERR_NOTFOUND    -49  // No such file or directory
+#define FAT_ERR_NOTDIR      -50  // Path component is not a directory
+#define FAT_ERR_ISDIR       -51  // Tried to open a directory as a file
+#define FAT_ERR_CORRUPT     -52  // Bad cluster chain or entry
+#define FAT_ERR_UNSUPPORTED -53  // FAT12, or sectors other than 512 bytes
+
+#define FAT_NAME_MAX        255
+
+// Extents held by an open file; longer chains are remapped on demand
+#define FAT_MAX_EXTENTS     32
+
+// Directory entry attributes
+#define FAT_ATTR_READ_ONLY  0x01
+#define FAT_ATTR_HIDDEN     0x02
+#define FAT_ATTR_SYSTEM     0x04
+#define FAT_ATTR_VOLUME_ID  0x08
+#define FAT_ATTR_DIRECTORY  0x10
+#define FAT_ATTR_ARCHIVE    0x20
+#define FAT_ATTR_LFN        0x0F
+
+typedef struct {
+    blockdev_t *dev;
+    uint32_t type;              // 16 or 32
+    uint32_t cluster_blocks;    // Blocks per cluster (power of two)
+    uint32_t cluster_shift;     // log2(cluster_blocks)
+    uint32_t fat_lba;           // First FAT
+    uint32_t fat_blocks;        // Blocks per FAT
+    uint32_t root_lba;          // FAT16 fixed root directory
+    uint32_t root_blocks;
+    uint32_t root_cluster;      // FAT32 root directory
+    uint32_t data_lba;          // First block of cluster 2
+    uint32_t num_clusters;
+    char label[12];
+} fat_volume_t;
+
+// A contiguous run of blocks on the device
+typedef struct {
+    uint32_t lba;
+    uint32_t blocks;
+} fat_extent_t;
+
+typedef struct {
+    char name[FAT_NAME_MAX + 1];    // Long name, or the 8.3 name
+    char short_name[13];            // "NAME.EXT"
+    uint8_t attr;
+    uint32_t first_cluster;
+    uint32_t size;                  // Bytes
+    uint16_t mtime;                 // FAT time/date of last write
+    uint16_t mdate;
+    uint32_t entry_lba;             // Block holding the short entry (0 for
+    uint32_t entry_offset;          // the root) and its byte offset there
+} fat_dirent_t;
+
+typedef struct {
+    fat_volume_t *vol;
+    uint32_t cluster;           // Current cluster, 0 for the FAT16 root
+    uint32_t block;             // Block within the cluster or root region
+    uint32_t index;             // Entry within the block
+    int end;
+
+    // Long name being assembled
+    char lfn[FAT_NAME_MAX + 1];
+    uint8_t lfn_sum;
+    uint8_t lfn_next;           // Next expected sequence number, 0 = done
+    int lfn_valid;
+} fat_dir_t;
+
+typedef struct {
+    fat_volume_t *vol;
+    uint32_t first_cluster;
+    uint32_t size;              // Bytes
+    uint32_t pos;               // Read position
+
+    // Extent map of file blocks [map_block, map_block + map_blocks)
+    uint32_t map_block;
+    uint32_t map_blocks;
+    uint32_t map_next;          // Cluster after the map, 0 = end of chain
+    uint32_t num_extents;
+    fat_extent_t extents[FAT_MAX_EXTENTS];
+} fat_file_t;
+
+// Mount the volume at the start of dev (sets up the block cache if needed)
+int fat_mount(fat_volume_t *vol, blockdev_t *dev);
+
+// Iterate a directory ("/" or "" for the root). fat_readdir returns 1 with
+// an entry, 0 at the end, or a negative error.
+int fat_opendir(fat_volume_t *vol, const char *path, fat_dir_t *dir);
+int fat_readdir(fat_dir_t *dir, fat_dirent_t *entry);
+
+// Look up a path (case-insensitive, long or 8.3 names)
+int fat_stat(fat_volume_t *vol, const char *path, fat_dirent_t *entry);
+
+// Re-read the short entry at a location reported by fat_readdir, e.g. to
+// check that a saved lookup is still current. Only the 8.3 name is
+// filled in; FAT_ERR_NOTFOUND if the slot no longer holds a file.
+int fat_stat_at(fat_volume_t *vol, uint32_t lba, uint32_t offset, fat_dirent_t *entry);
+
+// Open a file for reading
+int fat_open(fat_volume_t *vol, const char *path, fat_file_t *file);
+
+// Open a file from a directory entry already looked up
+int fat_open_entry(fat_volume_t *vol, const fat_dirent_t *entry, fat_file_t *file);
+
+// Open a file from a saved extent map without reading the FAT. Extents
+// outside the data area or short of the file size are ignored and the
+// chain is mapped from first_cluster instead.
+int fat_open_extents(fat_volume_t *vol, uint32_t first_cluster, uint32_t size,
+                     const fat_extent_t *extents, uint32_t count, fat_file_t *file);
+
+// Open size bytes of raw blocks from lba on dev as a file, for images
+// kept outside any filesystem. vol only carries the device.
+int fat_open_blocks(fat_volume_t *vol, blockdev_t *dev, uint32_t lba, uint32_t size,
+                    fat_file_t *file);
+
+// Blocks of a directory's first cluster; cluster 0 is the root directory
+// (on FAT16 its whole fixed region)
+void fat_dir_blocks(const fat_volume_t *vol, uint32_t cluster, fat_extent_t *ext);
+
+// Read from the current position; returns bytes read or a negative error
+int fat_read(fat_file_t *file, void *buffer, uint32_t size);
+
+// Set the read position
+int fat_seek(fat_file_t *file, uint32_t pos);
+
+// Device LBA of file block `block` and the number of contiguous blocks
+// from there (to the end of the extent or file), for callers that queue
+// their own transfers
+int fat_map(fat_file_t *file, uint32_t block, uint32_t *lba, uint32_t *count);
+
+// Short description of an error code
+const char *fat_strerror(int err);
+
+#endif // FAT_H
@@ -6,4 +6,13 @@
 // 8x16 font data
 extern const uint8_t font8x16[256][16];
 
+// Pre-expanded glyph atlases for integer-scaled text (printable ASCII).
+// Generated at build time from src/font.c by tools/mkatlas.py; each row
+// holds 8*scale pixels, leftmost pixel in the most significant used bit.
+#define FONT_ATLAS_FIRST 0x20
+#define FONT_ATLAS_COUNT 95
+
+extern const uint16_t font_atlas_2x[FONT_ATLAS_COUNT][16];
+extern const uint32_t font_atlas_3x[FONT_ATLAS_COUNT][16];
+
 #endif // FONT_H
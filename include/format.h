@@ -0,0 +1,21 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+// Formatted output into caller buffers, shared by the UART, framebuffer
+// and boot log sinks.
+//
+// Conversions: %d %i %u %x %X %c %s %p %%, with the flags - 0 + space #,
+// a width and a precision (either may be *), and the length modifiers
+// l (long, 32-bit here), ll (64-bit), h and z (ignored). %x prints just
+// the digits; use 0x%08X for the old fixed 8-digit form, or %p.
+
+// Format into buf, writing at most size bytes including the terminating
+// NUL (nothing if size is 0). Returns the length the whole output would
+// have had, so a result >= size means it was cut short.
+int vsnprintf(char *buf, uint32_t size, const char *fmt, va_list args);
+int snprintf(char *buf, uint32_t size, const char *fmt, ...);
+
+#endif // FORMAT_H
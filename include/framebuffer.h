@@ -3,32 +3,55 @@
 
 #include <stdint.h>
 
+// Text layout is designed for a 640x480 logical screen; on larger
+// displays it is drawn with integer-scaled glyphs and centered.
+#define FB_LOGICAL_WIDTH  640
+#define FB_LOGICAL_HEIGHT 480
+#define FB_MAX_SCALE      3
+
 typedef struct {
     uint32_t width;
     uint32_t height;
     uint32_t pitch;
     uint32_t *buffer;
+    uint32_t scale;     // Integer scale applied to text and logical coords
+    uint32_t origin_x;  // Physical offset of the logical screen
+    uint32_t origin_y;
 } framebuffer_t;
 
 // Initialize framebuffer
 int fb_init(uint32_t width, uint32_t height, uint32_t depth);
 
+// Initialize framebuffer at the display's preferred (EDID) resolution,
+// falling back to 640x480 if the firmware does not report one
+int fb_init_native(void);
+
 // Get framebuffer info
 framebuffer_t *fb_get_info(void);
 
-// Draw a pixel
+// Select text scale (1..FB_MAX_SCALE) and re-center the logical screen
+void fb_set_scale(uint32_t scale);
+
+// Draw a pixel (physical coordinates)
 void fb_draw_pixel(uint32_t x, uint32_t y, uint32_t color);
 
 // Clear screen
 void fb_clear(uint32_t color);
 
-// Draw a character using 8x16 font
+// Draw a character using 8x16 font (logical coordinates)
 void fb_draw_char(uint32_t x, uint32_t y, char c, uint32_t fg, uint32_t bg);
 
-// Draw a string
+// Draw a string (logical coordinates)
 void fb_draw_string(uint32_t x, uint32_t y, const char *str, uint32_t fg, uint32_t bg);
 
+// Draw formatted text (see format.h), cut at FB_PRINTF_MAX characters
+#define FB_PRINTF_MAX 128
+void fb_printf(uint32_t x, uint32_t y, uint32_t fg, uint32_t bg, const char *fmt, ...);
+
 // Apply scanline effect
 void fb_apply_scanlines(void);
 
+// Render count glyphs at the given scale; returns glyphs per second
+uint32_t fb_benchmark_glyphs(uint32_t scale, uint32_t count);
+
 #endif // FRAMEBUFFER_H
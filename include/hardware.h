@@ -8,14 +8,21 @@
 #if defined(BCM2836)
     // BCM2836 for RPi2
     #define PERIPHERAL_BASE 0x3F000000
+    #define BUS_RAM_ALIAS   0xC0000000  // Uncached (L2 is not shared)
 #elif defined(BCM2837)
     // BCM2837 for RPi3
     #define PERIPHERAL_BASE 0x3F000000
+    #define BUS_RAM_ALIAS   0xC0000000
 #else
     // BCM2835 for RPi0/1
     #define PERIPHERAL_BASE 0x20000000
+    #define BUS_RAM_ALIAS   0x40000000  // L2 cache coherent
 #endif
 
+// VideoCore bus addresses, as seen by DMA engines
+#define BUS_PERIPHERAL(addr) ((uint32_t)(addr) - PERIPHERAL_BASE + 0x7E000000)
+#define BUS_ADDRESS(addr)    ((uint32_t)(addr) | BUS_RAM_ALIAS)
+
 // GPIO
 #define GPIO_BASE (PERIPHERAL_BASE + 0x200000)
 
@@ -27,8 +34,23 @@
 #define UART0_FBRD   (UART0_BASE + 0x28)
 #define UART0_LCRH   (UART0_BASE + 0x2C)
 #define UART0_CR     (UART0_BASE + 0x30)
+#define UART0_IFLS   (UART0_BASE + 0x34)
+#define UART0_IMSC   (UART0_BASE + 0x38)
+#define UART0_MIS    (UART0_BASE + 0x40)
 #define UART0_ICR    (UART0_BASE + 0x44)
 
+// Interrupt controller (ARM side); IRQs 0-63 are the GPU peripheral lines
+#define IRQ_BASE            (PERIPHERAL_BASE + 0xB200)
+#define IRQ_BASIC_PENDING   (IRQ_BASE + 0x00)
+#define IRQ_PENDING_1       (IRQ_BASE + 0x04)
+#define IRQ_PENDING_2       (IRQ_BASE + 0x08)
+#define IRQ_ENABLE_1        (IRQ_BASE + 0x10)
+#define IRQ_ENABLE_2        (IRQ_BASE + 0x14)
+#define IRQ_ENABLE_BASIC    (IRQ_BASE + 0x18)
+#define IRQ_DISABLE_1       (IRQ_BASE + 0x1C)
+#define IRQ_DISABLE_2       (IRQ_BASE + 0x20)
+#define IRQ_DISABLE_BASIC   (IRQ_BASE + 0x24)
+
 // Mailbox
 #define MAILBOX_BASE (PERIPHERAL_BASE + 0xB880)
 #define MAILBOX_READ  (MAILBOX_BASE + 0x00)
@@ -49,6 +71,12 @@
 #define CM_PWMCTL (CM_BASE + 0xA0)
 #define CM_PWMDIV (CM_BASE + 0xA4)
 
+// Power management: watchdog and reset control
+#define PM_BASE     (PERIPHERAL_BASE + 0x100000)
+#define PM_RSTC     (PM_BASE + 0x1C)
+#define PM_WDOG     (PM_BASE + 0x24)
+#define PM_PASSWORD 0x5A000000      // Required in every PM register write
+
 // System Timer
 #define TIMER_BASE (PERIPHERAL_BASE + 0x3000)
 #define TIMER_CLO  (TIMER_BASE + 0x04)
@@ -56,6 +84,10 @@
 // EMMC (SD Card)
 #define EMMC_BASE (PERIPHERAL_BASE + 0x300000)
 
+// DMA controller (channels 0-14)
+#define DMA_BASE   (PERIPHERAL_BASE + 0x7000)
+#define DMA_ENABLE (DMA_BASE + 0xFF0)
+
 // Helper macros
 #define MMIO_READ(reg) (*(volatile uint32_t *)(reg))
 #define MMIO_WRITE(reg, val) (*(volatile uint32_t *)(reg) = (val))
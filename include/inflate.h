@@ -0,0 +1,20 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <stdint.h>
+#include "stream.h"
+
+// Streaming DEFLATE decoder (RFC 1951) with the gzip wrapper (RFC 1952).
+// Output goes to one flat destination, which doubles as the history
+// window. Huffman codes up to INFLATE_FAST_BITS long decode with a single
+// table lookup; longer ones fall back to a canonical bit-by-bit walk.
+
+#define INFLATE_FAST_BITS 9
+
+// Decode raw DEFLATE data from s into dst (max bytes)
+int inflate_raw(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len);
+
+// Decode one or more gzip members, checking each CRC-32 and length
+int gzip_decode(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len);
+
+#endif // INFLATE_H
@@ -0,0 +1,49 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+// Interrupts
+// boot.S installs the vector table and an IRQ stack; the IRQ vector calls
+// irq_dispatch, which runs the handler registered for each pending GPU
+// peripheral line. Handlers run with IRQs masked and must not touch VFP
+// or NEON registers, which the vector does not save.
+
+#define IRQ_LINES   64
+
+// GPU peripheral interrupt lines
+#define IRQ_UART0   57
+
+typedef void (*irq_handler_t)(void);
+
+// Mask every line at the controller (call once, before any irq_register)
+void irq_init(void);
+
+// Route a line to a handler and unmask it at the controller
+void irq_register(uint32_t irq, irq_handler_t handler);
+
+// Mask a line again
+void irq_unregister(uint32_t irq);
+
+// Allow or block IRQs at the CPU
+void irq_enable(void);
+void irq_disable(void);
+
+// Block IRQs for a critical section; irq_restore puts back the state saved
+static inline uint32_t irq_save(void) {
+    uint32_t cpsr;
+    asm volatile("mrs %0, cpsr\n\tcpsid i" : "=r"(cpsr) : : "memory");
+    return cpsr;
+}
+
+static inline void irq_restore(uint32_t cpsr) {
+    asm volatile("msr cpsr_c, %0" : : "r"(cpsr) : "memory");
+}
+
+// Mask every line and block IRQs, before handing the CPU to a kernel
+void irq_shutdown(void);
+
+// Called from the IRQ vector in boot.S
+void irq_dispatch(void);
+
+#endif // IRQ_H
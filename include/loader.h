@@ -0,0 +1,119 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdint.h>
+#include "fat.h"
+#include "ed25519.h"
+#include "sha256.h"
+
+// Pipelined image loader
+// File blocks stream from the card into a ring of DMA buffers through the
+// block I/O queue while the decompressor consumes the filled slots and
+// writes straight to the load address, so card transfers and decoding
+// overlap. The format is detected from the first bytes: LZ4 frame or
+// legacy, gzip, otherwise the file is read as-is. The CRC-32 of the file
+// is computed on the way through.
+//
+// Native RETROS images (rimg.h) are scatter-loaded instead: each segment
+// streams to its own load address, decoded per its compression, and
+// zero-filled segments cost only a memset.
+//
+// A file may start with a signed header (tools/sign_image.py): one block
+// carrying the SHA-256 of the payload that follows and an Ed25519
+// signature over the header. The signature is checked against the key
+// built into the BIOS before loading, and the payload is hashed as it
+// streams in, so the digest is ready the moment the last block lands.
+
+// Default load address and the space available there
+#define LOADER_ADDRESS      0x04000000
+#define LOADER_MAX_SIZE     0x04000000
+
+// Ring geometry: slots of up to LOADER_SLOT_BLOCKS blocks each
+#define LOADER_SLOTS        8
+#define LOADER_SLOT_BLOCKS  64
+
+// Image formats
+#define LOADER_FORMAT_RAW   0
+#define LOADER_FORMAT_LZ4   1
+#define LOADER_FORMAT_GZIP  2
+#define LOADER_FORMAT_RIMG  3   // Native segmented image
+
+// Errors
+#define LOADER_ERR_HEADER       -96     // Malformed signed header
+#define LOADER_ERR_SIGNATURE    -97     // Header signature invalid
+#define LOADER_ERR_DIGEST       -98     // Payload does not match the header
+#define LOADER_ERR_UNSIGNED     -99     // Unsigned image (VERIFIED_BOOT builds)
+#define LOADER_ERR_IMAGE        -100    // Malformed native image header
+#define LOADER_ERR_RANGE        -101    // Segment or entry outside dest..dest+max
+
+// Signed image header, little-endian, padded to one block so the payload
+// stays block aligned. The signature covers the first 64 bytes.
+#define LOADER_SIG_MAGIC    0x47495352  // "RSIG"
+#define LOADER_SIG_VERSION  1
+#define LOADER_SIG_SIZE     512
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // LOADER_SIG_SIZE
+    uint32_t payload_size;      // Bytes after the header
+    uint32_t flags;             // Reserved, 0
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t reserved[16];
+    uint8_t signature[ED25519_SIGNATURE_SIZE];
+    uint8_t pad[LOADER_SIG_SIZE - 128];
+} __attribute__((packed)) loader_sig_header_t;
+
+// How far an image was authenticated
+#define LOADER_SIG_NONE     0   // Unsigned
+#define LOADER_SIG_DIGEST   1   // Digest matched; no key built in
+#define LOADER_SIG_VERIFIED 2   // Signature and digest both good
+
+// Public key images are verified against (make BOOT_KEY=file); weak and
+// resolves to 0 when none was built in
+extern const uint8_t boot_public_key[ED25519_PUBLIC_KEY_SIZE] __attribute__((weak));
+
+// Per-stage figures for one load
+typedef struct {
+    int format;
+    uint32_t in_bytes;          // Read from the card
+    uint32_t out_bytes;         // Written to the destination
+    uint32_t commands;          // Card commands issued
+    uint32_t crc;               // CRC-32 of the file as read (flat images)
+    int sig;                    // LOADER_SIG_*
+    uint32_t entry;             // Where to start the image
+    uint32_t top;               // End of the highest byte placed in memory
+    uint32_t segments;          // Native images: segments loaded
+    uint32_t zeroed;            // Native images: bytes zero filled
+    uint64_t total_us;
+    uint64_t io_us;             // Card busy transferring
+    uint64_t wait_us;           // Decoder stalled waiting for data
+    uint64_t hash_us;           // SHA-256 over the payload
+    uint64_t verify_us;         // Ed25519 signature check
+} loader_stats_t;
+
+// Load an open file into dest (at most max bytes; native images place
+// their segments anywhere in that range). Returns the number of bytes
+// written or a negative error (LOADER_ERR_*, STREAM_ERR_*,
+// FAT_ERR_*, device).
+int loader_load(fat_file_t *file, uint8_t *dest, uint32_t max, loader_stats_t *stats);
+
+// Authenticate an image already in memory (e.g. received over the UART)
+// the same way loader_load does a file: a signed header is checked
+// against the built-in key and the payload against its digest, and
+// VERIFIED_BOOT builds refuse unsigned images. Returns the offset of the
+// payload (LOADER_SIG_SIZE, or 0 if unsigned) or a negative error; sets
+// sig, hash_us and verify_us in stats.
+int loader_verify(const uint8_t *image, uint32_t size, loader_stats_t *stats);
+
+// Name of a LOADER_FORMAT_* value
+const char *loader_format_name(int format);
+
+// Short description of an error code
+const char *loader_strerror(int err);
+
+// Transfer control to a loaded image with r0-r3 set; does not return
+void loader_jump(uint32_t entry, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+    __attribute__((noreturn));
+
+#endif // LOADER_H
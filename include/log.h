@@ -0,0 +1,76 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+// Leveled diagnostics
+// Each message has a level and a subsystem tag and is formatted once,
+// timestamped from timer_get_uptime_us, into a line such as
+//   [    1.204518] W sd: Block cache disabled (out of memory)
+// which then goes to every sink whose level lets it through: the UART,
+// a strip at the bottom of the screen and a RAM ring that keeps the most
+// recent lines for the shell's dmesg.
+//
+// Messages above LOG_COMPILE_LEVEL (make LOG_LEVEL=n) are compiled out,
+// arguments and all. The rest are filtered per sink at run time; the UART
+// level comes from log-level in retros.cfg.
+
+#define LOG_ERROR   0
+#define LOG_WARN    1
+#define LOG_INFO    2
+#define LOG_DEBUG   3
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_INFO
+#endif
+
+// Sinks
+#define LOG_SINK_UART   0
+#define LOG_SINK_SCREEN 1
+#define LOG_SINK_RING   2
+#define LOG_SINKS       3
+
+#define LOG_LINE_MAX    160         // Longer messages are cut
+#define LOG_RING_SIZE   8192        // Bytes of recent lines kept in RAM
+
+// Screen strip at the foot of the 640x480 logical screen; it scrolls, the
+// newest line at the bottom, colored by level
+#define LOG_SCREEN_X    16
+#define LOG_SCREEN_Y    450
+#define LOG_SCREEN_ROWS 2
+#define LOG_SCREEN_COLS 76
+
+typedef struct {
+    uint32_t messages;              // Formatted and sent to a sink
+    uint32_t filtered;              // Below every sink's level at run time
+    uint32_t ring_lost;             // Bytes pushed out of the ring
+    uint64_t us;                    // Time spent in log_write
+} log_stats_t;
+
+// Format and send one message; use the macros below instead
+void log_write(int level, const char *tag, const char *fmt, ...);
+
+#define LOG_AT(level, tag, ...) do { \
+    if ((level) <= LOG_COMPILE_LEVEL) log_write((level), (tag), __VA_ARGS__); \
+} while (0)
+
+#define log_error(tag, ...) LOG_AT(LOG_ERROR, tag, __VA_ARGS__)
+#define log_warn(tag, ...)  LOG_AT(LOG_WARN, tag, __VA_ARGS__)
+#define log_info(tag, ...)  LOG_AT(LOG_INFO, tag, __VA_ARGS__)
+#define log_debug(tag, ...) LOG_AT(LOG_DEBUG, tag, __VA_ARGS__)
+
+// Highest level a sink shows. Defaults: UART info, screen warnings,
+// ring everything compiled in.
+void log_set_level(int sink, int level);
+int log_get_level(int sink);
+
+// The screen sink stays off until the framebuffer is up
+void log_screen_enable(int on);
+
+// Print the ring, oldest line first, on the UART
+void log_dump(void);
+
+// Message count and the time spent logging this boot
+const log_stats_t *log_get_stats(void);
+
+#endif // LOG_H
@@ -0,0 +1,19 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <stdint.h>
+#include "stream.h"
+
+// Streaming LZ4 decoder (frame format and the legacy format produced by
+// "lz4 -l", as used for Linux kernels). Matches are copied from the
+// destination itself, so no window is kept. Block and content checksums
+// (xxHash32) are skipped, not verified.
+
+#define LZ4_MAGIC           0x184D2204
+#define LZ4_LEGACY_MAGIC    0x184C2102
+
+// Decode from s into dst (max bytes); *out_len receives the bytes written.
+// Returns 0 or a STREAM_ERR_* / device error.
+int lz4_decode(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len);
+
+#endif // LZ4_H
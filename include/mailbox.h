@@ -0,0 +1,42 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stdint.h>
+
+// Mailbox channels
+#define MBOX_CH_PROPERTY 8
+
+// Property interface
+#define MBOX_REQUEST        0x00000000
+#define MBOX_RESPONSE_OK    0x80000000
+
+// Property tags
+#define MBOX_TAG_GET_PHYS_SIZE  0x00040003
+#define MBOX_TAG_ALLOCATE_FB    0x00040001
+#define MBOX_TAG_GET_PITCH      0x00040008
+#define MBOX_TAG_SET_PHYS_SIZE  0x00048003
+#define MBOX_TAG_SET_VIRT_SIZE  0x00048004
+#define MBOX_TAG_SET_DEPTH      0x00048005
+#define MBOX_TAG_GET_CLOCK_RATE 0x00030002
+#define MBOX_TAG_SET_CLOCK_RATE 0x00038002
+#define MBOX_TAG_END            0x00000000
+
+// Clock IDs
+#define MBOX_CLOCK_EMMC 1
+#define MBOX_CLOCK_UART 2
+
+// Send a property message (16-byte aligned) and wait for the reply.
+// Returns 1 if the firmware reported success.
+int mailbox_call(volatile uint32_t *msg, uint8_t channel);
+
+// Query a single-value-pair tag (e.g. display size). Returns 0 on success.
+int mailbox_get_pair(uint32_t tag, uint32_t *a, uint32_t *b);
+
+// Current rate of a firmware-managed clock in Hz, or 0 on failure
+uint32_t mailbox_get_clock_rate(uint32_t clock_id);
+
+// Ask the firmware to change a clock; returns the rate it settled on, or
+// 0 on failure
+uint32_t mailbox_set_clock_rate(uint32_t clock_id, uint32_t rate);
+
+#endif // MAILBOX_H
@@ -0,0 +1,28 @@
+#ifndef MENU_H
+#define MENU_H
+
+#include <stdint.h>
+
+// Boot menu
+// A list of choices drawn on the framebuffer and mirrored on the UART.
+// menu_poll never blocks: it takes whatever input has arrived and
+// redraws the countdown, so the caller keeps animations and other boot
+// work running between polls.
+//
+// Keys: Up/Down (or k/j) move the highlight, Enter picks it, 1-9 pick
+// that entry at once. Any key stops the countdown.
+
+#define MENU_MAX_ITEMS  16
+
+// menu_poll result while no choice has been made
+#define MENU_PENDING    -1
+
+// Show the menu with item def highlighted; it is picked after
+// timeout_ms without input (0 waits for a key)
+void menu_open(const char *title, const char *const *items, uint32_t count,
+               uint32_t def, uint32_t timeout_ms);
+
+// Index of the chosen item, or MENU_PENDING
+int menu_poll(void);
+
+#endif // MENU_H
@@ -3,6 +3,32 @@
 
 #include <stdint.h>
 
+// Error codes returned by the MMC driver
+#define MMC_OK               0
+#define MMC_ERR_NOT_READY   -1   // Controller not initialized or no card
+#define MMC_ERR_TIMEOUT     -2   // Command or data phase timed out
+#define MMC_ERR_CMD         -3   // Command CRC/index/end-bit error
+#define MMC_ERR_DATA        -4   // Data CRC/end-bit error
+#define MMC_ERR_UNSUPPORTED -5   // Card or request not supported
+#define MMC_ERR_BUSY        -6   // An asynchronous transfer is in flight
+
+// Returned by mmc_async_poll while a transfer is still running
+#define MMC_PENDING          1
+
+// Largest transfer a single multi-block command can carry
+#define MMC_MAX_BLOCKS_PER_CMD 0xFFFF
+
+// DMA transfers: buffer alignment (covers every cache line size) and the
+// maximum number of scattered destination segments per command
+#define MMC_DMA_ALIGN       64
+#define MMC_MAX_SEGMENTS    16
+
+// One destination of a scattered read
+typedef struct {
+    uint8_t *buffer;            // MMC_DMA_ALIGN aligned
+    uint32_t num_blocks;
+} mmc_segment_t;
+
 // MMC/SD card types
 typedef enum {
     MMC_TYPE_UNKNOWN = 0,
@@ -12,6 +38,13 @@ typedef enum {
     MMC_TYPE_SDHC = 4
 } mmc_card_type_t;
 
+// Bus modes, slowest first
+typedef enum {
+    MMC_MODE_IDENT = 0,         // 400 kHz, 1-bit (card identification)
+    MMC_MODE_DEFAULT_SPEED,     // 25 MHz, 4-bit
+    MMC_MODE_HIGH_SPEED         // 50 MHz, 4-bit (CMD6 switch)
+} mmc_mode_t;
+
 // MMC card information
 typedef struct {
     mmc_card_type_t type;
@@ -19,8 +52,14 @@ typedef struct {
     uint32_t ocr;               // Operating conditions register
     uint32_t capacity;          // Card capacity in blocks
     uint32_t block_size;        // Block size in bytes
-    uint8_t csd[16];            // Card-specific data
-    uint8_t cid[16];            // Card identification
+    uint8_t csd[16];            // Card-specific data (CRC stripped, LSB first)
+    uint8_t cid[16];            // Card identification (CRC stripped, LSB first)
+    uint8_t scr[8];             // SD configuration register (MSB first)
+    mmc_mode_t mode;            // Current bus mode
+    mmc_mode_t max_mode;        // Fastest mode supported by card and host
+    uint32_t bus_width;         // Data lines in use (1 or 4)
+    uint32_t base_clock;        // EMMC controller input clock (Hz)
+    uint32_t clock_hz;          // Actual SD clock after division
 } mmc_card_info_t;
 
 // Initialize MMC/SD card controller
@@ -29,12 +68,38 @@ int mmc_init(void);
 // Get card information
 mmc_card_info_t *mmc_get_card_info(void);
 
-// Read blocks from card
+// Read blocks from card: DMA when the buffer is MMC_DMA_ALIGN aligned,
+// word-burst PIO when 4-byte aligned, byte stores otherwise
 int mmc_read_blocks(uint32_t start_block, uint32_t num_blocks, uint8_t *buffer);
 
-// Write blocks to card
+// Start a DMA read of consecutive blocks into one or more segments and
+// return immediately. Buffers must not be touched until completion.
+int mmc_read_async(uint32_t start_block, const mmc_segment_t *segments,
+                   uint32_t num_segments);
+
+// MMC_PENDING while the transfer runs, then its result (MMC_OK or error)
+int mmc_async_poll(void);
+
+// Block until the outstanding transfer (if any) has completed
+int mmc_async_wait(void);
+
+// Write blocks to card (word-burst PIO when 4-byte aligned)
 int mmc_write_blocks(uint32_t start_block, uint32_t num_blocks, const uint8_t *buffer);
 
+// Switch bus width, card timing and SD clock for the given mode
+int mmc_set_mode(mmc_mode_t mode);
+
+// Human-readable mode name
+const char *mmc_mode_name(mmc_mode_t mode);
+
+// Time a multi-block read in the current mode; returns KB/s (0 on error)
+// and, if cycles_per_block is non-null, the CPU cycles spent per block
+uint32_t mmc_benchmark(uint32_t start_block, uint32_t num_blocks, uint8_t *buffer,
+                       uint32_t *cycles_per_block);
+
+// Enable or disable DMA for mmc_read_blocks (enabled by default)
+void mmc_use_dma(int enable);
+
 // Reset MMC controller
 void mmc_reset(void);
 
@@ -0,0 +1,64 @@
+#ifndef PART_H
+#define PART_H
+
+#include <stdint.h>
+#include "blockdev.h"
+
+// Partition discovery (MBR with extended partitions, GPT)
+// The disk is scanned once; the resulting table stays valid for the rest
+// of boot and each entry carries a block device for the filesystem layer.
+
+#define PART_MAX            16
+
+// Error codes (device errors are passed through)
+#define PART_OK              0
+#define PART_ERR_NOTABLE   -64  // No MBR or GPT (e.g. a bare FAT volume)
+#define PART_ERR_CORRUPT   -65  // GPT failed its CRC checks (both copies)
+#define PART_ERR_NOBOOT    -66  // No partition suitable for booting
+
+// Partition table schemes
+#define PART_SCHEME_MBR      1
+#define PART_SCHEME_GPT      2
+
+// Partition flags
+#define PART_FLAG_ACTIVE    (1 << 0)    // MBR boot indicator / GPT legacy bootable
+#define PART_FLAG_ESP       (1 << 1)    // EFI system partition
+#define PART_FLAG_FAT       (1 << 2)    // Type says FAT (or basic data)
+#define PART_FLAG_LOGICAL   (1 << 3)    // Inside an MBR extended partition
+
+typedef struct {
+    blockdev_t dev;             // Window onto the disk
+    char name[8];               // "sdN"
+    uint8_t mbr_type;           // MBR system ID, 0 for GPT entries
+    uint8_t type_guid[16];      // GPT type GUID, zero for MBR entries
+    uint32_t flags;
+} part_t;
+
+typedef struct {
+    int scheme;                 // PART_SCHEME_*, 0 if none
+    uint32_t count;
+    part_t parts[PART_MAX];
+    int gpt_backup;             // GPT taken from the backup header
+} part_table_t;
+
+// Scan disk for partitions; the table is cached until the next scan
+int part_scan(blockdev_t *disk);
+
+// Table from the last successful scan (0 if none)
+const part_table_t *part_get_table(void);
+
+// Partition to boot from: the EFI system partition, else the first
+// active FAT partition, else the first FAT partition
+part_t *part_find_boot(void);
+
+// Block 0 of the disk as read by the last scan, also when no table was
+// found (0 if the read failed)
+const uint8_t *part_boot_sector(void);
+
+// Short description of a partition type
+const char *part_type_name(const part_t *part);
+
+// Short description of an error code
+const char *part_strerror(int err);
+
+#endif // PART_H
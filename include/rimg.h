@@ -0,0 +1,50 @@
+#ifndef RIMG_H
+#define RIMG_H
+
+#include <stdint.h>
+
+// RETROS native boot image (tools/mkimage.py)
+// One header block with a segment table, followed by the segment data.
+// Each segment is stored from a block boundary, in table order, so the
+// loader reads them with multi-block transfers straight to their load
+// addresses. Segments with no stored data (bss) are only zero filled.
+// All fields are little-endian.
+
+#define RIMG_MAGIC          0x474D4952  // "RIMG"
+#define RIMG_VERSION        1
+#define RIMG_HEADER_SIZE    512
+#define RIMG_MAX_SEGMENTS   15
+
+// Segment compression
+#define RIMG_COMP_NONE      0
+#define RIMG_COMP_LZ4       1
+#define RIMG_COMP_GZIP      2
+
+// Segment flags
+#define RIMG_SEG_EXEC       0x01        // Contains code
+
+typedef struct {
+    uint32_t offset;            // From the start of the image, block aligned
+    uint32_t file_size;         // Bytes stored (0 for zero-filled segments)
+    uint32_t load_addr;
+    uint32_t mem_size;          // Bytes at load_addr; beyond the data is zeroed
+    uint8_t compression;        // RIMG_COMP_*
+    uint8_t reserved[3];
+    uint32_t crc;               // CRC-32 of the stored bytes
+    uint32_t flags;             // RIMG_SEG_*
+    uint32_t reserved2;
+} __attribute__((packed)) rimg_segment_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // RIMG_HEADER_SIZE
+    uint32_t entry;
+    uint32_t flags;             // Reserved, 0
+    uint32_t segment_count;
+    uint32_t header_crc;        // CRC-32 of the header with this field 0
+    uint32_t reserved[2];
+    rimg_segment_t segments[RIMG_MAX_SEGMENTS];
+} __attribute__((packed)) rimg_header_t;
+
+#endif // RIMG_H
@@ -0,0 +1,84 @@
+#ifndef SERIAL_LOAD_H
+#define SERIAL_LOAD_H
+
+#include <stdint.h>
+
+// Serial image loading (tools/serial_load.py is the sender)
+// The host sends packets: a 16-byte header (magic, type, payload length,
+// image offset, CRC-32 of header and payload) and up to
+// SERIAL_CHUNK_MAX bytes of payload. A HEADER packet names the load
+// address, size, image CRC and entry point; DATA packets carry the image
+// in order, each landing straight at its load address; DONE asks for the
+// whole image to be checked.
+//
+// Every packet is answered with a 12-byte reply (magic, code, offset).
+// The sender keeps a window of DATA packets in flight; ACKs are
+// cumulative (the offset is the next byte wanted), and a damaged or out
+// of order packet gets one NAK with that offset, after which the BIOS
+// drops packets until the sender goes back to it. Whenever the line has
+// been quiet for a second the BIOS sends READY.
+//
+// A transfer that stops part way is resumed by sending the same HEADER
+// again (same address, size and CRC): the ACK says where to carry on.
+
+#define SERIAL_PACKET_MAGIC 0x504C5352  // "RSLP"
+#define SERIAL_REPLY_MAGIC  0x414C5352  // "RSLA"
+#define SERIAL_CHUNK_MAX    4096
+
+// Packet types
+#define SERIAL_PKT_HEADER   1
+#define SERIAL_PKT_DATA     2
+#define SERIAL_PKT_DONE     3
+
+// Reply codes
+#define SERIAL_REPLY_ACK    0
+#define SERIAL_REPLY_NAK    1
+#define SERIAL_REPLY_ERROR  2           // Offset field holds the error code
+#define SERIAL_REPLY_READY  3
+
+// Header flags
+#define SERIAL_FLAG_RUN     0x01        // Jump to the entry point when done
+
+// Timeouts
+#define SERIAL_IDLE_TIMEOUT_US  60000000    // Nothing at all received
+#define SERIAL_BYTE_TIMEOUT_US  200000      // Gap inside a packet
+
+// Errors
+#define SERIAL_ERR_ABORT    -192        // Ctrl-C or idle timeout
+#define SERIAL_ERR_RANGE    -193        // Image outside the load area
+#define SERIAL_ERR_CHECK    -194        // Whole-image CRC mismatch
+
+typedef struct {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t len;                       // Payload bytes
+    uint32_t offset;                    // DATA: where the payload goes
+    uint32_t crc;                       // Over the header up to here, then the payload
+} serial_packet_t;
+
+typedef struct {                        // HEADER payload
+    uint32_t load_addr;
+    uint32_t size;
+    uint32_t crc;                       // CRC-32 of the whole image
+    uint32_t entry;                     // 0: load_addr
+    uint32_t flags;                     // SERIAL_FLAG_*
+} serial_header_t;
+
+typedef struct {
+    serial_header_t image;
+    uint32_t resumed_at;                // Offset the transfer started from
+    uint32_t packets;
+    uint32_t naks;
+    uint64_t us;                        // HEADER to DONE
+} serial_load_info_t;
+
+// Receive an image into [base, base + max). Returns 0 with *info filled
+// in once the whole image has arrived and checked out, or a negative
+// error (SERIAL_ERR_*).
+int serial_load(uint32_t base, uint32_t max, serial_load_info_t *info);
+
+// Short description of an error code
+const char *serial_strerror(int err);
+
+#endif // SERIAL_LOAD_H
@@ -0,0 +1,27 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+
+// SHA-256 (FIPS 180-4), streaming. Rounds are fully unrolled; on cores
+// with NEON (BCM2836/7) the message schedule is expanded four words at a
+// time in vector registers.
+
+#define SHA256_DIGEST_SIZE  32
+#define SHA256_BLOCK_SIZE   64
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;            // Bytes hashed so far
+    uint8_t buffer[SHA256_BLOCK_SIZE];
+    uint32_t used;              // Bytes waiting in buffer
+} sha256_ctx_t;
+
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, const void *data, uint32_t len);
+void sha256_final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// One-shot digest
+void sha256(const void *data, uint32_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#endif // SHA256_H
@@ -0,0 +1,23 @@
+#ifndef SHA512_H
+#define SHA512_H
+
+#include <stdint.h>
+
+// SHA-512 (FIPS 180-4), streaming. Only used on short messages (the
+// Ed25519 challenge), so it favors size over speed.
+
+#define SHA512_DIGEST_SIZE  64
+#define SHA512_BLOCK_SIZE   128
+
+typedef struct {
+    uint64_t state[8];
+    uint64_t length;            // Bytes hashed so far
+    uint8_t buffer[SHA512_BLOCK_SIZE];
+    uint32_t used;
+} sha512_ctx_t;
+
+void sha512_init(sha512_ctx_t *ctx);
+void sha512_update(sha512_ctx_t *ctx, const void *data, uint32_t len);
+void sha512_final(sha512_ctx_t *ctx, uint8_t digest[SHA512_DIGEST_SIZE]);
+
+#endif // SHA512_H
@@ -0,0 +1,51 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <stdint.h>
+
+// Command interpreter for the emergency shell
+// A line is split into words at spaces and the first word is looked up in
+// the caller's command table, then among the built-in tools. Typing is
+// edited in place: backspace, Ctrl-U clears the line and Ctrl-C drops it;
+// Up and Down step through the last SHELL_HISTORY lines, and Tab
+// completes a command name (twice at an ambiguous prefix lists them).
+//
+// Built-in tools (numbers are decimal or 0x hex):
+//   md[.b|.w|.l] [addr] [count]      Dump memory; without an address it
+//                                    carries on after the last dump
+//   mw[.b|.w|.l] addr value [count]  Write (fill) memory
+//   sd lba [count]                   Dump SD card blocks
+//   crc addr len                     CRC-32 of a memory range
+//   time command ...                 Run a command and time it
+//   help                             List every command
+// .b, .w and .l select 8, 16 and 32-bit accesses (default .l). Dumps go
+// out a line at a time and stop at Ctrl-C. VERIFIED_BOOT builds have no mw.
+
+#define SHELL_LINE_MAX  80
+#define SHELL_MAX_ARGS  8
+#define SHELL_HISTORY   16
+
+// Errors
+#define SHELL_ERR_USAGE     -208        // Bad arguments; the usage line is shown
+#define SHELL_ERR_UNKNOWN   -209        // No such command
+
+typedef struct {
+    const char *name;
+    const char *args;                   // Usage after the name, e.g. "<file> [file]"
+    const char *help;                   // One line
+    int (*run)(int argc, char **argv);  // 0, or SHELL_ERR_USAGE
+} shell_command_t;
+
+// Read and run commands on the UART for good
+void shell_run(const shell_command_t *commands, uint32_t count) __attribute__((noreturn));
+
+// Run a line as if it had been typed (splits it in place)
+int shell_execute(char *line);
+
+// Decimal or 0x-prefixed hex; returns 1 if the whole string was a number
+int shell_parse_uint(const char *s, uint32_t *value);
+
+// Built-in tools, for listing
+const shell_command_t *shell_builtins(uint32_t *count);
+
+#endif // SHELL_H
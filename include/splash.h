@@ -0,0 +1,80 @@
+#ifndef SPLASH_H
+#define SPLASH_H
+
+#include <stdint.h>
+#include "fat.h"
+
+// RETROS splash image format (little-endian)
+//
+//   0  'R' 'S' 'P' 'L'
+//   4  uint16 version (SPLASH_VERSION)
+//   6  uint16 flags (reserved, 0)
+//   8  uint16 width
+//  10  uint16 height
+//  12  uint16 palette entry count (1..256)
+//  14  uint16 reserved
+//  16  uint32 palette[count]  (0x00RRGGBB)
+//  ..  pixel index stream, row-major, runs may cross rows:
+//        0x00-0x7F  literal: (n + 1) index bytes follow
+//        0x80-0xBF  short run: next byte repeated (n & 0x3F) + 2 times
+//        0xC0-0xFF  long run: count = ((n & 0x3F) << 8 | next) + 2,
+//                   then the index byte
+//
+// Images are produced from PNG files by tools/png2splash.py.
+
+#define SPLASH_MAGIC        0x4C505352  // "RSPL"
+#define SPLASH_VERSION      1
+#define SPLASH_HEADER_SIZE  16
+#define SPLASH_MAX_COLORS   256
+
+// Input window size; the decoder never holds more than this of the stream
+#define SPLASH_WINDOW_SIZE  512
+
+// Error codes
+#define SPLASH_OK            0
+#define SPLASH_ERR_IO       -1  // Reader failed or stream ended early
+#define SPLASH_ERR_FORMAT   -2  // Bad magic, version or encoding
+#define SPLASH_ERR_BUDGET   -3  // Time budget exhausted (image partial)
+
+// Streaming input: fill up to max bytes into buf, return count (0 = end)
+typedef int (*splash_fill_fn)(void *ctx, uint8_t *buf, uint32_t max);
+
+typedef struct {
+    splash_fill_fn fill;
+    void *ctx;
+} splash_reader_t;
+
+// Destination surface (the framebuffer or a shadow buffer)
+typedef struct {
+    uint32_t *base;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;    // In pixels
+} splash_surface_t;
+
+// Decode an image centered on the surface. budget_us bounds the decode
+// time (0 = unlimited). Memory use is fixed: one input window plus the
+// palette, independent of image size.
+int splash_decode(const splash_reader_t *reader, const splash_surface_t *surface,
+                  uint32_t budget_us);
+
+// Image embedded at build time (make SPLASH=file.png); both symbols are
+// weak and resolve to 0 when no splash was embedded
+extern const uint8_t splash_image[] __attribute__((weak));
+extern const uint32_t splash_image_size __attribute__((weak));
+
+// Default decode budget for the boot splash
+#define SPLASH_BUDGET_US 100000
+
+// Splash file on the boot volume, used in place of the embedded image
+// (the "splash" setting names another)
+#define SPLASH_PATH "/splash.rspl"
+
+// Decode an image embedded in memory (e.g. rodata) onto the framebuffer
+int splash_draw_mem(const uint8_t *data, uint32_t size, uint32_t budget_us);
+
+// Decode an image from an open file (e.g. on the SD card) onto the
+// framebuffer, reading it one window at a time
+int splash_draw_file(fat_file_t *file, uint32_t budget_us);
+
+#endif // SPLASH_H
@@ -0,0 +1,48 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+
+// Pull-based byte input for the streaming decoders. The owner hands out
+// one chunk at a time through fill(); a chunk stays valid until fill() is
+// called again, so decoders copy straight out of the I/O buffers.
+
+// Error codes shared by the decoders
+#define STREAM_ERR_EOF      -80  // Input ended inside the stream
+#define STREAM_ERR_FORMAT   -81  // Bad magic, header or encoding
+#define STREAM_ERR_OVERFLOW -82  // Output does not fit the destination
+#define STREAM_ERR_CHECK    -83  // Length or checksum mismatch
+
+typedef struct stream {
+    const uint8_t *ptr;         // Next unread byte of the current chunk
+    const uint8_t *end;
+    // Replace the chunk; returns its length, 0 at end of input or < 0
+    int (*fill)(struct stream *s);
+    void *ctx;
+} stream_t;
+
+// Make at least one byte available; returns 0, STREAM_ERR_EOF or an I/O error
+static inline int stream_need(stream_t *s) {
+    while (s->ptr == s->end) {
+        int n = s->fill(s);
+        if (n <= 0) return n < 0 ? n : STREAM_ERR_EOF;
+    }
+    return 0;
+}
+
+// Next byte (0-255), or a negative error
+static inline int stream_byte(stream_t *s) {
+    int rc = stream_need(s);
+    return rc ? rc : *s->ptr++;
+}
+
+// Copy len bytes into dst; returns 0 or a negative error
+int stream_read(stream_t *s, uint8_t *dst, uint32_t len);
+
+// Discard len bytes; returns 0 or a negative error
+int stream_skip(stream_t *s, uint32_t len);
+
+// Read a little-endian 32-bit value; returns 0 or a negative error
+int stream_le32(stream_t *s, uint32_t *value);
+
+#endif // STREAM_H
@@ -21,4 +21,7 @@ void timer_set_interval(uint32_t microseconds);
 // Get elapsed time since boot in microseconds
 uint64_t timer_get_uptime_us(void);
 
+// CPU cycle counter (PMU), started by timer_init; wraps every 2^32 cycles
+uint32_t timer_get_cycles(void);
+
 #endif // TIMER_H
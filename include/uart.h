@@ -1,24 +1,106 @@
 #ifndef UART_H
 #define UART_H
 
+#include <stdarg.h>
 #include <stdint.h>
 
-// Initialize UART for debugging
+// Output and input go through rings serviced by the UART interrupt, so
+// printing never waits for the line: the TX ring is refilled into the
+// FIFO whenever it drains to 1/8, and receive and receive-timeout
+// interrupts empty the RX FIFO into the RX ring. When a ring is full the
+// byte is dropped and counted, unless blocking output is turned on.
+
+#define UART_TX_RING    8192        // Bytes; powers of two
+#define UART_RX_RING    8192        // A whole serial load DATA packet (4 KB + header)
+#define UART_PRINTF_MAX 256         // Longer uart_printf output is cut
+
+typedef struct {
+    uint32_t tx_dropped;            // Output lost to a full TX ring
+    uint32_t rx_dropped;            // Input lost to a full RX ring
+    uint32_t rx_overruns;           // Input lost in the hardware FIFO
+} uart_stats_t;
+
+// Initialize UART for debugging and register its interrupt (after
+// irq_init; the rings are serviced once IRQs are enabled at the CPU)
 void uart_init(void);
 
+// UART reference clock: asked of the firmware at init, UART_CLOCK_HZ if
+// it does not say. Rates over clock / 16 raise it to UART_CLOCK_MAX_HZ.
+#define UART_CLOCK_HZ       3000000
+#define UART_CLOCK_MAX_HZ   48000000
+#define UART_BAUD_MAX       (UART_CLOCK_MAX_HZ / 16)
+#define UART_BAUD_TOLERANCE 25      // Per mille, for the divisor and loopback
+
+// Errors
+#define UART_ERR_BAUD       -176    // Rate not within tolerance of the clock
+#define UART_ERR_LOOPBACK   -177    // Loopback data lost or rate off
+
+// Change the baud rate once pending output has drained. Returns 0, or
+// UART_ERR_BAUD (leaving the rate alone) if no divisor comes close enough.
+int uart_set_baud(uint32_t baud);
+
+// Rate produced by the current divisor, and the clock it divides
+uint32_t uart_get_baud(void);
+uint32_t uart_get_clock(void);
+
+// Send a test pattern through the UART's internal loopback at the current
+// rate and time it; *measured gets the rate seen. Returns 0 or
+// UART_ERR_LOOPBACK. Nothing goes out on the line.
+int uart_loopback_test(uint32_t *measured);
+
+// Short description of an error code
+const char *uart_strerror(int err);
+
 // Send a single character
 void uart_putc(char c);
 
 // Send a string
 void uart_puts(const char *str);
 
+// Queue a character without ever waiting; -1 if the TX ring is full
+int uart_try_putc(char c);
+
 // Receive a character (blocking)
 char uart_getc(void);
 
+// Next received character, or -1 if none has arrived
+int uart_try_getc(void);
+
+// Copy up to len received bytes without waiting; returns how many
+uint32_t uart_read(void *buffer, uint32_t len);
+
 // Check if data is available
 int uart_data_available(void);
 
-// Printf-like function for debugging
+// Received byte n places from the front (0: the next one) without taking
+// it, or -1 if fewer have arrived. Before the interrupt is set up only the
+// next byte can be seen.
+int uart_peek(uint32_t n);
+
+// Take the received byte n places from the front out of the input, leaving
+// the others queued in order; n as for uart_peek
+void uart_remove(uint32_t n);
+
+// Formatted output (see format.h), queued as one string
 void uart_printf(const char *fmt, ...);
+void uart_vprintf(const char *fmt, va_list args);
+
+// Wait for a full TX ring to drain instead of dropping output (for
+// interactive use; the boot path keeps this off)
+void uart_set_blocking(int on);
+
+// Send everything queued and wait until the line is idle
+void uart_flush(void);
+
+// Synchronous output for panic paths: drains the ring, then writes the
+// string with IRQs blocked
+void uart_puts_sync(const char *str);
+
+// Flush and go back to polled I/O with the interrupt masked, before
+// handing the UART to a kernel
+void uart_shutdown(void);
+
+// Dropped-byte counters
+const uart_stats_t *uart_get_stats(void);
 
 #endif // UART_H
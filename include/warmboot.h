@@ -0,0 +1,68 @@
+#ifndef WARMBOOT_H
+#define WARMBOOT_H
+
+#include <stdint.h>
+#include "loader.h"
+
+// Warm reboot
+// A watchdog reset leaves RAM alone, so before jumping to a kernel the
+// BIOS keeps a copy of the loaded image and the settings handed to it in
+// a reserved region, described by a checksummed block. The next boot
+// finds the block, checks the copy against its CRC-32 and jumps straight
+// back in: no SD card, no reload, no boot screen. After a power cycle the
+// block no longer checks out and the boot is cold.
+//
+// The kernel must leave the block and the cache untouched; clearing the
+// block's magic makes the next boot cold.
+
+#define WARMBOOT_BLOCK_ADDR 0x08004000  // Just past the config handoff
+#define WARMBOOT_CACHE_ADDR 0x08010000
+#define WARMBOOT_CACHE_MAX  0x01FF0000  // Cache ends at 0x0A000000
+#define WARMBOOT_MAGIC      0x4D524157  // "WARM"
+#define WARMBOOT_NAME_MAX   32
+
+// Errors
+#define WARMBOOT_ERR_TOOBIG  -144   // Image and handoff exceed the cache
+#define WARMBOOT_ERR_CHANGED -145   // Block intact but the cached copy is not
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;              // sizeof(warmboot_block_t)
+    uint32_t load_addr;         // Image: where it runs and its size; the
+    uint32_t image_size;        // cache holds the image, then the handoff
+    uint32_t image_crc;         // CRC-32 of the cached image and handoff
+    uint32_t entry;
+    uint32_t handoff_addr;      // Config handoff (0: none) and its size
+    uint32_t handoff_size;
+    int32_t sig;                // LOADER_SIG_* when it was loaded
+    uint32_t warm_boots;        // Since the last cold boot
+    uint32_t cold_us;           // Reset to jump on the cold boot
+    uint32_t cold_bios_us;      // Of which spent in the BIOS
+    char name[WARMBOOT_NAME_MAX];
+    uint32_t crc;               // CRC-32 of the block, this field 0
+} warmboot_block_t;
+
+// Cache the image just loaded at load_addr (up to st->top) and the
+// config handoff for the next warm boot; bios_us is the time since the
+// BIOS started. Returns 0 or WARMBOOT_ERR_TOOBIG.
+int warmboot_save(uint32_t load_addr, const loader_stats_t *st, uint32_t handoff_addr,
+                  uint32_t handoff_size, const char *name, uint32_t bios_us);
+
+// Check the block left by the previous boot and its cached copy: 1 if a
+// warm boot is possible, 0 if there is no block, or WARMBOOT_ERR_CHANGED
+int warmboot_find(void);
+
+// Copy the cached image and handoff back into place and count the warm
+// boot; returns the block, whose fields say where to jump
+const warmboot_block_t *warmboot_restore(void);
+
+// Make the next boot cold
+void warmboot_invalidate(void);
+
+// Reset the SoC through the PM watchdog; RAM keeps its contents
+void warmboot_reset(void) __attribute__((noreturn));
+
+// Short description of an error code
+const char *warmboot_strerror(int err);
+
+#endif // WARMBOOT_H
@@ -0,0 +1,218 @@
+#include "anim.h"
+#include "framebuffer.h"
+#include "timer.h"
+#include "uart.h"
+
+// Text animation engine
+// Jobs carry their own start time and rate, so a late tick simply catches
+// up by drawing every character that has become due since the last one.
+
+#define ANIM_BG 0x00000000
+#define ANIM_SKIP_SCAN 16   // Pending input bytes searched for a skip key
+
+typedef enum {
+    JOB_FREE = 0,
+    JOB_TYPE,
+    JOB_CURSOR
+} anim_job_type_t;
+
+typedef struct {
+    anim_job_type_t type;
+    uint32_t x;             // Line origin (for '\n')
+    uint32_t cx, cy;        // Next character cell
+    const char *text;       // Remaining text (JOB_TYPE)
+    uint32_t color;
+    uint64_t start_us;      // When the job becomes active
+    uint64_t end_us;        // When a cursor job expires
+    uint32_t rate_us;       // Microseconds per character
+    uint32_t drawn;         // Characters emitted so far
+    int cursor_on;          // Cursor currently drawn at (cx, cy)
+} anim_job_t;
+
+static anim_job_t jobs[ANIM_MAX_JOBS];
+static int skip_requested = 0;
+
+static void anim_set_cursor(anim_job_t *job, int on) {
+    if (job->cursor_on == on) return;
+    fb_draw_char(job->cx, job->cy, on ? '_' : ' ', job->color, ANIM_BG);
+    job->cursor_on = on;
+}
+
+// Emit one character of a typing job; returns 0 at end of text
+static int anim_emit_char(anim_job_t *job) {
+    char c = *job->text;
+    if (!c) return 0;
+
+    // The glyph (or newline) replaces whatever cursor was drawn here
+    if (job->cursor_on) {
+        if (c == '\n') fb_draw_char(job->cx, job->cy, ' ', job->color, ANIM_BG);
+        job->cursor_on = 0;
+    }
+
+    if (c == '\n') {
+        job->cx = job->x;
+        job->cy += 16;
+    } else {
+        fb_draw_char(job->cx, job->cy, c, job->color, ANIM_BG);
+        job->cx += 8;
+    }
+    job->text++;
+    job->drawn++;
+    return 1;
+}
+
+static void anim_finish_job(anim_job_t *job) {
+    if (job->type == JOB_TYPE) {
+        while (anim_emit_char(job)) { }
+    }
+    anim_set_cursor(job, 0);
+    job->type = JOB_FREE;
+}
+
+static anim_job_t *anim_alloc(void) {
+    for (int i = 0; i < ANIM_MAX_JOBS; i++) {
+        if (jobs[i].type == JOB_FREE) {
+            return &jobs[i];
+        }
+    }
+    return 0;
+}
+
+void anim_init(void) {
+    for (int i = 0; i < ANIM_MAX_JOBS; i++) {
+        jobs[i].type = JOB_FREE;
+    }
+    skip_requested = 0;
+}
+
+int anim_type_text_rate(uint32_t x, uint32_t y, const char *msg, uint32_t color,
+                        uint32_t delay_us, uint32_t rate_us) {
+    // Mirror the whole line to UART up front instead of per glyph
+    uart_puts(msg);
+    uart_puts("\n");
+
+    anim_job_t *job = skip_requested ? 0 : anim_alloc();
+    if (!job) {
+        fb_draw_string(x, y, msg, color, ANIM_BG);
+        return -1;
+    }
+
+    job->type = JOB_TYPE;
+    job->x = x;
+    job->cx = x;
+    job->cy = y;
+    job->text = msg;
+    job->color = color;
+    job->start_us = timer_get_uptime_us() + delay_us;
+    job->end_us = 0;
+    job->rate_us = rate_us;
+    job->drawn = 0;
+    job->cursor_on = 0;
+
+    return (int)(job - jobs);
+}
+
+int anim_type_text(uint32_t x, uint32_t y, const char *msg, uint32_t color,
+                   uint32_t delay_us) {
+    return anim_type_text_rate(x, y, msg, color, delay_us, ANIM_TYPE_RATE_US);
+}
+
+int anim_cursor(uint32_t x, uint32_t y, uint32_t color, uint32_t duration_us) {
+    anim_job_t *job = skip_requested ? 0 : anim_alloc();
+    if (!job) return -1;
+
+    uint64_t now = timer_get_uptime_us();
+    job->type = JOB_CURSOR;
+    job->x = x;
+    job->cx = x;
+    job->cy = y;
+    job->text = 0;
+    job->color = color;
+    job->start_us = now;
+    job->end_us = now + duration_us;
+    job->rate_us = ANIM_CURSOR_BLINK_US;
+    job->drawn = 0;
+    job->cursor_on = 0;
+
+    return (int)(job - jobs);
+}
+
+// Look through the input that has arrived for a skip key and take it out
+// wherever it sits; other keys stay queued in order for their owner (e.g.
+// 'D' for diagnostics, arrow keys for the menu). An ESC followed by '[' is
+// the start of an arrow key sequence, not a skip.
+static void anim_poll_skip_key(void) {
+    if (skip_requested) return;
+
+    for (uint32_t i = 0; i < ANIM_SKIP_SCAN; i++) {
+        int c = uart_peek(i);
+        if (c < 0) return;
+        if (c == ANIM_SKIP_KEY_ESC && uart_peek(i + 1) == '[') continue;
+        if (c == ANIM_SKIP_KEY || c == ANIM_SKIP_KEY_ESC) {
+            uart_remove(i);
+            anim_skip();
+            return;
+        }
+    }
+}
+
+void anim_tick(void) {
+    anim_poll_skip_key();
+
+    uint64_t now = timer_get_uptime_us();
+
+    for (int i = 0; i < ANIM_MAX_JOBS; i++) {
+        anim_job_t *job = &jobs[i];
+        if (job->type == JOB_FREE || now < job->start_us) continue;
+
+        uint32_t elapsed = (uint32_t)(now - job->start_us);
+        int blink_on = ((elapsed / ANIM_CURSOR_BLINK_US) & 1) == 0;
+
+        if (job->type == JOB_TYPE) {
+            uint32_t due = job->rate_us ? elapsed / job->rate_us + 1 : 0xFFFFFFFF;
+            while (job->drawn < due && anim_emit_char(job)) { }
+            if (!*job->text) {
+                anim_finish_job(job);
+                continue;
+            }
+        } else if (now >= job->end_us) {
+            anim_finish_job(job);
+            continue;
+        }
+
+        anim_set_cursor(job, blink_on);
+    }
+}
+
+void anim_skip(void) {
+    skip_requested = 1;
+    for (int i = 0; i < ANIM_MAX_JOBS; i++) {
+        if (jobs[i].type != JOB_FREE) {
+            anim_finish_job(&jobs[i]);
+        }
+    }
+}
+
+int anim_busy(void) {
+    for (int i = 0; i < ANIM_MAX_JOBS; i++) {
+        if (jobs[i].type != JOB_FREE) return 1;
+    }
+    return 0;
+}
+
+int anim_skipped(void) {
+    return skip_requested;
+}
+
+void anim_delay_ms(uint32_t milliseconds) {
+    uint64_t deadline = timer_get_uptime_us() + (uint64_t)milliseconds * 1000;
+    while (!skip_requested && timer_get_uptime_us() < deadline) {
+        anim_tick();
+    }
+}
+
+void anim_sync(void) {
+    while (anim_busy()) {
+        anim_tick();
+    }
+}
@@ -0,0 +1,264 @@
+#include "bcache.h"
+#include "bio.h"
+#include "mmc.h"
+#include "memory.h"
+
+// Block cache
+// Entries live on a hash chain (by LBA) and, unless pinned, on an LRU
+// list with the most recently used entry at the head. Free entries sit at
+// the tail, so allocation always takes the LRU tail.
+
+#define BCACHE_NO_LBA 0xFFFFFFFF
+
+typedef struct bcache_entry {
+    uint32_t lba;               // Absolute LBA, BCACHE_NO_LBA if free
+    uint32_t pins;
+    uint8_t *data;
+    struct bcache_entry *hash_next;
+    struct bcache_entry *lru_prev;
+    struct bcache_entry *lru_next;
+} bcache_entry_t;
+
+static bcache_entry_t *entries;
+static bcache_entry_t **buckets;
+static uint8_t *data_raw;
+static uint8_t *data_base;
+static uint32_t num_buckets;
+static bcache_entry_t *lru_head;
+static bcache_entry_t *lru_tail;
+static bcache_stats_t stats;
+
+static uint32_t bcache_hash(uint32_t lba) {
+    return (lba * 2654435761u) & (num_buckets - 1);
+}
+
+static void lru_unlink(bcache_entry_t *e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next; else lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev; else lru_tail = e->lru_prev;
+    e->lru_prev = 0;
+    e->lru_next = 0;
+}
+
+static void lru_push_head(bcache_entry_t *e) {
+    e->lru_prev = 0;
+    e->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = e; else lru_tail = e;
+    lru_head = e;
+}
+
+static void lru_push_tail(bcache_entry_t *e) {
+    e->lru_next = 0;
+    e->lru_prev = lru_tail;
+    if (lru_tail) lru_tail->lru_next = e; else lru_head = e;
+    lru_tail = e;
+}
+
+static bcache_entry_t *bcache_lookup(uint32_t lba) {
+    if (!buckets) return 0;
+    for (bcache_entry_t *e = buckets[bcache_hash(lba)]; e; e = e->hash_next) {
+        if (e->lba == lba) return e;
+    }
+    return 0;
+}
+
+static void hash_remove(bcache_entry_t *e) {
+    bcache_entry_t **link = &buckets[bcache_hash(e->lba)];
+    while (*link && *link != e) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) *link = e->hash_next;
+    e->hash_next = 0;
+}
+
+// Mark an entry most recently used
+static void bcache_touch(bcache_entry_t *e) {
+    if (e->pins == 0) {
+        lru_unlink(e);
+        lru_push_head(e);
+    }
+}
+
+// Take the least recently used unpinned entry for lba (not yet filled)
+static bcache_entry_t *bcache_alloc(uint32_t lba) {
+    bcache_entry_t *e = lru_tail;
+    if (!e) return 0;
+
+    if (e->lba != BCACHE_NO_LBA) {
+        hash_remove(e);
+        stats.evictions++;
+    } else {
+        stats.used++;
+    }
+
+    e->lba = lba;
+    uint32_t h = bcache_hash(lba);
+    e->hash_next = buckets[h];
+    buckets[h] = e;
+    bcache_touch(e);
+    return e;
+}
+
+static void bcache_free_entry(bcache_entry_t *e) {
+    hash_remove(e);
+    e->lba = BCACHE_NO_LBA;
+    lru_unlink(e);
+    lru_push_tail(e);
+    stats.used--;
+}
+
+static void bcache_release(void) {
+    free(entries);
+    free(buckets);
+    free(data_raw);
+    entries = 0;
+    buckets = 0;
+    data_raw = 0;
+}
+
+int bcache_init(uint32_t count) {
+    bcache_release();
+    memset(&stats, 0, sizeof(stats));
+    lru_head = 0;
+    lru_tail = 0;
+
+    if (count == 0) count = BCACHE_DEFAULT_ENTRIES;
+    if (count > BCACHE_MAX_ENTRIES) count = BCACHE_MAX_ENTRIES;
+
+    num_buckets = 1;
+    while (num_buckets < count) num_buckets <<= 1;
+
+    entries = malloc(count * sizeof(bcache_entry_t));
+    buckets = malloc(num_buckets * sizeof(bcache_entry_t *));
+    data_raw = malloc(count * 512 + MMC_DMA_ALIGN);
+    if (!entries || !buckets || !data_raw) {
+        bcache_release();
+        return BCACHE_ERR_NOMEM;
+    }
+
+    // Block data is DMA aligned so misses land straight in the entry
+    data_base = (uint8_t *)(((uint32_t)data_raw + MMC_DMA_ALIGN - 1) & ~(MMC_DMA_ALIGN - 1));
+    memset(buckets, 0, num_buckets * sizeof(bcache_entry_t *));
+    for (uint32_t i = 0; i < count; i++) {
+        entries[i].lba = BCACHE_NO_LBA;
+        entries[i].pins = 0;
+        entries[i].data = data_base + i * 512;
+        entries[i].hash_next = 0;
+        lru_push_tail(&entries[i]);
+    }
+
+    stats.entries = count;
+    return BLK_OK;
+}
+
+// Read one block into a new entry
+static bcache_entry_t *bcache_fill(blockdev_t *dev, uint32_t lba, int *rc) {
+    bcache_entry_t *e = bcache_alloc(dev->start + lba);
+    if (!e) {
+        *rc = BCACHE_ERR_FULL;
+        return 0;
+    }
+
+    *rc = blockdev_read(dev, lba, 1, e->data);
+    if (*rc != BLK_OK) {
+        bcache_free_entry(e);
+        return 0;
+    }
+    stats.misses++;
+    return e;
+}
+
+int bcache_read(blockdev_t *dev, uint32_t lba, uint32_t count, uint8_t *buffer,
+                uint32_t flags) {
+    if (!dev) return BLK_ERR_NODEV;
+    if (lba > dev->num_blocks || count > dev->num_blocks - lba) return BLK_ERR_RANGE;
+
+    if (!entries || (flags & BCACHE_BYPASS)) {
+        // Write-through keeps the device current, so it can be read directly
+        stats.bypass += count;
+        return blockdev_read(dev, lba, count, buffer);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        bcache_entry_t *e = bcache_lookup(dev->start + lba + i);
+        if (e) {
+            stats.hits++;
+            bcache_touch(e);
+        } else {
+            int rc;
+            e = bcache_fill(dev, lba + i, &rc);
+            if (!e) return rc;
+        }
+        memcpy(buffer + i * 512, e->data, 512);
+    }
+    return BLK_OK;
+}
+
+int bcache_write(blockdev_t *dev, uint32_t lba, uint32_t count, const uint8_t *buffer) {
+    int rc = blockdev_write(dev, lba, count, buffer);
+    if (rc != BLK_OK) {
+        // Cached copies may no longer match the card
+        for (uint32_t i = 0; i < count; i++) {
+            bcache_entry_t *e = bcache_lookup(dev->start + lba + i);
+            if (e && e->pins == 0) bcache_free_entry(e);
+        }
+        bio_invalidate();
+        return rc;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        bcache_entry_t *e = bcache_lookup(dev->start + lba + i);
+        if (e) {
+            memcpy(e->data, buffer + i * 512, 512);
+            bcache_touch(e);
+        }
+    }
+    stats.writes += count;
+    bio_invalidate();
+    return BLK_OK;
+}
+
+const uint8_t *bcache_pin(blockdev_t *dev, uint32_t lba) {
+    if (!entries || !dev || lba >= dev->num_blocks) return 0;
+
+    bcache_entry_t *e = bcache_lookup(dev->start + lba);
+    if (e) {
+        stats.hits++;
+        bcache_touch(e);
+    } else {
+        int rc;
+        e = bcache_fill(dev, lba, &rc);
+        if (!e) return 0;
+    }
+
+    if (e->pins++ == 0) {
+        lru_unlink(e);
+        stats.pinned++;
+    }
+    return e->data;
+}
+
+void bcache_unpin(const uint8_t *data) {
+    if (!entries || data < data_base) return;
+
+    uint32_t index = (uint32_t)(data - data_base) / 512;
+    if (index >= stats.entries) return;
+
+    bcache_entry_t *e = &entries[index];
+    if (e->pins && --e->pins == 0) {
+        lru_push_head(e);
+        stats.pinned--;
+    }
+}
+
+void bcache_invalidate(void) {
+    if (!entries) return;
+    for (uint32_t i = 0; i < stats.entries; i++) {
+        if (entries[i].lba != BCACHE_NO_LBA && entries[i].pins == 0) {
+            bcache_free_entry(&entries[i]);
+        }
+    }
+}
+
+const bcache_stats_t *bcache_get_stats(void) {
+    return &stats;
+}
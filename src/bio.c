@@ -0,0 +1,295 @@
+#include "bio.h"
+#include "mmc.h"
+#include "memory.h"
+#include "timer.h"
+
+// Block I/O request queue
+// One card command is in flight at a time. When it completes the next one
+// is built from the head of the queue plus every queued request that
+// continues it, each landing in its own DMA segment, so no copies are
+// made. All devices are windows onto the SD card (see blockdev.c), which
+// lets requests on different partitions merge by absolute LBA.
+
+static bio_t *queue_head;
+static bio_t *queue_tail;
+
+// Command in flight
+static bio_t *active[MMC_MAX_SEGMENTS];
+static uint32_t active_count;
+static int in_flight;
+static uint64_t command_start;
+static uint64_t idle_since;
+
+// Read-ahead window (absolute LBAs)
+static uint8_t ra_buffer[BIO_READAHEAD_MAX * 512] __attribute__((aligned(MMC_DMA_ALIGN)));
+static uint32_t ra_lba;
+static uint32_t ra_count;
+static int ra_valid;
+static int ra_loading;
+static uint32_t ra_blocks = BIO_READAHEAD_DEFAULT;
+
+// End of the last demand read, for sequential stream detection
+static uint32_t stream_end = 0xFFFFFFFF;
+
+static bio_stats_t stats;
+
+void bio_init(void) {
+    mmc_async_wait();
+    queue_head = 0;
+    queue_tail = 0;
+    active_count = 0;
+    in_flight = 0;
+    ra_valid = 0;
+    ra_loading = 0;
+    stream_end = 0xFFFFFFFF;
+    memset(&stats, 0, sizeof(stats));
+    idle_since = timer_get_ticks();
+}
+
+static uint32_t bio_abs(const bio_t *bio) {
+    return bio->dev->start + bio->lba;
+}
+
+static void bio_complete(bio_t *bio, int status) {
+    bio->status = status;
+    stats.completed++;
+    stats.depth--;
+    if (bio->done) {
+        bio->done(bio);
+    }
+}
+
+// Serve a request from the read-ahead window if it lies entirely inside
+static int bio_try_readahead(bio_t *bio) {
+    uint32_t lba = bio_abs(bio);
+    if (!ra_valid || lba < ra_lba || lba - ra_lba + bio->count > ra_count) {
+        return 0;
+    }
+
+    memcpy(bio->buffer, ra_buffer + (lba - ra_lba) * 512, bio->count * 512);
+    stream_end = lba + bio->count;
+    stats.ra_hits++;
+    bio_complete(bio, BLK_OK);
+    return 1;
+}
+
+static void bio_unlink(bio_t *prev, bio_t *bio) {
+    if (prev) {
+        prev->next = bio->next;
+    } else {
+        queue_head = bio->next;
+    }
+    if (queue_tail == bio) {
+        queue_tail = prev;
+    }
+    bio->next = 0;
+}
+
+static int bio_dma_capable(const bio_t *bio) {
+    return ((uint32_t)bio->buffer & (MMC_DMA_ALIGN - 1)) == 0;
+}
+
+// Card capacity, bounding read-ahead
+static uint32_t bio_capacity(void) {
+    blockdev_t *sd = blockdev_get_sd();
+    return sd ? sd->num_blocks : 0;
+}
+
+static void bio_start(uint32_t lba, mmc_segment_t *segs, uint32_t num_segs) {
+    uint64_t now = timer_get_ticks();
+
+    int rc = mmc_read_async(lba, segs, num_segs);
+    if (rc != MMC_OK) {
+        for (uint32_t i = 0; i < active_count; i++) {
+            bio_complete(active[i], rc);
+        }
+        active_count = 0;
+        ra_loading = 0;
+        return;
+    }
+
+    in_flight = 1;
+    command_start = now;
+    stats.commands++;
+    for (uint32_t i = 0; i < num_segs; i++) {
+        stats.blocks += segs[i].num_blocks;
+    }
+}
+
+// Append a read-ahead segment after end if the stream is sequential
+static uint32_t bio_add_readahead(mmc_segment_t *segs, uint32_t n, uint32_t end) {
+    uint32_t capacity = bio_capacity();
+    if (!ra_blocks || n >= MMC_MAX_SEGMENTS || end >= capacity) {
+        return n;
+    }
+
+    ra_lba = end;
+    ra_count = capacity - end < ra_blocks ? capacity - end : ra_blocks;
+    ra_valid = 0;
+    ra_loading = 1;
+    stats.ra_blocks += ra_count;
+
+    segs[n].buffer = ra_buffer;
+    segs[n].num_blocks = ra_count;
+    return n + 1;
+}
+
+static void bio_dispatch(void) {
+    uint64_t now = timer_get_ticks();
+
+    // Requests that need no card command of their own
+    while (queue_head) {
+        bio_t *bio = queue_head;
+        if (bio_try_readahead(bio)) {
+            bio_unlink(0, bio);
+            continue;
+        }
+        if (!bio_dma_capable(bio)) {
+            bio_unlink(0, bio);
+            bio_complete(bio, blockdev_read(bio->dev, bio->lba, bio->count, bio->buffer));
+            stream_end = bio_abs(bio) + bio->count;
+            continue;
+        }
+        break;
+    }
+
+    mmc_segment_t segs[MMC_MAX_SEGMENTS];
+    uint32_t n = 0;
+
+    if (!queue_head) {
+        // Consumer has caught up with the window: fetch the next one
+        if (ra_valid && stream_end == ra_lba + ra_count) {
+            n = bio_add_readahead(segs, 0, stream_end);
+            if (n) bio_start(ra_lba, segs, n);
+        }
+        return;
+    }
+
+    // Time the card sat idle while the head request was waiting
+    bio_t *head = queue_head;
+    uint64_t waiting_since = head->queued_us > idle_since ? head->queued_us : idle_since;
+    stats.stall_us += now - waiting_since;
+
+    // Head request plus every queued request that continues it
+    bio_unlink(0, head);
+    uint32_t start = bio_abs(head);
+    uint32_t end = start + head->count;
+    int sequential = (start == stream_end);
+    active[0] = head;
+    segs[0].buffer = head->buffer;
+    segs[0].num_blocks = head->count;
+    n = 1;
+
+    int found = 1;
+    while (found && n < MMC_MAX_SEGMENTS - 1) {
+        found = 0;
+        bio_t *prev = 0;
+        for (bio_t *bio = queue_head; bio; prev = bio, bio = bio->next) {
+            if (bio_abs(bio) == end && bio_dma_capable(bio) &&
+                bio->count <= MMC_MAX_BLOCKS_PER_CMD - (end - start)) {
+                bio_unlink(prev, bio);
+                active[n] = bio;
+                segs[n].buffer = bio->buffer;
+                segs[n].num_blocks = bio->count;
+                n++;
+                end += bio->count;
+                stats.merged++;
+                found = 1;
+                break;
+            }
+        }
+    }
+    active_count = n;
+    stream_end = end;
+
+    if (sequential && end - start + ra_blocks <= MMC_MAX_BLOCKS_PER_CMD) {
+        n = bio_add_readahead(segs, n, end);
+    }
+    bio_start(start, segs, n);
+}
+
+void bio_poll(void) {
+    if (in_flight) {
+        int rc = mmc_async_poll();
+        if (rc == MMC_PENDING) return;
+
+        uint64_t now = timer_get_ticks();
+        stats.busy_us += now - command_start;
+        idle_since = now;
+        in_flight = 0;
+
+        for (uint32_t i = 0; i < active_count; i++) {
+            bio_complete(active[i], rc);
+        }
+        active_count = 0;
+        if (ra_loading) {
+            ra_valid = (rc == MMC_OK);
+            ra_loading = 0;
+        }
+    }
+
+    bio_dispatch();
+}
+
+int bio_submit(bio_t *bio) {
+    if (!bio->dev) return BLK_ERR_NODEV;
+    if (bio->lba > bio->dev->num_blocks || bio->count > bio->dev->num_blocks - bio->lba) {
+        return BLK_ERR_RANGE;
+    }
+
+    bio->status = BIO_PENDING;
+    bio->next = 0;
+    bio->queued_us = timer_get_ticks();
+
+    stats.submitted++;
+    stats.depth++;
+    stats.depth_sum += stats.depth;
+    if (stats.depth > stats.max_depth) {
+        stats.max_depth = stats.depth;
+    }
+
+    if (bio->count == 0) {
+        bio_complete(bio, BLK_OK);
+        return BLK_OK;
+    }
+
+    if (queue_tail) {
+        queue_tail->next = bio;
+    } else {
+        queue_head = bio;
+    }
+    queue_tail = bio;
+
+    bio_poll();
+    return BLK_OK;
+}
+
+int bio_wait(bio_t *bio) {
+    while (bio->status == BIO_PENDING) {
+        bio_poll();
+    }
+    return bio->status;
+}
+
+void bio_drain(void) {
+    while (queue_head || active_count) {
+        bio_poll();
+    }
+}
+
+void bio_set_readahead(uint32_t blocks) {
+    ra_blocks = blocks > BIO_READAHEAD_MAX ? BIO_READAHEAD_MAX : blocks;
+    ra_valid = 0;
+}
+
+void bio_invalidate(void) {
+    // Let a window that is still loading land first, then drop it
+    while (in_flight) {
+        bio_poll();
+    }
+    ra_valid = 0;
+}
+
+const bio_stats_t *bio_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,112 @@
+#include "blockdev.h"
+#include "log.h"
+#include "mmc.h"
+
+// Block device layer
+// Callers address devices by relative LBA; requests are range checked and
+// split only where the controller's block counter forces it, so a large
+// read stays a handful of multi-block commands.
+
+static blockdev_t sd_dev;
+static int sd_ready = 0;
+
+// Per-command traces exist only in LOG_LEVEL=3 builds
+static int sd_read(blockdev_t *dev, uint32_t lba, uint32_t count, uint8_t *buffer) {
+    (void)dev;
+    log_debug("sd", "read %u blocks at %u", count, lba);
+    return mmc_read_blocks(lba, count, buffer);
+}
+
+static int sd_write(blockdev_t *dev, uint32_t lba, uint32_t count, const uint8_t *buffer) {
+    (void)dev;
+    log_debug("sd", "write %u blocks at %u", count, lba);
+    return mmc_write_blocks(lba, count, buffer);
+}
+
+int blockdev_init(void) {
+    sd_ready = 0;
+
+    int rc = mmc_init();
+    if (rc != MMC_OK) {
+        return rc;
+    }
+
+    mmc_card_info_t *info = mmc_get_card_info();
+    sd_dev.name = "sd";
+    sd_dev.start = 0;
+    sd_dev.num_blocks = info->capacity;
+    sd_dev.read = sd_read;
+    sd_dev.write = sd_write;
+    sd_ready = 1;
+
+    return BLK_OK;
+}
+
+blockdev_t *blockdev_get_sd(void) {
+    return sd_ready ? &sd_dev : 0;
+}
+
+int blockdev_sub(blockdev_t *sub, const blockdev_t *parent, const char *name,
+                 uint32_t start, uint32_t num_blocks) {
+    if (!parent) return BLK_ERR_NODEV;
+    if (start > parent->num_blocks || num_blocks > parent->num_blocks - start) {
+        return BLK_ERR_RANGE;
+    }
+
+    sub->name = name;
+    sub->start = parent->start + start;
+    sub->num_blocks = num_blocks;
+    sub->read = parent->read;
+    sub->write = parent->write;
+    return BLK_OK;
+}
+
+static int blockdev_check(const blockdev_t *dev, uint32_t lba, uint32_t count) {
+    if (!dev || !dev->read) return BLK_ERR_NODEV;
+    if (lba > dev->num_blocks || count > dev->num_blocks - lba) {
+        return BLK_ERR_RANGE;
+    }
+    return BLK_OK;
+}
+
+int blockdev_read(blockdev_t *dev, uint32_t lba, uint32_t count, uint8_t *buffer) {
+    int rc = blockdev_check(dev, lba, count);
+
+    while (rc == BLK_OK && count) {
+        uint32_t n = count > MMC_MAX_BLOCKS_PER_CMD ? MMC_MAX_BLOCKS_PER_CMD : count;
+        rc = dev->read(dev, dev->start + lba, n, buffer);
+        lba += n;
+        count -= n;
+        buffer += n * BLOCKDEV_BLOCK_SIZE;
+    }
+    return rc;
+}
+
+int blockdev_write(blockdev_t *dev, uint32_t lba, uint32_t count, const uint8_t *buffer) {
+    int rc = blockdev_check(dev, lba, count);
+    if (rc == BLK_OK && !dev->write) rc = BLK_ERR_NODEV;
+
+    while (rc == BLK_OK && count) {
+        uint32_t n = count > MMC_MAX_BLOCKS_PER_CMD ? MMC_MAX_BLOCKS_PER_CMD : count;
+        rc = dev->write(dev, dev->start + lba, n, buffer);
+        lba += n;
+        count -= n;
+        buffer += n * BLOCKDEV_BLOCK_SIZE;
+    }
+    return rc;
+}
+
+const char *blockdev_strerror(int err) {
+    switch (err) {
+        case BLK_OK:                return "ok";
+        case BLK_ERR_RANGE:         return "out of range";
+        case BLK_ERR_NODEV:         return "no device";
+        case MMC_ERR_NOT_READY:     return "card not ready";
+        case MMC_ERR_TIMEOUT:       return "timeout";
+        case MMC_ERR_CMD:           return "command error";
+        case MMC_ERR_DATA:          return "data error";
+        case MMC_ERR_UNSUPPORTED:   return "unsupported card";
+        case MMC_ERR_BUSY:          return "transfer in progress";
+        default:                    return "unknown error";
+    }
+}
@@ -0,0 +1,200 @@
+#include "bootlog.h"
+#include "bcache.h"
+#include "crc32.h"
+#include "format.h"
+#include "memory.h"
+#include "timer.h"
+#include <stddef.h>
+
+#define BOOTLOG_RECORD_BLOCKS (BOOTLOG_RECORD_SIZE / 512)
+#define BOOTLOG_LINE_MAX    128
+
+static bootlog_record_t record __attribute__((aligned(64)));
+static uint64_t phase_mark;         // End of the previous phase
+
+static fat_volume_t *log_vol;       // Set once the log file is found
+static fat_file_t log_file;
+static uint32_t log_slots;
+static uint32_t log_slot;           // Slot this boot's record goes to
+
+static bootlog_record_t *history;
+
+static const char *const phase_names[BOOTLOG_PHASES] = {
+    "firmware", "config", "display", "screen", "card", "menu", "load", "other"
+};
+
+// CRC-32 of a record as if its crc field were 0
+static uint32_t bootlog_crc(const bootlog_record_t *r) {
+    const uint32_t zero = 0;
+    uint32_t crc = crc32(0, r, offsetof(bootlog_record_t, crc));
+    crc = crc32(crc, &zero, sizeof(zero));
+    return crc32(crc, &r->flags, sizeof(*r) - offsetof(bootlog_record_t, flags));
+}
+
+static int bootlog_valid(const bootlog_record_t *r) {
+    return r->magic == BOOTLOG_MAGIC && r->text_len < BOOTLOG_TEXT_MAX &&
+           r->crc == bootlog_crc(r);
+}
+
+// Read the whole ring into the heap; 0 if it cannot be read
+static bootlog_record_t *bootlog_read_ring(void) {
+    uint32_t size = log_slots * BOOTLOG_RECORD_SIZE;
+    bootlog_record_t *ring = malloc(size);
+    if (!ring) return 0;
+    if (fat_seek(&log_file, 0) != FAT_OK || fat_read(&log_file, ring, size) != (int)size) {
+        free(ring);
+        return 0;
+    }
+    return ring;
+}
+
+// Slot of the intact record with the highest sequence number, or -1
+static int bootlog_newest(const bootlog_record_t *ring) {
+    int newest = -1;
+    for (uint32_t i = 0; i < log_slots; i++) {
+        if (bootlog_valid(&ring[i]) && (newest < 0 || ring[i].seq > ring[newest].seq)) {
+            newest = (int)i;
+        }
+    }
+    return newest;
+}
+
+void bootlog_begin(void) {
+    memset(&record, 0, sizeof(record));
+    record.magic = BOOTLOG_MAGIC;
+
+    // The system timer starts at reset, so its value is the firmware's time
+    phase_mark = timer_get_ticks();
+    record.phase_us[BOOTLOG_PHASE_FIRMWARE] = (uint32_t)phase_mark;
+}
+
+int bootlog_attach(fat_volume_t *vol) {
+    int rc = fat_open(vol, BOOTLOG_PATH, &log_file);
+    if (rc == FAT_ERR_NOTFOUND || (rc == FAT_OK && log_file.size < 2 * BOOTLOG_RECORD_SIZE)) {
+        return BOOTLOG_ERR_NOFILE;
+    }
+    if (rc != FAT_OK) return rc;
+
+    log_slots = log_file.size / BOOTLOG_RECORD_SIZE;
+    if (log_slots > BOOTLOG_MAX_RECORDS) log_slots = BOOTLOG_MAX_RECORDS;
+
+    // The new record follows the newest intact one, overwriting the oldest
+    bootlog_record_t *ring = bootlog_read_ring();
+    if (!ring) return FAT_ERR_CORRUPT;
+    int newest = bootlog_newest(ring);
+    record.seq = newest < 0 ? 1 : ring[newest].seq + 1;
+    log_slot = newest < 0 ? 0 : ((uint32_t)newest + 1) % log_slots;
+    free(ring);
+
+    log_vol = vol;
+    return FAT_OK;
+}
+
+void bootlog_phase(int phase) {
+    uint64_t now = timer_get_ticks();
+    if (phase >= 0 && phase < BOOTLOG_PHASES) {
+        record.phase_us[phase] += (uint32_t)(now - phase_mark);
+    }
+    phase_mark = now;
+}
+
+// Build one line and add it whole, or not at all
+static void bootlog_line(const char *prefix, const char *what, const char *detail, int err) {
+    char line[BOOTLOG_LINE_MAX];
+    char code[16] = "";
+
+    if (err) snprintf(code, sizeof(code), " (%d)", err);
+    uint32_t n = (uint32_t)snprintf(line, sizeof(line) - 1, "[%u] %s%s%s%s%s",
+                                    (uint32_t)(timer_get_ticks() / 1000), prefix, what,
+                                    detail ? ": " : "", detail ? detail : "", code);
+    if (n > sizeof(line) - 2) n = sizeof(line) - 2;
+    line[n++] = '\n';
+
+    // Keep room for the terminating NUL
+    if (record.text_len + n >= BOOTLOG_TEXT_MAX) return;
+    memcpy(record.text + record.text_len, line, n);
+    record.text_len += n;
+}
+
+void bootlog_note(const char *what, const char *detail) {
+    bootlog_line("", what, detail, 0);
+}
+
+void bootlog_error(const char *what, const char *detail, int err) {
+    record.error = err;
+    record.flags |= BOOTLOG_FLAG_ERROR;
+    bootlog_line("ERROR: ", what, detail, err);
+}
+
+void bootlog_kernel(const char *name) {
+    memset(record.kernel, 0, sizeof(record.kernel));
+    strncpy(record.kernel, name, BOOTLOG_KERNEL_MAX - 1);
+}
+
+void bootlog_flag(uint32_t flag) {
+    record.flags |= flag;
+}
+
+int bootlog_commit(void) {
+    if (!log_vol) return BOOTLOG_ERR_NOFILE;
+
+    record.end_ms = (uint32_t)(timer_get_ticks() / 1000);
+    record.crc = bootlog_crc(&record);
+
+    // Both blocks of the record in one transfer unless the file is
+    // fragmented right there
+    const uint8_t *data = (const uint8_t *)&record;
+    uint32_t block = log_slot * BOOTLOG_RECORD_BLOCKS;
+    for (uint32_t done = 0; done < BOOTLOG_RECORD_BLOCKS; ) {
+        uint32_t lba, run;
+        int rc = fat_map(&log_file, block + done, &lba, &run);
+        if (rc != FAT_OK) return rc;
+        if (run > BOOTLOG_RECORD_BLOCKS - done) run = BOOTLOG_RECORD_BLOCKS - done;
+        rc = bcache_write(log_vol->dev, lba, run, data + done * 512);
+        if (rc != BLK_OK) return rc;
+        done += run;
+    }
+    return FAT_OK;
+}
+
+const bootlog_record_t *bootlog_history(uint32_t *count) {
+    *count = 0;
+    if (history) {
+        free(history);
+        history = 0;
+    }
+    if (!log_vol) return 0;
+
+    bootlog_record_t *ring = bootlog_read_ring();
+    if (!ring) return 0;
+    history = malloc(log_slots * sizeof(bootlog_record_t));
+    if (!history) {
+        free(ring);
+        return 0;
+    }
+
+    // Oldest first: the slots after the newest record, wrapping around
+    int newest = bootlog_newest(ring);
+    for (uint32_t i = 1; newest >= 0 && i <= log_slots; i++) {
+        const bootlog_record_t *r = &ring[((uint32_t)newest + i) % log_slots];
+        if (!bootlog_valid(r)) continue;
+
+        bootlog_record_t *h = &history[(*count)++];
+        *h = *r;
+        h->text[h->text_len] = '\0';
+        h->kernel[BOOTLOG_KERNEL_MAX - 1] = '\0';
+    }
+    free(ring);
+    return history;
+}
+
+const char *bootlog_phase_name(int phase) {
+    return (phase >= 0 && phase < BOOTLOG_PHASES) ? phase_names[phase] : "?";
+}
+
+const char *bootlog_strerror(int err) {
+    switch (err) {
+        case BOOTLOG_ERR_NOFILE:    return BOOTLOG_PATH " missing or too small";
+        default:                    return fat_strerror(err);
+    }
+}
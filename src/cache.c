@@ -0,0 +1,43 @@
+#include "cache.h"
+
+// Data cache maintenance by virtual address
+// ARM1176 and Cortex-A7/A53 share the CP15 c7 encodings for these
+// operations; only the line size and the barrier instruction differ.
+
+void cache_sync(void) {
+#if defined(BCM2836) || defined(BCM2837)
+    asm volatile("dsb" : : : "memory");
+#else
+    asm volatile("mcr p15, 0, %0, c7, c10, 4" : : "r"(0) : "memory");
+#endif
+}
+
+void cache_clean_range(const void *start, uint32_t size) {
+    uint32_t addr = (uint32_t)start & ~(CACHE_LINE_SIZE - 1);
+    uint32_t end = (uint32_t)start + size;
+
+    for (; addr < end; addr += CACHE_LINE_SIZE) {
+        asm volatile("mcr p15, 0, %0, c7, c10, 1" : : "r"(addr) : "memory");
+    }
+    cache_sync();
+}
+
+void cache_invalidate_range(void *start, uint32_t size) {
+    uint32_t addr = (uint32_t)start & ~(CACHE_LINE_SIZE - 1);
+    uint32_t end = (uint32_t)start + size;
+
+    for (; addr < end; addr += CACHE_LINE_SIZE) {
+        asm volatile("mcr p15, 0, %0, c7, c6, 1" : : "r"(addr) : "memory");
+    }
+    cache_sync();
+}
+
+void cache_clean_invalidate_range(void *start, uint32_t size) {
+    uint32_t addr = (uint32_t)start & ~(CACHE_LINE_SIZE - 1);
+    uint32_t end = (uint32_t)start + size;
+
+    for (; addr < end; addr += CACHE_LINE_SIZE) {
+        asm volatile("mcr p15, 0, %0, c7, c14, 1" : : "r"(addr) : "memory");
+    }
+    cache_sync();
+}
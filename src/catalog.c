@@ -0,0 +1,338 @@
+#include "catalog.h"
+#include "bcache.h"
+#include "crc32.h"
+#include "memory.h"
+#include "timer.h"
+
+// Catalog as stored: the header record, then one record per entry
+typedef struct {
+    catalog_header_t header;
+    catalog_entry_t entries[CATALOG_MAX_ENTRIES];
+} catalog_t;
+
+// Bytes read per transfer while checksumming a file
+#define CATALOG_CHUNK       (64 * 1024)
+
+static catalog_t catalog __attribute__((aligned(64)));
+static catalog_stats_t stats;
+
+static char catalog_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+static uint32_t catalog_crc(const catalog_t *cat) {
+    catalog_header_t header = cat->header;
+    header.crc = 0;
+    uint32_t crc = crc32(0, &header, sizeof(header));
+    return crc32(crc, cat->entries, sizeof(cat->entries));
+}
+
+// Well formed and built for this volume; its checksums can be reused
+static int catalog_usable(const catalog_t *cat, const fat_volume_t *vol) {
+    const catalog_header_t *h = &cat->header;
+    return h->magic == CATALOG_MAGIC && h->version == CATALOG_VERSION &&
+           h->count <= CATALOG_MAX_ENTRIES && h->watch_count <= CATALOG_MAX_WATCH &&
+           h->crc == catalog_crc(cat) &&
+           h->data_lba == vol->data_lba && h->num_clusters == vol->num_clusters;
+}
+
+// CRC-32 of a directory's first cluster. Access dates (bytes 18-19 of
+// each entry) are left out: hosts may update them on every read.
+static int catalog_watch_crc(fat_volume_t *vol, const catalog_watch_t *w, uint32_t *crc) {
+    uint32_t c = 0;
+    for (uint32_t b = 0; b < w->blocks; b++) {
+        const uint8_t *block = bcache_pin(vol->dev, w->lba + b);
+        if (!block) return FAT_ERR_CORRUPT;
+        for (uint32_t off = 0; off < 512; off += 32) {
+            c = crc32(c, block + off, 18);
+            c = crc32(c, block + off + 20, 12);
+        }
+        bcache_unpin(block);
+    }
+    *crc = c;
+    return FAT_OK;
+}
+
+static int catalog_same_file(const catalog_entry_t *e, const fat_dirent_t *d) {
+    return !(d->attr & FAT_ATTR_DIRECTORY) && d->first_cluster == e->first_cluster &&
+           d->size == e->size && d->mtime == e->mtime && d->mdate == e->mdate &&
+           strcmp(d->short_name, e->short_name) == 0;
+}
+
+// Why the loaded catalog cannot be used, or 0 if it still matches the card
+static const char *catalog_check(fat_volume_t *vol, uint32_t sources) {
+    const catalog_header_t *h = &catalog.header;
+    if (h->magic != CATALOG_MAGIC || h->version != CATALOG_VERSION) return "no catalog";
+    if (!catalog_usable(&catalog, vol)) return "corrupt or from another volume";
+    if (h->sources != sources) return "boot order changed";
+
+    // New or removed files show up in their directory's first cluster
+    for (uint32_t i = 0; i < h->watch_count; i++) {
+        uint32_t crc;
+        if (catalog_watch_crc(vol, &h->watch[i], &crc) != FAT_OK || crc != h->watch[i].crc) {
+            return "directory changed";
+        }
+    }
+
+    // Entries further down a directory are checked one by one
+    for (uint32_t i = 0; i < h->count; i++) {
+        catalog_entry_t *e = &catalog.entries[i];
+        fat_dirent_t d;
+        e->name[CATALOG_NAME_MAX - 1] = '\0';
+        e->path[CATALOG_PATH_MAX - 1] = '\0';
+        e->short_name[sizeof(e->short_name) - 1] = '\0';
+        if (fat_stat_at(vol, e->entry_lba, e->entry_offset, &d) != FAT_OK ||
+            !catalog_same_file(e, &d)) {
+            return "file changed";
+        }
+    }
+    return 0;
+}
+
+// Checksum the first cluster of a directory and add it to the watch list
+static void catalog_watch(fat_volume_t *vol, const char *path, uint32_t len) {
+    catalog_header_t *h = &catalog.header;
+    char dir[CATALOG_PATH_MAX];
+    fat_dirent_t d;
+    fat_extent_t ext;
+
+    if (len >= CATALOG_PATH_MAX) return;
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+    if (fat_stat(vol, dir, &d) != FAT_OK || !(d.attr & FAT_ATTR_DIRECTORY)) return;
+
+    fat_dir_blocks(vol, d.first_cluster, &ext);
+    for (uint32_t i = 0; i < h->watch_count; i++) {
+        if (h->watch[i].lba == ext.lba) return;
+    }
+    if (h->watch_count == CATALOG_MAX_WATCH) return;
+
+    catalog_watch_t *w = &h->watch[h->watch_count];
+    w->lba = ext.lba;
+    w->blocks = ext.blocks;
+    if (catalog_watch_crc(vol, w, &w->crc) == FAT_OK) h->watch_count++;
+}
+
+// Watch the directory holding path
+static void catalog_watch_parent(fat_volume_t *vol, const char *path) {
+    uint32_t len = strlen(path);
+    while (len > 0 && path[len - 1] != '/') len--;
+    catalog_watch(vol, path, len);
+}
+
+// CRC-32 of a whole file, read in large transfers
+static int catalog_checksum(fat_file_t *file, uint8_t *buffer, uint32_t *crc) {
+    uint32_t c = 0;
+    int n;
+    while ((n = fat_read(file, buffer, CATALOG_CHUNK)) > 0) {
+        c = crc32(c, buffer, (uint32_t)n);
+    }
+    if (n < 0) return n;
+    *crc = c;
+    stats.checksummed++;
+    return FAT_OK;
+}
+
+// Add a file found by the scan. Checksums are carried over from the old
+// catalog for files whose directory entry has not changed.
+static void catalog_add(fat_volume_t *vol, const char *path, const fat_dirent_t *d,
+                        const catalog_t *old, uint8_t *buffer) {
+    catalog_header_t *h = &catalog.header;
+    if (h->count == CATALOG_MAX_ENTRIES || (d->attr & FAT_ATTR_DIRECTORY) || d->size == 0) return;
+    if (strlen(path) >= CATALOG_PATH_MAX) return;
+    for (uint32_t i = 0; i < h->count; i++) {
+        const catalog_entry_t *e = &catalog.entries[i];
+        if (e->entry_lba == d->entry_lba && e->entry_offset == d->entry_offset) return;
+    }
+
+    catalog_entry_t *e = &catalog.entries[h->count];
+    memset(e, 0, sizeof(*e));
+    strcpy(e->path, path);
+    strcpy(e->short_name, d->short_name);
+    e->first_cluster = d->first_cluster;
+    e->size = d->size;
+    e->entry_lba = d->entry_lba;
+    e->entry_offset = d->entry_offset;
+    e->mtime = d->mtime;
+    e->mdate = d->mdate;
+
+    // Label: the long name up to its extension
+    uint32_t len = strlen(d->name);
+    for (uint32_t i = len; i > 1; i--) {
+        if (d->name[i - 1] == '.') {
+            len = i - 1;
+            break;
+        }
+    }
+    if (len >= CATALOG_NAME_MAX) len = CATALOG_NAME_MAX - 1;
+    memcpy(e->name, d->name, len);
+
+    fat_file_t file;
+    if (fat_open_entry(vol, d, &file) != FAT_OK) return;
+    if (file.map_next == 0 && file.num_extents <= CATALOG_EXTENTS) {
+        e->num_extents = file.num_extents;
+        memcpy(e->extents, file.extents, file.num_extents * sizeof(fat_extent_t));
+    }
+
+    int reused = 0;
+    for (uint32_t i = 0; old && i < old->header.count && !reused; i++) {
+        const catalog_entry_t *o = &old->entries[i];
+        if (o->entry_lba == d->entry_lba && o->entry_offset == d->entry_offset &&
+            catalog_same_file(o, d)) {
+            e->crc = o->crc;
+            reused = 1;
+        }
+    }
+    if (!reused && (!buffer || catalog_checksum(&file, buffer, &e->crc) != FAT_OK)) return;
+
+    h->count++;
+}
+
+// Write the catalog over the blocks of CATALOG_PATH
+static int catalog_save(fat_volume_t *vol) {
+    const uint8_t *data = (const uint8_t *)&catalog;
+    const uint32_t blocks = CATALOG_SIZE / 512;
+    fat_file_t file;
+
+    int rc = fat_open(vol, CATALOG_PATH, &file);
+    if (rc == FAT_ERR_NOTFOUND || (rc == FAT_OK && file.size < CATALOG_SIZE)) {
+        return CATALOG_ERR_NOSPACE;
+    }
+    for (uint32_t block = 0; rc == FAT_OK && block < blocks; ) {
+        uint32_t lba, run;
+        rc = fat_map(&file, block, &lba, &run);
+        if (rc != FAT_OK) break;
+        if (run > blocks - block) run = blocks - block;
+        rc = bcache_write(vol->dev, lba, run, data + block * 512);
+        block += run;
+    }
+    return rc;
+}
+
+// Full scan: every file of the boot order, then everything in CATALOG_DIR
+static int catalog_scan(fat_volume_t *vol, const char *sources, const catalog_t *old) {
+    uint64_t start = timer_get_ticks();
+    catalog_header_t *h = &catalog.header;
+    char path[CATALOG_PATH_MAX];
+    fat_dirent_t d;
+
+    uint8_t *buffer = malloc(CATALOG_CHUNK + 64);
+    uint8_t *aligned = buffer ? (uint8_t *)(((uint32_t)buffer + 63) & ~63u) : 0;
+
+    memset(&catalog, 0, sizeof(catalog));
+    h->magic = CATALOG_MAGIC;
+    h->version = CATALOG_VERSION;
+    h->data_lba = vol->data_lba;
+    h->num_clusters = vol->num_clusters;
+    h->sources = crc32(0, sources, strlen(sources));
+
+    for (const char *p = sources; *p; ) {
+        uint32_t len = 0;
+        while (*p == ' ' || *p == ',') p++;
+        while (p[len] && p[len] != ',') len++;
+        uint32_t end = len;
+        while (end > 0 && p[end - 1] == ' ') end--;
+        if (end > 0 && end < CATALOG_PATH_MAX) {
+            memcpy(path, p, end);
+            path[end] = '\0';
+            // Watched even if the file is missing, so creating it counts
+            catalog_watch_parent(vol, path);
+            if (fat_stat(vol, path, &d) == FAT_OK) catalog_add(vol, path, &d, old, aligned);
+        }
+        p += len;
+    }
+
+    fat_dir_t dir;
+    catalog_watch_parent(vol, CATALOG_DIR);
+    if (fat_opendir(vol, CATALOG_DIR, &dir) == FAT_OK) {
+        catalog_watch(vol, CATALOG_DIR, strlen(CATALOG_DIR));
+        while (fat_readdir(&dir, &d) > 0) {
+            if (d.name[0] == '.') continue;
+            if (strlen(CATALOG_DIR) + 1 + strlen(d.name) >= CATALOG_PATH_MAX) continue;
+            strcpy(path, CATALOG_DIR "/");
+            strcat(path, d.name);
+            catalog_add(vol, path, &d, old, aligned);
+        }
+    }
+    if (buffer) free(buffer);
+
+    h->crc = catalog_crc(&catalog);
+    stats.rebuilt = 1;
+    stats.save_rc = catalog_save(vol);
+    stats.scan_us = timer_get_ticks() - start;
+    return h->count;
+}
+
+int catalog_load(fat_volume_t *vol, const char *sources) {
+    uint64_t start = timer_get_ticks();
+    fat_file_t file;
+
+    memset(&stats, 0, sizeof(stats));
+    int rc = fat_open(vol, CATALOG_PATH, &file);
+
+    // A catalog that cannot be saved would be rebuilt, reading every file
+    // in full, on each boot; leave the card to the boot order instead
+    if (rc == FAT_ERR_NOTFOUND || (rc == FAT_OK && file.size < CATALOG_SIZE)) {
+        catalog.header.magic = 0;
+        stats.check_us = timer_get_ticks() - start;
+        return CATALOG_ERR_NOSPACE;
+    }
+    if (rc == FAT_OK) rc = fat_read(&file, &catalog, CATALOG_SIZE);
+    if (rc != CATALOG_SIZE) catalog.header.magic = 0;
+
+    const char *reason = catalog_check(vol, crc32(0, sources, strlen(sources)));
+    stats.check_us = timer_get_ticks() - start;
+    if (!reason) return catalog.header.count;
+
+    // Keep the stale catalog's checksums for files that did not change
+    catalog_t *old = 0;
+    if (catalog_usable(&catalog, vol)) {
+        old = malloc(sizeof(catalog_t));
+        if (old) memcpy(old, &catalog, sizeof(catalog_t));
+    }
+    stats.reason = reason;
+    rc = catalog_scan(vol, sources, old);
+    if (old) free(old);
+    return rc;
+}
+
+int catalog_rebuild(fat_volume_t *vol, const char *sources) {
+    memset(&stats, 0, sizeof(stats));
+    stats.reason = "rebuild requested";
+    return catalog_scan(vol, sources, 0);
+}
+
+const catalog_entry_t *catalog_entries(uint32_t *count) {
+    *count = catalog.header.magic == CATALOG_MAGIC ? catalog.header.count : 0;
+    return catalog.entries;
+}
+
+int catalog_find(const char *name) {
+    uint32_t count;
+    const catalog_entry_t *entries = catalog_entries(&count);
+    for (uint32_t i = 0; i < count; i++) {
+        const char *a = name, *b = entries[i].name;
+        while (*a && catalog_upper(*a) == catalog_upper(*b)) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') return (int)i;
+    }
+    return -1;
+}
+
+int catalog_open(fat_volume_t *vol, const catalog_entry_t *entry, fat_file_t *file) {
+    return fat_open_extents(vol, entry->first_cluster, entry->size,
+                            entry->extents, entry->num_extents, file);
+}
+
+const catalog_stats_t *catalog_get_stats(void) {
+    return &stats;
+}
+
+const char *catalog_strerror(int err) {
+    switch (err) {
+        case CATALOG_ERR_NOSPACE:   return CATALOG_PATH " missing or too small";
+        default:                    return fat_strerror(err);
+    }
+}
@@ -0,0 +1,183 @@
+#include "config.h"
+#include "memory.h"
+
+static char config_text[CONFIG_MAX_SIZE + 1] __attribute__((aligned(64)));
+static config_entry_t config_table[CONFIG_MAX_ENTRIES];
+static uint32_t config_count;
+static uint32_t config_bad;
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Index of key in the table, or -(insertion point + 1) if absent
+static int config_find(const char *key) {
+    int lo = 0, hi = (int)config_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(key, config_table[mid].key);
+        if (cmp == 0) return mid;
+        if (cmp < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return -(lo + 1);
+}
+
+// Add or replace a key; a later line wins over an earlier one
+static int config_insert(const char *key, const char *value) {
+    int i = config_find(key);
+    if (i >= 0) {
+        config_table[i].value = value;
+        return 0;
+    }
+    if (config_count == CONFIG_MAX_ENTRIES) return CONFIG_ERR_FULL;
+
+    i = -i - 1;
+    memmove(&config_table[i + 1], &config_table[i],
+            (config_count - (uint32_t)i) * sizeof(config_entry_t));
+    config_table[i].key = key;
+    config_table[i].value = value;
+    config_count++;
+    return 0;
+}
+
+// Split the text in place: each line's key and value are terminated
+// where they end and entered into the table
+static int config_parse(char *p, char *end) {
+    while (p < end) {
+        char *line = p;
+        while (p < end && *p != '\n') p++;
+        char *eol = p;
+        if (p < end) p++;
+
+        // Comments run to the end of the line
+        for (char *c = line; c < eol; c++) {
+            if (*c == '#') {
+                eol = c;
+                break;
+            }
+        }
+        while (line < eol && is_space(*line)) line++;
+        while (eol > line && is_space(eol[-1])) eol--;
+        if (line == eol) continue;
+
+        char *eq = line;
+        while (eq < eol && *eq != '=') eq++;
+        char *key_end = eq;
+        while (key_end > line && is_space(key_end[-1])) key_end--;
+        if (eq == eol || key_end == line) {
+            config_bad++;
+            continue;
+        }
+        char *value = eq + 1;
+        while (value < eol && is_space(*value)) value++;
+
+        *key_end = '\0';
+        *eol = '\0';
+        int rc = config_insert(line, value);
+        if (rc < 0) return rc;
+    }
+    return (int)config_count;
+}
+
+int config_load(fat_volume_t *vol, const char *path) {
+    fat_file_t file;
+
+    config_count = 0;
+    config_bad = 0;
+
+    int rc = fat_open(vol, path, &file);
+    if (rc != FAT_OK) return rc;
+    if (file.size > CONFIG_MAX_SIZE) return CONFIG_ERR_TOOBIG;
+
+    int n = fat_read(&file, config_text, file.size);
+    if (n < 0) return n;
+    config_text[n] = '\0';
+
+    rc = config_parse(config_text, config_text + n);
+    if (rc < 0) config_count = 0;
+    return rc;
+}
+
+uint32_t config_bad_lines(void) {
+    return config_bad;
+}
+
+const char *config_get(const char *key) {
+    int i = config_find(key);
+    return i >= 0 ? config_table[i].value : 0;
+}
+
+uint32_t config_get_uint(const char *key, uint32_t def) {
+    const char *p = config_get(key);
+    if (!p || !*p) return def;
+
+    uint32_t base = 10;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        base = 16;
+        p += 2;
+    }
+
+    uint32_t value = 0;
+    const char *start = p;
+    for (; *p; p++) {
+        uint32_t d;
+        if (*p >= '0' && *p <= '9') d = (uint32_t)(*p - '0');
+        else if (base == 16 && *p >= 'a' && *p <= 'f') d = (uint32_t)(*p - 'a' + 10);
+        else if (base == 16 && *p >= 'A' && *p <= 'F') d = (uint32_t)(*p - 'A' + 10);
+        else return def;
+        value = value * base + d;
+    }
+    return p == start ? def : value;
+}
+
+int config_get_bool(const char *key, int def) {
+    static const char *const yes[] = { "1", "yes", "on", "true" };
+    static const char *const no[] = { "0", "no", "off", "false" };
+
+    const char *value = config_get(key);
+    if (!value) return def;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (strcmp(value, yes[i]) == 0) return 1;
+        if (strcmp(value, no[i]) == 0) return 0;
+    }
+    return def;
+}
+
+const config_entry_t *config_entries(uint32_t *count) {
+    *count = config_count;
+    return config_table;
+}
+
+uint32_t config_handoff(void *dest, uint32_t max) {
+    config_handoff_t *h = (config_handoff_t *)dest;
+    uint32_t size = sizeof(config_handoff_t) + config_count * 4;
+
+    for (uint32_t i = 0; i < config_count; i++) {
+        size += strlen(config_table[i].key) + strlen(config_table[i].value) + 2;
+    }
+    if (size > max || size > 0xFFFF) return 0;
+
+    char *strings = (char *)&h->offsets[config_count * 2];
+    for (uint32_t i = 0; i < config_count; i++) {
+        h->offsets[i * 2] = (uint16_t)(strings - (char *)dest);
+        strcpy(strings, config_table[i].key);
+        strings += strlen(strings) + 1;
+        h->offsets[i * 2 + 1] = (uint16_t)(strings - (char *)dest);
+        strcpy(strings, config_table[i].value);
+        strings += strlen(strings) + 1;
+    }
+    h->magic = CONFIG_HANDOFF_MAGIC;
+    h->size = size;
+    h->count = config_count;
+    h->reserved = 0;
+    return size;
+}
+
+const char *config_strerror(int err) {
+    switch (err) {
+        case CONFIG_ERR_TOOBIG:     return "file too large";
+        case CONFIG_ERR_FULL:       return "too many keys";
+        default:                    return fat_strerror(err);
+    }
+}
@@ -0,0 +1,93 @@
+#include "crc32.h"
+
+// CRC-32, slicing by 8: each step folds 8 input bytes through 8 lookup
+// tables instead of one byte through one. The tables (8 KB) are built on
+// first use rather than stored, to keep them out of the image.
+//
+// The Cortex-A53 (BCM2837) implements the ARMv8 CRC32 instructions in
+// AArch32 as well; they are used when the compiler targets that core.
+
+#if defined(BCM2837) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32_HW 1
+#endif
+
+#define CRC32_POLY 0xEDB88320
+
+typedef uint32_t __attribute__((may_alias)) crc32_word_t;
+
+#ifndef CRC32_HW
+static uint32_t crc32_table[8][256];
+static int crc32_ready = 0;
+
+static void crc32_build_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32_POLY : c >> 1;
+        }
+        crc32_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t c = crc32_table[t - 1][i];
+            crc32_table[t][i] = (c >> 8) ^ crc32_table[0][c & 0xFF];
+        }
+    }
+    crc32_ready = 1;
+}
+
+static inline uint32_t crc32_byte(uint32_t crc, uint8_t b) {
+    return crc32_table[0][(crc ^ b) & 0xFF] ^ (crc >> 8);
+}
+#endif
+
+uint32_t crc32(uint32_t crc, const void *data, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+
+    crc = ~crc;
+
+#ifdef CRC32_HW
+    while (len && ((uint32_t)p & 3)) {
+        crc = __crc32b(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        const crc32_word_t *w = (const crc32_word_t *)p;
+        crc = __crc32w(crc, w[0]);
+        crc = __crc32w(crc, w[1]);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32b(crc, *p++);
+    }
+#else
+    if (!crc32_ready) crc32_build_table();
+
+    while (len && ((uint32_t)p & 3)) {
+        crc = crc32_byte(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        const crc32_word_t *w = (const crc32_word_t *)p;
+        uint32_t one = w[0] ^ crc;
+        uint32_t two = w[1];
+        crc = crc32_table[7][one & 0xFF] ^
+              crc32_table[6][(one >> 8) & 0xFF] ^
+              crc32_table[5][(one >> 16) & 0xFF] ^
+              crc32_table[4][one >> 24] ^
+              crc32_table[3][two & 0xFF] ^
+              crc32_table[2][(two >> 8) & 0xFF] ^
+              crc32_table[1][(two >> 16) & 0xFF] ^
+              crc32_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc32_byte(crc, *p++);
+    }
+#endif
+
+    return ~crc;
+}
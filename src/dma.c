@@ -0,0 +1,55 @@
+#include "dma.h"
+#include "hardware.h"
+#include "cache.h"
+
+// DMA channel registers
+#define DMA_CS(ch)          (DMA_BASE + (ch) * 0x100 + 0x00)
+#define DMA_CONBLK_AD(ch)   (DMA_BASE + (ch) * 0x100 + 0x04)
+#define DMA_DEBUG(ch)       (DMA_BASE + (ch) * 0x100 + 0x20)
+
+// CS bits
+#define DMA_CS_ACTIVE           (1 << 0)
+#define DMA_CS_END              (1 << 1)
+#define DMA_CS_INT              (1 << 2)
+#define DMA_CS_ERROR            (1 << 8)
+#define DMA_CS_PRIORITY(n)      ((uint32_t)(n) << 16)
+#define DMA_CS_PANIC_PRIORITY(n) ((uint32_t)(n) << 20)
+#define DMA_CS_WAIT_WRITES      (1 << 28)
+#define DMA_CS_RESET            (1u << 31)
+
+// DEBUG error flags (write 1 to clear)
+#define DMA_DEBUG_ERRORS        0x7
+
+void dma_init(uint32_t channel) {
+    if (channel >= DMA_CHANNELS) return;
+
+    MMIO_WRITE(DMA_ENABLE, MMIO_READ(DMA_ENABLE) | (1 << channel));
+    MMIO_WRITE(DMA_CS(channel), DMA_CS_RESET);
+    while (MMIO_READ(DMA_CS(channel)) & DMA_CS_RESET) { }
+}
+
+void dma_start(uint32_t channel, const dma_cb_t *cb, uint32_t count) {
+    // The engine reads control blocks straight from memory
+    cache_clean_range(cb, count * sizeof(dma_cb_t));
+
+    MMIO_WRITE(DMA_DEBUG(channel), DMA_DEBUG_ERRORS);
+    MMIO_WRITE(DMA_CS(channel), DMA_CS_END | DMA_CS_INT);
+    MMIO_WRITE(DMA_CONBLK_AD(channel), BUS_ADDRESS(cb));
+    MMIO_WRITE(DMA_CS(channel), DMA_CS_ACTIVE | DMA_CS_WAIT_WRITES |
+                                DMA_CS_PRIORITY(8) | DMA_CS_PANIC_PRIORITY(8));
+}
+
+int dma_status(uint32_t channel) {
+    uint32_t cs = MMIO_READ(DMA_CS(channel));
+
+    if ((cs & DMA_CS_ERROR) || (MMIO_READ(DMA_DEBUG(channel)) & DMA_DEBUG_ERRORS)) {
+        return DMA_ERROR;
+    }
+    return (cs & DMA_CS_ACTIVE) ? DMA_BUSY : DMA_DONE;
+}
+
+void dma_abort(uint32_t channel) {
+    MMIO_WRITE(DMA_CS(channel), DMA_CS_RESET);
+    while (MMIO_READ(DMA_CS(channel)) & DMA_CS_RESET) { }
+    MMIO_WRITE(DMA_DEBUG(channel), DMA_DEBUG_ERRORS);
+}
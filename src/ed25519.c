@@ -0,0 +1,317 @@
+#include "ed25519.h"
+#include "sha512.h"
+
+// Field elements mod 2^255-19 as 16 signed limbs of 16 bits. Verification
+// runs once per boot, so this trades speed for a small, constant-time
+// implementation with no tables beyond the curve constants.
+typedef int64_t gf[16];
+
+static const gf gf0;
+static const gf gf1 = {1};
+static const gf ed_d = {
+    0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070,
+    0xe898, 0x7779, 0x4079, 0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203
+};
+static const gf ed_d2 = {
+    0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0,
+    0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406
+};
+static const gf ed_bx = {
+    0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c,
+    0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169
+};
+static const gf ed_by = {
+    0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+    0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666
+};
+static const gf ed_sqrtm1 = {
+    0xa0b0, 0x4a0e, 0x1b27, 0xc4ee, 0xe478, 0xad2f, 0x1806, 0x2f43,
+    0xd7a7, 0x3dfb, 0x0099, 0x2b4d, 0xdf0b, 0x4fc1, 0x2480, 0x2b83
+};
+
+// Group order L = 2^252 + 27742317777372353535851937790883648493
+static const int64_t ed_l[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10
+};
+
+static void gf_copy(gf r, const gf a) {
+    for (int i = 0; i < 16; i++) r[i] = a[i];
+}
+
+static void gf_carry(gf o) {
+    for (int i = 0; i < 16; i++) {
+        o[i] += (int64_t)1 << 16;
+        int64_t c = o[i] >> 16;
+        o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+        o[i] -= c << 16;
+    }
+}
+
+// Constant-time swap of p and q when b is 1
+static void gf_swap(gf p, gf q, int b) {
+    int64_t c = ~(int64_t)(b - 1);
+    for (int i = 0; i < 16; i++) {
+        int64_t t = c & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+static void gf_pack(uint8_t *o, const gf n) {
+    gf m, t;
+    gf_copy(t, n);
+    gf_carry(t);
+    gf_carry(t);
+    gf_carry(t);
+    for (int j = 0; j < 2; j++) {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int b = (int)((m[15] >> 16) & 1);
+        m[14] &= 0xffff;
+        gf_swap(t, m, 1 - b);
+    }
+    for (int i = 0; i < 16; i++) {
+        o[2 * i] = (uint8_t)t[i];
+        o[2 * i + 1] = (uint8_t)(t[i] >> 8);
+    }
+}
+
+static int bytes_neq32(const uint8_t *x, const uint8_t *y) {
+    uint32_t d = 0;
+    for (int i = 0; i < 32; i++) d |= x[i] ^ y[i];
+    return d != 0;
+}
+
+static int gf_neq(const gf a, const gf b) {
+    uint8_t c[32], d[32];
+    gf_pack(c, a);
+    gf_pack(d, b);
+    return bytes_neq32(c, d);
+}
+
+static int gf_parity(const gf a) {
+    uint8_t d[32];
+    gf_pack(d, a);
+    return d[0] & 1;
+}
+
+static void gf_unpack(gf o, const uint8_t *n) {
+    for (int i = 0; i < 16; i++) o[i] = n[2 * i] + ((int64_t)n[2 * i + 1] << 8);
+    o[15] &= 0x7fff;
+}
+
+static void gf_add(gf o, const gf a, const gf b) {
+    for (int i = 0; i < 16; i++) o[i] = a[i] + b[i];
+}
+
+static void gf_sub(gf o, const gf a, const gf b) {
+    for (int i = 0; i < 16; i++) o[i] = a[i] - b[i];
+}
+
+static void gf_mul(gf o, const gf a, const gf b) {
+    int64_t t[31];
+    for (int i = 0; i < 31; i++) t[i] = 0;
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 16; j++) t[i + j] += a[i] * b[j];
+    }
+    for (int i = 0; i < 15; i++) t[i] += 38 * t[i + 16];
+    for (int i = 0; i < 16; i++) o[i] = t[i];
+    gf_carry(o);
+    gf_carry(o);
+}
+
+static void gf_sqr(gf o, const gf a) {
+    gf_mul(o, a, a);
+}
+
+static void gf_inv(gf o, const gf i) {
+    gf c;
+    gf_copy(c, i);
+    for (int a = 253; a >= 0; a--) {
+        gf_sqr(c, c);
+        if (a != 2 && a != 4) gf_mul(c, c, i);
+    }
+    gf_copy(o, c);
+}
+
+// i^((p-5)/8), used for the square root in point decompression
+static void gf_pow2523(gf o, const gf i) {
+    gf c;
+    gf_copy(c, i);
+    for (int a = 250; a >= 0; a--) {
+        gf_sqr(c, c);
+        if (a != 1) gf_mul(c, c, i);
+    }
+    gf_copy(o, c);
+}
+
+// Extended twisted Edwards coordinates (X, Y, Z, T)
+static void point_add(gf p[4], gf q[4]) {
+    gf a, b, c, d, t, e, f, g, h;
+
+    gf_sub(a, p[1], p[0]);
+    gf_sub(t, q[1], q[0]);
+    gf_mul(a, a, t);
+    gf_add(b, p[0], p[1]);
+    gf_add(t, q[0], q[1]);
+    gf_mul(b, b, t);
+    gf_mul(c, p[3], q[3]);
+    gf_mul(c, c, ed_d2);
+    gf_mul(d, p[2], q[2]);
+    gf_add(d, d, d);
+    gf_sub(e, b, a);
+    gf_sub(f, d, c);
+    gf_add(g, d, c);
+    gf_add(h, b, a);
+
+    gf_mul(p[0], e, f);
+    gf_mul(p[1], h, g);
+    gf_mul(p[2], g, f);
+    gf_mul(p[3], e, h);
+}
+
+static void point_swap(gf p[4], gf q[4], int b) {
+    for (int i = 0; i < 4; i++) gf_swap(p[i], q[i], b);
+}
+
+static void point_pack(uint8_t *r, gf p[4]) {
+    gf tx, ty, zi;
+    gf_inv(zi, p[2]);
+    gf_mul(tx, p[0], zi);
+    gf_mul(ty, p[1], zi);
+    gf_pack(r, ty);
+    r[31] ^= (uint8_t)(gf_parity(tx) << 7);
+}
+
+// p = s * q (q is clobbered)
+static void point_scalarmult(gf p[4], gf q[4], const uint8_t *s) {
+    gf_copy(p[0], gf0);
+    gf_copy(p[1], gf1);
+    gf_copy(p[2], gf1);
+    gf_copy(p[3], gf0);
+    for (int i = 255; i >= 0; i--) {
+        int b = (s[i / 8] >> (i & 7)) & 1;
+        point_swap(p, q, b);
+        point_add(q, p);
+        point_add(p, p);
+        point_swap(p, q, b);
+    }
+}
+
+static void point_scalarbase(gf p[4], const uint8_t *s) {
+    gf q[4];
+    gf_copy(q[0], ed_bx);
+    gf_copy(q[1], ed_by);
+    gf_copy(q[2], gf1);
+    gf_mul(q[3], ed_bx, ed_by);
+    point_scalarmult(p, q, s);
+}
+
+// Decompresses p into r as its negation; -1 if p is not on the curve
+static int point_unpackneg(gf r[4], const uint8_t p[32]) {
+    gf t, chk, num, den, den2, den4, den6;
+
+    gf_copy(r[2], gf1);
+    gf_unpack(r[1], p);
+    gf_sqr(num, r[1]);
+    gf_mul(den, num, ed_d);
+    gf_sub(num, num, r[2]);
+    gf_add(den, r[2], den);
+
+    gf_sqr(den2, den);
+    gf_sqr(den4, den2);
+    gf_mul(den6, den4, den2);
+    gf_mul(t, den6, num);
+    gf_mul(t, t, den);
+
+    gf_pow2523(t, t);
+    gf_mul(t, t, num);
+    gf_mul(t, t, den);
+    gf_mul(t, t, den);
+    gf_mul(r[0], t, den);
+
+    gf_sqr(chk, r[0]);
+    gf_mul(chk, chk, den);
+    if (gf_neq(chk, num)) gf_mul(r[0], r[0], ed_sqrtm1);
+
+    gf_sqr(chk, r[0]);
+    gf_mul(chk, chk, den);
+    if (gf_neq(chk, num)) return -1;
+
+    if (gf_parity(r[0]) == (p[31] >> 7)) gf_sub(r[0], gf0, r[0]);
+
+    gf_mul(r[3], r[0], r[1]);
+    return 0;
+}
+
+// r = x mod L, x given as 64 little-endian base-256 digits
+static void scalar_mod_l(uint8_t *r, int64_t x[64]) {
+    int64_t carry;
+    int i, j;
+
+    for (i = 63; i >= 32; --i) {
+        carry = 0;
+        for (j = i - 32; j < i - 12; ++j) {
+            x[j] += carry - 16 * x[i] * ed_l[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry * 256;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+    carry = 0;
+    for (j = 0; j < 32; j++) {
+        x[j] += carry - (x[31] >> 4) * ed_l[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (j = 0; j < 32; j++) x[j] -= carry * ed_l[j];
+    for (i = 0; i < 32; i++) {
+        x[i + 1] += x[i] >> 8;
+        r[i] = (uint8_t)(x[i] & 255);
+    }
+}
+
+// Rejects non-canonical S (S >= L) to rule out malleable signatures
+static int scalar_is_canonical(const uint8_t s[32]) {
+    for (int i = 31; i >= 0; i--) {
+        if (s[i] < ed_l[i]) return 1;
+        if (s[i] > ed_l[i]) return 0;
+    }
+    return 0;
+}
+
+int ed25519_verify(const uint8_t sig[ED25519_SIGNATURE_SIZE],
+                   const void *msg, uint32_t len,
+                   const uint8_t pk[ED25519_PUBLIC_KEY_SIZE]) {
+    sha512_ctx_t ctx;
+    uint8_t h[64], k[32], t[32];
+    int64_t x[64];
+    gf p[4], q[4];
+
+    if (!scalar_is_canonical(sig + 32)) return -1;
+    if (point_unpackneg(q, pk) < 0) return -1;
+
+    // k = SHA-512(R || A || M) mod L
+    sha512_init(&ctx);
+    sha512_update(&ctx, sig, 32);
+    sha512_update(&ctx, pk, 32);
+    sha512_update(&ctx, msg, len);
+    sha512_final(&ctx, h);
+    for (int i = 0; i < 64; i++) x[i] = h[i];
+    scalar_mod_l(k, x);
+
+    // Check R == S*B - k*A (q holds -A)
+    point_scalarmult(p, q, k);
+    point_scalarbase(q, sig + 32);
+    point_add(p, q);
+    point_pack(t, p);
+
+    return bytes_neq32(sig, t) ? -1 : 0;
+}
@@ -0,0 +1,612 @@
+#include "fat.h"
+#include "bcache.h"
+#include "memory.h"
+
+// FAT16/FAT32 reader
+// A file's cluster chain is walked once and collapsed into extents of
+// consecutive clusters; reads then cost one multi-block transfer per
+// extent. The FAT sector being walked stays pinned in the block cache.
+
+#define FAT_DIRENT_SIZE     32
+#define FAT_ENTRIES_PER_BLOCK (512 / FAT_DIRENT_SIZE)
+
+// Sentinel returned by fat_next_cluster at the end of a chain
+#define FAT_CHAIN_END       0
+
+static uint8_t fat_bounce[512] __attribute__((aligned(64)));
+
+static uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static char fat_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+static int fat_name_equal(const char *a, const char *b, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (fat_upper(a[i]) != fat_upper(b[i])) return 0;
+    }
+    return b[len] == '\0';
+}
+
+static uint32_t fat_cluster_lba(const fat_volume_t *vol, uint32_t cluster) {
+    return vol->data_lba + ((cluster - 2) << vol->cluster_shift);
+}
+
+static int fat_cluster_valid(const fat_volume_t *vol, uint32_t cluster) {
+    return cluster >= 2 && cluster < vol->num_clusters + 2;
+}
+
+// FAT sector pinned while walking a chain
+typedef struct {
+    fat_volume_t *vol;
+    uint32_t lba;
+    const uint8_t *data;
+} fat_cursor_t;
+
+static void fat_cursor_release(fat_cursor_t *cur) {
+    if (cur->data) {
+        bcache_unpin(cur->data);
+        cur->data = 0;
+    }
+}
+
+// Follow the FAT: *next receives the following cluster or FAT_CHAIN_END
+static int fat_next_cluster(fat_cursor_t *cur, uint32_t cluster, uint32_t *next) {
+    fat_volume_t *vol = cur->vol;
+    uint32_t offset = cluster * (vol->type == 32 ? 4 : 2);
+    uint32_t lba = vol->fat_lba + offset / 512;
+
+    if (!cur->data || cur->lba != lba) {
+        fat_cursor_release(cur);
+        cur->data = bcache_pin(vol->dev, lba);
+        if (!cur->data) return FAT_ERR_CORRUPT;
+        cur->lba = lba;
+    }
+
+    uint32_t value;
+    if (vol->type == 32) {
+        value = rd32(cur->data + offset % 512) & 0x0FFFFFFF;
+        if (value >= 0x0FFFFFF8) value = FAT_CHAIN_END;
+    } else {
+        value = rd16(cur->data + offset % 512);
+        if (value >= 0xFFF8) value = FAT_CHAIN_END;
+    }
+
+    if (value != FAT_CHAIN_END && !fat_cluster_valid(vol, value)) {
+        return FAT_ERR_CORRUPT;
+    }
+    *next = value;
+    return FAT_OK;
+}
+
+int fat_mount(fat_volume_t *vol, blockdev_t *dev) {
+    if (!dev) return BLK_ERR_NODEV;
+    if (bcache_get_stats()->entries == 0) {
+        int rc = bcache_init(BCACHE_DEFAULT_ENTRIES);
+        if (rc != BLK_OK) return rc;
+    }
+
+    const uint8_t *bs = bcache_pin(dev, 0);
+    if (!bs) return FAT_ERR_NOFS;
+
+    int rc = FAT_OK;
+    uint32_t bytes_per_sector = rd16(bs + 11);
+    uint32_t cluster_blocks = bs[13];
+    uint32_t reserved = rd16(bs + 14);
+    uint32_t num_fats = bs[16];
+    uint32_t root_entries = rd16(bs + 17);
+    uint32_t total = rd16(bs + 19) ? rd16(bs + 19) : rd32(bs + 32);
+    uint32_t fat_blocks = rd16(bs + 22) ? rd16(bs + 22) : rd32(bs + 36);
+
+    if (bs[510] != 0x55 || bs[511] != 0xAA || (bs[0] != 0xEB && bs[0] != 0xE9) ||
+        cluster_blocks == 0 || (cluster_blocks & (cluster_blocks - 1)) ||
+        num_fats == 0 || fat_blocks == 0 || reserved == 0) {
+        rc = FAT_ERR_NOFS;
+    } else if (bytes_per_sector != 512) {
+        rc = FAT_ERR_UNSUPPORTED;
+    }
+
+    if (rc == FAT_OK) {
+        vol->dev = dev;
+        vol->cluster_blocks = cluster_blocks;
+        vol->cluster_shift = 0;
+        while ((1u << vol->cluster_shift) < cluster_blocks) vol->cluster_shift++;
+
+        vol->fat_lba = reserved;
+        vol->fat_blocks = fat_blocks;
+        vol->root_lba = reserved + num_fats * fat_blocks;
+        vol->root_blocks = (root_entries * FAT_DIRENT_SIZE + 511) / 512;
+        vol->data_lba = vol->root_lba + vol->root_blocks;
+
+        if (total <= vol->data_lba || total > dev->num_blocks) {
+            rc = FAT_ERR_NOFS;
+        } else {
+            vol->num_clusters = (total - vol->data_lba) >> vol->cluster_shift;
+        }
+    }
+
+    if (rc == FAT_OK) {
+        // The cluster count alone decides the FAT type
+        const uint8_t *label;
+        if (vol->num_clusters < 4085) {
+            rc = FAT_ERR_UNSUPPORTED;
+            label = 0;
+        } else if (vol->num_clusters < 65525) {
+            vol->type = 16;
+            vol->root_cluster = 0;
+            label = bs + 43;
+        } else {
+            vol->type = 32;
+            vol->root_cluster = rd32(bs + 44);
+            label = bs + 71;
+            if (!fat_cluster_valid(vol, vol->root_cluster)) rc = FAT_ERR_CORRUPT;
+        }
+
+        if (label) {
+            int n = 11;
+            for (int i = 0; i < 11; i++) vol->label[i] = (char)label[i];
+            while (n > 0 && vol->label[n - 1] == ' ') n--;
+            vol->label[n] = '\0';
+        }
+    }
+
+    bcache_unpin(bs);
+    return rc;
+}
+
+static void fat_dir_start(fat_volume_t *vol, uint32_t cluster, fat_dir_t *dir) {
+    dir->vol = vol;
+    dir->cluster = (cluster == 0 && vol->type == 32) ? vol->root_cluster : cluster;
+    dir->block = 0;
+    dir->index = 0;
+    dir->end = 0;
+    dir->lfn_next = 0;
+    dir->lfn_valid = 0;
+}
+
+// Format an 8.3 name, honoring the lowercase flags in byte 12
+static void fat_short_name(const uint8_t *e, char *out) {
+    int n = 0;
+    for (int i = 0; i < 8 && e[i] != ' '; i++) {
+        char c = (char)((i == 0 && e[0] == 0x05) ? 0xE5 : e[i]);
+        out[n++] = (e[12] & 0x08 && c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    if (e[8] != ' ') {
+        out[n++] = '.';
+        for (int i = 8; i < 11 && e[i] != ' '; i++) {
+            char c = (char)e[i];
+            out[n++] = (e[12] & 0x10 && c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+        }
+    }
+    out[n] = '\0';
+}
+
+static uint8_t fat_lfn_checksum(const uint8_t *e) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + e[i]);
+    }
+    return sum;
+}
+
+// Collect the 13 characters of one long-name entry
+static void fat_lfn_entry(fat_dir_t *dir, const uint8_t *e) {
+    static const uint8_t offsets[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+    uint8_t seq = e[0] & 0x1F;
+
+    if (e[0] & 0x40) {
+        // Last entry of the name comes first
+        dir->lfn_next = seq;
+        dir->lfn_sum = e[13];
+        dir->lfn_valid = 0;
+        dir->lfn[0] = '\0';
+    }
+    if (seq == 0 || seq != dir->lfn_next || e[13] != dir->lfn_sum || seq * 13 > FAT_NAME_MAX + 13) {
+        dir->lfn_next = 0;
+        dir->lfn_valid = 0;
+        return;
+    }
+
+    uint32_t base = (seq - 1) * 13;
+    for (int i = 0; i < 13; i++) {
+        uint16_t ch = rd16(e + offsets[i]);
+        if (base + i >= FAT_NAME_MAX) break;
+        if (ch == 0x0000) {
+            dir->lfn[base + i] = '\0';
+            break;
+        }
+        dir->lfn[base + i] = (ch == 0xFFFF) ? '\0' : (ch < 0x80 ? (char)ch : '?');
+    }
+    if (e[0] & 0x40) {
+        uint32_t last = base + 13 > FAT_NAME_MAX ? FAT_NAME_MAX : base + 13;
+        dir->lfn[last] = '\0';
+    }
+
+    dir->lfn_next = seq - 1;
+    dir->lfn_valid = (dir->lfn_next == 0);
+}
+
+// Fields of a short entry; the name is the 8.3 one
+static void fat_short_entry(const fat_volume_t *vol, const uint8_t *e, fat_dirent_t *entry) {
+    fat_short_name(e, entry->short_name);
+    strcpy(entry->name, entry->short_name);
+    entry->attr = e[11];
+    entry->first_cluster = rd16(e + 26);
+    if (vol->type == 32) entry->first_cluster |= (uint32_t)rd16(e + 20) << 16;
+    entry->size = rd32(e + 28);
+    entry->mtime = rd16(e + 22);
+    entry->mdate = rd16(e + 24);
+}
+
+// Advance to the next directory block; returns 0 at the end
+static int fat_dir_advance(fat_dir_t *dir) {
+    fat_volume_t *vol = dir->vol;
+    dir->index = 0;
+    dir->block++;
+
+    if (dir->cluster == 0) {
+        // FAT16 root: fixed region
+        return dir->block < vol->root_blocks;
+    }
+    if (dir->block < vol->cluster_blocks) {
+        return 1;
+    }
+
+    fat_cursor_t cur = { vol, 0, 0 };
+    uint32_t next;
+    int rc = fat_next_cluster(&cur, dir->cluster, &next);
+    fat_cursor_release(&cur);
+    if (rc != FAT_OK) return rc;
+    if (next == FAT_CHAIN_END) return 0;
+
+    dir->cluster = next;
+    dir->block = 0;
+    return 1;
+}
+
+int fat_readdir(fat_dir_t *dir, fat_dirent_t *entry) {
+    fat_volume_t *vol = dir->vol;
+
+    while (!dir->end) {
+        if (dir->index == FAT_ENTRIES_PER_BLOCK) {
+            int rc = fat_dir_advance(dir);
+            if (rc <= 0) {
+                dir->end = 1;
+                return rc;
+            }
+        }
+
+        uint32_t lba = (dir->cluster == 0) ? vol->root_lba + dir->block
+                                           : fat_cluster_lba(vol, dir->cluster) + dir->block;
+        const uint8_t *block = bcache_pin(vol->dev, lba);
+        if (!block) return FAT_ERR_CORRUPT;
+
+        int found = 0;
+        while (dir->index < FAT_ENTRIES_PER_BLOCK && !found) {
+            const uint8_t *e = block + dir->index * FAT_DIRENT_SIZE;
+            dir->index++;
+
+            if (e[0] == 0x00) {
+                dir->end = 1;
+                break;
+            }
+            if (e[0] == 0xE5) {
+                dir->lfn_valid = 0;
+                dir->lfn_next = 0;
+                continue;
+            }
+            if ((e[11] & 0x3F) == FAT_ATTR_LFN) {
+                fat_lfn_entry(dir, e);
+                continue;
+            }
+            if (e[11] & FAT_ATTR_VOLUME_ID) {
+                dir->lfn_valid = 0;
+                continue;
+            }
+
+            fat_short_entry(vol, e, entry);
+            if (dir->lfn_valid && fat_lfn_checksum(e) == dir->lfn_sum) {
+                strcpy(entry->name, dir->lfn);
+            }
+            dir->lfn_valid = 0;
+            dir->lfn_next = 0;
+
+            entry->entry_lba = lba;
+            entry->entry_offset = (uint32_t)(e - block);
+            found = 1;
+        }
+
+        bcache_unpin(block);
+        if (found) return 1;
+    }
+    return 0;
+}
+
+// Resolve a path to its directory entry; the root has no entry and is
+// reported as a directory with cluster 0
+static int fat_lookup(fat_volume_t *vol, const char *path, fat_dirent_t *entry) {
+    entry->name[0] = '\0';
+    entry->short_name[0] = '\0';
+    entry->attr = FAT_ATTR_DIRECTORY;
+    entry->first_cluster = 0;
+    entry->size = 0;
+    entry->mtime = 0;
+    entry->mdate = 0;
+    entry->entry_lba = 0;
+    entry->entry_offset = 0;
+
+    while (*path) {
+        while (*path == '/') path++;
+        if (!*path) break;
+
+        uint32_t len = 0;
+        while (path[len] && path[len] != '/') len++;
+        if (!(entry->attr & FAT_ATTR_DIRECTORY)) return FAT_ERR_NOTDIR;
+
+        fat_dir_t dir;
+        fat_dir_start(vol, entry->first_cluster, &dir);
+
+        int rc;
+        while ((rc = fat_readdir(&dir, entry)) > 0) {
+            if (fat_name_equal(path, entry->name, len) ||
+                fat_name_equal(path, entry->short_name, len)) {
+                break;
+            }
+        }
+        if (rc < 0) return rc;
+        if (rc == 0) return FAT_ERR_NOTFOUND;
+
+        path += len;
+    }
+    return FAT_OK;
+}
+
+int fat_stat(fat_volume_t *vol, const char *path, fat_dirent_t *entry) {
+    return fat_lookup(vol, path, entry);
+}
+
+int fat_stat_at(fat_volume_t *vol, uint32_t lba, uint32_t offset, fat_dirent_t *entry) {
+    if (offset % FAT_DIRENT_SIZE || offset >= 512) return FAT_ERR_NOTFOUND;
+
+    const uint8_t *block = bcache_pin(vol->dev, lba);
+    if (!block) return FAT_ERR_CORRUPT;
+
+    const uint8_t *e = block + offset;
+    int rc = FAT_OK;
+    if (e[0] == 0x00 || e[0] == 0xE5 || (e[11] & 0x3F) == FAT_ATTR_LFN ||
+        (e[11] & FAT_ATTR_VOLUME_ID)) {
+        rc = FAT_ERR_NOTFOUND;
+    } else {
+        fat_short_entry(vol, e, entry);
+        entry->entry_lba = lba;
+        entry->entry_offset = offset;
+    }
+
+    bcache_unpin(block);
+    return rc;
+}
+
+void fat_dir_blocks(const fat_volume_t *vol, uint32_t cluster, fat_extent_t *ext) {
+    if (cluster == 0 && vol->type == 16) {
+        ext->lba = vol->root_lba;
+        ext->blocks = vol->root_blocks;
+        return;
+    }
+    if (cluster == 0) cluster = vol->root_cluster;
+    ext->lba = fat_cluster_lba(vol, cluster);
+    ext->blocks = vol->cluster_blocks;
+}
+
+int fat_opendir(fat_volume_t *vol, const char *path, fat_dir_t *dir) {
+    fat_dirent_t entry;
+    int rc = fat_lookup(vol, path, &entry);
+    if (rc != FAT_OK) return rc;
+    if (!(entry.attr & FAT_ATTR_DIRECTORY)) return FAT_ERR_NOTDIR;
+
+    fat_dir_start(vol, entry.first_cluster, dir);
+    return FAT_OK;
+}
+
+// Map clusters from `cluster` (file block `block`) into the extent table
+static int fat_map_from(fat_file_t *file, uint32_t cluster, uint32_t block) {
+    fat_volume_t *vol = file->vol;
+    fat_cursor_t cur = { vol, 0, 0 };
+    int rc = FAT_OK;
+
+    file->map_block = block;
+    file->map_blocks = 0;
+    file->num_extents = 0;
+    file->map_next = FAT_CHAIN_END;
+
+    // Bound the walk by the volume size so a looping chain terminates
+    uint32_t budget = vol->num_clusters;
+    while (cluster != FAT_CHAIN_END) {
+        uint32_t lba = fat_cluster_lba(vol, cluster);
+        fat_extent_t *ext = file->num_extents ? &file->extents[file->num_extents - 1] : 0;
+
+        if (ext && ext->lba + ext->blocks == lba) {
+            ext->blocks += vol->cluster_blocks;
+        } else if (file->num_extents == FAT_MAX_EXTENTS) {
+            file->map_next = cluster;
+            break;
+        } else {
+            ext = &file->extents[file->num_extents++];
+            ext->lba = lba;
+            ext->blocks = vol->cluster_blocks;
+        }
+        file->map_blocks += vol->cluster_blocks;
+
+        if (budget-- == 0) {
+            rc = FAT_ERR_CORRUPT;
+            break;
+        }
+        rc = fat_next_cluster(&cur, cluster, &cluster);
+        if (rc != FAT_OK) break;
+    }
+
+    fat_cursor_release(&cur);
+    return rc;
+}
+
+int fat_open(fat_volume_t *vol, const char *path, fat_file_t *file) {
+    fat_dirent_t entry;
+    int rc = fat_lookup(vol, path, &entry);
+    if (rc != FAT_OK) return rc;
+    return fat_open_entry(vol, &entry, file);
+}
+
+int fat_open_entry(fat_volume_t *vol, const fat_dirent_t *entry, fat_file_t *file) {
+    if (entry->attr & FAT_ATTR_DIRECTORY) return FAT_ERR_ISDIR;
+    return fat_open_extents(vol, entry->first_cluster, entry->size, 0, 0, file);
+}
+
+int fat_open_extents(fat_volume_t *vol, uint32_t first_cluster, uint32_t size,
+                     const fat_extent_t *extents, uint32_t count, fat_file_t *file) {
+    file->vol = vol;
+    file->first_cluster = first_cluster;
+    file->size = size;
+    file->pos = 0;
+    file->map_block = 0;
+    file->map_blocks = 0;
+    file->map_next = FAT_CHAIN_END;
+    file->num_extents = 0;
+
+    if (size == 0) return FAT_OK;
+    if (!fat_cluster_valid(vol, first_cluster)) return FAT_ERR_CORRUPT;
+
+    // A saved map is trusted only as far as it stays on the volume
+    uint32_t data_end = vol->data_lba + (vol->num_clusters << vol->cluster_shift);
+    uint32_t blocks = 0;
+    if (count > FAT_MAX_EXTENTS) count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const fat_extent_t *ext = &extents[i];
+        if (ext->lba < vol->data_lba || ext->blocks > data_end - ext->lba) {
+            count = 0;
+            break;
+        }
+        file->extents[i] = *ext;
+        blocks += ext->blocks;
+    }
+    if (count == 0 || blocks < (size + 511) / 512) {
+        return fat_map_from(file, first_cluster, 0);
+    }
+
+    file->num_extents = count;
+    file->map_blocks = blocks;
+    return FAT_OK;
+}
+
+int fat_open_blocks(fat_volume_t *vol, blockdev_t *dev, uint32_t lba, uint32_t size,
+                    fat_file_t *file) {
+    uint32_t blocks = (size + 511) / 512;
+    if (size == 0 || lba >= dev->num_blocks || blocks > dev->num_blocks - lba) {
+        return BLK_ERR_RANGE;
+    }
+
+    memset(vol, 0, sizeof(*vol));
+    vol->dev = dev;
+
+    // One extent covering the whole file, so fat_map never walks a chain
+    file->vol = vol;
+    file->first_cluster = 0;
+    file->size = size;
+    file->pos = 0;
+    file->map_block = 0;
+    file->map_blocks = blocks;
+    file->map_next = FAT_CHAIN_END;
+    file->num_extents = 1;
+    file->extents[0].lba = lba;
+    file->extents[0].blocks = blocks;
+    return FAT_OK;
+}
+
+int fat_map(fat_file_t *file, uint32_t block, uint32_t *lba, uint32_t *count) {
+    uint32_t file_blocks = (file->size + 511) / 512;
+    if (block >= file_blocks) return BLK_ERR_RANGE;
+
+    // Remap from the start (seeking back) or continue past the table
+    if (block < file->map_block) {
+        int rc = fat_map_from(file, file->first_cluster, 0);
+        if (rc != FAT_OK) return rc;
+    }
+    while (block >= file->map_block + file->map_blocks) {
+        if (file->map_next == FAT_CHAIN_END) return FAT_ERR_CORRUPT;
+        int rc = fat_map_from(file, file->map_next, file->map_block + file->map_blocks);
+        if (rc != FAT_OK) return rc;
+    }
+
+    uint32_t offset = block - file->map_block;
+    for (uint32_t i = 0; i < file->num_extents; i++) {
+        const fat_extent_t *ext = &file->extents[i];
+        if (offset < ext->blocks) {
+            uint32_t run = ext->blocks - offset;
+            *lba = ext->lba + offset;
+            *count = run < file_blocks - block ? run : file_blocks - block;
+            return FAT_OK;
+        }
+        offset -= ext->blocks;
+    }
+    return FAT_ERR_CORRUPT;
+}
+
+int fat_read(fat_file_t *file, void *buffer, uint32_t size) {
+    uint8_t *out = (uint8_t *)buffer;
+    if (file->pos >= file->size) return 0;
+    if (size > file->size - file->pos) size = file->size - file->pos;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t block = file->pos / 512;
+        uint32_t offset = file->pos % 512;
+        uint32_t lba, run;
+
+        int rc = fat_map(file, block, &lba, &run);
+        if (rc != FAT_OK) return rc;
+
+        uint32_t n;
+        if (offset || size - done < 512) {
+            // Partial block through a bounce buffer
+            rc = blockdev_read(file->vol->dev, lba, 1, fat_bounce);
+            if (rc != BLK_OK) return rc;
+            n = 512 - offset;
+            if (n > size - done) n = size - done;
+            memcpy(out + done, fat_bounce + offset, n);
+        } else {
+            // Whole blocks straight into the caller's buffer
+            uint32_t blocks = (size - done) / 512;
+            if (blocks > run) blocks = run;
+            rc = blockdev_read(file->vol->dev, lba, blocks, out + done);
+            if (rc != BLK_OK) return rc;
+            n = blocks * 512;
+        }
+
+        file->pos += n;
+        done += n;
+    }
+    return (int)done;
+}
+
+int fat_seek(fat_file_t *file, uint32_t pos) {
+    if (pos > file->size) return BLK_ERR_RANGE;
+    file->pos = pos;
+    return FAT_OK;
+}
+
+const char *fat_strerror(int err) {
+    switch (err) {
+        case FAT_ERR_NOFS:          return "no FAT filesystem";
+        case FAT_ERR_NOTFOUND:      return "not found";
+        case FAT_ERR_NOTDIR:        return "not a directory";
+        case FAT_ERR_ISDIR:         return "is a directory";
+        case FAT_ERR_CORRUPT:       return "corrupt filesystem";
+        case FAT_ERR_UNSUPPORTED:   return "unsupported FAT variant";
+        default:                    return blockdev_strerror(err);
+    }
+}
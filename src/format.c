@@ -0,0 +1,223 @@
+#include "format.h"
+
+// Numbers are converted backwards into a small buffer, two decimal digits
+// per division from a pair table; 64-bit values are split into 8-digit
+// groups first so the digit loop stays in 32-bit arithmetic.
+
+#define FMT_LEFT    0x01    // -
+#define FMT_ZERO    0x02    // 0
+#define FMT_PLUS    0x04    // +
+#define FMT_SPACE   0x08    // space
+#define FMT_ALT     0x10    // #
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+typedef struct {
+    char *buf;
+    uint32_t size;
+    uint32_t len;           // Full output length, including what did not fit
+} format_out_t;
+
+static void out_mem(format_out_t *o, const char *s, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++, o->len++) {
+        if (o->len + 1 < o->size) o->buf[o->len] = s[i];
+    }
+}
+
+static void out_repeat(format_out_t *o, char c, int n) {
+    for (; n > 0; n--, o->len++) {
+        if (o->len + 1 < o->size) o->buf[o->len] = c;
+    }
+}
+
+// Digits of v ending just before end; returns where they start
+static char *format_dec32(char *end, uint32_t v) {
+    while (v >= 100) {
+        uint32_t q = v / 100;
+        const char *d = &digit_pairs[(v - q * 100) * 2];
+        *--end = d[1];
+        *--end = d[0];
+        v = q;
+    }
+    if (v >= 10) {
+        *--end = digit_pairs[v * 2 + 1];
+        *--end = digit_pairs[v * 2];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static char *format_dec(char *end, uint64_t v) {
+    while (v >> 32) {
+        uint32_t low = (uint32_t)(v % 100000000);
+        v /= 100000000;
+        char *start = format_dec32(end, low);
+        while (start > end - 8) *--start = '0';
+        end = start;
+    }
+    return format_dec32(end, (uint32_t)v);
+}
+
+static char *format_hex(char *end, uint64_t v, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    do {
+        *--end = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+    return end;
+}
+
+// Emit prefix, precision zeros and body, padded out to width
+static void out_field(format_out_t *o, const char *prefix, const char *body, int len,
+                      int precision, int width, uint32_t flags) {
+    int prefix_len = 0;
+    while (prefix[prefix_len]) prefix_len++;
+    int zeros = precision > len ? precision - len : 0;
+    int pad = width - prefix_len - zeros - len;
+
+    if (flags & FMT_LEFT) {
+        out_mem(o, prefix, prefix_len);
+        out_repeat(o, '0', zeros);
+        out_mem(o, body, len);
+        out_repeat(o, ' ', pad);
+    } else if (flags & FMT_ZERO) {
+        out_mem(o, prefix, prefix_len);
+        out_repeat(o, '0', zeros + pad);
+        out_mem(o, body, len);
+    } else {
+        out_repeat(o, ' ', pad);
+        out_mem(o, prefix, prefix_len);
+        out_repeat(o, '0', zeros);
+        out_mem(o, body, len);
+    }
+}
+
+int vsnprintf(char *buf, uint32_t size, const char *fmt, va_list args) {
+    format_out_t o = { buf, size, 0 };
+
+    while (*fmt) {
+        // Literal text goes out as one run
+        const char *run = fmt;
+        while (*fmt && *fmt != '%') fmt++;
+        out_mem(&o, run, (uint32_t)(fmt - run));
+        if (!*fmt) break;
+        fmt++;
+
+        uint32_t flags = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') flags |= FMT_LEFT;
+            else if (*fmt == '0') flags |= FMT_ZERO;
+            else if (*fmt == '+') flags |= FMT_PLUS;
+            else if (*fmt == ' ') flags |= FMT_SPACE;
+            else if (*fmt == '#') flags |= FMT_ALT;
+            else break;
+        }
+
+        int width = 0;
+        if (*fmt == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                flags |= FMT_LEFT;
+                width = -width;
+            }
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+        }
+
+        int precision = -1;
+        if (*fmt == '.') {
+            fmt++;
+            precision = 0;
+            if (*fmt == '*') {
+                precision = va_arg(args, int);
+                if (precision < 0) precision = -1;
+                fmt++;
+            } else {
+                while (*fmt >= '0' && *fmt <= '9') precision = precision * 10 + (*fmt++ - '0');
+            }
+        }
+
+        int longs = 0;
+        while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z') {
+            if (*fmt == 'l') longs++;
+            fmt++;
+        }
+
+        char conv = *fmt;
+        if (!conv) break;
+        fmt++;
+
+        char digits[24];
+        char *end = digits + sizeof(digits);
+        char *start = end;
+        const char *prefix = "";
+        uint64_t v;
+
+        switch (conv) {
+            case 'd':
+            case 'i': {
+                int64_t s = longs >= 2 ? va_arg(args, long long) :
+                            longs ? va_arg(args, long) : va_arg(args, int);
+                v = s < 0 ? -(uint64_t)s : (uint64_t)s;
+                prefix = s < 0 ? "-" : (flags & FMT_PLUS) ? "+" : (flags & FMT_SPACE) ? " " : "";
+                if (v || precision != 0) start = format_dec(end, v);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+                v = longs >= 2 ? va_arg(args, unsigned long long) :
+                    longs ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+                if (v || precision != 0) {
+                    start = conv == 'u' ? format_dec(end, v) : format_hex(end, v, conv == 'X');
+                }
+                if (conv != 'u' && (flags & FMT_ALT) && v) prefix = conv == 'X' ? "0X" : "0x";
+                break;
+            case 'p':
+                v = (uintptr_t)va_arg(args, void *);
+                start = format_hex(end, v, 0);
+                prefix = "0x";
+                if (precision < 8) precision = 8;
+                break;
+            case 'c':
+                digits[0] = (char)va_arg(args, int);
+                out_field(&o, "", digits, 1, -1, width, flags & FMT_LEFT);
+                continue;
+            case 's': {
+                const char *s = va_arg(args, const char *);
+                if (!s) s = "(null)";
+                int len = 0;
+                while (s[len] && (precision < 0 || len < precision)) len++;
+                out_field(&o, "", s, len, -1, width, flags & FMT_LEFT);
+                continue;
+            }
+            case '%':
+                out_mem(&o, "%", 1);
+                continue;
+            default:
+                out_mem(&o, "%", 1);
+                out_mem(&o, &conv, 1);
+                continue;
+        }
+
+        // A precision turns off zero padding, as in C
+        if (precision >= 0) flags &= ~FMT_ZERO;
+        out_field(&o, prefix, start, (int)(end - start), precision, width, flags);
+    }
+
+    if (size) buf[o.len < size ? o.len : size - 1] = '\0';
+    return (int)o.len;
+}
+
+int snprintf(char *buf, uint32_t size, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return n;
+}
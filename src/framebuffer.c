@@ -1,86 +1,61 @@
 #include "framebuffer.h"
 #include "hardware.h"
 #include "font.h"
+#include "format.h"
+#include "mailbox.h"
+#include "timer.h"
 
 // Framebuffer address mask (removes VC/ARM address bit)
 #define FRAMEBUFFER_ADDR_MASK 0x3FFFFFFF
 
 static framebuffer_t fb_info;
 
-// Mailbox property interface
-typedef struct {
-    uint32_t size;
-    uint32_t request_code;
-    uint32_t tags[32];
-} mailbox_property_t;
-
-static uint32_t mailbox_property[256] __attribute__((aligned(16)));
-
-static int mailbox_call(uint8_t channel) {
-    uint32_t addr = (uint32_t)mailbox_property;
-
-    // Wait for mailbox to be available
-    while (MMIO_READ(MAILBOX_STATUS) & MAILBOX_FULL) { }
-
-    // Write the address of our message to the mailbox with channel identifier
-    MMIO_WRITE(MAILBOX_WRITE, (addr & ~0xF) | (channel & 0xF));
-
-    // Wait for the response
-    while (1) {
-        while (MMIO_READ(MAILBOX_STATUS) & MAILBOX_EMPTY) { }
-
-        uint32_t response = MMIO_READ(MAILBOX_READ);
-
-        if ((response & 0xF) == channel && (response & ~0xF) == addr) {
-            return mailbox_property[1] == 0x80000000;
-        }
-    }
-}
+static volatile uint32_t mailbox_property[36] __attribute__((aligned(16)));
 
 int fb_init(uint32_t width, uint32_t height, uint32_t depth) {
     int i = 0;
 
     // Set size
     mailbox_property[i++] = 35 * 4;  // Buffer size in bytes
-    mailbox_property[i++] = 0;        // Request code
+    mailbox_property[i++] = MBOX_REQUEST;
 
     // Set physical display size
-    mailbox_property[i++] = 0x48003;  // Tag id
+    mailbox_property[i++] = MBOX_TAG_SET_PHYS_SIZE;
     mailbox_property[i++] = 8;        // Value buffer size
     mailbox_property[i++] = 8;        // Request/response size
     mailbox_property[i++] = width;
     mailbox_property[i++] = height;
 
     // Set virtual display size
-    mailbox_property[i++] = 0x48004;
+    mailbox_property[i++] = MBOX_TAG_SET_VIRT_SIZE;
     mailbox_property[i++] = 8;
     mailbox_property[i++] = 8;
     mailbox_property[i++] = width;
     mailbox_property[i++] = height;
 
     // Set depth
-    mailbox_property[i++] = 0x48005;
+    mailbox_property[i++] = MBOX_TAG_SET_DEPTH;
     mailbox_property[i++] = 4;
     mailbox_property[i++] = 4;
     mailbox_property[i++] = depth;
 
     // Allocate framebuffer
-    mailbox_property[i++] = 0x40001;
+    mailbox_property[i++] = MBOX_TAG_ALLOCATE_FB;
     mailbox_property[i++] = 8;
     mailbox_property[i++] = 8;
     mailbox_property[i++] = 16;       // Alignment
     mailbox_property[i++] = 0;        // Size returned here
 
     // Get pitch
-    mailbox_property[i++] = 0x40008;
+    mailbox_property[i++] = MBOX_TAG_GET_PITCH;
     mailbox_property[i++] = 4;
     mailbox_property[i++] = 4;
     mailbox_property[i++] = 0;        // Pitch returned here
 
     // End tag
-    mailbox_property[i++] = 0;
+    mailbox_property[i++] = MBOX_TAG_END;
 
-    if (!mailbox_call(8)) {
+    if (!mailbox_call(mailbox_property, MBOX_CH_PROPERTY)) {
         return -1;
     }
 
@@ -90,9 +65,45 @@ int fb_init(uint32_t width, uint32_t height, uint32_t depth) {
     fb_info.pitch = mailbox_property[33];
     fb_info.buffer = (uint32_t *)(mailbox_property[28] & FRAMEBUFFER_ADDR_MASK);
 
+    // Largest integer scale at which the logical screen still fits
+    uint32_t sx = fb_info.width / FB_LOGICAL_WIDTH;
+    uint32_t sy = fb_info.height / FB_LOGICAL_HEIGHT;
+    fb_set_scale(sx < sy ? sx : sy);
+
     return 0;
 }
 
+int fb_init_native(void) {
+    uint32_t width = 0, height = 0;
+
+    // The firmware reports the EDID preferred mode as the physical size
+    if (mailbox_get_pair(MBOX_TAG_GET_PHYS_SIZE, &width, &height) != 0 ||
+        width < FB_LOGICAL_WIDTH || height < FB_LOGICAL_HEIGHT) {
+        width = FB_LOGICAL_WIDTH;
+        height = FB_LOGICAL_HEIGHT;
+    }
+
+    if (fb_init(width, height, 32) == 0) {
+        return 0;
+    }
+    return fb_init(FB_LOGICAL_WIDTH, FB_LOGICAL_HEIGHT, 32);
+}
+
+void fb_set_scale(uint32_t scale) {
+    if (scale < 1) scale = 1;
+    if (scale > FB_MAX_SCALE) scale = FB_MAX_SCALE;
+
+    fb_info.scale = scale;
+    fb_info.origin_x = 0;
+    fb_info.origin_y = 0;
+    if (fb_info.width > FB_LOGICAL_WIDTH * scale) {
+        fb_info.origin_x = (fb_info.width - FB_LOGICAL_WIDTH * scale) / 2;
+    }
+    if (fb_info.height > FB_LOGICAL_HEIGHT * scale) {
+        fb_info.origin_y = (fb_info.height - FB_LOGICAL_HEIGHT * scale) / 2;
+    }
+}
+
 framebuffer_t *fb_get_info(void) {
     return &fb_info;
 }
@@ -105,23 +116,102 @@ void fb_draw_pixel(uint32_t x, uint32_t y, uint32_t color) {
 }
 
 void fb_clear(uint32_t color) {
+    uint32_t stride = fb_info.pitch / 4;
+    uint32_t *row = fb_info.buffer;
+
     for (uint32_t y = 0; y < fb_info.height; y++) {
         for (uint32_t x = 0; x < fb_info.width; x++) {
-            fb_draw_pixel(x, y, color);
+            row[x] = color;
         }
+        row += stride;
     }
 }
 
-void fb_draw_char(uint32_t x, uint32_t y, char c, uint32_t fg, uint32_t bg) {
-    const uint8_t *glyph = font8x16[(uint8_t)c];
+// Fetch one glyph row expanded to 8*scale pixels
+static inline uint32_t fb_glyph_row(uint8_t c, uint32_t row, uint32_t scale) {
+    if (scale == 1) {
+        return font8x16[c][row];
+    }
+
+    uint32_t idx = 0;  // Space for glyphs outside the atlas
+    if (c >= FONT_ATLAS_FIRST && c < FONT_ATLAS_FIRST + FONT_ATLAS_COUNT) {
+        idx = c - FONT_ATLAS_FIRST;
+    }
+    return (scale == 2) ? font_atlas_2x[idx][row] : font_atlas_3x[idx][row];
+}
+
+// Pixels for every 4-bit run of a glyph row in the current colors: each
+// expanded row goes out as whole 4-word groups with no per-pixel test.
+// Rebuilt only when the fg/bg pair changes, which text rarely does.
+static uint32_t nibble_pixels[16][4];
+static uint32_t nibble_fg, nibble_bg;
+static int nibble_valid;
 
-    for (int row = 0; row < 16; row++) {
-        uint8_t line = glyph[row];
-        for (int col = 0; col < 8; col++) {
-            uint32_t color = (line & (1 << (7 - col))) ? fg : bg;
-            fb_draw_pixel(x + col, y + row, color);
+static void fb_set_colors(uint32_t fg, uint32_t bg) {
+    if (nibble_valid && fg == nibble_fg && bg == nibble_bg) return;
+    for (uint32_t n = 0; n < 16; n++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            nibble_pixels[n][i] = (n & (8u >> i)) ? fg : bg;
         }
     }
+    nibble_fg = fg;
+    nibble_bg = bg;
+    nibble_valid = 1;
+}
+
+// Blit a glyph at physical (px, py). Each expanded row is written once
+// and then copied to the remaining scale-1 lines.
+static void fb_blit_glyph(uint32_t px, uint32_t py, uint8_t c,
+                          uint32_t fg, uint32_t bg, uint32_t scale) {
+    uint32_t w = 8 * scale;
+
+    if (px + w > fb_info.width || py + 16 * scale > fb_info.height) {
+        // Clipped at the screen edge - slow per-pixel path
+        for (uint32_t row = 0; row < 16 * scale; row++) {
+            uint32_t bits = fb_glyph_row(c, row / scale, scale);
+            for (uint32_t col = 0; col < w; col++) {
+                uint32_t color = (bits & (1u << (w - 1 - col))) ? fg : bg;
+                fb_draw_pixel(px + col, py + row, color);
+            }
+        }
+        return;
+    }
+
+    uint32_t stride = fb_info.pitch / 4;
+    uint32_t *dst = fb_info.buffer + py * stride + px;
+
+    fb_set_colors(fg, bg);
+    for (uint32_t row = 0; row < 16; row++) {
+        uint32_t bits = fb_glyph_row(c, row, scale);
+        uint32_t *out = dst;
+
+        // w is 8, 16 or 24: two, four or six nibbles, high one first
+        for (int shift = (int)w - 4; shift >= 0; shift -= 4, out += 4) {
+            const uint32_t *q = nibble_pixels[(bits >> shift) & 0xF];
+            out[0] = q[0];
+            out[1] = q[1];
+            out[2] = q[2];
+            out[3] = q[3];
+        }
+
+        const uint32_t *line = dst;
+        dst += stride;
+        for (uint32_t rep = 1; rep < scale; rep++) {
+            for (uint32_t col = 0; col < w; col += 4) {
+                dst[col] = line[col];
+                dst[col + 1] = line[col + 1];
+                dst[col + 2] = line[col + 2];
+                dst[col + 3] = line[col + 3];
+            }
+            dst += stride;
+        }
+    }
+}
+
+void fb_draw_char(uint32_t x, uint32_t y, char c, uint32_t fg, uint32_t bg) {
+    uint32_t scale = fb_info.scale;
+    fb_blit_glyph(fb_info.origin_x + x * scale, fb_info.origin_y + y * scale,
+                  (uint8_t)c, fg, bg, scale);
 }
 
 void fb_draw_string(uint32_t x, uint32_t y, const char *str, uint32_t fg, uint32_t bg) {
@@ -138,6 +228,15 @@ void fb_draw_string(uint32_t x, uint32_t y, const char *str, uint32_t fg, uint32
     }
 }
 
+void fb_printf(uint32_t x, uint32_t y, uint32_t fg, uint32_t bg, const char *fmt, ...) {
+    char buffer[FB_PRINTF_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    fb_draw_string(x, y, buffer, fg, bg);
+}
+
 void fb_apply_scanlines(void) {
     // Apply scanline effect (darken every other line)
     for (uint32_t y = 1; y < fb_info.height; y += 2) {
@@ -154,3 +253,26 @@ void fb_apply_scanlines(void) {
         }
     }
 }
+
+uint32_t fb_benchmark_glyphs(uint32_t scale, uint32_t count) {
+    if (scale < 1 || scale > FB_MAX_SCALE || count == 0) return 0;
+
+    uint32_t w = 8 * scale;
+    uint32_t h = 16 * scale;
+    uint32_t px = 0, py = 0;
+
+    uint64_t start = timer_get_ticks();
+    for (uint32_t i = 0; i < count; i++) {
+        fb_blit_glyph(px, py, (uint8_t)('!' + i % 94), 0x0000FF00, 0, scale);
+        px += w;
+        if (px + w > fb_info.width) {
+            px = 0;
+            py += h;
+            if (py + h > fb_info.height) py = 0;
+        }
+    }
+    uint64_t elapsed = timer_get_ticks() - start;
+
+    if (elapsed == 0) elapsed = 1;
+    return (uint32_t)(((uint64_t)count * 1000000) / elapsed);
+}
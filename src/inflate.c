@@ -0,0 +1,420 @@
+#include "inflate.h"
+#include "crc32.h"
+#include "memory.h"
+
+#define MAX_BITS    15
+#define MAX_LCODES  286
+#define MAX_DCODES  30
+#define FIX_LCODES  288
+
+#define GZIP_FHCRC      (1 << 1)
+#define GZIP_FEXTRA     (1 << 2)
+#define GZIP_FNAME      (1 << 3)
+#define GZIP_FCOMMENT   (1 << 4)
+
+// Canonical Huffman code plus a direct lookup table for short codes.
+// fast[] entries are (length << 9) | symbol, 0 for codes longer than
+// INFLATE_FAST_BITS.
+typedef struct {
+    uint16_t count[MAX_BITS + 1];
+    uint16_t symbol[FIX_LCODES];
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+} huffman_t;
+
+typedef struct {
+    stream_t *s;
+    uint32_t bitbuf;
+    uint32_t bitcnt;
+    uint8_t *dst;
+    uint32_t pos;
+    uint32_t max;
+} inflate_state_t;
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t clen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Tables for the current block; the fixed code is built once
+static huffman_t lencode, distcode;
+static huffman_t fixed_len, fixed_dist;
+static int fixed_ready = 0;
+
+// Ensure n bits (n <= 24) are buffered
+static int inflate_need(inflate_state_t *st, uint32_t n) {
+    while (st->bitcnt < n) {
+        int b = stream_byte(st->s);
+        if (b < 0) return b;
+        st->bitbuf |= (uint32_t)b << st->bitcnt;
+        st->bitcnt += 8;
+    }
+    return 0;
+}
+
+static int inflate_bits(inflate_state_t *st, uint32_t n, uint32_t *value) {
+    int rc = inflate_need(st, n);
+    if (rc) return rc;
+    *value = st->bitbuf & ((1u << n) - 1);
+    st->bitbuf >>= n;
+    st->bitcnt -= n;
+    return 0;
+}
+
+// Top up the bit buffer from the current chunk without blocking, so the
+// fast table can be used; near the end of input fewer bits may remain
+static void inflate_peek(inflate_state_t *st) {
+    stream_t *s = st->s;
+    if (st->bitcnt < INFLATE_FAST_BITS && s->ptr == s->end) {
+        stream_need(s);
+    }
+    while (st->bitcnt <= 24 && s->ptr != s->end) {
+        st->bitbuf |= (uint32_t)*s->ptr++ << st->bitcnt;
+        st->bitcnt += 8;
+    }
+}
+
+static uint32_t inflate_reverse(uint32_t code, uint32_t len) {
+    uint32_t r = 0;
+    while (len--) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+// Build a code from per-symbol lengths. Incomplete codes are allowed
+// (a lone distance code is legal); over-subscribed ones are not.
+static int huffman_build(huffman_t *h, const uint8_t *lengths, uint32_t n) {
+    uint16_t offs[MAX_BITS + 1];
+    uint16_t next[MAX_BITS + 1];
+
+    memset(h->count, 0, sizeof(h->count));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (uint32_t sym = 0; sym < n; sym++) h->count[lengths[sym]]++;
+    if (h->count[0] == n) return 0;
+
+    int left = 1;
+    for (int len = 1; len <= MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) return STREAM_ERR_FORMAT;
+    }
+
+    offs[1] = 0;
+    next[1] = 0;
+    for (int len = 1; len < MAX_BITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+        next[len + 1] = (uint16_t)((next[len] + h->count[len]) << 1);
+    }
+
+    for (uint32_t sym = 0; sym < n; sym++) {
+        uint32_t len = lengths[sym];
+        if (len == 0) continue;
+
+        h->symbol[offs[len]++] = (uint16_t)sym;
+        uint32_t code = next[len]++;
+        if (len <= INFLATE_FAST_BITS) {
+            uint32_t rev = inflate_reverse(code, len);
+            for (uint32_t i = rev; i < (1u << INFLATE_FAST_BITS); i += 1u << len) {
+                h->fast[i] = (uint16_t)((len << 9) | sym);
+            }
+        }
+    }
+    return 0;
+}
+
+static int inflate_decode(inflate_state_t *st, const huffman_t *h) {
+    inflate_peek(st);
+
+    uint16_t entry = h->fast[st->bitbuf & ((1u << INFLATE_FAST_BITS) - 1)];
+    uint32_t len = entry >> 9;
+    if (entry && len <= st->bitcnt) {
+        st->bitbuf >>= len;
+        st->bitcnt -= len;
+        return entry & 0x1FF;
+    }
+
+    // Canonical walk, one bit at a time
+    int code = 0, first = 0, index = 0;
+    for (len = 1; len <= MAX_BITS; len++) {
+        uint32_t bit;
+        int rc = inflate_bits(st, 1, &bit);
+        if (rc) return rc;
+        code |= (int)bit;
+
+        int count = h->count[len];
+        if (code - count < first) return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return STREAM_ERR_FORMAT;
+}
+
+static int inflate_codes(inflate_state_t *st, const huffman_t *lc, const huffman_t *dc) {
+    while (1) {
+        int sym = inflate_decode(st, lc);
+        if (sym < 0) return sym;
+
+        if (sym < 256) {
+            if (st->pos == st->max) return STREAM_ERR_OVERFLOW;
+            st->dst[st->pos++] = (uint8_t)sym;
+            continue;
+        }
+        if (sym == 256) return 0;
+
+        sym -= 257;
+        if (sym >= 29) return STREAM_ERR_FORMAT;
+        uint32_t extra, len, dist;
+        int rc = inflate_bits(st, length_extra[sym], &extra);
+        if (rc) return rc;
+        len = length_base[sym] + extra;
+
+        int dsym = inflate_decode(st, dc);
+        if (dsym < 0) return dsym;
+        if (dsym >= 30) return STREAM_ERR_FORMAT;
+        rc = inflate_bits(st, dist_extra[dsym], &extra);
+        if (rc) return rc;
+        dist = dist_base[dsym] + extra;
+
+        if (dist > st->pos) return STREAM_ERR_FORMAT;
+        if (len > st->max - st->pos) return STREAM_ERR_OVERFLOW;
+
+        uint8_t *out = st->dst + st->pos;
+        const uint8_t *from = out - dist;
+        if (dist >= len) {
+            memcpy(out, from, len);
+        } else {
+            for (uint32_t i = 0; i < len; i++) out[i] = from[i];
+        }
+        st->pos += len;
+    }
+}
+
+// Next whole byte: drains the bit buffer before touching the stream
+static int inflate_byte(inflate_state_t *st) {
+    if (st->bitcnt >= 8) {
+        int b = (int)(st->bitbuf & 0xFF);
+        st->bitbuf >>= 8;
+        st->bitcnt -= 8;
+        return b;
+    }
+    return stream_byte(st->s);
+}
+
+static void inflate_align(inflate_state_t *st) {
+    st->bitbuf >>= st->bitcnt & 7;
+    st->bitcnt &= ~7u;
+}
+
+static int inflate_stored(inflate_state_t *st) {
+    inflate_align(st);
+
+    uint32_t len = 0, nlen = 0;
+    for (int i = 0; i < 4; i++) {
+        int b = inflate_byte(st);
+        if (b < 0) return b;
+        if (i < 2) len |= (uint32_t)b << (i * 8);
+        else nlen |= (uint32_t)b << ((i - 2) * 8);
+    }
+    if (len != (~nlen & 0xFFFF)) return STREAM_ERR_FORMAT;
+    if (len > st->max - st->pos) return STREAM_ERR_OVERFLOW;
+
+    while (len && st->bitcnt) {
+        st->dst[st->pos++] = (uint8_t)inflate_byte(st);
+        len--;
+    }
+    int rc = stream_read(st->s, st->dst + st->pos, len);
+    if (rc) return rc;
+    st->pos += len;
+    return 0;
+}
+
+static int inflate_fixed(inflate_state_t *st) {
+    if (!fixed_ready) {
+        uint8_t lengths[FIX_LCODES];
+        uint32_t sym = 0;
+        for (; sym < 144; sym++) lengths[sym] = 8;
+        for (; sym < 256; sym++) lengths[sym] = 9;
+        for (; sym < 280; sym++) lengths[sym] = 7;
+        for (; sym < FIX_LCODES; sym++) lengths[sym] = 8;
+        huffman_build(&fixed_len, lengths, FIX_LCODES);
+
+        for (sym = 0; sym < MAX_DCODES; sym++) lengths[sym] = 5;
+        huffman_build(&fixed_dist, lengths, MAX_DCODES);
+        fixed_ready = 1;
+    }
+    return inflate_codes(st, &fixed_len, &fixed_dist);
+}
+
+static int inflate_dynamic(inflate_state_t *st) {
+    uint8_t lengths[MAX_LCODES + MAX_DCODES];
+    uint32_t nlen, ndist, ncode, v;
+    int rc;
+
+    if ((rc = inflate_bits(st, 5, &nlen)) || (rc = inflate_bits(st, 5, &ndist)) ||
+        (rc = inflate_bits(st, 4, &ncode))) {
+        return rc;
+    }
+    nlen += 257;
+    ndist += 1;
+    ncode += 4;
+    if (nlen > MAX_LCODES || ndist > MAX_DCODES) return STREAM_ERR_FORMAT;
+
+    // Code length code
+    memset(lengths, 0, 19);
+    for (uint32_t i = 0; i < ncode; i++) {
+        if ((rc = inflate_bits(st, 3, &v))) return rc;
+        lengths[clen_order[i]] = (uint8_t)v;
+    }
+    if ((rc = huffman_build(&lencode, lengths, 19))) return rc;
+
+    // Literal/length and distance code lengths, run-length coded
+    uint32_t index = 0;
+    while (index < nlen + ndist) {
+        int sym = inflate_decode(st, &lencode);
+        if (sym < 0) return sym;
+
+        if (sym < 16) {
+            lengths[index++] = (uint8_t)sym;
+            continue;
+        }
+
+        uint8_t len = 0;
+        uint32_t repeat;
+        if (sym == 16) {
+            if (index == 0) return STREAM_ERR_FORMAT;
+            len = lengths[index - 1];
+            if ((rc = inflate_bits(st, 2, &repeat))) return rc;
+            repeat += 3;
+        } else if (sym == 17) {
+            if ((rc = inflate_bits(st, 3, &repeat))) return rc;
+            repeat += 3;
+        } else {
+            if ((rc = inflate_bits(st, 7, &repeat))) return rc;
+            repeat += 11;
+        }
+        if (index + repeat > nlen + ndist) return STREAM_ERR_FORMAT;
+        while (repeat--) lengths[index++] = len;
+    }
+    if (lengths[256] == 0) return STREAM_ERR_FORMAT;
+
+    if ((rc = huffman_build(&lencode, lengths, nlen)) ||
+        (rc = huffman_build(&distcode, lengths + nlen, ndist))) {
+        return rc;
+    }
+    return inflate_codes(st, &lencode, &distcode);
+}
+
+// Decode blocks up to the final one; *crc (if given) is updated over the
+// output after each block while it is still warm
+static int inflate_blocks(inflate_state_t *st, uint32_t *crc) {
+    uint32_t last, type;
+    uint32_t crc_pos = st->pos;
+
+    do {
+        int rc;
+        if ((rc = inflate_bits(st, 1, &last)) || (rc = inflate_bits(st, 2, &type))) {
+            return rc;
+        }
+
+        switch (type) {
+            case 0:  rc = inflate_stored(st); break;
+            case 1:  rc = inflate_fixed(st); break;
+            case 2:  rc = inflate_dynamic(st); break;
+            default: rc = STREAM_ERR_FORMAT; break;
+        }
+        if (rc) return rc;
+
+        if (crc) {
+            *crc = crc32(*crc, st->dst + crc_pos, st->pos - crc_pos);
+            crc_pos = st->pos;
+        }
+    } while (!last);
+
+    inflate_align(st);
+    return 0;
+}
+
+int inflate_raw(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len) {
+    inflate_state_t st = { s, 0, 0, dst, 0, max };
+    int rc = inflate_blocks(&st, 0);
+    *out_len = st.pos;
+    return rc;
+}
+
+static int gzip_skip_string(inflate_state_t *st) {
+    int b;
+    while ((b = inflate_byte(st)) > 0) { }
+    return b;
+}
+
+static int gzip_member(inflate_state_t *st) {
+    uint8_t hdr[10];
+    for (int i = 0; i < 10; i++) {
+        int b = inflate_byte(st);
+        if (b < 0) return b;
+        hdr[i] = (uint8_t)b;
+    }
+    if (hdr[0] != 0x1F || hdr[1] != 0x8B || hdr[2] != 8 || (hdr[3] & 0xE0)) {
+        return STREAM_ERR_FORMAT;
+    }
+
+    uint8_t flags = hdr[3];
+    int rc = 0;
+    if (flags & GZIP_FEXTRA) {
+        int lo = inflate_byte(st);
+        int hi = inflate_byte(st);
+        if (lo < 0 || hi < 0) return STREAM_ERR_EOF;
+        rc = stream_skip(st->s, (uint32_t)lo | ((uint32_t)hi << 8));
+    }
+    if (rc == 0 && (flags & GZIP_FNAME)) rc = gzip_skip_string(st);
+    if (rc == 0 && (flags & GZIP_FCOMMENT)) rc = gzip_skip_string(st);
+    if (rc == 0 && (flags & GZIP_FHCRC)) rc = stream_skip(st->s, 2);
+    if (rc) return rc;
+
+    uint32_t start = st->pos;
+    uint32_t crc = 0;
+    rc = inflate_blocks(st, &crc);
+    if (rc) return rc;
+
+    // Trailer: CRC-32 and length modulo 2^32
+    uint32_t trailer[2] = { 0, 0 };
+    for (int i = 0; i < 8; i++) {
+        int b = inflate_byte(st);
+        if (b < 0) return b;
+        trailer[i / 4] |= (uint32_t)b << ((i % 4) * 8);
+    }
+    if (trailer[0] != crc || trailer[1] != st->pos - start) return STREAM_ERR_CHECK;
+    return 0;
+}
+
+int gzip_decode(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len) {
+    inflate_state_t st = { s, 0, 0, dst, 0, max };
+    int rc;
+
+    // Members may be concatenated
+    do {
+        rc = gzip_member(&st);
+    } while (rc == 0 && (st.bitcnt || stream_need(s) == 0));
+
+    *out_len = st.pos;
+    return rc;
+}
@@ -0,0 +1,52 @@
+#include "irq.h"
+#include "hardware.h"
+
+static irq_handler_t irq_handlers[IRQ_LINES];
+
+void irq_init(void) {
+    MMIO_WRITE(IRQ_DISABLE_1, 0xFFFFFFFF);
+    MMIO_WRITE(IRQ_DISABLE_2, 0xFFFFFFFF);
+    MMIO_WRITE(IRQ_DISABLE_BASIC, 0xFFFFFFFF);
+}
+
+void irq_register(uint32_t irq, irq_handler_t handler) {
+    if (irq >= IRQ_LINES) return;
+    irq_handlers[irq] = handler;
+    MMIO_WRITE(irq < 32 ? IRQ_ENABLE_1 : IRQ_ENABLE_2, 1u << (irq & 31));
+}
+
+void irq_unregister(uint32_t irq) {
+    if (irq >= IRQ_LINES) return;
+    MMIO_WRITE(irq < 32 ? IRQ_DISABLE_1 : IRQ_DISABLE_2, 1u << (irq & 31));
+    irq_handlers[irq] = 0;
+}
+
+void irq_enable(void) {
+    asm volatile("cpsie i" : : : "memory");
+}
+
+void irq_disable(void) {
+    asm volatile("cpsid i" : : : "memory");
+}
+
+void irq_shutdown(void) {
+    irq_disable();
+    MMIO_WRITE(IRQ_DISABLE_1, 0xFFFFFFFF);
+    MMIO_WRITE(IRQ_DISABLE_2, 0xFFFFFFFF);
+    MMIO_WRITE(IRQ_DISABLE_BASIC, 0xFFFFFFFF);
+}
+
+void irq_dispatch(void) {
+    // Pending registers only show unmasked lines that have a handler
+    uint32_t pending[2] = { MMIO_READ(IRQ_PENDING_1), MMIO_READ(IRQ_PENDING_2) };
+
+    for (uint32_t bank = 0; bank < 2; bank++) {
+        while (pending[bank]) {
+            uint32_t bit = 31 - (uint32_t)__builtin_clz(pending[bank]);
+            pending[bank] &= ~(1u << bit);
+
+            irq_handler_t handler = irq_handlers[bank * 32 + bit];
+            if (handler) handler();
+        }
+    }
+}
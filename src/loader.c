@@ -0,0 +1,457 @@
+#include "loader.h"
+#include "bio.h"
+#include "cache.h"
+#include "crc32.h"
+#include "lz4.h"
+#include "inflate.h"
+#include "irq.h"
+#include "memory.h"
+#include "mmc.h"
+#include "rimg.h"
+#include "timer.h"
+#include "uart.h"
+#include <stddef.h>
+
+// Pipelined loader
+// The file, or each segment of a native image, is read as a region of
+// consecutive blocks. Slots are submitted in file order, up to LOADER_SLOTS
+// ahead of the consumer; adjacent ones merge into a single card command in
+// the queue.
+// Each time the consumer asks for more input the slot it just finished is
+// recycled for the next part of the file, and the DMA engine keeps the
+// card busy while the CPU works. Compressed images land in the ring and
+// are decoded to the destination; raw data is read straight into place,
+// the "slots" then being consecutive windows of the destination.
+//
+// The CRC-32 of the file is folded in chunk by chunk as each one is handed
+// over, while later chunks are still in flight, so verification needs no
+// separate pass once loading ends. The SHA-256 of a signed payload is
+// folded in the same way.
+
+#define LOADER_SLOT_BYTES (LOADER_SLOT_BLOCKS * 512)
+
+static uint8_t slot_data[LOADER_SLOTS][LOADER_SLOT_BYTES] __attribute__((aligned(MMC_DMA_ALIGN)));
+
+typedef struct {
+    fat_file_t *file;
+    uint8_t *direct;            // Raw data: whole blocks are read into place here
+    uint32_t first_block;       // Region start, in file blocks
+    uint32_t end_block;         // Block after the region's last one
+    uint32_t end;               // File offset where the region ends
+    bio_t bios[LOADER_SLOTS];
+    uint32_t head;              // Next slot to consume
+    uint32_t tail;              // Next slot to submit
+    int holding;                // Consumer holds slot head - 1
+    uint32_t next_block;        // Next file block to submit
+    uint32_t consumed;          // File offset handed to the consumer
+    uint32_t crc;               // CRC-32 of the bytes handed over
+    int hashing;                // Signed image: hash everything read
+    sha256_ctx_t sha;
+    loader_stats_t *stats;
+} loader_ring_t;
+
+static loader_ring_t ring;
+static loader_sig_header_t sig_header __attribute__((aligned(4)));
+static rimg_header_t rimg_header __attribute__((aligned(4)));
+
+// Queue reads for free slots, never crossing an extent
+static int loader_submit(loader_ring_t *ring) {
+    while (ring->tail - ring->head < LOADER_SLOTS && ring->next_block < ring->end_block) {
+        uint32_t lba, run;
+        int rc = fat_map(ring->file, ring->next_block, &lba, &run);
+        if (rc != FAT_OK) return rc;
+        if (run > LOADER_SLOT_BLOCKS) run = LOADER_SLOT_BLOCKS;
+        if (run > ring->end_block - ring->next_block) run = ring->end_block - ring->next_block;
+
+        uint32_t slot = ring->tail % LOADER_SLOTS;
+        uint8_t *buffer = slot_data[slot];
+
+        // A partial last block goes through a slot so that nothing lands
+        // past the end of the region
+        uint32_t whole = ring->end / 512;
+        if (ring->direct && ring->next_block < whole) {
+            if (run > whole - ring->next_block) run = whole - ring->next_block;
+            buffer = ring->direct + (ring->next_block - ring->first_block) * 512;
+        }
+
+        bio_t *bio = &ring->bios[slot];
+        bio->dev = ring->file->vol->dev;
+        bio->lba = lba;
+        bio->count = run;
+        bio->buffer = buffer;
+        bio->done = 0;
+        rc = bio_submit(bio);
+        if (rc != BLK_OK) return rc;
+
+        ring->tail++;
+        ring->next_block += run;
+    }
+    return BLK_OK;
+}
+
+static int loader_fill(stream_t *s) {
+    loader_ring_t *ring = (loader_ring_t *)s->ctx;
+
+    bio_poll();
+
+    // The consumer is done with the previous slot: reuse it
+    if (ring->holding) {
+        ring->head++;
+        ring->holding = 0;
+    }
+    int rc = loader_submit(ring);
+    if (rc != BLK_OK) return rc;
+    if (ring->head == ring->tail) return 0;
+
+    bio_t *bio = &ring->bios[ring->head % LOADER_SLOTS];
+    if (bio->status == BIO_PENDING) {
+        uint64_t start = timer_get_ticks();
+        rc = bio_wait(bio);
+        ring->stats->wait_us += timer_get_ticks() - start;
+    } else {
+        rc = bio->status;
+    }
+    if (rc != BLK_OK) return rc;
+
+    // The digest covers every byte of the file, including padding after
+    // the region; the consumer and the CRC only see the region itself
+    uint32_t len = bio->count * 512;
+    if (len > ring->file->size - ring->consumed) len = ring->file->size - ring->consumed;
+    ring->stats->in_bytes += len;
+    if (ring->hashing) {
+        uint64_t start = timer_get_ticks();
+        sha256_update(&ring->sha, bio->buffer, len);
+        ring->stats->hash_us += timer_get_ticks() - start;
+    }
+    if (len > ring->end - ring->consumed) len = ring->end - ring->consumed;
+    ring->consumed += len;
+    ring->holding = 1;
+    ring->crc = crc32(ring->crc, bio->buffer, len);
+
+    s->ptr = bio->buffer;
+    s->end = bio->buffer + len;
+    return (int)len;
+}
+
+// Check the signed header in sig_header, n bytes of it present, for an
+// image of size bytes. Returns 1 if the image is signed, 0 if not, or a
+// negative error.
+static int loader_check_header(uint32_t n, uint32_t size, loader_stats_t *stats) {
+    if (n < 4 || sig_header.magic != LOADER_SIG_MAGIC) {
+#ifdef VERIFIED_BOOT
+        return LOADER_ERR_UNSIGNED;
+#else
+        return 0;
+#endif
+    }
+    if (n != LOADER_SIG_SIZE || sig_header.version != LOADER_SIG_VERSION ||
+        sig_header.header_size != LOADER_SIG_SIZE ||
+        sig_header.payload_size != size - LOADER_SIG_SIZE) {
+        return LOADER_ERR_HEADER;
+    }
+
+    // Without a key only the digest can be checked, which catches
+    // corruption but not tampering
+    if (boot_public_key) {
+        uint64_t start = timer_get_ticks();
+        int rc = ed25519_verify(sig_header.signature, &sig_header,
+                                offsetof(loader_sig_header_t, signature), boot_public_key);
+        stats->verify_us = timer_get_ticks() - start;
+        if (rc != 0) return LOADER_ERR_SIGNATURE;
+    }
+    return 1;
+}
+
+// Read a signed header if the file has one and check its signature.
+// Returns 1 if the image is signed, 0 if not, or a negative error.
+static int loader_read_header(fat_file_t *file, loader_stats_t *stats) {
+    int n = fat_read(file, &sig_header, LOADER_SIG_SIZE);
+    if (n < 0) return n;
+    int rc = loader_check_header((uint32_t)n, file->size, stats);
+    if (rc == 1) {
+        stats->crc = crc32(0, &sig_header, LOADER_SIG_SIZE);
+        stats->in_bytes = LOADER_SIG_SIZE;
+    }
+    return rc;
+}
+
+static int loader_detect(fat_file_t *file, uint32_t offset) {
+    uint8_t magic[4] = { 0, 0, 0, 0 };
+    int rc = fat_seek(file, offset);
+    if (rc != FAT_OK) return rc;
+    int n = fat_read(file, magic, 4);
+    if (n < 0) return n;
+
+    uint32_t word = (uint32_t)magic[0] | ((uint32_t)magic[1] << 8) |
+                    ((uint32_t)magic[2] << 16) | ((uint32_t)magic[3] << 24);
+    if (n == 4 && word == RIMG_MAGIC) return LOADER_FORMAT_RIMG;
+    if (n == 4 && (word == LZ4_MAGIC || word == LZ4_LEGACY_MAGIC)) return LOADER_FORMAT_LZ4;
+    if (n >= 3 && magic[0] == 0x1F && magic[1] == 0x8B && magic[2] == 8) return LOADER_FORMAT_GZIP;
+    return LOADER_FORMAT_RAW;
+}
+
+// Consumer for raw data: whole blocks are already in place, only a partial
+// last block arrives in a slot
+static int loader_copy_raw(stream_t *s, uint8_t *dest, uint32_t *out_len) {
+    int n;
+    *out_len = 0;
+    while ((n = s->fill(s)) > 0) {
+        if (s->ptr != dest + *out_len) memcpy(dest + *out_len, s->ptr, (uint32_t)n);
+        *out_len += (uint32_t)n;
+        s->ptr = s->end;
+    }
+    return n;
+}
+
+// Stream the file bytes [start, end) to dest, decoding them as format.
+// start must be block aligned.
+static int loader_region(uint32_t start, uint32_t end, int format,
+                         uint8_t *dest, uint32_t max, uint32_t *out) {
+    ring.direct = 0;
+    ring.first_block = start / 512;
+    ring.end_block = (end + 511) / 512;
+    ring.end = end;
+    ring.head = 0;
+    ring.tail = 0;
+    ring.holding = 0;
+    ring.next_block = ring.first_block;
+    ring.consumed = start;
+
+    if (format == LOADER_FORMAT_RAW) {
+        if (end - start > max) return STREAM_ERR_OVERFLOW;
+        ring.direct = dest;
+    }
+
+    stream_t s = { 0, 0, loader_fill, &ring };
+    int rc;
+    *out = 0;
+    switch (format) {
+        case LOADER_FORMAT_LZ4:     rc = lz4_decode(&s, dest, max, out); break;
+        case LOADER_FORMAT_GZIP:    rc = gzip_decode(&s, dest, max, out); break;
+        default:                    rc = loader_copy_raw(&s, dest, out); break;
+    }
+
+    // Trailing data after a compressed stream still counts for the CRC
+    // and digest
+    while (rc == 0 && loader_fill(&s) > 0) { }
+    return rc;
+}
+
+// Read and validate a native image header at offset base. Every segment
+// must fit in [dest, dest + max) and the stored ones must follow each
+// other block by block up to the end of the file.
+static int loader_read_rimg(fat_file_t *file, uint32_t base, uint8_t *dest, uint32_t max) {
+    rimg_header_t *h = &rimg_header;
+    uint32_t limit = (uint32_t)dest + max;
+
+    int rc = fat_seek(file, base);
+    if (rc != FAT_OK) return rc;
+    int n = fat_read(file, h, RIMG_HEADER_SIZE);
+    if (n < 0) return n;
+    if (n != RIMG_HEADER_SIZE || h->version != RIMG_VERSION ||
+        h->header_size != RIMG_HEADER_SIZE || h->segment_count > RIMG_MAX_SEGMENTS) {
+        return LOADER_ERR_IMAGE;
+    }
+
+    uint32_t crc = h->header_crc;
+    h->header_crc = 0;
+    if (crc32(0, h, RIMG_HEADER_SIZE) != crc) return LOADER_ERR_IMAGE;
+    h->header_crc = crc;
+
+    if (h->entry < (uint32_t)dest || h->entry >= limit) return LOADER_ERR_RANGE;
+
+    uint32_t next = RIMG_HEADER_SIZE;
+    for (uint32_t i = 0; i < h->segment_count; i++) {
+        const rimg_segment_t *seg = &h->segments[i];
+        if (seg->compression > RIMG_COMP_GZIP) return LOADER_ERR_IMAGE;
+        if (seg->load_addr < (uint32_t)dest || seg->mem_size > limit - seg->load_addr) {
+            return LOADER_ERR_RANGE;
+        }
+        if (seg->file_size == 0) continue;
+        if (seg->offset != next || seg->file_size > file->size - base - next) {
+            return LOADER_ERR_IMAGE;
+        }
+        next += (seg->file_size + 511) & ~511u;
+    }
+    if (file->size - base > next) return LOADER_ERR_IMAGE;
+    return FAT_OK;
+}
+
+// Scatter-load a native image: stored segments stream in with
+// multi-block reads to their load addresses, the rest is zero filled
+static int loader_scatter(uint32_t base, loader_stats_t *stats) {
+    static const int formats[] = {
+        LOADER_FORMAT_RAW, LOADER_FORMAT_LZ4, LOADER_FORMAT_GZIP
+    };
+    const rimg_header_t *h = &rimg_header;
+    uint32_t total = 0;
+
+    stats->in_bytes += RIMG_HEADER_SIZE;
+    if (ring.hashing) sha256_update(&ring.sha, h, RIMG_HEADER_SIZE);
+
+    for (uint32_t i = 0; i < h->segment_count; i++) {
+        const rimg_segment_t *seg = &h->segments[i];
+        uint8_t *load = (uint8_t *)seg->load_addr;
+        uint32_t out = 0;
+
+        if (seg->file_size) {
+            uint32_t start = base + seg->offset;
+            ring.crc = 0;
+            int rc = loader_region(start, start + seg->file_size, formats[seg->compression],
+                                   load, seg->mem_size, &out);
+            if (rc != 0) return rc;
+            if (ring.crc != seg->crc) return STREAM_ERR_CHECK;
+        }
+
+        // bss and the tail of short segments
+        if (out < seg->mem_size) {
+            memset(load + out, 0, seg->mem_size - out);
+            stats->zeroed += seg->mem_size - out;
+        }
+        total += seg->mem_size;
+        if (seg->load_addr + seg->mem_size > stats->top) {
+            stats->top = seg->load_addr + seg->mem_size;
+        }
+    }
+
+    stats->segments = h->segment_count;
+    stats->entry = h->entry;
+    return (int)total;
+}
+
+int loader_load(fat_file_t *file, uint8_t *dest, uint32_t max, loader_stats_t *stats) {
+    uint64_t start = timer_get_ticks();
+
+    stats->format = LOADER_FORMAT_RAW;
+    stats->in_bytes = 0;
+    stats->out_bytes = 0;
+    stats->commands = 0;
+    stats->crc = 0;
+    stats->sig = LOADER_SIG_NONE;
+    stats->entry = (uint32_t)dest;
+    stats->top = (uint32_t)dest;
+    stats->segments = 0;
+    stats->zeroed = 0;
+    stats->io_us = 0;
+    stats->wait_us = 0;
+    stats->hash_us = 0;
+    stats->verify_us = 0;
+
+    int rc = loader_read_header(file, stats);
+    if (rc < 0) return rc;
+    int hashing = rc;
+    uint32_t base = hashing ? LOADER_SIG_SIZE : 0;
+
+    rc = loader_detect(file, base);
+    if (rc < 0) return rc;
+    stats->format = rc;
+    if (stats->format == LOADER_FORMAT_RIMG) {
+        rc = loader_read_rimg(file, base, dest, max);
+        if (rc != FAT_OK) return rc;
+    }
+
+    ring.file = file;
+    ring.crc = stats->crc;
+    ring.hashing = hashing;
+    ring.stats = stats;
+    if (hashing) sha256_init(&ring.sha);
+
+    // The ring already reads ahead; the queue's own window would only
+    // duplicate it
+    bio_init();
+    bio_set_readahead(0);
+
+    uint32_t out = 0;
+    if (stats->format == LOADER_FORMAT_RIMG) {
+        rc = loader_scatter(base, stats);
+        if (rc >= 0) {
+            out = (uint32_t)rc;
+            rc = 0;
+        }
+    } else {
+        rc = loader_region(base, file->size, stats->format, dest, max, &out);
+        stats->crc = ring.crc;
+        stats->top = (uint32_t)dest + out;
+    }
+    bio_drain();
+
+    const bio_stats_t *bst = bio_get_stats();
+    stats->out_bytes = out;
+    stats->commands = bst->commands;
+    stats->io_us = bst->busy_us;
+    bio_set_readahead(BIO_READAHEAD_DEFAULT);
+
+    if (rc == 0 && hashing) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        uint64_t t = timer_get_ticks();
+        sha256_final(&ring.sha, digest);
+        stats->hash_us += timer_get_ticks() - t;
+        if (memcmp(digest, sig_header.digest, SHA256_DIGEST_SIZE) != 0) rc = LOADER_ERR_DIGEST;
+        else stats->sig = boot_public_key ? LOADER_SIG_VERIFIED : LOADER_SIG_DIGEST;
+    }
+
+    stats->total_us = timer_get_ticks() - start;
+    return rc ? rc : (int)out;
+}
+
+int loader_verify(const uint8_t *image, uint32_t size, loader_stats_t *stats) {
+    uint32_t n = size < LOADER_SIG_SIZE ? size : LOADER_SIG_SIZE;
+
+    stats->sig = LOADER_SIG_NONE;
+    stats->hash_us = 0;
+    stats->verify_us = 0;
+
+    memset(&sig_header, 0, sizeof(sig_header));
+    memcpy(&sig_header, image, n);
+    int rc = loader_check_header(n, size, stats);
+    if (rc <= 0) return rc;
+
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint64_t start = timer_get_ticks();
+    sha256(image + LOADER_SIG_SIZE, size - LOADER_SIG_SIZE, digest);
+    stats->hash_us = timer_get_ticks() - start;
+    if (memcmp(digest, sig_header.digest, SHA256_DIGEST_SIZE) != 0) return LOADER_ERR_DIGEST;
+
+    stats->sig = boot_public_key ? LOADER_SIG_VERIFIED : LOADER_SIG_DIGEST;
+    return LOADER_SIG_SIZE;
+}
+
+const char *loader_format_name(int format) {
+    switch (format) {
+        case LOADER_FORMAT_LZ4:     return "LZ4";
+        case LOADER_FORMAT_GZIP:    return "gzip";
+        case LOADER_FORMAT_RIMG:    return "RETROS";
+        default:                    return "raw";
+    }
+}
+
+const char *loader_strerror(int err) {
+    switch (err) {
+        case STREAM_ERR_EOF:        return "image truncated";
+        case STREAM_ERR_FORMAT:     return "corrupt compressed data";
+        case STREAM_ERR_OVERFLOW:   return "image too large";
+        case STREAM_ERR_CHECK:      return "checksum mismatch";
+        case LOADER_ERR_HEADER:     return "bad signed header";
+        case LOADER_ERR_SIGNATURE:  return "signature invalid";
+        case LOADER_ERR_DIGEST:     return "image digest mismatch";
+        case LOADER_ERR_UNSIGNED:   return "image not signed";
+        case LOADER_ERR_IMAGE:      return "bad image header";
+        case LOADER_ERR_RANGE:      return "segment outside load area";
+        default:                    return fat_strerror(err);
+    }
+}
+
+void loader_jump(uint32_t entry, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3) {
+    typedef void (*entry_fn)(uint32_t, uint32_t, uint32_t, uint32_t);
+
+    // No transfer may still be writing memory behind the new image, and
+    // the kernel gets the CPU with IRQs off and the serial output sent
+    bio_drain();
+    mmc_async_wait();
+    uart_shutdown();
+    irq_shutdown();
+    cache_sync();
+
+    ((entry_fn)entry)(r0, r1, r2, r3);
+    while (1) { }
+}
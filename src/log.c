@@ -0,0 +1,123 @@
+#include "log.h"
+#include "format.h"
+#include "framebuffer.h"
+#include "memory.h"
+#include "timer.h"
+#include "uart.h"
+#include <stdarg.h>
+
+static const char level_chars[] = "EWID";
+// Screen colors by level: red, amber, green, dark green
+static const uint32_t level_colors[] = { 0x00FF0000, 0x00FFA500, 0x0000FF00, 0x00008000 };
+
+#define LOG_SCREEN_BG   0x00000000
+
+static int sink_level[LOG_SINKS] = { LOG_INFO, LOG_WARN, LOG_DEBUG };
+
+static int screen_on;
+static char screen_text[LOG_SCREEN_ROWS][LOG_SCREEN_COLS + 1];
+static uint32_t screen_color[LOG_SCREEN_ROWS];
+
+static char ring[LOG_RING_SIZE];
+static uint32_t ring_head;          // Bytes ever written; the ring keeps the last LOG_RING_SIZE
+
+static log_stats_t stats;
+
+void log_set_level(int sink, int level) {
+    if (sink >= 0 && sink < LOG_SINKS) sink_level[sink] = level;
+}
+
+int log_get_level(int sink) {
+    return sink >= 0 && sink < LOG_SINKS ? sink_level[sink] : -1;
+}
+
+void log_screen_enable(int on) {
+    screen_on = on;
+}
+
+// Copy a line in, in at most two runs
+static void ring_write(const char *s, uint32_t n) {
+    uint32_t at = ring_head & (LOG_RING_SIZE - 1);
+    uint32_t first = n < LOG_RING_SIZE - at ? n : LOG_RING_SIZE - at;
+    memcpy(ring + at, s, first);
+    memcpy(ring, s + first, n - first);
+    ring_head += n;
+}
+
+// Scroll the strip up a row and draw the line at the bottom, padded to
+// the full width so it covers what was there
+static void screen_write(const char *s, int level) {
+    for (uint32_t i = 0; i + 1 < LOG_SCREEN_ROWS; i++) {
+        memcpy(screen_text[i], screen_text[i + 1], sizeof(screen_text[i]));
+        screen_color[i] = screen_color[i + 1];
+    }
+    snprintf(screen_text[LOG_SCREEN_ROWS - 1], LOG_SCREEN_COLS + 1, "%-*s", LOG_SCREEN_COLS, s);
+    screen_color[LOG_SCREEN_ROWS - 1] = level_colors[level & 3];
+
+    for (uint32_t i = 0; i < LOG_SCREEN_ROWS; i++) {
+        if (!screen_text[i][0]) continue;
+        fb_draw_string(LOG_SCREEN_X, LOG_SCREEN_Y + i * 16, screen_text[i],
+                       screen_color[i], LOG_SCREEN_BG);
+    }
+}
+
+void log_write(int level, const char *tag, const char *fmt, ...) {
+    int to_uart = level <= sink_level[LOG_SINK_UART];
+    int to_screen = screen_on && level <= sink_level[LOG_SINK_SCREEN];
+    int to_ring = level <= sink_level[LOG_SINK_RING];
+    if (!to_uart && !to_screen && !to_ring) {
+        stats.filtered++;
+        return;
+    }
+
+    uint64_t start = timer_get_uptime_us();
+    char line[LOG_LINE_MAX];
+    uint32_t max = sizeof(line) - 2;    // Room for the newline and NUL
+
+    // The screen leaves out the timestamp
+    uint32_t stamp = (uint32_t)snprintf(line, max, "[%5u.%06u] ",
+                                        (uint32_t)(start / 1000000), (uint32_t)(start % 1000000));
+    uint32_t n = stamp + (uint32_t)snprintf(line + stamp, max - stamp, "%c %s: ",
+                                            level_chars[level & 3], tag);
+    if (n < max) {
+        va_list args;
+        va_start(args, fmt);
+        n += (uint32_t)vsnprintf(line + n, max - n, fmt, args);
+        va_end(args);
+    }
+    if (n > max - 1) n = max - 1;
+
+    if (to_screen) screen_write(line + stamp, level);
+    line[n++] = '\n';
+    line[n] = '\0';
+    if (to_uart) uart_puts(line);
+    if (to_ring) ring_write(line, n);
+
+    stats.messages++;
+    stats.us += timer_get_uptime_us() - start;
+}
+
+void log_dump(void) {
+    uint32_t start = ring_head > LOG_RING_SIZE ? ring_head - LOG_RING_SIZE : 0;
+
+    // After a wrap the oldest line is partly overwritten; skip to the next
+    if (start) {
+        while (start < ring_head && ring[start & (LOG_RING_SIZE - 1)] != '\n') start++;
+        start++;
+    }
+
+    char chunk[129];
+    while (start < ring_head) {
+        uint32_t n = 0;
+        while (n < sizeof(chunk) - 1 && start < ring_head) {
+            chunk[n++] = ring[start++ & (LOG_RING_SIZE - 1)];
+        }
+        chunk[n] = '\0';
+        uart_puts(chunk);
+    }
+}
+
+const log_stats_t *log_get_stats(void) {
+    stats.ring_lost = ring_head > LOG_RING_SIZE ? ring_head - LOG_RING_SIZE : 0;
+    return &stats;
+}
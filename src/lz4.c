@@ -0,0 +1,181 @@
+#include "lz4.h"
+#include "memory.h"
+
+// Skippable frames carry 0x184D2A50-0x184D2A5F
+#define LZ4_SKIPPABLE_MASK  0xFFFFFFF0
+#define LZ4_SKIPPABLE_MAGIC 0x184D2A50
+
+// Legacy blocks are at most 8 MB of output, compressed a bit larger
+#define LZ4_LEGACY_BLOCK_MAX (8 * 1024 * 1024 + 64 * 1024)
+
+// FLG byte
+#define LZ4_FLG_VERSION(f)  (((f) >> 6) & 3)
+#define LZ4_FLG_BLOCK_CSUM  (1 << 4)
+#define LZ4_FLG_SIZE        (1 << 3)
+#define LZ4_FLG_CONTENT_CSUM (1 << 2)
+#define LZ4_FLG_DICT_ID     (1 << 0)
+
+typedef struct {
+    stream_t *s;
+    uint8_t *dst;
+    uint32_t pos;
+    uint32_t max;
+} lz4_state_t;
+
+// Extra length bytes after a 15 nibble; `left` is the block budget
+static int lz4_length(lz4_state_t *st, uint32_t *len, uint32_t *left) {
+    int b;
+    do {
+        if (*left == 0) return STREAM_ERR_FORMAT;
+        b = stream_byte(st->s);
+        if (b < 0) return b;
+        (*left)--;
+        *len += (uint32_t)b;
+    } while (b == 255);
+    return 0;
+}
+
+// Decode one compressed block of `size` input bytes
+static int lz4_block(lz4_state_t *st, uint32_t size) {
+    uint32_t left = size;
+
+    while (left) {
+        int token = stream_byte(st->s);
+        if (token < 0) return token;
+        left--;
+
+        // Literals, copied straight out of the input chunk
+        uint32_t lit = (uint32_t)token >> 4;
+        int rc;
+        if (lit == 15 && (rc = lz4_length(st, &lit, &left)) != 0) return rc;
+        if (lit > left) return STREAM_ERR_FORMAT;
+        if (lit > st->max - st->pos) return STREAM_ERR_OVERFLOW;
+        rc = stream_read(st->s, st->dst + st->pos, lit);
+        if (rc) return rc;
+        st->pos += lit;
+        left -= lit;
+
+        // The last sequence has no match
+        if (left == 0) break;
+
+        if (left < 2) return STREAM_ERR_FORMAT;
+        int lo = stream_byte(st->s);
+        int hi = stream_byte(st->s);
+        if (lo < 0) return lo;
+        if (hi < 0) return hi;
+        left -= 2;
+
+        uint32_t offset = (uint32_t)lo | ((uint32_t)hi << 8);
+        uint32_t len = ((uint32_t)token & 0x0F);
+        if (len == 15 && (rc = lz4_length(st, &len, &left)) != 0) return rc;
+        len += 4;
+
+        if (offset == 0 || offset > st->pos) return STREAM_ERR_FORMAT;
+        if (len > st->max - st->pos) return STREAM_ERR_OVERFLOW;
+
+        uint8_t *out = st->dst + st->pos;
+        const uint8_t *from = out - offset;
+        if (offset >= len) {
+            memcpy(out, from, len);
+        } else {
+            // Overlapping match repeats the last `offset` bytes
+            for (uint32_t i = 0; i < len; i++) out[i] = from[i];
+        }
+        st->pos += len;
+    }
+    return 0;
+}
+
+static int lz4_frame(lz4_state_t *st) {
+    stream_t *s = st->s;
+    int flg = stream_byte(s);
+    int bd = stream_byte(s);
+    if (flg < 0) return flg;
+    if (bd < 0) return bd;
+    if (LZ4_FLG_VERSION(flg) != 1 || (bd & 0x8F) || ((bd >> 4) & 7) < 4) {
+        return STREAM_ERR_FORMAT;
+    }
+
+    uint32_t block_max = 1u << (8 + 2 * ((bd >> 4) & 7));
+    uint32_t skip = 1;                          // Header checksum
+    if (flg & LZ4_FLG_SIZE) skip += 8;
+    if (flg & LZ4_FLG_DICT_ID) skip += 4;
+    int rc = stream_skip(s, skip);
+    if (rc) return rc;
+
+    while (1) {
+        uint32_t size;
+        rc = stream_le32(s, &size);
+        if (rc) return rc;
+        if (size == 0) break;                   // End mark
+
+        uint32_t raw = size & 0x80000000;
+        size &= 0x7FFFFFFF;
+        if (size > block_max) return STREAM_ERR_FORMAT;
+
+        if (raw) {
+            if (size > st->max - st->pos) return STREAM_ERR_OVERFLOW;
+            rc = stream_read(s, st->dst + st->pos, size);
+            st->pos += size;
+        } else {
+            rc = lz4_block(st, size);
+        }
+        if (rc) return rc;
+
+        if (flg & LZ4_FLG_BLOCK_CSUM) {
+            rc = stream_skip(s, 4);
+            if (rc) return rc;
+        }
+    }
+
+    return (flg & LZ4_FLG_CONTENT_CSUM) ? stream_skip(s, 4) : 0;
+}
+
+// Legacy frames have no end mark: they stop at the end of input or at
+// the magic of a following frame
+static int lz4_legacy(lz4_state_t *st) {
+    while (1) {
+        int rc = stream_need(st->s);
+        if (rc == STREAM_ERR_EOF) return 0;
+        if (rc) return rc;
+
+        uint32_t size;
+        rc = stream_le32(st->s, &size);
+        if (rc) return rc;
+        if (size == LZ4_LEGACY_MAGIC) continue;
+        if (size == 0 || size > LZ4_LEGACY_BLOCK_MAX) return STREAM_ERR_FORMAT;
+
+        rc = lz4_block(st, size);
+        if (rc) return rc;
+    }
+}
+
+int lz4_decode(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len) {
+    lz4_state_t st = { s, dst, 0, max };
+    int frames = 0;
+    int rc = 0;
+
+    // Concatenated frames are decoded back to back
+    while (rc == 0 && !(frames && stream_need(s) == STREAM_ERR_EOF)) {
+        uint32_t magic;
+        rc = stream_le32(s, &magic);
+        if (rc) break;
+
+        if (magic == LZ4_MAGIC) {
+            rc = lz4_frame(&st);
+            frames++;
+        } else if (magic == LZ4_LEGACY_MAGIC) {
+            rc = lz4_legacy(&st);
+            frames++;
+        } else if ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+            uint32_t size;
+            rc = stream_le32(s, &size);
+            if (rc == 0) rc = stream_skip(s, size);
+        } else {
+            rc = STREAM_ERR_FORMAT;
+        }
+    }
+
+    *out_len = st.pos;
+    return rc;
+}
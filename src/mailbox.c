@@ -0,0 +1,80 @@
+#include "mailbox.h"
+#include "hardware.h"
+
+static volatile uint32_t mailbox_msg[16] __attribute__((aligned(16)));
+
+int mailbox_call(volatile uint32_t *msg, uint8_t channel) {
+    uint32_t addr = (uint32_t)msg;
+
+    // Wait for mailbox to be available
+    while (MMIO_READ(MAILBOX_STATUS) & MAILBOX_FULL) { }
+
+    // Write the address of our message to the mailbox with channel identifier
+    MMIO_WRITE(MAILBOX_WRITE, (addr & ~0xF) | (channel & 0xF));
+
+    // Wait for the response
+    while (1) {
+        while (MMIO_READ(MAILBOX_STATUS) & MAILBOX_EMPTY) { }
+
+        uint32_t response = MMIO_READ(MAILBOX_READ);
+
+        if ((response & 0xF) == channel && (response & ~0xF) == addr) {
+            return msg[1] == MBOX_RESPONSE_OK;
+        }
+    }
+}
+
+int mailbox_get_pair(uint32_t tag, uint32_t *a, uint32_t *b) {
+    int i = 0;
+    mailbox_msg[i++] = 8 * 4;       // Buffer size in bytes
+    mailbox_msg[i++] = MBOX_REQUEST;
+    mailbox_msg[i++] = tag;
+    mailbox_msg[i++] = 8;           // Value buffer size
+    mailbox_msg[i++] = 0;           // Request size
+    mailbox_msg[i++] = 0;           // Value a returned here
+    mailbox_msg[i++] = 0;           // Value b returned here
+    mailbox_msg[i++] = MBOX_TAG_END;
+
+    if (!mailbox_call(mailbox_msg, MBOX_CH_PROPERTY)) {
+        return -1;
+    }
+
+    *a = mailbox_msg[5];
+    *b = mailbox_msg[6];
+    return 0;
+}
+
+uint32_t mailbox_get_clock_rate(uint32_t clock_id) {
+    int i = 0;
+    mailbox_msg[i++] = 8 * 4;       // Buffer size in bytes
+    mailbox_msg[i++] = MBOX_REQUEST;
+    mailbox_msg[i++] = MBOX_TAG_GET_CLOCK_RATE;
+    mailbox_msg[i++] = 8;           // Value buffer size
+    mailbox_msg[i++] = 4;           // Request size
+    mailbox_msg[i++] = clock_id;
+    mailbox_msg[i++] = 0;           // Rate returned here
+    mailbox_msg[i++] = MBOX_TAG_END;
+
+    if (!mailbox_call(mailbox_msg, MBOX_CH_PROPERTY)) {
+        return 0;
+    }
+    return mailbox_msg[6];
+}
+
+uint32_t mailbox_set_clock_rate(uint32_t clock_id, uint32_t rate) {
+    int i = 0;
+    mailbox_msg[i++] = 9 * 4;       // Buffer size in bytes
+    mailbox_msg[i++] = MBOX_REQUEST;
+    mailbox_msg[i++] = MBOX_TAG_SET_CLOCK_RATE;
+    mailbox_msg[i++] = 12;          // Value buffer size
+    mailbox_msg[i++] = 12;          // Request size
+    mailbox_msg[i++] = clock_id;
+    mailbox_msg[i++] = rate;        // Rate set returned here
+    mailbox_msg[i++] = 0;           // Skip setting turbo
+    mailbox_msg[i++] = MBOX_TAG_END;
+
+    if (!mailbox_call(mailbox_msg, MBOX_CH_PROPERTY)) {
+        return 0;
+    }
+    return mailbox_msg[6];
+}
@@ -1,8 +1,29 @@
 #include "hardware.h"
+#include "irq.h"
 #include "uart.h"
+#include "format.h"
 #include "framebuffer.h"
 #include "pwm_audio.h"
-#include "sdcard.h"
+#include "blockdev.h"
+#include "mmc.h"
+#include "timer.h"
+#include "anim.h"
+#include "splash.h"
+#include "memory.h"
+#include "bio.h"
+#include "bcache.h"
+#include "fat.h"
+#include "part.h"
+#include "loader.h"
+#include "stream.h"
+#include "config.h"
+#include "catalog.h"
+#include "menu.h"
+#include "warmboot.h"
+#include "bootlog.h"
+#include "log.h"
+#include "serial_load.h"
+#include "shell.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -13,6 +34,9 @@
 #define COLOR_AMBER     0x00FFA500
 #define COLOR_RED       0x00FF0000
 
+// Next-stage files tried when retros.cfg sets no boot-order
+#define DEFAULT_BOOT_ORDER "/mfboot.bin,/kernel.bin"
+
 // Random number generator (simple LCG)
 static uint32_t rng_state = 12345;
 
@@ -21,21 +45,9 @@ uint32_t random(void) {
     return (rng_state / 65536) % 32768;
 }
 
-// Display boot messages with typing effect
+// Display boot messages with typing effect (queued, never blocks)
 void boot_message_animated(uint32_t x, uint32_t y, const char *msg, uint32_t color) {
-    uint32_t current_x = x;
-    while (*msg) {
-        if (*msg == '\n') {
-            current_x = x;
-            y += 16;
-        } else {
-            fb_draw_char(current_x, y, *msg, color, COLOR_BLACK);
-            current_x += 8;
-            delay_ms(10);  // Typing effect
-        }
-        uart_putc(*msg);  // Also send to UART
-        msg++;
-    }
+    anim_type_text(x, y, msg, color, 0);
 }
 
 // Display memory test pattern
@@ -46,62 +58,26 @@ void memory_test_pattern(void) {
     y_start += 32;
 
     for (int i = 0; i < 8; i++) {
-        char buffer[64];
         uint32_t addr = 0x00100000 + (i * 0x00100000);
         uint32_t pattern = random() & 0xFFFFFF;
 
-        // Create string manually (no sprintf)
-        buffer[0] = '0'; buffer[1] = 'x';
-        for (int j = 7; j >= 0; j--) {
-            uint32_t nibble = (addr >> (j * 4)) & 0xF;
-            buffer[9 - j] = nibble < 10 ? '0' + nibble : 'A' + nibble - 10;
-        }
-        buffer[10] = ':'; buffer[11] = ' ';
-        for (int j = 5; j >= 0; j--) {
-            uint32_t nibble = (pattern >> (j * 4)) & 0xF;
-            buffer[17 - j] = nibble < 10 ? '0' + nibble : 'A' + nibble - 10;
-        }
-        buffer[18] = ' '; buffer[19] = 'O'; buffer[20] = 'K';
-        buffer[21] = '\0';
-
-        fb_draw_string(32, y_start + (i * 18), buffer, COLOR_DKGREEN, COLOR_BLACK);
-        delay_ms(100);
+        fb_printf(32, y_start + (i * 18), COLOR_DKGREEN, COLOR_BLACK,
+                  "0x%08X: %06X OK", addr, pattern);
+        anim_delay_ms(100);
     }
 }
 
 // Simulate bad sector warning
 void bad_sector_warning(void) {
-    if ((random() % 100) < 15) {  // 15% chance
+    if ((random() % 100) < config_get_uint("bad-sector-chance", 15)) {
         uint32_t sector = random() % 10000;
         char msg[64];
-        int pos = 0;
-
-        // Initialize message manually
-        const char *prefix = "WARNING: Bad sector detected: ";
-        while (*prefix) {
-            msg[pos++] = *prefix++;
-        }
-
-        // Convert sector number to string
-        if (sector == 0) {
-            msg[pos++] = '0';
-        } else {
-            char temp[12];
-            int i = 0;
-            while (sector > 0) {
-                temp[i++] = '0' + (sector % 10);
-                sector /= 10;
-            }
-            while (i > 0) {
-                msg[pos++] = temp[--i];
-            }
-        }
-        msg[pos] = '\0';
+        snprintf(msg, sizeof(msg), "WARNING: Bad sector detected: %u", sector);
 
         fb_draw_string(16, 400, msg, COLOR_AMBER, COLOR_BLACK);
         uart_puts(msg);
         uart_puts("\n");
-        delay_ms(800);
+        anim_delay_ms(800);
     }
 }
 
@@ -118,8 +94,105 @@ int check_diagnostic_mode(void) {
     return 0;
 }
 
+// Measure glyph render throughput at every text scale
+static void report_render_throughput(void) {
+    for (uint32_t scale = 1; scale <= FB_MAX_SCALE; scale++) {
+        uint32_t glyphs = fb_benchmark_glyphs(scale, 2000);
+        uint32_t kpixels = (glyphs / 1000) * 8 * 16 * scale * scale;
+        uart_printf("Render %dx: %d glyphs/s (%d kpixel/s)\n", scale, glyphs, kpixels);
+    }
+}
+
+// Print a KB/s figure as MB/s with two decimals, plus CPU cycles per block
+static void print_sd_rate(const char *label, uint32_t kbps, uint32_t cycles) {
+    uint32_t centi = kbps * 100 / 1024;
+    uart_printf("  %s %u.%02u MB/s, %u cycles/block\n", label, centi / 100, centi % 100, cycles);
+}
+
+// Report SD read throughput for every bus mode the card supports through
+// each data path: byte-wise PIO (unaligned buffer), word-burst PIO and DMA
+static void report_sd_throughput(void) {
+    if (!blockdev_get_sd() && blockdev_init() != BLK_OK) {
+        uart_puts("SD: no card\n");
+        return;
+    }
+
+    const uint32_t blocks = 256;
+    uint8_t *raw = malloc(blocks * 512 + MMC_DMA_ALIGN + 1);
+    if (!raw) return;
+    uint8_t *aligned = (uint8_t *)(((uint32_t)raw + MMC_DMA_ALIGN - 1) & ~(MMC_DMA_ALIGN - 1));
+
+    mmc_card_info_t *card = mmc_get_card_info();
+    mmc_mode_t best = card->max_mode;
+    for (mmc_mode_t mode = MMC_MODE_DEFAULT_SPEED; mode <= best; mode++) {
+        if (mmc_set_mode(mode) != MMC_OK) break;
+        uart_printf("SD %s (%d kHz, %d-bit):\n", mmc_mode_name(mode),
+                    card->clock_hz / 1000, card->bus_width);
+
+        uint32_t cycles = 0;
+        uint32_t kbps = mmc_benchmark(0, blocks, aligned + 1, &cycles);
+        print_sd_rate("PIO bytes:", kbps, cycles);
+
+        mmc_use_dma(0);
+        kbps = mmc_benchmark(0, blocks, aligned, &cycles);
+        print_sd_rate("PIO words:", kbps, cycles);
+        mmc_use_dma(1);
+
+        kbps = mmc_benchmark(0, blocks, aligned, &cycles);
+        print_sd_rate("DMA:      ", kbps, cycles);
+    }
+    mmc_set_mode(best);
+
+    free(raw);
+}
+
+// Exercise the block I/O queue with a sequential stream (queued ahead,
+// then consumed one request at a time) and report its statistics
+static void report_bio_queue(void) {
+    blockdev_t *sd = blockdev_get_sd();
+    if (!sd) return;
+
+    const uint32_t reqs = 16, per_req = 4;
+    uint8_t *raw = malloc(reqs * per_req * 512 + MMC_DMA_ALIGN);
+    if (!raw) return;
+    uint8_t *buf = (uint8_t *)(((uint32_t)raw + MMC_DMA_ALIGN - 1) & ~(MMC_DMA_ALIGN - 1));
+
+    bio_t bios[16];
+    bio_init();
+
+    // Queue depth: submit everything, then wait
+    for (uint32_t i = 0; i < reqs; i++) {
+        bios[i] = (bio_t){ .dev = sd, .lba = i * per_req, .count = per_req,
+                           .buffer = buf + i * per_req * 512 };
+        bio_submit(&bios[i]);
+    }
+    bio_drain();
+
+    // Sequential consumer: read-ahead keeps the card busy
+    for (uint32_t i = 0; i < reqs; i++) {
+        bios[i].lba = (reqs + i) * per_req;
+        bio_submit(&bios[i]);
+        bio_wait(&bios[i]);
+    }
+    bio_drain();
+
+    const bio_stats_t *st = bio_get_stats();
+    uart_printf("BIO: %d requests, %d commands, %d merged (%d%%), %d read-ahead hits\n",
+                st->submitted, st->commands, st->merged,
+                st->submitted ? st->merged * 100 / st->submitted : 0, st->ra_hits);
+    uart_printf("BIO: depth max %d avg %d, busy %d us, stalled %d us\n",
+                st->max_depth, st->submitted ? st->depth_sum / st->submitted : 0,
+                (uint32_t)st->busy_us, (uint32_t)st->stall_us);
+
+    free(raw);
+}
+
 // Diagnostic mode display
 void diagnostic_mode(void) {
+    report_render_throughput();
+    report_sd_throughput();
+    report_bio_queue();
+
     fb_clear(COLOR_BLACK);
     fb_draw_string(16, 16, "=== DIAGNOSTIC MODE ===", COLOR_AMBER, COLOR_BLACK);
     fb_draw_string(16, 48, "Hardware Status:", COLOR_GREEN, COLOR_BLACK);
@@ -147,82 +220,489 @@ void diagnostic_mode(void) {
     uart_getc();
 }
 
-// Emergency shell - basic command interpreter
-void emergency_shell(void) {
-    fb_clear(COLOR_BLACK);
-    fb_draw_string(16, 16, "=== EMERGENCY SHELL ===", COLOR_AMBER, COLOR_BLACK);
-    fb_draw_string(16, 48, "No bootable device found.", COLOR_RED, COLOR_BLACK);
-    fb_draw_string(16, 80, "Available commands:", COLOR_GREEN, COLOR_BLACK);
-    fb_draw_string(32, 112, "help   - Show this help", COLOR_DKGREEN, COLOR_BLACK);
-    fb_draw_string(32, 132, "reboot - Reboot system", COLOR_DKGREEN, COLOR_BLACK);
-    fb_draw_string(32, 152, "diag   - Run diagnostics", COLOR_DKGREEN, COLOR_BLACK);
-    fb_draw_string(32, 172, "info   - System information", COLOR_DKGREEN, COLOR_BLACK);
-    fb_draw_string(16, 220, "> ", COLOR_GREEN, COLOR_BLACK);
-    fb_apply_scanlines();
+// Registers from the firmware, passed on to the next stage
+static uint32_t boot_machine;
+static uint32_t boot_atags;
 
-    uart_puts("\n=== EMERGENCY SHELL ===\n");
-    uart_puts("No bootable device found.\n");
-    uart_puts("Type 'help' for available commands.\n\n");
+// Volume on the SD card, mounted on first use
+static fat_volume_t boot_volume;
+static int boot_volume_mounted = 0;
 
-    char cmd_buffer[32];
-    int cmd_pos = 0;
+static int mount_boot_volume(void) {
+    if (boot_volume_mounted) return FAT_OK;
 
-    while (1) {
-        uart_puts("> ");
-        cmd_pos = 0;
-
-        // Read command
-        while (1) {
-            char c = uart_getc();
-            if (c == '\r' || c == '\n') {
-                cmd_buffer[cmd_pos] = '\0';
-                uart_puts("\n");
-                break;
-            } else if (c == 127 || c == 8) {  // Backspace
-                if (cmd_pos > 0) {
-                    cmd_pos--;
-                    uart_puts("\b \b");
-                }
-            } else if (cmd_pos < 31 && c >= 32 && c <= 126) {
-                cmd_buffer[cmd_pos++] = c;
-                uart_putc(c);
+    int rc = blockdev_get_sd() ? BLK_OK : blockdev_init();
+    if (rc != BLK_OK) return rc;
+
+    // Boot partition if the card has a table, else the whole card
+    blockdev_t *dev = blockdev_get_sd();
+    rc = part_get_table() ? PART_OK : part_scan(dev);
+    if (rc == PART_OK) {
+        const part_table_t *table = part_get_table();
+        uart_printf("%s partition table, %d partitions%s\n",
+                    table->scheme == PART_SCHEME_GPT ? "GPT" : "MBR", table->count,
+                    table->gpt_backup ? " (backup GPT)" : "");
+        for (uint32_t i = 0; i < table->count; i++) {
+            const part_t *p = &table->parts[i];
+            uart_printf("  %s: %s, start %d, %d MB%s\n", p->name, part_type_name(p),
+                        p->dev.start, p->dev.num_blocks / 2048,
+                        (p->flags & PART_FLAG_ACTIVE) ? ", active" : "");
+        }
+
+        part_t *boot = part_find_boot();
+        if (!boot) return PART_ERR_NOBOOT;
+        uart_printf("Boot partition: %s\n", boot->name);
+        dev = &boot->dev;
+    } else if (rc != PART_ERR_NOTABLE) {
+        return rc;
+    }
+
+    rc = fat_mount(&boot_volume, dev);
+    if (rc != FAT_OK) return rc;
+
+    boot_volume_mounted = 1;
+    uart_printf("FAT%d volume '%s': %d clusters of %d KB\n",
+                boot_volume.type, boot_volume.label, boot_volume.num_clusters,
+                boot_volume.cluster_blocks / 2);
+    return FAT_OK;
+}
+
+static const char *volume_strerror(int rc) {
+    return (rc <= PART_ERR_NOTABLE && rc > PART_ERR_NOTABLE - 16) ? part_strerror(rc)
+                                                                  : fat_strerror(rc);
+}
+
+static void list_directory(const char *path) {
+    fat_dir_t dir;
+    fat_dirent_t entry;
+
+    int rc = mount_boot_volume();
+    if (rc == FAT_OK) rc = fat_opendir(&boot_volume, path, &dir);
+    while (rc == FAT_OK && (rc = fat_readdir(&dir, &entry)) > 0) {
+        if (entry.attr & FAT_ATTR_DIRECTORY) {
+            uart_printf("  %s/\n", entry.name);
+        } else {
+            uart_printf("  %s  %d\n", entry.name, entry.size);
+        }
+        rc = FAT_OK;
+    }
+    if (rc < 0) {
+        uart_printf("ls: %s: %s\n", path, volume_strerror(rc));
+    }
+}
+
+// Print one pipeline stage: bytes over time as MB/s with two decimals
+static void print_load_rate(const char *label, uint32_t bytes, uint64_t us) {
+    uint32_t centi = us ? (uint32_t)((uint64_t)bytes * 100 * 1000000 / (us * 1024 * 1024)) : 0;
+    uart_printf("  %s %u KB in %u ms, %u.%02u MB/s\n", label, bytes / 1024,
+                (uint32_t)(us / 1000), centi / 100, centi % 100);
+}
+
+// Per-stage rates of one load
+static void print_load_stats(const loader_stats_t *st) {
+    print_load_rate("card:   ", st->in_bytes, st->io_us);
+    if (st->format != LOADER_FORMAT_RAW) {
+        print_load_rate("decode: ", st->out_bytes, st->total_us - st->wait_us);
+        uart_printf("  decoder waited %d ms for the card\n", (uint32_t)(st->wait_us / 1000));
+    }
+    if (st->sig != LOADER_SIG_NONE) {
+        print_load_rate("sha256: ", st->in_bytes - LOADER_SIG_SIZE, st->hash_us);
+    }
+    if (st->sig == LOADER_SIG_VERIFIED) {
+        uart_printf("  ed25519: signature checked in %d ms\n", (uint32_t)(st->verify_us / 1000));
+    }
+    print_load_rate("overall:", st->out_bytes, st->total_us);
+}
+
+// Load each file to the load area without running it and compare the
+// times, e.g. a native image against the same program as a flat binary
+static void load_benchmark(int count, char **paths) {
+    uint64_t times[2] = { 0, 0 };
+
+    int rc = mount_boot_volume();
+    if (rc != FAT_OK) {
+        uart_printf("bench: %s\n", volume_strerror(rc));
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        fat_file_t file;
+        loader_stats_t st;
+
+        rc = fat_open(&boot_volume, paths[i], &file);
+        if (rc == FAT_OK) {
+            rc = loader_load(&file, (uint8_t *)LOADER_ADDRESS, LOADER_MAX_SIZE, &st);
+        }
+        if (rc < 0) {
+            uart_printf("bench: %s: %s\n", paths[i], loader_strerror(rc));
+            return;
+        }
+        uart_printf("%s: %s, %d bytes from %d on the card\n", paths[i],
+                    loader_format_name(st.format), st.out_bytes, st.in_bytes);
+        print_load_stats(&st);
+        times[i] = st.total_us;
+    }
+    if (count == 2 && times[1]) {
+        uart_printf("%s took %d%% of the time of %s\n", paths[0],
+                    (uint32_t)(times[0] * 100 / times[1]), paths[1]);
+    }
+}
+
+// Load the boot catalog, rebuilding it if the card changed, and report
+static int load_catalog(int rebuild) {
+    const char *order = config_get("boot-order");
+    if (!order) order = DEFAULT_BOOT_ORDER;
+
+    int rc = rebuild ? catalog_rebuild(&boot_volume, order)
+                     : catalog_load(&boot_volume, order);
+    const catalog_stats_t *cs = catalog_get_stats();
+    if (rc == CATALOG_ERR_NOSPACE) {
+        // No retros.cat is a normal setup: boot-order is used directly
+        log_info("catalog", "Boot catalog unavailable (%s)", catalog_strerror(rc));
+    } else if (rc < 0) {
+        log_warn("catalog", "Boot catalog unavailable (%s)", catalog_strerror(rc));
+    } else if (cs->rebuilt) {
+        log_info("catalog", "Boot catalog rebuilt (%s): %d entries, %u files checksummed in %u ms",
+                 cs->reason, rc, cs->checksummed, (uint32_t)(cs->scan_us / 1000));
+        bootlog_note("Boot catalog rebuilt", cs->reason);
+        if (cs->save_rc != 0) {
+            log_warn("catalog", "Boot catalog not saved (%s)", catalog_strerror(cs->save_rc));
+        }
+    } else {
+        log_info("catalog", "Boot catalog: %d entries, checked in %u us", rc, (uint32_t)cs->check_us);
+    }
+    return rc;
+}
+
+// List the boot catalog, rescanning the card first if asked to
+static void show_catalog(int rebuild) {
+    int rc = mount_boot_volume();
+    if (rc != FAT_OK) {
+        uart_printf("catalog: %s\n", volume_strerror(rc));
+        return;
+    }
+
+    uint32_t count;
+    catalog_entries(&count);
+    if (rebuild || count == 0) {
+        rc = load_catalog(rebuild);
+        if (rc < 0) return;
+    }
+
+    const catalog_entry_t *entries = catalog_entries(&count);
+    for (uint32_t i = 0; i < count; i++) {
+        const catalog_entry_t *e = &entries[i];
+        uart_printf("  %s: %s, %d bytes, CRC 0x%08X, ", e->name, e->path, e->size, e->crc);
+        if (e->num_extents) {
+            uart_printf("%d extents\n", e->num_extents);
+        } else {
+            uart_puts("mapped at load time\n");
+        }
+    }
+}
+
+// Print the last few boot records, oldest first
+static void show_boot_log(const char *arg) {
+    uint32_t count;
+    const bootlog_record_t *records = bootlog_history(&count);
+    if (count == 0) {
+        uart_puts("No boot log (create " BOOTLOG_PATH " to keep one)\n");
+        return;
+    }
+
+    uint32_t show = 0;
+    while (*arg >= '0' && *arg <= '9') show = show * 10 + (uint32_t)(*arg++ - '0');
+    if (show == 0) show = 5;
+    if (show > count) show = count;
+
+    for (const bootlog_record_t *r = records + count - show; r < records + count; r++) {
+        uart_printf("Boot %d: %s, %d ms", r->seq, r->kernel[0] ? r->kernel : "no kernel",
+                    r->end_ms);
+        if (r->flags & BOOTLOG_FLAG_BOOTED) uart_puts(", booted");
+        if (r->flags & BOOTLOG_FLAG_SHELL) uart_puts(", shell");
+        if (r->flags & BOOTLOG_FLAG_ERROR) uart_printf(", error %d", r->error);
+        uart_puts("\n ");
+        for (int i = 0; i < BOOTLOG_PHASES; i++) {
+            if (r->phase_us[i]) {
+                uart_printf(" %s %d ms", bootlog_phase_name(i), r->phase_us[i] / 1000);
             }
         }
+        uart_puts("\n");
+        uart_puts(r->text);
+    }
+}
+
+// Switch the UART to a new rate and check it through the loopback; a
+// rate that fails goes back to the previous one
+static int switch_baud(uint32_t baud) {
+    uint32_t old = uart_get_baud();
+    uint32_t measured = 0;
+
+    log_info("uart", "Switching UART to %u baud", baud);
+    int rc = uart_set_baud(baud);
+    if (rc == 0) rc = uart_loopback_test(&measured);
+    if (rc < 0) {
+        uart_set_baud(old);
+        log_warn("uart", "%u baud not usable (%s, measured %u), staying at %u",
+                 baud, uart_strerror(rc), measured, uart_get_baud());
+        return rc;
+    }
+    log_info("uart", "UART at %u baud (clock %u Hz, loopback measured %u)",
+             uart_get_baud(), uart_get_clock(), measured);
+    return 0;
+}
+
+// Run code that is already in memory (a serial image, or 'go') with the
+// same handoff as a kernel from the card
+__attribute__((noreturn))
+static void run_loaded(uint32_t entry, const char *what) {
+    // The warm boot cache no longer matches what runs next
+    warmboot_invalidate();
+    uint32_t handoff_size = config_handoff((void *)CONFIG_HANDOFF_ADDR, CONFIG_HANDOFF_MAX);
+
+    bootlog_kernel(what);
+    bootlog_phase(BOOTLOG_PHASE_LOAD);
+    bootlog_flag(BOOTLOG_FLAG_BOOTED);
+    bootlog_commit();
 
-        // Process command
-        if (cmd_buffer[0] == '\0') {
-            continue;
-        } else if (cmd_buffer[0] == 'h') {  // help
-            uart_puts("Available commands:\n");
-            uart_puts("  help   - Show this help\n");
-            uart_puts("  reboot - Reboot system\n");
-            uart_puts("  diag   - Run diagnostics\n");
-            uart_puts("  info   - System information\n");
-        } else if (cmd_buffer[0] == 'r') {  // reboot
-            uart_puts("Rebooting system...\n");
-            delay_ms(1000);
-            // In real implementation: reset via watchdog
-            uart_puts("(Reboot not implemented in demo)\n");
-        } else if (cmd_buffer[0] == 'd') {  // diag
-            diagnostic_mode();
-        } else if (cmd_buffer[0] == 'i') {  // info
-            uart_puts("RETROS-BIOS v1.0.0\n");
-            uart_printf("Peripheral Base: %x\n", PERIPHERAL_BASE);
-            uart_puts("Target: "
+    uart_printf("Jumping to %s image at 0x%08X\n", what, entry);
+    loader_jump(entry, 0, boot_machine, boot_atags, handoff_size ? CONFIG_HANDOFF_ADDR : 0);
+}
+
+// Receive an image over the UART (tools/serial_load.py) and run it if
+// the sender asked for that
+static void serial_boot(void) {
+    serial_load_info_t info;
+
+    uart_puts("Waiting for an image from tools/serial_load.py (Ctrl-C to cancel)\n");
+    int rc = serial_load(LOADER_ADDRESS, LOADER_MAX_SIZE, &info);
+    if (rc < 0) {
+        uart_printf("\nload: %s\n", serial_strerror(rc));
+        return;
+    }
+
+    // Bytes per ms is kB/s; the line carries 10 bits per byte
+    uint32_t ms = (uint32_t)(info.us / 1000);
+    uart_printf("\nReceived %d bytes at 0x%08X in %d ms: %d kB/s on a %d kB/s line\n",
+                info.image.size, info.image.load_addr, ms,
+                ms ? info.image.size / ms : 0, uart_get_baud() / 10000);
+    uart_printf("%d packets, %d NAKs", info.packets, info.naks);
+    if (info.resumed_at) uart_printf(", resumed at byte %d", info.resumed_at);
+    uart_printf(", image CRC 0x%08X OK\n", info.image.crc);
+
+    // Signed images are checked as if they came from the card (and
+    // VERIFIED_BOOT builds take nothing else); the payload then moves down
+    // over the header and runs from the load address
+    loader_stats_t st;
+    uint8_t *image = (uint8_t *)info.image.load_addr;
+    uint32_t entry = info.image.entry;
+    rc = loader_verify(image, info.image.size, &st);
+    if (rc < 0) {
+        uart_printf("load: %s, not run\n", loader_strerror(rc));
+        return;
+    }
+    if (rc > 0) {
+        memmove(image, image + rc, info.image.size - (uint32_t)rc);
+        entry = info.image.load_addr;
+        uart_printf("Image %s OK in %u us\n",
+                    st.sig == LOADER_SIG_VERIFIED ? "signature and SHA-256 digest" :
+                    "SHA-256 digest (no boot key built in)",
+                    (uint32_t)(st.verify_us + st.hash_us));
+    }
+    if (!(info.image.flags & SERIAL_FLAG_RUN)) return;
+
+    run_loaded(entry, "serial");
+}
+
+// Print the in-RAM log, or with a level (0-3) set what reaches the UART
+static void show_messages(const char *arg) {
+    if (*arg >= '0' && *arg <= '3' && !arg[1]) {
+        log_set_level(LOG_SINK_UART, *arg - '0');
+        return;
+    }
+
+    log_dump();
+    const log_stats_t *ls = log_get_stats();
+    uart_printf("%u messages in %u us, %u filtered, %u bytes dropped from the ring; "
+                "UART level %d, built with level %d\n",
+                ls->messages, (uint32_t)ls->us, ls->filtered, ls->ring_lost,
+                log_get_level(LOG_SINK_UART), LOG_COMPILE_LEVEL);
+}
+
+// Emergency shell commands; the memory and SD tools are built into the
+// shell itself
+static int cmd_reboot(int argc, char **argv) {
+    // A plain reboot is cold; "reboot warm" keeps the cached kernel
+    if (argc < 2 || strcmp(argv[1], "warm") != 0) warmboot_invalidate();
+    uart_puts("Rebooting system...\n");
+    uart_flush();
+    warmboot_reset();
+}
+
+static int cmd_diag(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    diagnostic_mode();
+    return 0;
+}
+
+static int cmd_info(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    uart_puts("RETROS-BIOS v1.0.0\n");
+    uart_printf("Peripheral Base: 0x%08X\n", PERIPHERAL_BASE);
+    uart_puts("Target: "
 #if defined(BCM2836)
-                "BCM2836 (RPi2)\n"
+        "BCM2836 (RPi2)\n"
 #elif defined(BCM2837)
-                "BCM2837 (RPi3)\n"
+        "BCM2837 (RPi3)\n"
 #else
-                "BCM2835 (RPi0/1)\n"
+        "BCM2835 (RPi0/1)\n"
 #endif
-            );
-        } else {
-            uart_puts("Unknown command: ");
-            uart_puts(cmd_buffer);
-            uart_puts("\nType 'help' for available commands.\n");
-        }
+    );
+    const uart_stats_t *us = uart_get_stats();
+    uart_printf("UART: %d bytes dropped sending, %d receiving, %d overruns\n",
+                us->tx_dropped, us->rx_dropped, us->rx_overruns);
+    const log_stats_t *ls = log_get_stats();
+    uart_printf("Log: %u messages in %u us, %u filtered\n",
+                ls->messages, (uint32_t)ls->us, ls->filtered);
+    return 0;
+}
+
+static int cmd_cache(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    const bcache_stats_t *st = bcache_get_stats();
+    uint32_t lookups = st->hits + st->misses;
+    uart_printf("Block cache: %d/%d entries used, %d pinned\n",
+                st->used, st->entries, st->pinned);
+    uart_printf("  hits %d, misses %d (%d%% hit rate), evictions %d\n",
+                st->hits, st->misses, lookups ? st->hits * 100 / lookups : 0,
+                st->evictions);
+    uart_printf("  bypass %d blocks, written %d blocks\n", st->bypass, st->writes);
+    return 0;
+}
+
+static int cmd_ls(int argc, char **argv) {
+    list_directory(argc > 1 ? argv[1] : "/");
+    return 0;
+}
+
+static int cmd_bench(int argc, char **argv) {
+    if (argc < 2 || argc > 3) return SHELL_ERR_USAGE;
+    load_benchmark(argc - 1, argv + 1);
+    return 0;
+}
+
+static int cmd_config(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    uint32_t count;
+    const config_entry_t *entries = config_entries(&count);
+    if (count == 0) uart_puts("No settings loaded, defaults in use\n");
+    for (uint32_t i = 0; i < count; i++) {
+        uart_printf("  %s = %s\n", entries[i].key, entries[i].value);
+    }
+    return 0;
+}
+
+static int cmd_catalog(int argc, char **argv) {
+    show_catalog(argc > 1 && strcmp(argv[1], "rebuild") == 0);
+    return 0;
+}
+
+static int cmd_log(int argc, char **argv) {
+    show_boot_log(argc > 1 ? argv[1] : "");
+    return 0;
+}
+
+static int cmd_dmesg(int argc, char **argv) {
+    show_messages(argc > 1 ? argv[1] : "");
+    return 0;
+}
+
+static int cmd_baud(int argc, char **argv) {
+    uint32_t baud;
+    if (argc < 2) {
+        uart_printf("UART at %d baud, clock %d Hz\n", uart_get_baud(), uart_get_clock());
+        return 0;
     }
+    if (!shell_parse_uint(argv[1], &baud) || baud == 0) return SHELL_ERR_USAGE;
+    switch_baud(baud);
+    return 0;
+}
+
+static int cmd_load(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    serial_boot();
+    return 0;
+}
+
+// Not in verified boot builds: it would run code no signature covers
+#ifndef VERIFIED_BOOT
+static int cmd_go(int argc, char **argv) {
+    uint32_t entry;
+    if (argc != 2 || !shell_parse_uint(argv[1], &entry)) return SHELL_ERR_USAGE;
+    run_loaded(entry, "go");
+}
+#endif
+
+static const shell_command_t bios_commands[] = {
+    { "reboot",  "[warm]",        "Reboot system (warm: rerun the cached kernel)",   cmd_reboot },
+    { "diag",    "",              "Run diagnostics",                                 cmd_diag },
+    { "info",    "",              "System information",                              cmd_info },
+    { "cache",   "",              "Block cache statistics",                          cmd_cache },
+    { "ls",      "[dir]",         "List a directory on the SD card",                 cmd_ls },
+    { "bench",   "<file> [file]", "Time loading images",                             cmd_bench },
+    { "config",  "",              "Show boot settings from " CONFIG_PATH,            cmd_config },
+    { "catalog", "[rebuild]",     "Show or rescan the boot catalog",                 cmd_catalog },
+    { "log",     "[n]",           "Show the last boots from " BOOTLOG_PATH,          cmd_log },
+    { "dmesg",   "[0-3]",         "Show recent log messages, or set the UART level", cmd_dmesg },
+    { "baud",    "[rate]",        "Show or change the UART rate (up to 3000000)",    cmd_baud },
+    { "load",    "",              "Receive an image from tools/serial_load.py",      cmd_load },
+#ifndef VERIFIED_BOOT
+    { "go",      "<addr>",        "Jump to code in memory",                          cmd_go },
+#endif
+};
+
+#define BIOS_COMMANDS (sizeof(bios_commands) / sizeof(bios_commands[0]))
+
+// Emergency shell - command interpreter on the UART
+void emergency_shell(void) {
+    // This boot ends here; keep its record
+    bootlog_flag(BOOTLOG_FLAG_SHELL);
+    bootlog_commit();
+
+    // Interactive from here on: wait for the line rather than drop output
+    uart_set_blocking(1);
+
+    fb_clear(COLOR_BLACK);
+    fb_draw_string(16, 16, "=== EMERGENCY SHELL ===", COLOR_AMBER, COLOR_BLACK);
+    fb_draw_string(16, 48, "No bootable device found.", COLOR_RED, COLOR_BLACK);
+    fb_draw_string(16, 80, "Available commands:", COLOR_GREEN, COLOR_BLACK);
+
+    uint32_t y = 112;
+    for (uint32_t i = 0; i < BIOS_COMMANDS; i++, y += 16) {
+        fb_printf(32, y, COLOR_DKGREEN, COLOR_BLACK, "%-7s - %s",
+                  bios_commands[i].name, bios_commands[i].help);
+    }
+
+    // The built-in tools share a line
+    char tools[64];
+    uint32_t count, n = 0;
+    const shell_command_t *builtins = shell_builtins(&count);
+    for (uint32_t i = 0; i < count && n < sizeof(tools); i++) {
+        n += (uint32_t)snprintf(tools + n, sizeof(tools) - n, "%s ", builtins[i].name);
+    }
+    fb_printf(32, y, COLOR_DKGREEN, COLOR_BLACK, "%s- Memory, SD and timing tools", tools);
+    fb_draw_string(16, y + 28, "> ", COLOR_GREEN, COLOR_BLACK);
+    fb_apply_scanlines();
+
+    uart_puts("\n=== EMERGENCY SHELL ===\n");
+    uart_puts("No bootable device found.\n");
+    uart_puts("Type 'help' for available commands.\n\n");
+
+    shell_run(bios_commands, BIOS_COMMANDS);
 }
 
 // Check if a file exists in boot sector by looking for signature
@@ -244,73 +724,309 @@ int check_boot_signature(const uint8_t *buffer, const char *signature) {
     return 0;
 }
 
+// Expected CRC-32 of an image from its "<path>.crc" companion file, which
+// holds the value as hex digits; returns 0 if there is none
+static int read_expected_crc(const char *path, uint32_t *crc) {
+    char name[FAT_NAME_MAX + 1];
+    char text[16];
+    fat_file_t file;
+
+    if (!boot_volume_mounted || strlen(path) + 5 > FAT_NAME_MAX) return 0;
+    strcpy(name, path);
+    strcat(name, ".crc");
+    if (fat_open(&boot_volume, name, &file) != FAT_OK) return 0;
+
+    int n = fat_read(&file, text, sizeof(text) - 1);
+    if (n <= 0) return 0;
+    text[n] = '\0';
+
+    const char *p = text;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+
+    uint32_t value = 0;
+    int digits = 0;
+    for (; digits < 8; digits++, p++) {
+        char c = *p;
+        uint32_t d;
+        if (c >= '0' && c <= '9') d = (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') d = (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') d = (uint32_t)(c - 'A' + 10);
+        else break;
+        value = (value << 4) | d;
+    }
+    if (digits == 0) return 0;
+
+    *crc = value;
+    return 1;
+}
+
+// Verified boot builds never warm boot: the cached copy is the loaded
+// image, not the signed file, so its signature cannot be checked again and
+// anything in RAM could have rewritten it
+static int warm_boot_enabled(void) {
+#ifdef VERIFIED_BOOT
+    return 0;
+#else
+    return config_get_bool("warm-boot", 1);
+#endif
+}
+
+// Load an open next-stage file and run it. A catalog entry, if the file
+// came from one, supplies the expected CRC; otherwise it is looked for
+// in "<path>.crc".
+static void boot_image(fat_file_t *file, const char *path, const char *what,
+                       const catalog_entry_t *entry) {
+    loader_stats_t st;
+
+    bootlog_kernel(what);
+    fb_draw_string(16, 450, "Loading next stage image...", COLOR_GREEN, COLOR_BLACK);
+    log_info("load", "Loading %s from %s (%u bytes) to 0x%08X", what, path, file->size, LOADER_ADDRESS);
+
+    int rc = loader_load(file, (uint8_t *)LOADER_ADDRESS, LOADER_MAX_SIZE, &st);
+    if (rc < 0) {
+        log_error("load", "Failed to load %s (%s)", path, loader_strerror(rc));
+        bootlog_error("Load failed", path, rc);
+        log_info("boot", "Dropping to emergency shell...");
+        delay_ms(1000);
+        emergency_shell();
+    }
+
+    log_info("load", "Loaded %s image: %u -> %u bytes, %u card commands",
+             loader_format_name(st.format), st.in_bytes, st.out_bytes, st.commands);
+
+    // CRC-32 of the file, accumulated while it streamed in; native images
+    // carry one per segment instead
+    uint32_t expected = entry ? entry->crc : 0;
+    if (st.format == LOADER_FORMAT_RIMG) {
+        log_info("load", "%u segments, %u bytes zero filled, segment CRCs OK",
+                 st.segments, st.zeroed);
+    } else if (!entry && !read_expected_crc(path, &expected)) {
+        log_info("load", "No %s.crc, image CRC 0x%08X not verified", path, st.crc);
+    } else if (expected != st.crc) {
+        log_error("load", "%s CRC mismatch: expected 0x%08X, got 0x%08X", path, expected, st.crc);
+        bootlog_error("CRC mismatch", path, STREAM_ERR_CHECK);
+        log_info("boot", "Dropping to emergency shell...");
+        delay_ms(1000);
+        emergency_shell();
+    } else {
+        log_info("load", "Image CRC 0x%08X OK", st.crc);
+    }
+    if (st.sig == LOADER_SIG_VERIFIED) {
+        log_info("sig", "Image signature and SHA-256 digest OK");
+    } else if (st.sig == LOADER_SIG_DIGEST) {
+        log_warn("sig", "No boot key built in, image signature not checked");
+        log_info("sig", "Image SHA-256 digest OK");
+    } else {
+        log_info("sig", "Image is not signed");
+    }
+    print_load_stats(&st);
+
+    // The parsed configuration goes along in r3
+    uint32_t handoff_size = config_handoff((void *)CONFIG_HANDOFF_ADDR, CONFIG_HANDOFF_MAX);
+    uint32_t handoff = handoff_size ? CONFIG_HANDOFF_ADDR : 0;
+
+    // Keep a copy for a warm reboot, and time this cold boot against it
+    if (warm_boot_enabled()) {
+        rc = warmboot_save(LOADER_ADDRESS, &st, CONFIG_HANDOFF_ADDR, handoff_size, what,
+                           (uint32_t)timer_get_uptime_us());
+        if (rc < 0) {
+            log_warn("warm", "Warm boot cache not updated (%s)", warmboot_strerror(rc));
+        }
+    } else {
+        warmboot_invalidate();
+    }
+    log_info("boot", "Cold boot: %u ms from reset, %u ms in the BIOS",
+             (uint32_t)(timer_get_ticks() / 1000), (uint32_t)(timer_get_uptime_us() / 1000));
+    const log_stats_t *ls = log_get_stats();
+    log_info("log", "%u messages, %u us spent logging", ls->messages, (uint32_t)ls->us);
+
+    // The boot record goes out last, in a single write
+    bootlog_phase(BOOTLOG_PHASE_LOAD);
+    bootlog_flag(BOOTLOG_FLAG_BOOTED);
+    rc = bootlog_commit();
+    if (rc < 0 && rc != BOOTLOG_ERR_NOFILE) {
+        log_warn("bootlog", "Boot log not written (%s)", bootlog_strerror(rc));
+    }
+
+    fb_draw_string(16, 466, "Jumping to next stage...", COLOR_GREEN, COLOR_BLACK);
+    log_info("boot", "Jumping to %s at 0x%08X", what, st.entry);
+    loader_jump(st.entry, 0, boot_machine, boot_atags, handoff);
+}
+
+// Load a next-stage file from the boot volume and run it; returns only
+// if the file does not exist
+static void boot_file(const char *path, const char *what) {
+    fat_file_t file;
+
+    if (fat_open(&boot_volume, path, &file) != FAT_OK) return;
+    boot_image(&file, path, what, 0);
+}
+
+// Offer the catalog entries in a menu and boot the choice straight from
+// its saved extents; returns if there is nothing to boot that way
+static void boot_catalog(void) {
+    if (load_catalog(0) <= 0) return;
+
+    uint32_t count;
+    const catalog_entry_t *entries = catalog_entries(&count);
+
+    int choice = 0;
+    const char *def = config_get("menu-default");
+    if (def && (choice = catalog_find(def)) < 0) {
+        log_warn("catalog", "menu-default '%s' is not in the boot catalog", def);
+        choice = 0;
+    }
+
+    uint32_t timeout = config_get_uint("menu-timeout", 3000);
+    if (count > 1 && timeout) {
+        const char *names[CATALOG_MAX_ENTRIES];
+        for (uint32_t i = 0; i < count; i++) names[i] = entries[i].name;
+
+        // The menu only polls, so animations keep running while it waits
+        menu_open("=== BOOT MENU ===", names, count, (uint32_t)choice, timeout);
+        while ((choice = menu_poll()) == MENU_PENDING) {
+            anim_tick();
+        }
+    }
+    bootlog_phase(BOOTLOG_PHASE_MENU);
+
+    const catalog_entry_t *entry = &entries[choice];
+    fat_file_t file;
+    int rc = catalog_open(&boot_volume, entry, &file);
+    if (rc != FAT_OK) {
+        log_warn("catalog", "Cannot open %s from the boot catalog (%s)",
+                 entry->path, catalog_strerror(rc));
+        return;
+    }
+    boot_image(&file, entry->path, entry->name, entry);
+}
+
+// Try each file of a comma-separated list in turn
+static void boot_order(const char *list) {
+    char path[FAT_NAME_MAX + 1];
+
+    while (*list) {
+        uint32_t len = 0;
+        while (*list == ' ' || *list == ',') list++;
+        while (list[len] && list[len] != ',') len++;
+        uint32_t end = len;
+        while (end > 0 && list[end - 1] == ' ') end--;
+        if (end > 0 && end <= FAT_NAME_MAX) {
+            memcpy(path, list, end);
+            path[end] = '\0';
+            boot_file(path, path);
+        }
+        list += len;
+    }
+}
+
+// Raw boot sector (tools/mkdisk.py): the signature at byte 16, then the
+// first block and byte size of an image stored outside any filesystem
+#define BOOT_SECTOR_IMAGE_LBA   24
+#define BOOT_SECTOR_IMAGE_SIZE  28
+
+static uint32_t boot_sector_word(const uint8_t *sector, uint32_t offset) {
+    return sector[offset] | (sector[offset + 1] << 8) | (sector[offset + 2] << 16) |
+           ((uint32_t)sector[offset + 3] << 24);
+}
+
+// Load the image the boot sector points at and run it; returns if it
+// names none or the blocks are off the card
+static void boot_sector_image(const uint8_t *sector, const char *what) {
+    static fat_volume_t raw_volume;
+    uint32_t lba = boot_sector_word(sector, BOOT_SECTOR_IMAGE_LBA);
+    uint32_t size = boot_sector_word(sector, BOOT_SECTOR_IMAGE_SIZE);
+    fat_file_t file;
+
+    if (lba == 0 || size == 0) {
+        log_warn("boot", "Boot sector names no %s image", what);
+        return;
+    }
+    int rc = fat_open_blocks(&raw_volume, blockdev_get_sd(), lba, size, &file);
+    if (rc != FAT_OK) {
+        log_error("boot", "%s image at block %u (%u bytes): %s", what, lba, size,
+                  fat_strerror(rc));
+        return;
+    }
+    boot_image(&file, "boot sector", what, 0);
+}
+
 // Chain-load next stage from SD card
 void chain_load_next_stage(void) {
     fb_draw_string(16, 430, "Loading next stage...", COLOR_GREEN, COLOR_BLACK);
-    uart_puts("Chain-loading next stage from SD card...\n");
+    log_info("boot", "Chain-loading next stage from SD card...");
 
-    // Initialize SD card
-    if (sd_init() != 0) {
-        fb_draw_string(16, 450, "ERROR: SD card init failed", COLOR_RED, COLOR_BLACK);
-        uart_puts("ERROR: Failed to initialize SD card\n");
-        uart_puts("Dropping to emergency shell...\n");
+    // Initialize SD card (diagnostic mode may already have done so)
+    int rc = blockdev_get_sd() ? BLK_OK : blockdev_init();
+    if (rc != BLK_OK) {
+        log_error("sd", "Failed to initialize SD card (%s)", blockdev_strerror(rc));
+        bootlog_error("SD card init failed", 0, rc);
+        log_info("boot", "Dropping to emergency shell...");
         delay_ms(1000);
         emergency_shell();
         return;
     }
 
-    // Read boot sector (block 0)
-    uint8_t buffer[512];
-    if (sd_read_block(0, buffer) != 0) {
-        fb_draw_string(16, 450, "ERROR: Cannot read boot sector", COLOR_RED, COLOR_BLACK);
-        uart_puts("ERROR: Failed to read boot sector\n");
-        uart_puts("Dropping to emergency shell...\n");
+    if (bcache_get_stats()->entries == 0 && bcache_init(BCACHE_DEFAULT_ENTRIES) != BLK_OK) {
+        log_warn("sd", "Block cache disabled (out of memory)");
+    }
+
+    mmc_card_info_t *card = mmc_get_card_info();
+    log_info("sd", "%s, %u MB, %s at %u kHz, %u-bit bus",
+             card->type == MMC_TYPE_SDHC ? "SDHC/SDXC" : "SDSC",
+             card->capacity / 2048, mmc_mode_name(card->mode),
+             card->clock_hz / 1000, card->bus_width);
+    bootlog_phase(BOOTLOG_PHASE_CARD);
+
+    // Strategy 1: Look for next-stage files on a FAT volume
+    rc = mount_boot_volume();
+    if (rc != FAT_OK) {
+        log_info("fat", "No FAT volume (%s), scanning boot sector", volume_strerror(rc));
+    } else {
+        // Path lookups only run if the catalog had nothing to boot
+        boot_catalog();
+        if (config_get("boot-order")) {
+            boot_order(config_get("boot-order"));
+        } else {
+            boot_file("/mfboot.bin", "MFBootAgent");
+            boot_file("/kernel.bin", "kernel");
+        }
+    }
+
+    // Boot sector (block 0), already read by the partition scan
+    const uint8_t *buffer = part_boot_sector();
+    if (!buffer) {
+        rc = part_scan(blockdev_get_sd());
+        buffer = part_boot_sector();
+    }
+    if (!buffer) {
+        log_error("sd", "Failed to read boot sector (%s)", blockdev_strerror(rc));
+        bootlog_error("Boot sector read failed", 0, rc);
+        log_info("boot", "Dropping to emergency shell...");
         delay_ms(1000);
         emergency_shell();
         return;
     }
 
-    // Strategy 1: Look for MFBootAgent
-    uart_puts("Looking for MFBootAgent...\n");
+    // Strategy 2: Look for MFBootAgent in the boot sector
+    log_info("boot", "Looking for MFBootAgent...");
     if (check_boot_signature(buffer, "MFBOOT")) {
         fb_draw_string(16, 450, "Found MFBootAgent!", COLOR_GREEN, COLOR_BLACK);
-        uart_puts("MFBootAgent found!\n");
-
-        // In real implementation:
-        // 1. Parse MFBootAgent header
-        // 2. Load agent to 0x8000 (or specified address)
-        // 3. Jump to entry point: ((void(*)(void))0x8000)();
-
-        uart_puts("Loading MFBootAgent to memory...\n");
-        delay_ms(500);
-        fb_draw_string(16, 466, "Jumping to MFBootAgent...", COLOR_GREEN, COLOR_BLACK);
-        uart_puts("Would jump to MFBootAgent at 0x8000...\n");
-        delay_ms(2000);
-        return;
+        log_info("boot", "MFBootAgent found!");
+        boot_sector_image(buffer, "MFBootAgent");
     }
 
-    // Strategy 2: Try to load kernel directly
-    uart_puts("MFBootAgent not found. Looking for kernel...\n");
-    if (check_boot_signature(buffer, "KERNEL") || (buffer[510] == 0x55 && buffer[511] == 0xAA)) {
+    // Strategy 3: Try to load kernel directly
+    log_info("boot", "MFBootAgent not found. Looking for kernel...");
+    if (check_boot_signature(buffer, "KERNEL")) {
         fb_draw_string(16, 450, "Found kernel image", COLOR_GREEN, COLOR_BLACK);
-        uart_puts("Kernel image found!\n");
-
-        // In real implementation:
-        // 1. Parse kernel header
-        // 2. Load kernel to specified address
-        // 3. Set up kernel parameters
-        // 4. Jump to kernel entry point
-
-        uart_puts("Loading kernel to memory...\n");
-        delay_ms(500);
-        fb_draw_string(16, 466, "Jumping to kernel...", COLOR_GREEN, COLOR_BLACK);
-        uart_puts("Would jump to kernel...\n");
-        delay_ms(2000);
-        return;
+        log_info("boot", "Kernel image found!");
+        boot_sector_image(buffer, "kernel");
     }
 
-    // Strategy 3: Nothing found - drop to emergency shell
-    uart_puts("No bootable image found.\n");
+    // Strategy 4: Nothing found - drop to emergency shell
+    log_info("boot", "No bootable image found.");
+    bootlog_note("No bootable image found", 0);
     fb_draw_string(16, 450, "No boot image found", COLOR_AMBER, COLOR_BLACK);
     fb_draw_string(16, 466, "Entering emergency shell...", COLOR_AMBER, COLOR_BLACK);
     delay_ms(1500);
@@ -318,37 +1034,166 @@ void chain_load_next_stage(void) {
     emergency_shell();
 }
 
+// Jump straight back into the kernel cached by the previous boot if a
+// watchdog reset left it intact; returns if the boot has to be cold.
+// This runs before load_config(), so only the build can rule it out here;
+// "warm-boot = no" acts through boot_image, which drops the cached copy on
+// the next cold boot instead of saving one.
+static void warm_boot(void) {
+#ifdef VERIFIED_BOOT
+    warmboot_invalidate();
+    return;
+#endif
+
+    int rc = warmboot_find();
+    if (rc == 0) return;
+    if (rc < 0) {
+        log_info("warm", "Warm boot not possible (%s), cold booting", warmboot_strerror(rc));
+        return;
+    }
+
+    uint64_t start = timer_get_ticks();
+    const warmboot_block_t *b = warmboot_restore();
+    uint64_t now = timer_get_ticks();
+
+    log_info("warm", "Warm boot %u: %s (%u bytes) restored from RAM in %u us",
+             b->warm_boots, b->name, b->image_size, (uint32_t)(now - start));
+    log_info("warm", "Warm boot: %u ms from reset, %u us in the BIOS",
+             (uint32_t)(now / 1000), (uint32_t)timer_get_uptime_us());
+    log_info("warm", "Cold boot: %u ms from reset, %u ms in the BIOS",
+             b->cold_us / 1000, b->cold_bios_us / 1000);
+    loader_jump(b->entry, 0, boot_machine, boot_atags, b->handoff_addr);
+}
+
+// Skip the cosmetic parts of the boot (fast-boot in retros.cfg)
+static int fast_boot;
+
+// Read retros.cfg from the boot partition; without it every setting keeps
+// its built-in default
+static void load_config(void) {
+    int rc = mount_boot_volume();
+    if (rc != FAT_OK) {
+        log_info("cfg", "No boot volume (%s), using default settings", volume_strerror(rc));
+        return;
+    }
+
+    // Find the boot log while the volume is fresh; without the file the
+    // record is kept in RAM only
+    rc = bootlog_attach(&boot_volume);
+    if (rc < 0 && rc != BOOTLOG_ERR_NOFILE) {
+        log_warn("bootlog", "Boot log disabled (%s)", bootlog_strerror(rc));
+    }
+
+    rc = config_load(&boot_volume, CONFIG_PATH);
+    if (rc < 0) {
+        log_info("cfg", "No %s (%s), using default settings", CONFIG_PATH, config_strerror(rc));
+        bootlog_note("Default settings", config_strerror(rc));
+        return;
+    }
+    log_info("cfg", "%s: %d settings", CONFIG_PATH, rc);
+    if (config_bad_lines()) {
+        log_warn("cfg", "%u malformed lines in %s ignored", config_bad_lines(), CONFIG_PATH);
+    }
+    log_set_level(LOG_SINK_UART, (int)config_get_uint("log-level", LOG_INFO));
+
+    uint32_t baud = config_get_uint("baud", 0);
+    if (baud) switch_baud(baud);
+}
+
+// Draw the boot splash: SPLASH_PATH (or the "splash" setting) on the boot
+// volume, else the image embedded with SPLASH=file.png. Returns 1 if one
+// was drawn.
+static int show_splash(void) {
+    const char *path = config_get("splash");
+    if (!path) path = SPLASH_PATH;
+
+    uint64_t start = timer_get_ticks();
+    fat_file_t file;
+    int rc;
+    if (boot_volume_mounted && fat_open(&boot_volume, path, &file) == FAT_OK) {
+        rc = splash_draw_file(&file, SPLASH_BUDGET_US);
+    } else if (&splash_image_size != 0) {
+        path = "embedded";
+        rc = splash_draw_mem(splash_image, splash_image_size, SPLASH_BUDGET_US);
+    } else {
+        return 0;
+    }
+    log_info("fb", "Splash (%s) decoded in %u us (status %d)", path,
+             (uint32_t)(timer_get_ticks() - start), rc);
+    return 1;
+}
+
+// "resolution = WIDTHxHEIGHT" if set and usable, else the native mode
+static int init_display(void) {
+    const char *p = config_get("resolution");
+    uint32_t size[2] = { 0, 0 };
+
+    for (int i = 0; p && i < 2; i++) {
+        while (*p >= '0' && *p <= '9') size[i] = size[i] * 10 + (uint32_t)(*p++ - '0');
+        if (*p == 'x' || *p == 'X') p++;
+    }
+    if (size[0] >= FB_LOGICAL_WIDTH && size[1] >= FB_LOGICAL_HEIGHT) {
+        if (fb_init(size[0], size[1], 32) == 0) return 0;
+        log_warn("fb", "%ux%u not available, using native resolution", size[0], size[1]);
+    }
+    return fb_init_native();
+}
+
 // Main kernel entry point
 void kernel_main(uint32_t r0 __attribute__((unused)),
-                 uint32_t r1 __attribute__((unused)),
-                 uint32_t atags __attribute__((unused))) {
+                 uint32_t r1,
+                 uint32_t atags) {
+    boot_machine = r1;
+    boot_atags = atags;
+
     // Initialize hardware
+    timer_init();
+    bootlog_begin();
+    irq_init();
     uart_init();
+    irq_enable();
     uart_puts("\n\n");
     uart_puts("======================================\n");
     uart_puts("  RETROS-BIOS v1.0\n");
     uart_puts("  RobCo Industries (TM) Terminal\n");
     uart_puts("======================================\n\n");
 
-    // Initialize framebuffer (640x480, 32-bit color)
-    if (fb_init(640, 480, 32) != 0) {
-        uart_puts("ERROR: Failed to initialize framebuffer\n");
+    warm_boot();
+    load_config();
+    fast_boot = config_get_bool("fast-boot", 0);
+    bootlog_phase(BOOTLOG_PHASE_CONFIG);
+
+    // Initialize framebuffer at the configured or the display's native
+    // resolution (32-bit color); the 640x480 text layout is scaled up to fit
+    if (init_display() != 0) {
+        uart_puts_sync("ERROR: Failed to initialize framebuffer\n");
         while (1) { }
     }
 
     framebuffer_t *fb = fb_get_info();
-    uart_printf("Framebuffer initialized: %dx%d, pitch=%d\n",
-                fb->width, fb->height, fb->pitch);
+    log_screen_enable(1);
+    log_info("fb", "Framebuffer initialized: %ux%u, pitch=%u, text scale=%ux",
+             fb->width, fb->height, fb->pitch, fb->scale);
 
     // Clear screen to black
     fb_clear(COLOR_BLACK);
 
+    int splash = show_splash();
+
     // Initialize PWM for audio
     pwm_audio_init();
 
     // Boot beep
-    uart_puts("Playing boot beep...\n");
-    pwm_boot_beep();
+    if (!fast_boot) {
+        uart_puts("Playing boot beep...\n");
+        pwm_boot_beep();
+    }
+
+    if (splash && !fast_boot) {
+        anim_delay_ms(1000);
+        fb_clear(COLOR_BLACK);
+    }
+    bootlog_phase(BOOTLOG_PHASE_DISPLAY);
 
     // Display boot header with Fallout style
     uint32_t y = 16;
@@ -359,27 +1204,35 @@ void kernel_main(uint32_t r0 __attribute__((unused)),
     fb_draw_string(16, y, "All Rights Reserved", COLOR_DKGREEN, COLOR_BLACK);
     y += 32;
 
-    delay_ms(500);
+    // Boot messages with animation; lines type concurrently with the
+    // rest of the boot work and finish at once if the skip key is pressed
+    anim_init();
+    anim_delay_ms(500);
 
-    // Boot messages with animation
     boot_message_animated(16, y, "Initializing hardware...", COLOR_GREEN);
     y += 32;
 
-    boot_message_animated(16, y, "Checking system memory...", COLOR_GREEN);
+    anim_type_text(16, y, "Checking system memory...", COLOR_GREEN, 150000);
     y += 20;
 
-    // Memory test pattern
-    delay_ms(300);
-    memory_test_pattern();
+    if (!fast_boot) {
+        // Memory test pattern
+        anim_delay_ms(300);
+        memory_test_pattern();
 
-    // Bad sector warning (random)
-    delay_ms(300);
-    bad_sector_warning();
+        // Bad sector warning (random)
+        anim_delay_ms(300);
+        bad_sector_warning();
+    }
 
     y = 430;
     boot_message_animated(16, y, "System initialization complete.", COLOR_GREEN);
-
-    delay_ms(500);
+    if (fast_boot) anim_skip();
+    anim_sync();
+    if (!fast_boot) {
+        anim_cursor(16 + 31 * 8, y, COLOR_GREEN, 500000);
+        anim_sync();
+    }
 
     // Apply scanline effect
     fb_apply_scanlines();
@@ -388,13 +1241,14 @@ void kernel_main(uint32_t r0 __attribute__((unused)),
     uart_puts("Press 'D' for diagnostic mode.\n");
 
     // Check for diagnostic mode
-    delay_ms(1000);
+    delay_ms(config_get_uint("diag-timeout", 1000));
     if (check_diagnostic_mode()) {
         diagnostic_mode();
         fb_clear(COLOR_BLACK);
         fb_draw_string(16, 16, "Exiting diagnostic mode...", COLOR_GREEN, COLOR_BLACK);
         delay_ms(1000);
     }
+    bootlog_phase(BOOTLOG_PHASE_SCREEN);
 
     // Chain-load next stage
     chain_load_next_stage();
@@ -1,9 +1,9 @@
 #include "memory.h"
 
 // Simple heap allocator
-// Heap starts after BSS section and grows upward
-extern char __bss_end[];  // Defined in linker script - use char array to avoid aliasing
-#define HEAP_START ((uint32_t)__bss_end)
+// Heap starts above the SVC and IRQ stacks and grows upward
+extern char __heap_start[];  // Defined in linker script - use char array to avoid aliasing
+#define HEAP_START ((uint32_t)__heap_start)
 #define HEAP_SIZE  (32 * 1024 * 1024)  // 32 MB heap
 
 typedef struct block_header {
@@ -126,6 +126,26 @@ void *realloc(void *ptr, uint32_t size) {
 
 void *memset(void *s, int c, uint32_t n) {
     uint8_t *p = (uint8_t *)s;
+
+    // Bytes up to a word boundary, then eight words per iteration (large
+    // fills such as a loaded image's bss)
+    while (n && ((uint32_t)p & 3)) {
+        *p++ = (uint8_t)c;
+        n--;
+    }
+    uint32_t word = (uint8_t)c * 0x01010101u;
+    uint32_t *w = (uint32_t *)p;
+    while (n >= 32) {
+        w[0] = word; w[1] = word; w[2] = word; w[3] = word;
+        w[4] = word; w[5] = word; w[6] = word; w[7] = word;
+        w += 8;
+        n -= 32;
+    }
+    while (n >= 4) {
+        *w++ = word;
+        n -= 4;
+    }
+    p = (uint8_t *)w;
     while (n--) {
         *p++ = (uint8_t)c;
     }
@@ -0,0 +1,157 @@
+#include "menu.h"
+#include "format.h"
+#include "framebuffer.h"
+#include "uart.h"
+#include "timer.h"
+
+// Layout on the 640x480 logical screen
+#define MENU_X          32
+#define MENU_Y          64
+#define MENU_LINE       20
+#define MENU_WIDTH      48          // Characters per row
+
+#define MENU_FG         0x0000FF00
+#define MENU_BG         0x00000000
+#define MENU_TITLE      0x00FFA500
+
+static const char *const *menu_items;
+static uint32_t menu_count;
+static uint32_t menu_sel;
+static uint64_t menu_deadline;      // 0 once the countdown has stopped
+static uint32_t menu_shown;         // Seconds left when last drawn
+static int menu_esc;                // 1 after ESC, 2 after ESC [
+
+// Pad a row of n characters with spaces so it overwrites what was drawn
+// before
+static void menu_pad(char *row, int n) {
+    if (n > MENU_WIDTH) n = MENU_WIDTH;
+    while (n < MENU_WIDTH) row[n++] = ' ';
+    row[n] = '\0';
+}
+
+static void menu_draw_item(uint32_t i) {
+    char row[MENU_WIDTH + 1];
+    int n;
+
+    if (i < 9) {
+        n = snprintf(row, sizeof(row), " %u. %s", i + 1, menu_items[i]);
+    } else {
+        n = snprintf(row, sizeof(row), "    %s", menu_items[i]);
+    }
+    menu_pad(row, n);
+
+    int on = (i == menu_sel);
+    fb_draw_string(MENU_X, MENU_Y + i * MENU_LINE, row,
+                   on ? MENU_BG : MENU_FG, on ? MENU_FG : MENU_BG);
+}
+
+// Status line below the list, repeated on the UART in place
+static void menu_draw_status(const char *verb, uint32_t seconds) {
+    char row[MENU_WIDTH + 1];
+    int n;
+
+    if (seconds) {
+        n = snprintf(row, sizeof(row), "%s%s in %us", verb, menu_items[menu_sel], seconds);
+    } else {
+        n = snprintf(row, sizeof(row), "%s%s", verb, menu_items[menu_sel]);
+    }
+    menu_pad(row, n);
+
+    fb_draw_string(MENU_X, MENU_Y + menu_count * MENU_LINE + 16, row, MENU_TITLE, MENU_BG);
+    uart_printf("\r%s", row);
+}
+
+static uint32_t menu_seconds_left(void) {
+    uint64_t now = timer_get_uptime_us();
+    if (now >= menu_deadline) return 0;
+    return (uint32_t)((menu_deadline - now + 999999) / 1000000);
+}
+
+void menu_open(const char *title, const char *const *items, uint32_t count,
+               uint32_t def, uint32_t timeout_ms) {
+    menu_items = items;
+    menu_count = count > MENU_MAX_ITEMS ? MENU_MAX_ITEMS : count;
+    menu_sel = def < menu_count ? def : 0;
+    menu_deadline = timeout_ms ? timer_get_uptime_us() + (uint64_t)timeout_ms * 1000 : 0;
+    menu_shown = 0;
+    menu_esc = 0;
+
+    fb_clear(MENU_BG);
+    fb_draw_string(16, 16, title, MENU_TITLE, MENU_BG);
+    uart_printf("\n%s\n", title);
+    for (uint32_t i = 0; i < menu_count; i++) {
+        menu_draw_item(i);
+        if (i < 9) {
+            uart_printf("  %d. %s\n", i + 1, items[i]);
+        } else {
+            uart_printf("     %s\n", items[i]);
+        }
+    }
+    fb_draw_string(MENU_X, MENU_Y + menu_count * MENU_LINE + 36,
+                   "Up/Down to select, Enter to boot", MENU_FG, MENU_BG);
+    uart_puts("Up/Down or j/k to select, Enter or 1-9 to boot\n");
+
+    menu_shown = menu_deadline ? menu_seconds_left() : 0;
+    menu_draw_status(menu_deadline ? "Booting " : "Selected: ", menu_shown);
+}
+
+static void menu_select(uint32_t sel) {
+    uint32_t old = menu_sel;
+    menu_sel = sel;
+    menu_draw_item(old);
+    menu_draw_item(sel);
+}
+
+static int menu_choose(void) {
+    menu_deadline = 0;
+    menu_draw_status("Booting ", 0);
+    uart_puts("\n");
+    return (int)menu_sel;
+}
+
+int menu_poll(void) {
+    while (uart_data_available()) {
+        char c = uart_getc();
+        uint32_t sel = menu_sel;
+
+        if (menu_esc == 1) {
+            menu_esc = (c == '[' || c == 'O') ? 2 : 0;
+            continue;
+        }
+        if (menu_esc == 2) {
+            // Cursor keys: ESC [ A / ESC [ B
+            menu_esc = 0;
+            if (c == 'A' && sel > 0) sel--;
+            if (c == 'B' && sel + 1 < menu_count) sel++;
+        } else if (c == 0x1B) {
+            menu_esc = 1;
+        } else if (c == '\r' || c == '\n') {
+            return menu_choose();
+        } else if (c >= '1' && c <= '9' && (uint32_t)(c - '1') < menu_count) {
+            menu_select((uint32_t)(c - '1'));
+            return menu_choose();
+        } else if (c == 'k' && sel > 0) {
+            sel--;
+        } else if (c == 'j' && sel + 1 < menu_count) {
+            sel++;
+        }
+
+        // Any key stops the countdown
+        int changed = (sel != menu_sel);
+        if (changed) menu_select(sel);
+        if (menu_deadline || changed) {
+            menu_deadline = 0;
+            menu_draw_status("Selected: ", 0);
+        }
+    }
+
+    if (menu_deadline) {
+        uint32_t left = menu_seconds_left();
+        if (left == 0) return menu_choose();
+        if (left != menu_shown) {
+            menu_shown = left;
+            menu_draw_status("Booting ", left);
+        }
+    }
+    return MENU_PENDING;
+}
@@ -2,6 +2,9 @@
 #include "hardware.h"
 #include "timer.h"
 #include "gpio.h"
+#include "mailbox.h"
+#include "dma.h"
+#include "cache.h"
 
 // EMMC registers (Broadcom EMMC controller)
 #define EMMC_ARG2       (EMMC_BASE + 0x00)
@@ -49,6 +52,28 @@
 #define ACMD_SEND_NUM_WR_BLOCKS 22
 #define ACMD_SET_WR_BLK_ERASE_COUNT 23
 #define ACMD_SD_SEND_OP_COND    41
+#define ACMD_SEND_SCR           51
+
+// CMDTM fields
+#define CMDTM_INDEX(n)          ((uint32_t)(n) << 24)
+#define CMDTM_TYPE_ABORT        (3 << 22)
+#define CMDTM_ISDATA            (1 << 21)
+#define CMDTM_IXCHK_EN          (1 << 20)
+#define CMDTM_CRCCHK_EN         (1 << 19)
+#define CMDTM_RSP_NONE          (0 << 16)
+#define CMDTM_RSP_136           (1 << 16)
+#define CMDTM_RSP_48            (2 << 16)
+#define CMDTM_RSP_48_BUSY       (3 << 16)
+#define CMDTM_MULTI_BLOCK       (1 << 5)
+#define CMDTM_DAT_DIR_READ      (1 << 4)
+#define CMDTM_AUTO_CMD12        (1 << 2)
+#define CMDTM_BLKCNT_EN         (1 << 1)
+
+#define CMDTM_R1                (CMDTM_RSP_48 | CMDTM_CRCCHK_EN | CMDTM_IXCHK_EN)
+#define CMDTM_R1B               (CMDTM_RSP_48_BUSY | CMDTM_CRCCHK_EN | CMDTM_IXCHK_EN)
+#define CMDTM_READ              (CMDTM_R1 | CMDTM_ISDATA | CMDTM_DAT_DIR_READ)
+#define CMDTM_WRITE             (CMDTM_R1 | CMDTM_ISDATA)
+#define CMDTM_MULTI             (CMDTM_MULTI_BLOCK | CMDTM_BLKCNT_EN | CMDTM_AUTO_CMD12)
 
 // Status register bits
 #define SR_READ_AVAILABLE       (1 << 11)
@@ -59,107 +84,409 @@
 // Interrupt flags
 #define INT_CMD_DONE            (1 << 0)
 #define INT_DATA_DONE           (1 << 1)
+#define INT_WRITE_RDY           (1 << 4)
+#define INT_READ_RDY            (1 << 5)
 #define INT_ERROR               (1 << 15)
+#define INT_CMD_TIMEOUT         (1 << 16)
+#define INT_CMD_ERRORS          (0xF << 16)     // CTO, CCRC, CEND, CBAD
+#define INT_DATA_TIMEOUT        (1 << 20)
+
+// CONTROL0 bits
+#define C0_HCTL_DWIDTH          (1 << 1)        // 4-bit data bus
+#define C0_HCTL_HS_EN           (1 << 2)        // High speed timing
+
+// CONTROL1 bits
+#define C1_CLK_INTLEN           (1 << 0)
+#define C1_CLK_STABLE           (1 << 1)
+#define C1_CLK_EN               (1 << 2)
+#define C1_CLK_FREQ_MASK        (0x3FF << 6)    // 10-bit divider, split field
+#define C1_DATA_TOUNIT_MAX      (0xE << 16)
+#define C1_SRST_HC              (1 << 24)
+#define C1_SRST_CMD             (1 << 25)
+#define C1_SRST_DATA            (1 << 26)
+
+// SD clock rates per mode
+#define MMC_CLOCK_IDENT         400000
+#define MMC_CLOCK_DEFAULT       25000000
+#define MMC_CLOCK_HIGH          50000000
+
+// Used when the firmware does not report the EMMC clock; erring high only
+// makes the derived SD clock slower than requested
+#define MMC_BASE_CLOCK_FALLBACK 250000000
+
+// SCR fields (byte 0 is the most significant)
+#define SCR_SD_SPEC(scr)        ((scr)[0] & 0x0F)
+#define SCR_BUS_WIDTH_4         (1 << 2)        // In byte 1
+
+// CSD card command classes: class 10 = switch function
+#define CSD_CCC_SWITCH          (1 << 10)
+
+// Timeouts
+#define MMC_CMD_TIMEOUT_US      100000
+#define MMC_DATA_TIMEOUT_US     500000
+#define MMC_RESET_TIMEOUT_US    100000
+#define MMC_DATA_SPIN_LIMIT     1000000
+
+// DMA channel paced by the EMMC DREQ
+#define MMC_DMA_CHANNEL         5
+#define MMC_DMA_TI              (DMA_TI_SRC_DREQ | DMA_TI_PERMAP(DMA_DREQ_EMMC) | \
+                                 DMA_TI_DEST_INC | DMA_TI_WAIT_RESP)
+
+// Allowance per block on top of the data timeout for an async transfer
+#define MMC_BLOCK_TIMEOUT_US    2000
+
+// SD card pins (GPIO 48-53) are routed to the EMMC controller on ALT3
+#define MMC_GPIO_FIRST          48
+#define MMC_GPIO_LAST           53
 
 static mmc_card_info_t card_info;
 static int mmc_initialized = 0;
 
+// Outstanding asynchronous read
+static struct {
+    int active;
+    int result;
+    uint64_t deadline;
+    uint32_t num_segments;
+    mmc_segment_t segments[MMC_MAX_SEGMENTS];
+} async;
+
+static dma_cb_t dma_cbs[MMC_MAX_SEGMENTS];
+static int dma_enabled = 1;
+
+// Word view of caller buffers
+typedef uint32_t __attribute__((may_alias)) mmc_word_t;
+
 static void mmc_delay(uint32_t ms) {
     timer_wait_ms(ms);
 }
 
-static int mmc_wait_for_interrupt(uint32_t mask) {
-    uint32_t timeout = 1000000;  // 1 second timeout
+// Translate an error interrupt status into an MMC_ERR_* code
+static int mmc_decode_error(uint32_t status) {
+    MMIO_WRITE(EMMC_INTERRUPT, status);
+    if (status & (INT_CMD_TIMEOUT | INT_DATA_TIMEOUT)) {
+        return MMC_ERR_TIMEOUT;
+    }
+    return (status & INT_CMD_ERRORS) ? MMC_ERR_CMD : MMC_ERR_DATA;
+}
+
+static int mmc_wait_for_interrupt(uint32_t mask, uint32_t timeout_us) {
+    uint64_t deadline = timer_get_ticks() + timeout_us;
 
-    while (timeout--) {
+    while (1) {
         uint32_t status = MMIO_READ(EMMC_INTERRUPT);
         if (status & INT_ERROR) {
-            MMIO_WRITE(EMMC_INTERRUPT, 0xFFFFFFFF);
-            return -1;
+            return mmc_decode_error(status);
         }
         if (status & mask) {
             MMIO_WRITE(EMMC_INTERRUPT, mask);
-            return 0;
+            return MMC_OK;
+        }
+        if (timer_get_ticks() > deadline) {
+            return MMC_ERR_TIMEOUT;
         }
     }
+}
 
-    return -1;
+// Wait for a STATUS bit to clear (e.g. command/data inhibit)
+static int mmc_wait_status_clear(uint32_t mask, uint32_t timeout_us) {
+    uint64_t deadline = timer_get_ticks() + timeout_us;
+
+    while (MMIO_READ(EMMC_STATUS) & mask) {
+        if (timer_get_ticks() > deadline) {
+            return MMC_ERR_TIMEOUT;
+        }
+    }
+    return MMC_OK;
 }
 
-static int mmc_send_command(uint32_t cmd, uint32_t arg) {
-    // Wait for command inhibit to clear
-    uint32_t timeout = 1000000;
-    while ((MMIO_READ(EMMC_STATUS) & SR_CMD_INHIBIT) && timeout--) {
-        asm volatile("nop");
+// Wait for the data port to become ready in the given direction
+static int mmc_wait_data_port(uint32_t status_bit) {
+    uint32_t spins = MMC_DATA_SPIN_LIMIT;
+
+    while (!(MMIO_READ(EMMC_STATUS) & status_bit)) {
+        uint32_t irq = MMIO_READ(EMMC_INTERRUPT);
+        if (irq & INT_ERROR) {
+            return mmc_decode_error(irq);
+        }
+        if (--spins == 0) {
+            return MMC_ERR_TIMEOUT;
+        }
+    }
+    return MMC_OK;
+}
+
+// Reset the command and data state machines after an error
+static void mmc_recover(void) {
+    uint32_t c1 = MMIO_READ(EMMC_CONTROL1);
+    MMIO_WRITE(EMMC_CONTROL1, c1 | C1_SRST_CMD | C1_SRST_DATA);
+
+    uint64_t deadline = timer_get_ticks() + MMC_RESET_TIMEOUT_US;
+    while ((MMIO_READ(EMMC_CONTROL1) & (C1_SRST_CMD | C1_SRST_DATA)) &&
+           timer_get_ticks() < deadline) { }
+
+    MMIO_WRITE(EMMC_INTERRUPT, 0xFFFFFFFF);
+}
+
+// CMDTM flags (response type, data direction) for each command we use
+static uint32_t mmc_command_flags(uint32_t cmd, int app) {
+    if (app) {
+        switch (cmd) {
+            case ACMD_SD_SEND_OP_COND:  return CMDTM_RSP_48;  // R3: no CRC
+            case ACMD_SEND_SCR:         return CMDTM_READ;
+            default:                    return CMDTM_R1;
+        }
     }
 
-    if (timeout == 0) return -1;
+    switch (cmd) {
+        case CMD_GO_IDLE_STATE:         return CMDTM_RSP_NONE;
+        case CMD_ALL_SEND_CID:
+        case CMD_SEND_CSD:
+        case CMD_SEND_CID:              return CMDTM_RSP_136 | CMDTM_CRCCHK_EN;
+        case CMD_SELECT_CARD:           return CMDTM_R1B;
+        case CMD_STOP_TRANSMISSION:     return CMDTM_R1B | CMDTM_TYPE_ABORT;
+        case CMD_SWITCH_FUNC:
+        case CMD_READ_SINGLE_BLOCK:     return CMDTM_READ;
+        case CMD_READ_MULTIPLE_BLOCK:   return CMDTM_READ | CMDTM_MULTI;
+        case CMD_WRITE_BLOCK:           return CMDTM_WRITE;
+        case CMD_WRITE_MULTIPLE_BLOCK:  return CMDTM_WRITE | CMDTM_MULTI;
+        default:                        return CMDTM_R1;
+    }
+}
+
+static int mmc_issue(uint32_t cmd, uint32_t arg, int app) {
+    uint32_t flags = mmc_command_flags(cmd, app);
+
+    // Wait for command (and, for data/busy commands, data) inhibit to clear
+    uint32_t inhibit = SR_CMD_INHIBIT;
+    if (flags & (CMDTM_ISDATA | CMDTM_RSP_48_BUSY)) {
+        inhibit |= SR_DAT_INHIBIT;
+    }
+    if (mmc_wait_status_clear(inhibit, MMC_CMD_TIMEOUT_US) != MMC_OK) {
+        return MMC_ERR_TIMEOUT;
+    }
 
     // Clear interrupts
     MMIO_WRITE(EMMC_INTERRUPT, 0xFFFFFFFF);
 
     // Send command
     MMIO_WRITE(EMMC_ARG1, arg);
-    MMIO_WRITE(EMMC_CMDTM, cmd);
+    MMIO_WRITE(EMMC_CMDTM, CMDTM_INDEX(cmd) | flags);
 
     // Wait for command complete
-    return mmc_wait_for_interrupt(INT_CMD_DONE);
+    int rc = mmc_wait_for_interrupt(INT_CMD_DONE, MMC_CMD_TIMEOUT_US);
+    if (rc != MMC_OK) {
+        mmc_recover();
+    }
+    return rc;
 }
 
-int mmc_init(void) {
-    // Configure GPIO pins for EMMC (pins 48-53)
-    // These are typically pre-configured by the bootloader
+static int mmc_send_command(uint32_t cmd, uint32_t arg) {
+    return mmc_issue(cmd, arg, 0);
+}
 
-    // Reset controller
-    MMIO_WRITE(EMMC_CONTROL1, 0);
-    mmc_delay(10);
+static int mmc_send_app_command(uint32_t cmd, uint32_t arg) {
+    int rc = mmc_issue(CMD_APP_CMD, card_info.rca << 16, 0);
+    if (rc != MMC_OK) return rc;
+    return mmc_issue(cmd, arg, 1);
+}
 
-    // Set clock to 400 kHz for identification mode
-    uint32_t c1 = MMIO_READ(EMMC_CONTROL1);
-    c1 |= (0x3E << 8);  // Clock divider
-    c1 |= (1 << 0);     // Internal clock enable
+// Store a 136-bit response (CRC stripped by the controller) LSB first
+static void mmc_store_r2(uint8_t *out) {
+    for (int w = 0; w < 4; w++) {
+        uint32_t resp = MMIO_READ(EMMC_RESP0 + w * 4);
+        for (int b = 0; b < 4; b++) {
+            out[w * 4 + b] = (resp >> (b * 8)) & 0xFF;
+        }
+    }
+}
+
+// Extract CSD bits [msb:lsb] (CSD bit numbering; response holds bits 127:8)
+static uint32_t mmc_csd_bits(uint32_t msb, uint32_t lsb) {
+    uint32_t value = 0;
+    for (uint32_t bit = msb + 1; bit-- > lsb; ) {
+        uint32_t pos = bit - 8;
+        value = (value << 1) | ((card_info.csd[pos / 8] >> (pos % 8)) & 1);
+    }
+    return value;
+}
+
+static uint32_t mmc_csd_capacity(void) {
+    if (mmc_csd_bits(127, 126) == 1) {
+        // CSD v2 (SDHC/SDXC): capacity = (C_SIZE + 1) * 512 KiB
+        return (mmc_csd_bits(69, 48) + 1) * 1024;
+    }
+
+    // CSD v1: (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) * 2^READ_BL_LEN bytes
+    uint32_t c_size = mmc_csd_bits(73, 62);
+    uint32_t mult = mmc_csd_bits(49, 47);
+    uint32_t bl_len = mmc_csd_bits(83, 80);
+    if (bl_len < 9) bl_len = 9;
+    return (c_size + 1) << (mult + 2 + bl_len - 9);
+}
+
+static uint32_t mmc_block_address(uint32_t block) {
+    // Standard capacity cards are byte addressed
+    return (card_info.type == MMC_TYPE_SDHC) ? block : block * 512;
+}
+
+// SD clock = base / (2 * N); N = 0 passes the base clock through
+static uint32_t mmc_clock_divider(uint32_t base, uint32_t target) {
+    if (target >= base) return 0;
+
+    uint32_t n = (base + 2 * target - 1) / (2 * target);
+    return n > 0x3FF ? 0x3FF : n;
+}
+
+static int mmc_set_clock(uint32_t hz) {
+    // Only change the clock with the bus idle
+    mmc_wait_status_clear(SR_CMD_INHIBIT | SR_DAT_INHIBIT, MMC_CMD_TIMEOUT_US);
+
+    uint32_t c1 = MMIO_READ(EMMC_CONTROL1) & ~(C1_CLK_EN | C1_CLK_FREQ_MASK);
     MMIO_WRITE(EMMC_CONTROL1, c1);
-    mmc_delay(10);
 
-    // Enable clock
-    c1 |= (1 << 2);  // Clock enable
+    uint32_t n = mmc_clock_divider(card_info.base_clock, hz);
+    c1 |= ((n & 0xFF) << 8) | (((n >> 8) & 0x3) << 6);
+    c1 |= C1_DATA_TOUNIT_MAX | C1_CLK_INTLEN;
     MMIO_WRITE(EMMC_CONTROL1, c1);
-    mmc_delay(10);
+
+    uint64_t deadline = timer_get_ticks() + MMC_RESET_TIMEOUT_US;
+    while (!(MMIO_READ(EMMC_CONTROL1) & C1_CLK_STABLE)) {
+        if (timer_get_ticks() > deadline) return MMC_ERR_TIMEOUT;
+    }
+
+    // Enable clock
+    MMIO_WRITE(EMMC_CONTROL1, c1 | C1_CLK_EN);
+    timer_wait_us(2000);
+
+    card_info.clock_hz = n ? card_info.base_clock / (2 * n) : card_info.base_clock;
+    return MMC_OK;
+}
+
+// Finish a data transfer; on failure reset the data path
+static int mmc_finish_transfer(int rc) {
+    if (rc == MMC_OK) {
+        rc = mmc_wait_for_interrupt(INT_DATA_DONE, MMC_DATA_TIMEOUT_US);
+    }
+    if (rc != MMC_OK) {
+        mmc_recover();
+    }
+    return rc;
+}
+
+// Read a short single-block register (SCR, switch status) in send order
+static int mmc_read_register(uint32_t cmd, uint32_t arg, int app,
+                             uint8_t *buffer, uint32_t len) {
+    MMIO_WRITE(EMMC_BLKSIZECNT, (1 << 16) | len);
+
+    int rc = app ? mmc_send_app_command(cmd, arg) : mmc_send_command(cmd, arg);
+    if (rc != MMC_OK) return rc;
+
+    for (uint32_t i = 0; i < len && rc == MMC_OK; i += 4) {
+        rc = mmc_wait_data_port(SR_READ_AVAILABLE);
+        if (rc != MMC_OK) break;
+
+        uint32_t data = MMIO_READ(EMMC_DATA);
+        for (uint32_t b = 0; b < 4; b++) {
+            buffer[i + b] = (data >> (b * 8)) & 0xFF;
+        }
+    }
+
+    return mmc_finish_transfer(rc);
+}
+
+// CMD6: query (set = 0) or select (set = 1) a function in group 1
+// (access mode); the 512-bit status is returned MSB first
+static int mmc_switch_function(int set, uint32_t function, uint8_t *status) {
+    uint32_t arg = (set ? 0x80000000 : 0) | 0x00FFFFF0 | (function & 0xF);
+    int rc = mmc_read_register(CMD_SWITCH_FUNC, arg, 0, status, 64);
+
+    // The new timing applies within 8 clocks of the status block
+    timer_wait_us(10);
+    return rc;
+}
+
+static int mmc_supports_high_speed(void) {
+    // CMD6 needs SD spec 1.10 and command class 10
+    if (SCR_SD_SPEC(card_info.scr) < 1) return 0;
+    if (!(mmc_csd_bits(95, 84) & CSD_CCC_SWITCH)) return 0;
+
+    // Function 1 of group 1 supported: status bit 401
+    uint8_t status[64] __attribute__((aligned(4)));
+    if (mmc_switch_function(0, 1, status) != MMC_OK) return 0;
+    return (status[13] & 0x02) != 0;
+}
+
+int mmc_init(void) {
+    mmc_async_wait();
+    mmc_initialized = 0;
+    card_info.rca = 0;
+    dma_init(MMC_DMA_CHANNEL);
+
+    // Route the SD card pins to the EMMC controller
+    for (uint32_t pin = MMC_GPIO_FIRST; pin <= MMC_GPIO_LAST; pin++) {
+        gpio_set_function(pin, GPIO_ALT3);
+        gpio_set_pull(pin, pin == MMC_GPIO_FIRST ? GPIO_PULL_NONE : GPIO_PULL_UP);
+    }
+
+    // Reset controller
+    MMIO_WRITE(EMMC_CONTROL0, 0);
+    MMIO_WRITE(EMMC_CONTROL1, C1_SRST_HC);
+    uint64_t deadline = timer_get_ticks() + MMC_RESET_TIMEOUT_US;
+    while (MMIO_READ(EMMC_CONTROL1) & C1_SRST_HC) {
+        if (timer_get_ticks() > deadline) return MMC_ERR_TIMEOUT;
+    }
+
+    // Set clock to ~400 kHz for identification mode, derived from the
+    // controller's real input clock
+    card_info.base_clock = mailbox_get_clock_rate(MBOX_CLOCK_EMMC);
+    if (card_info.base_clock == 0) {
+        card_info.base_clock = MMC_BASE_CLOCK_FALLBACK;
+    }
+    card_info.mode = MMC_MODE_IDENT;
+    card_info.max_mode = MMC_MODE_IDENT;
+    card_info.bus_width = 1;
+    if (mmc_set_clock(MMC_CLOCK_IDENT) != MMC_OK) {
+        return MMC_ERR_TIMEOUT;
+    }
+
+    // Latch every status flag, but do not raise ARM interrupts
+    MMIO_WRITE(EMMC_IRPT_EN, 0);
+    MMIO_WRITE(EMMC_INTERRUPT, 0xFFFFFFFF);
+    MMIO_WRITE(EMMC_IRPT_MASK, 0xFFFFFFFF);
 
     // Send CMD0 - GO_IDLE_STATE
-    if (mmc_send_command(CMD_GO_IDLE_STATE, 0) != 0) {
-        return -1;
+    if (mmc_send_command(CMD_GO_IDLE_STATE, 0) != MMC_OK) {
+        return MMC_ERR_NOT_READY;
     }
 
     // Send CMD8 - SEND_IF_COND (check voltage)
-    if (mmc_send_command(CMD_SEND_IF_COND, 0x1AA) != 0) {
+    if (mmc_send_command(CMD_SEND_IF_COND, 0x1AA) != MMC_OK) {
         // Might be SD v1 or MMC
         card_info.type = MMC_TYPE_SD1;
+    } else if ((MMIO_READ(EMMC_RESP0) & 0xFFF) != 0x1AA) {
+        return MMC_ERR_UNSUPPORTED;
     } else {
         card_info.type = MMC_TYPE_SD2;
     }
 
-    // Send ACMD41 to initialize card
-    uint32_t retries = 1000;
-    while (retries--) {
-        // Send CMD55 (APP_CMD) first
-        if (mmc_send_command(CMD_APP_CMD, 0) != 0) {
-            return -1;
-        }
-
-        // Send ACMD41
+    // Send ACMD41 to initialize card (up to ~1 second)
+    int ready = 0;
+    for (uint32_t retries = 0; retries < 100 && !ready; retries++) {
         uint32_t arg = 0x00FF8000;  // Voltage range
         if (card_info.type == MMC_TYPE_SD2) {
             arg |= 0x40000000;  // HCS (High Capacity Support)
         }
 
-        if (mmc_send_command(ACMD_SD_SEND_OP_COND, arg) == 0) {
+        if (mmc_send_app_command(ACMD_SD_SEND_OP_COND, arg) == MMC_OK) {
             uint32_t resp = MMIO_READ(EMMC_RESP0);
             if (resp & 0x80000000) {
                 // Card is ready
+                card_info.ocr = resp;
                 if (resp & 0x40000000) {
                     card_info.type = MMC_TYPE_SDHC;
                 }
+                ready = 1;
                 break;
             }
         }
@@ -167,33 +494,109 @@ int mmc_init(void) {
         mmc_delay(10);
     }
 
-    if (retries == 0) return -1;
+    if (!ready) return MMC_ERR_TIMEOUT;
 
     // Get CID
-    if (mmc_send_command(CMD_ALL_SEND_CID, 0) != 0) {
-        return -1;
+    if (mmc_send_command(CMD_ALL_SEND_CID, 0) != MMC_OK) {
+        return MMC_ERR_CMD;
     }
+    mmc_store_r2(card_info.cid);
 
     // Get RCA
-    if (mmc_send_command(CMD_SEND_RELATIVE_ADDR, 0) != 0) {
-        return -1;
+    if (mmc_send_command(CMD_SEND_RELATIVE_ADDR, 0) != MMC_OK) {
+        return MMC_ERR_CMD;
     }
     card_info.rca = MMIO_READ(EMMC_RESP0) >> 16;
 
+    // Get CSD (card must still be in standby state)
+    if (mmc_send_command(CMD_SEND_CSD, card_info.rca << 16) != MMC_OK) {
+        return MMC_ERR_CMD;
+    }
+    mmc_store_r2(card_info.csd);
+    card_info.capacity = mmc_csd_capacity();
+
     // Select card
-    if (mmc_send_command(CMD_SELECT_CARD, card_info.rca << 16) != 0) {
-        return -1;
+    if (mmc_send_command(CMD_SELECT_CARD, card_info.rca << 16) != MMC_OK) {
+        return MMC_ERR_CMD;
     }
 
-    // Set block size to 512 bytes
-    if (mmc_send_command(CMD_SET_BLOCKLEN, 512) != 0) {
-        return -1;
+    // Set block size to 512 bytes (fixed on SDHC)
+    if (card_info.type != MMC_TYPE_SDHC &&
+        mmc_send_command(CMD_SET_BLOCKLEN, 512) != MMC_OK) {
+        return MMC_ERR_CMD;
     }
 
     card_info.block_size = 512;
     mmc_initialized = 1;
 
-    return 0;
+    // Read the SCR for the supported bus widths and spec version
+    if (mmc_read_register(ACMD_SEND_SCR, 0, 1, card_info.scr, 8) != MMC_OK) {
+        card_info.scr[0] = 0;
+        card_info.scr[1] = 0;
+    }
+
+    // 4-bit bus at 25 MHz, then high speed if the card can switch to it
+    card_info.max_mode = MMC_MODE_DEFAULT_SPEED;
+    int rc = mmc_set_mode(MMC_MODE_DEFAULT_SPEED);
+    if (rc != MMC_OK) return rc;
+
+    if (mmc_supports_high_speed()) {
+        card_info.max_mode = MMC_MODE_HIGH_SPEED;
+        if (mmc_set_mode(MMC_MODE_HIGH_SPEED) != MMC_OK) {
+            // Stay at default speed
+            card_info.max_mode = MMC_MODE_DEFAULT_SPEED;
+            return mmc_set_mode(MMC_MODE_DEFAULT_SPEED);
+        }
+    }
+
+    return MMC_OK;
+}
+
+int mmc_set_mode(mmc_mode_t mode) {
+    if (!mmc_initialized) return MMC_ERR_NOT_READY;
+    if (mode > card_info.max_mode) return MMC_ERR_UNSUPPORTED;
+    mmc_async_wait();
+
+    // Bus width: 4-bit past identification if the card supports it
+    uint32_t width = (mode != MMC_MODE_IDENT && (card_info.scr[1] & SCR_BUS_WIDTH_4)) ? 4 : 1;
+    if (width != card_info.bus_width) {
+        int rc = mmc_send_app_command(ACMD_SET_BUS_WIDTH, width == 4 ? 2 : 0);
+        if (rc != MMC_OK) return rc;
+
+        uint32_t c0 = MMIO_READ(EMMC_CONTROL0);
+        c0 = (width == 4) ? (c0 | C0_HCTL_DWIDTH) : (c0 & ~C0_HCTL_DWIDTH);
+        MMIO_WRITE(EMMC_CONTROL0, c0);
+        card_info.bus_width = width;
+    }
+
+    // Card timing (CMD6 access mode) before the clock changes
+    int high = (mode == MMC_MODE_HIGH_SPEED);
+    if (high != (card_info.mode == MMC_MODE_HIGH_SPEED)) {
+        uint8_t status[64] __attribute__((aligned(4)));
+        int rc = mmc_switch_function(1, high ? 1 : 0, status);
+        if (rc != MMC_OK) return rc;
+        if ((status[16] & 0x0F) != (high ? 1 : 0)) return MMC_ERR_UNSUPPORTED;
+
+        uint32_t c0 = MMIO_READ(EMMC_CONTROL0);
+        c0 = high ? (c0 | C0_HCTL_HS_EN) : (c0 & ~C0_HCTL_HS_EN);
+        MMIO_WRITE(EMMC_CONTROL0, c0);
+    }
+
+    static const uint32_t clocks[] = { MMC_CLOCK_IDENT, MMC_CLOCK_DEFAULT, MMC_CLOCK_HIGH };
+    int rc = mmc_set_clock(clocks[mode]);
+    if (rc != MMC_OK) return rc;
+
+    card_info.mode = mode;
+    return MMC_OK;
+}
+
+const char *mmc_mode_name(mmc_mode_t mode) {
+    switch (mode) {
+        case MMC_MODE_IDENT:            return "identification";
+        case MMC_MODE_DEFAULT_SPEED:    return "default speed";
+        case MMC_MODE_HIGH_SPEED:       return "high speed";
+        default:                        return "unknown";
+    }
 }
 
 mmc_card_info_t *mmc_get_card_info(void) {
@@ -201,28 +604,145 @@ mmc_card_info_t *mmc_get_card_info(void) {
     return &card_info;
 }
 
+// Release the segments to the CPU: drop lines speculatively loaded while
+// the engine was writing behind the cache
+static int mmc_async_finish(int rc) {
+    for (uint32_t i = 0; i < async.num_segments; i++) {
+        cache_invalidate_range(async.segments[i].buffer, async.segments[i].num_blocks * 512);
+    }
+    async.active = 0;
+    async.result = rc;
+    return rc;
+}
+
+int mmc_read_async(uint32_t start_block, const mmc_segment_t *segments,
+                   uint32_t num_segments) {
+    if (!mmc_initialized) return MMC_ERR_NOT_READY;
+    if (async.active) return MMC_ERR_BUSY;
+    if (num_segments == 0 || num_segments > MMC_MAX_SEGMENTS) return MMC_ERR_UNSUPPORTED;
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < num_segments; i++) {
+        const mmc_segment_t *seg = &segments[i];
+        if (((uint32_t)seg->buffer & (MMC_DMA_ALIGN - 1)) || seg->num_blocks == 0 ||
+            seg->num_blocks > MMC_MAX_BLOCKS_PER_CMD - total) {
+            return MMC_ERR_UNSUPPORTED;
+        }
+        total += seg->num_blocks;
+
+        // One control block per segment, chained in order
+        dma_cbs[i].ti = MMC_DMA_TI;
+        dma_cbs[i].source_ad = BUS_PERIPHERAL(EMMC_DATA);
+        dma_cbs[i].dest_ad = BUS_ADDRESS(seg->buffer);
+        dma_cbs[i].txfr_len = seg->num_blocks * 512;
+        dma_cbs[i].stride = 0;
+        dma_cbs[i].nextconbk = (i + 1 < num_segments) ? BUS_ADDRESS(&dma_cbs[i + 1]) : 0;
+
+        // No dirty line may be evicted on top of the incoming data
+        cache_clean_invalidate_range(seg->buffer, seg->num_blocks * 512);
+        async.segments[i] = *seg;
+    }
+    async.num_segments = num_segments;
+
+    MMIO_WRITE(EMMC_BLKSIZECNT, (total << 16) | 512);
+
+    uint32_t cmd = (total == 1) ? CMD_READ_SINGLE_BLOCK : CMD_READ_MULTIPLE_BLOCK;
+    int rc = mmc_send_command(cmd, mmc_block_address(start_block));
+    if (rc != MMC_OK) return mmc_async_finish(rc);
+
+    // Start the channel only once the data phase is under way, as the
+    // Linux driver does: DREQ would hold it until then on hardware, but
+    // emulated DMA (QEMU) ignores pacing and would drain an empty FIFO
+    dma_start(MMC_DMA_CHANNEL, dma_cbs, num_segments);
+
+    async.deadline = timer_get_ticks() + MMC_DATA_TIMEOUT_US +
+                     (uint64_t)total * MMC_BLOCK_TIMEOUT_US;
+    async.active = 1;
+    return MMC_OK;
+}
+
+int mmc_async_poll(void) {
+    if (!async.active) return async.result;
+
+    uint32_t irq = MMIO_READ(EMMC_INTERRUPT);
+    int dma = dma_status(MMC_DMA_CHANNEL);
+    int rc;
+
+    if (irq & INT_ERROR) {
+        rc = mmc_decode_error(irq);
+    } else if (dma == DMA_ERROR) {
+        rc = MMC_ERR_DATA;
+    } else if (dma == DMA_DONE && (irq & INT_DATA_DONE)) {
+        MMIO_WRITE(EMMC_INTERRUPT, INT_DATA_DONE);
+        return mmc_async_finish(MMC_OK);
+    } else if (timer_get_ticks() > async.deadline) {
+        rc = MMC_ERR_TIMEOUT;
+    } else {
+        return MMC_PENDING;
+    }
+
+    dma_abort(MMC_DMA_CHANNEL);
+    mmc_recover();
+    return mmc_async_finish(rc);
+}
+
+int mmc_async_wait(void) {
+    int rc;
+    while ((rc = mmc_async_poll()) == MMC_PENDING) { }
+    return rc;
+}
+
 int mmc_read_blocks(uint32_t start_block, uint32_t num_blocks, uint8_t *buffer) {
-    if (!mmc_initialized) return -1;
+    if (!mmc_initialized) return MMC_ERR_NOT_READY;
+    if (num_blocks == 0) return MMC_OK;
+    if (num_blocks > MMC_MAX_BLOCKS_PER_CMD) return MMC_ERR_UNSUPPORTED;
+    mmc_async_wait();
+
+    // Aligned buffers are filled by DMA
+    if (dma_enabled && ((uint32_t)buffer & (MMC_DMA_ALIGN - 1)) == 0) {
+        mmc_segment_t seg = { buffer, num_blocks };
+        int rc = mmc_read_async(start_block, &seg, 1);
+        return (rc == MMC_OK) ? mmc_async_wait() : rc;
+    }
 
     // Set block count and size
     MMIO_WRITE(EMMC_BLKSIZECNT, (num_blocks << 16) | 512);
 
-    // Send read command
+    // Send read command (multi-block reads end with an automatic CMD12)
     uint32_t cmd = (num_blocks == 1) ? CMD_READ_SINGLE_BLOCK : CMD_READ_MULTIPLE_BLOCK;
-    if (mmc_send_command(cmd, start_block) != 0) {
-        return -1;
+    int rc = mmc_send_command(cmd, mmc_block_address(start_block));
+    if (rc != MMC_OK) {
+        return rc;
     }
 
-    // Read data
-    for (uint32_t block = 0; block < num_blocks; block++) {
-        for (uint32_t i = 0; i < 512; i += 4) {
-            // Wait for data
-            uint32_t timeout = 1000000;
-            while (!(MMIO_READ(EMMC_STATUS) & SR_READ_AVAILABLE) && timeout--) {
-                asm volatile("nop");
+    if (((uint32_t)buffer & 3) == 0) {
+        // Fast path: one wait per block, then drain the whole block
+        mmc_word_t *dst = (mmc_word_t *)buffer;
+        for (uint32_t block = 0; block < num_blocks; block++) {
+            rc = mmc_wait_for_interrupt(INT_READ_RDY, MMC_DATA_TIMEOUT_US);
+            if (rc != MMC_OK) break;
+
+            for (uint32_t i = 0; i < 128; i += 8) {
+                dst[0] = MMIO_READ(EMMC_DATA);
+                dst[1] = MMIO_READ(EMMC_DATA);
+                dst[2] = MMIO_READ(EMMC_DATA);
+                dst[3] = MMIO_READ(EMMC_DATA);
+                dst[4] = MMIO_READ(EMMC_DATA);
+                dst[5] = MMIO_READ(EMMC_DATA);
+                dst[6] = MMIO_READ(EMMC_DATA);
+                dst[7] = MMIO_READ(EMMC_DATA);
+                dst += 8;
             }
+        }
+        return mmc_finish_transfer(rc);
+    }
 
-            if (timeout == 0) return -1;
+    // Unaligned buffer: poll and store byte by byte
+    for (uint32_t block = 0; block < num_blocks && rc == MMC_OK; block++) {
+        for (uint32_t i = 0; i < 512; i += 4) {
+            // Wait for data
+            rc = mmc_wait_data_port(SR_READ_AVAILABLE);
+            if (rc != MMC_OK) break;
 
             uint32_t data = MMIO_READ(EMMC_DATA);
             buffer[block * 512 + i + 0] = (data >> 0) & 0xFF;
@@ -232,36 +752,53 @@ int mmc_read_blocks(uint32_t start_block, uint32_t num_blocks, uint8_t *buffer)
         }
     }
 
-    // Stop transmission for multiple blocks
-    if (num_blocks > 1) {
-        mmc_send_command(CMD_STOP_TRANSMISSION, 0);
-    }
-
-    return 0;
+    return mmc_finish_transfer(rc);
 }
 
 int mmc_write_blocks(uint32_t start_block, uint32_t num_blocks, const uint8_t *buffer) {
-    if (!mmc_initialized) return -1;
+    if (!mmc_initialized) return MMC_ERR_NOT_READY;
+    if (num_blocks == 0) return MMC_OK;
+    if (num_blocks > MMC_MAX_BLOCKS_PER_CMD) return MMC_ERR_UNSUPPORTED;
+    mmc_async_wait();
 
     // Set block count and size
     MMIO_WRITE(EMMC_BLKSIZECNT, (num_blocks << 16) | 512);
 
-    // Send write command
+    // Send write command (multi-block writes end with an automatic CMD12)
     uint32_t cmd = (num_blocks == 1) ? CMD_WRITE_BLOCK : CMD_WRITE_MULTIPLE_BLOCK;
-    if (mmc_send_command(cmd, start_block) != 0) {
-        return -1;
+    int rc = mmc_send_command(cmd, mmc_block_address(start_block));
+    if (rc != MMC_OK) {
+        return rc;
     }
 
-    // Write data
-    for (uint32_t block = 0; block < num_blocks; block++) {
-        for (uint32_t i = 0; i < 512; i += 4) {
-            // Wait for buffer available
-            uint32_t timeout = 1000000;
-            while (!(MMIO_READ(EMMC_STATUS) & SR_WRITE_AVAILABLE) && timeout--) {
-                asm volatile("nop");
+    if (((uint32_t)buffer & 3) == 0) {
+        // Fast path: one wait per block, then fill the whole block
+        const mmc_word_t *src = (const mmc_word_t *)buffer;
+        for (uint32_t block = 0; block < num_blocks; block++) {
+            rc = mmc_wait_for_interrupt(INT_WRITE_RDY, MMC_DATA_TIMEOUT_US);
+            if (rc != MMC_OK) break;
+
+            for (uint32_t i = 0; i < 128; i += 8) {
+                MMIO_WRITE(EMMC_DATA, src[0]);
+                MMIO_WRITE(EMMC_DATA, src[1]);
+                MMIO_WRITE(EMMC_DATA, src[2]);
+                MMIO_WRITE(EMMC_DATA, src[3]);
+                MMIO_WRITE(EMMC_DATA, src[4]);
+                MMIO_WRITE(EMMC_DATA, src[5]);
+                MMIO_WRITE(EMMC_DATA, src[6]);
+                MMIO_WRITE(EMMC_DATA, src[7]);
+                src += 8;
             }
+        }
+        return mmc_finish_transfer(rc);
+    }
 
-            if (timeout == 0) return -1;
+    // Unaligned buffer: poll and assemble each word from bytes
+    for (uint32_t block = 0; block < num_blocks && rc == MMC_OK; block++) {
+        for (uint32_t i = 0; i < 512; i += 4) {
+            // Wait for buffer available
+            rc = mmc_wait_data_port(SR_WRITE_AVAILABLE);
+            if (rc != MMC_OK) break;
 
             uint32_t data = buffer[block * 512 + i + 0] |
                            (buffer[block * 512 + i + 1] << 8) |
@@ -272,19 +809,35 @@ int mmc_write_blocks(uint32_t start_block, uint32_t num_blocks, const uint8_t *b
     }
 
     // Wait for data done
-    if (mmc_wait_for_interrupt(INT_DATA_DONE) != 0) {
-        return -1;
-    }
+    return mmc_finish_transfer(rc);
+}
 
-    // Stop transmission for multiple blocks
-    if (num_blocks > 1) {
-        mmc_send_command(CMD_STOP_TRANSMISSION, 0);
+void mmc_use_dma(int enable) {
+    dma_enabled = enable;
+}
+
+uint32_t mmc_benchmark(uint32_t start_block, uint32_t num_blocks, uint8_t *buffer,
+                       uint32_t *cycles_per_block) {
+    if (num_blocks == 0) return 0;
+
+    uint32_t cycles = timer_get_cycles();
+    uint64_t start = timer_get_ticks();
+    if (mmc_read_blocks(start_block, num_blocks, buffer) != MMC_OK) {
+        return 0;
     }
+    uint64_t elapsed = timer_get_ticks() - start;
+    cycles = timer_get_cycles() - cycles;
 
-    return 0;
+    if (cycles_per_block) *cycles_per_block = cycles / num_blocks;
+    if (elapsed == 0) elapsed = 1;
+    return (uint32_t)(((uint64_t)num_blocks * 512 * 1000000) / (elapsed * 1024));
 }
 
 void mmc_reset(void) {
+    if (async.active) {
+        dma_abort(MMC_DMA_CHANNEL);
+        mmc_async_finish(MMC_ERR_NOT_READY);
+    }
     MMIO_WRITE(EMMC_CONTROL1, 0);
     mmc_initialized = 0;
 }
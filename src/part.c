@@ -0,0 +1,325 @@
+#include "part.h"
+#include "crc32.h"
+#include "memory.h"
+
+// Partition discovery
+// One multi-block read covers the MBR, the primary GPT header and a
+// standard 128-entry GPT array, so a typical card is scanned with a single
+// command. Extended partitions cost one read per EBR; the backup GPT is
+// only read if the primary copy fails its CRC checks.
+
+#define PART_SCAN_BLOCKS    34              // LBA 0..33
+#define PART_GPT_MAX_BYTES  (32 * 512)      // Largest entry array accepted
+#define PART_EBR_MAX        PART_MAX        // Bound on the EBR chain
+
+#define MBR_TABLE_OFFSET    446
+#define MBR_TYPE_GPT        0xEE
+#define MBR_TYPE_EFI        0xEF
+
+static uint8_t scan_buf[PART_SCAN_BLOCKS * 512] __attribute__((aligned(64)));
+static uint8_t aux_buf[512] __attribute__((aligned(64)));
+
+static part_table_t table;
+static int table_valid = 0;
+static int sector_valid = 0;    // scan_buf holds block 0
+
+static const uint8_t guid_esp[16] = {
+    0x28, 0x73, 0x2A, 0xC1, 0x1F, 0xF8, 0xD2, 0x11,
+    0xBA, 0x4B, 0x00, 0xA0, 0xC9, 0x3E, 0xC9, 0x3B
+};
+static const uint8_t guid_basic_data[16] = {
+    0xA2, 0xA0, 0xD0, 0xEB, 0xE5, 0xB9, 0x33, 0x44,
+    0x87, 0xC0, 0x68, 0xB6, 0xB7, 0x26, 0x99, 0xC7
+};
+static const uint8_t guid_linux[16] = {
+    0xAF, 0x3D, 0xC6, 0x0F, 0x83, 0x84, 0x72, 0x47,
+    0x8E, 0x79, 0x3D, 0x69, 0xD8, 0x47, 0x7D, 0xE4
+};
+
+static uint32_t rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 64-bit LBA field; returns 0 if it does not fit in 32 bits
+static int rd_lba(const uint8_t *p, uint32_t *lba) {
+    if (rd32(p + 4) != 0) return 0;
+    *lba = rd32(p);
+    return 1;
+}
+
+static int mbr_type_is_fat(uint8_t type) {
+    switch (type) {
+        case 0x01: case 0x04: case 0x06: case 0x0B:
+        case 0x0C: case 0x0E: case MBR_TYPE_EFI:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int mbr_type_is_extended(uint8_t type) {
+    return type == 0x05 || type == 0x0F || type == 0x85;
+}
+
+static void part_add(blockdev_t *disk, uint32_t start, uint32_t count,
+                     uint8_t mbr_type, const uint8_t *guid, uint32_t flags) {
+    if (count == 0 || table.count == PART_MAX) return;
+
+    part_t *part = &table.parts[table.count];
+    part->name[0] = 's';
+    part->name[1] = 'd';
+    if (table.count + 1 >= 10) {
+        part->name[2] = (char)('0' + (table.count + 1) / 10);
+        part->name[3] = (char)('0' + (table.count + 1) % 10);
+        part->name[4] = '\0';
+    } else {
+        part->name[2] = (char)('0' + table.count + 1);
+        part->name[3] = '\0';
+    }
+
+    // Entries reaching past the end of the card are dropped
+    if (blockdev_sub(&part->dev, disk, part->name, start, count) != BLK_OK) return;
+
+    part->mbr_type = mbr_type;
+    for (int i = 0; i < 16; i++) part->type_guid[i] = guid ? guid[i] : 0;
+    part->flags = flags;
+    table.count++;
+}
+
+// A FAT boot sector also ends in 0x55AA; tell it apart from an MBR
+static int part_is_fat_vbr(const uint8_t *b) {
+    if ((b[0] != 0xEB && b[0] != 0xE9) || b[11] != 0x00 || b[12] != 0x02) return 0;
+    return memcmp(b + 54, "FAT", 3) == 0 || memcmp(b + 82, "FAT", 3) == 0;
+}
+
+static int part_scan_ebr_chain(blockdev_t *disk, uint32_t ext_base, uint32_t ext_blocks) {
+    uint32_t ebr = ext_base;
+
+    for (int i = 0; i < PART_EBR_MAX; i++) {
+        if (ebr >= ext_base + ext_blocks) break;
+
+        int rc = blockdev_read(disk, ebr, 1, aux_buf);
+        if (rc != BLK_OK) return rc;
+        if (aux_buf[510] != 0x55 || aux_buf[511] != 0xAA) break;
+
+        // First entry: the logical partition, relative to this EBR
+        const uint8_t *e = aux_buf + MBR_TABLE_OFFSET;
+        uint8_t type = e[4];
+        if (type != 0 && !mbr_type_is_extended(type)) {
+            part_add(disk, ebr + rd32(e + 8), rd32(e + 12), type, 0,
+                     PART_FLAG_LOGICAL | (e[0] & 0x80 ? PART_FLAG_ACTIVE : 0) |
+                     (mbr_type_is_fat(type) ? PART_FLAG_FAT : 0));
+        }
+
+        // Second entry: the next EBR, relative to the extended partition
+        e += 16;
+        if (!mbr_type_is_extended(e[4]) || rd32(e + 8) == 0) break;
+        ebr = ext_base + rd32(e + 8);
+    }
+    return PART_OK;
+}
+
+static int part_scan_mbr(blockdev_t *disk, const uint8_t *mbr) {
+    uint32_t ext_base = 0, ext_blocks = 0;
+
+    for (int i = 0; i < 4; i++) {
+        const uint8_t *e = mbr + MBR_TABLE_OFFSET + i * 16;
+        uint8_t type = e[4];
+        uint32_t start = rd32(e + 8);
+        uint32_t count = rd32(e + 12);
+
+        if (type == 0) continue;
+        if (mbr_type_is_extended(type)) {
+            if (!ext_base) {
+                ext_base = start;
+                ext_blocks = count;
+            }
+            continue;
+        }
+
+        uint32_t flags = (e[0] & 0x80) ? PART_FLAG_ACTIVE : 0;
+        if (mbr_type_is_fat(type)) flags |= PART_FLAG_FAT;
+        if (type == MBR_TYPE_EFI) flags |= PART_FLAG_ESP;
+        part_add(disk, start, count, type, 0, flags);
+    }
+
+    table.scheme = PART_SCHEME_MBR;
+    return ext_base ? part_scan_ebr_chain(disk, ext_base, ext_blocks) : PART_OK;
+}
+
+// Validate a GPT header read from `lba`; returns the entry array size in
+// bytes, or 0 if the header is unusable
+static uint32_t part_gpt_header_ok(const uint8_t *hdr, uint32_t lba) {
+    static const uint8_t zero[4] = { 0, 0, 0, 0 };
+    uint32_t hsize = rd32(hdr + 12);
+    uint32_t my_lba, entries_lba;
+
+    if (memcmp(hdr, "EFI PART", 8) != 0 || hsize < 92 || hsize > 512) return 0;
+
+    // CRC over the header with its own CRC field taken as zero
+    uint32_t crc = crc32(0, hdr, 16);
+    crc = crc32(crc, zero, 4);
+    crc = crc32(crc, hdr + 20, hsize - 20);
+    if (crc != rd32(hdr + 16)) return 0;
+
+    if (!rd_lba(hdr + 24, &my_lba) || my_lba != lba) return 0;
+    if (!rd_lba(hdr + 72, &entries_lba)) return 0;
+
+    uint32_t num = rd32(hdr + 80);
+    uint32_t size = rd32(hdr + 84);
+    if (size < 128 || (size & (size - 1)) || num == 0 || num > PART_GPT_MAX_BYTES / size) {
+        return 0;
+    }
+    return num * size;
+}
+
+// Locate and check the entry array; returns it or 0
+static const uint8_t *part_gpt_entries(blockdev_t *disk, const uint8_t *hdr,
+                                       uint32_t bytes, uint32_t prefetched) {
+    uint32_t lba = rd32(hdr + 72);
+    uint32_t blocks = (bytes + 511) / 512;
+    const uint8_t *entries;
+
+    if (lba >= 2 && lba + blocks <= prefetched) {
+        entries = scan_buf + lba * 512;
+    } else {
+        // Outside the prefetch window: one read after the header block
+        uint8_t *dst = scan_buf + 2 * 512;
+        if (blockdev_read(disk, lba, blocks, dst) != BLK_OK) return 0;
+        entries = dst;
+    }
+
+    return crc32(0, entries, bytes) == rd32(hdr + 88) ? entries : 0;
+}
+
+static void part_gpt_table(blockdev_t *disk, const uint8_t *hdr, const uint8_t *entries) {
+    uint32_t num = rd32(hdr + 80);
+    uint32_t size = rd32(hdr + 84);
+
+    for (uint32_t i = 0; i < num; i++) {
+        const uint8_t *e = entries + i * size;
+        uint32_t first, last;
+        int used = 0;
+
+        for (int j = 0; j < 16; j++) used |= e[j];
+        if (!used) continue;
+        if (!rd_lba(e + 32, &first) || !rd_lba(e + 40, &last) || last < first) continue;
+
+        uint32_t flags = (e[48] & 0x04) ? PART_FLAG_ACTIVE : 0;
+        if (memcmp(e, guid_esp, 16) == 0) flags |= PART_FLAG_ESP | PART_FLAG_FAT;
+        if (memcmp(e, guid_basic_data, 16) == 0) flags |= PART_FLAG_FAT;
+        part_add(disk, first, last - first + 1, 0, e, flags);
+    }
+}
+
+static int part_scan_gpt(blockdev_t *disk, uint32_t prefetched) {
+    const uint8_t *hdr = scan_buf + 512;
+    const uint8_t *entries = 0;
+    uint32_t bytes = part_gpt_header_ok(hdr, 1);
+
+    if (bytes) entries = part_gpt_entries(disk, hdr, bytes, prefetched);
+
+    if (!entries) {
+        // Primary copy damaged: try the backup at the end of the disk
+        uint32_t alt = disk->num_blocks - 1;
+        int rc = blockdev_read(disk, alt, 1, aux_buf);
+        if (rc != BLK_OK) return rc;
+
+        hdr = aux_buf;
+        bytes = part_gpt_header_ok(hdr, alt);
+        if (bytes) entries = part_gpt_entries(disk, hdr, bytes, 0);
+        if (!entries) return PART_ERR_CORRUPT;
+        table.gpt_backup = 1;
+    }
+
+    part_gpt_table(disk, hdr, entries);
+    table.scheme = PART_SCHEME_GPT;
+    return PART_OK;
+}
+
+int part_scan(blockdev_t *disk) {
+    if (!disk) return BLK_ERR_NODEV;
+
+    table_valid = 0;
+    sector_valid = 0;
+    table.scheme = 0;
+    table.count = 0;
+    table.gpt_backup = 0;
+
+    uint32_t prefetched = disk->num_blocks < PART_SCAN_BLOCKS ? disk->num_blocks
+                                                               : PART_SCAN_BLOCKS;
+    int rc = blockdev_read(disk, 0, prefetched, scan_buf);
+    if (rc != BLK_OK) return rc;
+    sector_valid = 1;
+
+    const uint8_t *mbr = scan_buf;
+    if (mbr[510] != 0x55 || mbr[511] != 0xAA || part_is_fat_vbr(mbr)) {
+        return PART_ERR_NOTABLE;
+    }
+
+    int protective = 0;
+    for (int i = 0; i < 4; i++) {
+        const uint8_t *e = mbr + MBR_TABLE_OFFSET + i * 16;
+        if (e[0] != 0x00 && e[0] != 0x80) return PART_ERR_NOTABLE;
+        if (e[4] == MBR_TYPE_GPT) protective = 1;
+    }
+
+    rc = protective ? part_scan_gpt(disk, prefetched) : part_scan_mbr(disk, mbr);
+    if (rc != PART_OK) return rc;
+
+    // An empty MBR is most likely boot code of some other kind
+    if (table.scheme == PART_SCHEME_MBR && table.count == 0) return PART_ERR_NOTABLE;
+
+    table_valid = 1;
+    return PART_OK;
+}
+
+const part_table_t *part_get_table(void) {
+    return table_valid ? &table : 0;
+}
+
+part_t *part_find_boot(void) {
+    if (!table_valid) return 0;
+
+    static const uint32_t wanted[3] = {
+        PART_FLAG_ESP, PART_FLAG_ACTIVE | PART_FLAG_FAT, PART_FLAG_FAT
+    };
+    for (int w = 0; w < 3; w++) {
+        for (uint32_t i = 0; i < table.count; i++) {
+            if ((table.parts[i].flags & wanted[w]) == wanted[w]) {
+                return &table.parts[i];
+            }
+        }
+    }
+    return 0;
+}
+
+const uint8_t *part_boot_sector(void) {
+    return sector_valid ? scan_buf : 0;
+}
+
+const char *part_type_name(const part_t *part) {
+    if (part->flags & PART_FLAG_ESP) return "EFI system";
+    if (part->mbr_type == 0) {
+        if (memcmp(part->type_guid, guid_basic_data, 16) == 0) return "basic data";
+        if (memcmp(part->type_guid, guid_linux, 16) == 0) return "Linux";
+        return "unknown";
+    }
+    switch (part->mbr_type) {
+        case 0x01:                          return "FAT12";
+        case 0x04: case 0x06: case 0x0E:    return "FAT16";
+        case 0x0B: case 0x0C:               return "FAT32";
+        case 0x83:                          return "Linux";
+        default:                            return "unknown";
+    }
+}
+
+const char *part_strerror(int err) {
+    switch (err) {
+        case PART_ERR_NOTABLE:  return "no partition table";
+        case PART_ERR_CORRUPT:  return "corrupt GPT";
+        case PART_ERR_NOBOOT:   return "no boot partition";
+        default:                return blockdev_strerror(err);
+    }
+}
@@ -1,71 +0,0 @@
-#include "sdcard.h"
-#include "hardware.h"
-#include "uart.h"
-
-// Simplified SD card driver (basic support)
-// Full implementation would be quite complex
-
-static int sd_initialized = 0;
-
-int sd_init(void) {
-    uart_puts("SD Card: Initializing...\n");
-
-    // This is a placeholder for actual SD card initialization
-    // A real implementation would involve:
-    // 1. Setting up EMMC controller
-    // 2. Sending CMD0 (GO_IDLE_STATE)
-    // 3. Sending CMD8 (SEND_IF_COND)
-    // 4. Sending ACMD41 (SD_SEND_OP_COND)
-    // 5. Sending CMD2 (ALL_SEND_CID)
-    // 6. Sending CMD3 (SEND_RELATIVE_ADDR)
-    // 7. Sending CMD7 (SELECT_CARD)
-    // 8. Setting block size with CMD16
-
-    delay_ms(100);
-
-    // Simulate initialization
-    sd_initialized = 1;
-    uart_puts("SD Card: Ready\n");
-
-    return 0;
-}
-
-int sd_read_block(uint32_t block_num, uint8_t *buffer) {
-    if (!sd_initialized) {
-        return -1;
-    }
-
-    // Placeholder for SD card read
-    // Real implementation would:
-    // 1. Send CMD17 (READ_SINGLE_BLOCK) with block address
-    // 2. Wait for response
-    // 3. Read data block (512 bytes)
-    // 4. Verify CRC
-
-    uart_printf("SD Card: Reading block %d\n", block_num);
-
-    // For now, return simulated data
-    for (int i = 0; i < 512; i++) {
-        buffer[i] = 0;
-    }
-
-    return 0;
-}
-
-int sd_write_block(uint32_t block_num, const uint8_t *buffer __attribute__((unused))) {
-    if (!sd_initialized) {
-        return -1;
-    }
-
-    // Placeholder for SD card write
-    // Real implementation would:
-    // 1. Send CMD24 (WRITE_BLOCK) with block address
-    // 2. Wait for response
-    // 3. Send data block (512 bytes)
-    // 4. Send CRC
-    // 5. Wait for completion
-
-    uart_printf("SD Card: Writing block %d\n", block_num);
-
-    return 0;
-}
@@ -0,0 +1,188 @@
+#include "serial_load.h"
+#include "crc32.h"
+#include "memory.h"
+#include "timer.h"
+#include "uart.h"
+#include <stddef.h>
+
+#define SERIAL_READY_INTERVAL_US 1000000
+
+// Kept across calls so an interrupted transfer can be resumed
+static serial_header_t transfer;
+static uint32_t transfer_received;  // Bytes acknowledged, from the start
+
+static void serial_reply(uint32_t code, uint32_t value) {
+    uint32_t reply[3] = { SERIAL_REPLY_MAGIC, code, value };
+    const char *p = (const char *)reply;
+    for (uint32_t i = 0; i < sizeof(reply); i++) uart_putc(p[i]);
+}
+
+// Read exactly len bytes; 0, or SERIAL_ERR_ABORT if the line goes quiet
+static int serial_read(uint8_t *buffer, uint32_t len) {
+    uint64_t deadline = timer_get_ticks() + SERIAL_BYTE_TIMEOUT_US;
+    while (len) {
+        uint32_t n = uart_read(buffer, len);
+        if (n) {
+            buffer += n;
+            len -= n;
+            deadline = timer_get_ticks() + SERIAL_BYTE_TIMEOUT_US;
+        } else if (timer_get_ticks() >= deadline) {
+            return SERIAL_ERR_ABORT;
+        }
+    }
+    return 0;
+}
+
+// Read a payload of len bytes to dest and check the packet CRC
+static int serial_payload(const serial_packet_t *pkt, uint8_t *dest) {
+    if (serial_read(dest, pkt->len) < 0) return 0;
+    uint32_t crc = crc32(0, pkt, offsetof(serial_packet_t, crc));
+    return crc32(crc, dest, pkt->len) == pkt->crc;
+}
+
+// Consume a payload that has nowhere to go
+static void serial_skip(uint32_t len) {
+    uint8_t scratch[64];
+    while (len) {
+        uint32_t n = len < sizeof(scratch) ? len : sizeof(scratch);
+        if (serial_read(scratch, n) < 0) return;
+        len -= n;
+    }
+}
+
+static int serial_header(const serial_packet_t *pkt, uint32_t base, uint32_t max,
+                         serial_load_info_t *info) {
+    serial_header_t h;
+    if (pkt->len != sizeof(h)) {
+        serial_skip(pkt->len);
+        return 0;
+    }
+    if (!serial_payload(pkt, (uint8_t *)&h)) return 0;
+
+    if (h.load_addr < base || h.size == 0 || h.size > max ||
+        h.load_addr - base > max - h.size) {
+        serial_reply(SERIAL_REPLY_ERROR, (uint32_t)SERIAL_ERR_RANGE);
+        return SERIAL_ERR_RANGE;
+    }
+    if (h.entry == 0) h.entry = h.load_addr;
+
+    // The same image again carries on where it stopped
+    if (h.load_addr != transfer.load_addr || h.size != transfer.size ||
+        h.crc != transfer.crc || transfer_received >= h.size) {
+        transfer_received = 0;
+    }
+    transfer = h;
+
+    memset(info, 0, sizeof(*info));
+    info->image = h;
+    info->resumed_at = transfer_received;
+    info->us = timer_get_ticks();
+    serial_reply(SERIAL_REPLY_ACK, transfer_received);
+    return 1;
+}
+
+int serial_load(uint32_t base, uint32_t max, serial_load_info_t *info) {
+    int started = 0;
+    int nak_sent = 0;
+    uint32_t last_offset = 0;
+    uint32_t window = 0;
+    uint64_t last_rx = timer_get_ticks();
+    uint64_t next_ready = last_rx;
+
+    while (1) {
+        int c = uart_try_getc();
+        uint64_t now = timer_get_ticks();
+        if (c < 0) {
+            // Also once a transfer has stalled: a restarted sender waits for it
+            if (now >= next_ready && (!started || now - last_rx >= SERIAL_READY_INTERVAL_US)) {
+                serial_reply(SERIAL_REPLY_READY, transfer_received);
+                next_ready = now + SERIAL_READY_INTERVAL_US;
+            }
+            if (now - last_rx > SERIAL_IDLE_TIMEOUT_US) return SERIAL_ERR_ABORT;
+            continue;
+        }
+        last_rx = now;
+        if (!started && c == 0x03) return SERIAL_ERR_ABORT;   // Ctrl-C
+
+        // Hunt for the packet magic; anything else is line noise or echo
+        window = (window >> 8) | ((uint32_t)c << 24);
+        if (window != SERIAL_PACKET_MAGIC) continue;
+        window = 0;
+
+        serial_packet_t pkt;
+        pkt.magic = SERIAL_PACKET_MAGIC;
+        if (serial_read((uint8_t *)&pkt + 4, sizeof(pkt) - 4) < 0) continue;
+        if (pkt.len > SERIAL_CHUNK_MAX) continue;
+
+        if (pkt.type == SERIAL_PKT_HEADER) {
+            int rc = serial_header(&pkt, base, max, info);
+            if (rc < 0) return rc;
+            if (rc > 0) {
+                started = 1;
+                nak_sent = 0;
+            }
+            continue;
+        }
+        if (!started) {
+            serial_skip(pkt.len);
+            continue;
+        }
+        info->packets++;
+
+        if (pkt.type == SERIAL_PKT_DATA) {
+            // An offset going back means the sender rewound, and may need
+            // another NAK if the chunk it rewound to is lost too
+            if (pkt.offset <= last_offset) nak_sent = 0;
+            last_offset = pkt.offset;
+
+            // Only the next chunk in order is taken, straight into place;
+            // a bad one is simply overwritten by the retransmission
+            int ok = pkt.offset == transfer_received && pkt.len > 0 &&
+                     pkt.len <= transfer.size - transfer_received;
+            if (ok) {
+                ok = serial_payload(&pkt, (uint8_t *)(transfer.load_addr + pkt.offset));
+            } else {
+                serial_skip(pkt.len);
+            }
+            if (ok) {
+                transfer_received += pkt.len;
+                nak_sent = 0;
+                serial_reply(SERIAL_REPLY_ACK, transfer_received);
+            } else if (!nak_sent) {
+                nak_sent = 1;
+                info->naks++;
+                serial_reply(SERIAL_REPLY_NAK, transfer_received);
+            }
+        } else if (pkt.type == SERIAL_PKT_DONE) {
+            if (pkt.len != 0 || crc32(0, &pkt, offsetof(serial_packet_t, crc)) != pkt.crc) {
+                serial_skip(pkt.len);
+                continue;
+            }
+            if (transfer_received != transfer.size) {
+                serial_reply(SERIAL_REPLY_NAK, transfer_received);
+                continue;
+            }
+
+            // Done either way; a bad image starts from scratch next time
+            transfer_received = 0;
+            if (crc32(0, (const void *)transfer.load_addr, transfer.size) != transfer.crc) {
+                serial_reply(SERIAL_REPLY_ERROR, (uint32_t)SERIAL_ERR_CHECK);
+                return SERIAL_ERR_CHECK;
+            }
+            info->us = timer_get_ticks() - info->us;
+            serial_reply(SERIAL_REPLY_ACK, transfer.size);
+            return 0;
+        } else {
+            serial_skip(pkt.len);
+        }
+    }
+}
+
+const char *serial_strerror(int err) {
+    switch (err) {
+        case SERIAL_ERR_ABORT:      return "aborted or timed out";
+        case SERIAL_ERR_RANGE:      return "image outside the load area";
+        case SERIAL_ERR_CHECK:      return "image CRC mismatch";
+        default:                    return "unknown error";
+    }
+}
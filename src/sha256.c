@@ -0,0 +1,196 @@
+#include "sha256.h"
+#include "memory.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// SHA-256
+// Whole blocks are hashed straight from the caller's buffer; only a
+// partial block at either end goes through ctx->buffer. The 64 rounds are
+// unrolled eight at a time with the working variables renamed instead of
+// shifted, so each round is a handful of ALU operations on registers.
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+#define S0(x)       (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define S1(x)       (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define s0(x)       (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define s1(x)       (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+#define CH(x, y, z) (((x) & ((y) ^ (z))) ^ (z))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+#define ROUND(a, b, c, d, e, f, g, h, i) do {                   \
+        uint32_t t1 = h + S1(e) + CH(e, f, g) + w[i];           \
+        uint32_t t2 = S0(a) + MAJ(a, b, c);                     \
+        d += t1;                                                \
+        h = t1 + t2;                                            \
+    } while (0)
+
+static inline uint32_t sha256_load_be(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+#if defined(__ARM_NEON)
+// sigma0/sigma1 on four (or two) lanes: rotates are a shift plus a
+// shift-right-and-insert
+static inline uint32x4_t sha256_s0q(uint32x4_t x) {
+    uint32x4_t r7 = vsriq_n_u32(vshlq_n_u32(x, 25), x, 7);
+    uint32x4_t r18 = vsriq_n_u32(vshlq_n_u32(x, 14), x, 18);
+    return veorq_u32(veorq_u32(r7, r18), vshrq_n_u32(x, 3));
+}
+
+static inline uint32x2_t sha256_s1d(uint32x2_t x) {
+    uint32x2_t r17 = vsri_n_u32(vshl_n_u32(x, 15), x, 17);
+    uint32x2_t r19 = vsri_n_u32(vshl_n_u32(x, 13), x, 19);
+    return veor_u32(veor_u32(r17, r19), vshr_n_u32(x, 10));
+}
+
+// Expand w[16..63], four words per step. The upper two words of each
+// step depend on the lower two, so sigma1 is applied in two halves.
+static void sha256_schedule(uint32_t *w) {
+    uint32x4_t x0 = vld1q_u32(w);
+    uint32x4_t x1 = vld1q_u32(w + 4);
+    uint32x4_t x2 = vld1q_u32(w + 8);
+    uint32x4_t x3 = vld1q_u32(w + 12);
+
+    for (int t = 16; t < 64; t += 4) {
+        uint32x4_t sum = vaddq_u32(x0, sha256_s0q(vextq_u32(x0, x1, 1)));
+        sum = vaddq_u32(sum, vextq_u32(x2, x3, 1));
+
+        uint32x2_t lo = vadd_u32(vget_low_u32(sum), sha256_s1d(vget_high_u32(x3)));
+        uint32x2_t hi = vadd_u32(vget_high_u32(sum), sha256_s1d(lo));
+        uint32x4_t next = vcombine_u32(lo, hi);
+        vst1q_u32(w + t, next);
+
+        x0 = x1;
+        x1 = x2;
+        x2 = x3;
+        x3 = next;
+    }
+}
+#else
+static void sha256_schedule(uint32_t *w) {
+    for (int t = 16; t < 64; t += 4) {
+        w[t] = s1(w[t - 2]) + w[t - 7] + s0(w[t - 15]) + w[t - 16];
+        w[t + 1] = s1(w[t - 1]) + w[t - 6] + s0(w[t - 14]) + w[t - 15];
+        w[t + 2] = s1(w[t]) + w[t - 5] + s0(w[t - 13]) + w[t - 14];
+        w[t + 3] = s1(w[t + 1]) + w[t - 4] + s0(w[t - 12]) + w[t - 13];
+    }
+}
+#endif
+
+static void sha256_blocks(uint32_t *state, const uint8_t *p, uint32_t blocks) {
+    uint32_t w[64] __attribute__((aligned(16)));
+
+    while (blocks--) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = sha256_load_be(p + i * 4);
+        }
+        sha256_schedule(w);
+
+        // Fold the round constants in ahead of the rounds
+        for (int i = 0; i < 64; i++) {
+            w[i] += sha256_k[i];
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i += 8) {
+            ROUND(a, b, c, d, e, f, g, h, i);
+            ROUND(h, a, b, c, d, e, f, g, i + 1);
+            ROUND(g, h, a, b, c, d, e, f, i + 2);
+            ROUND(f, g, h, a, b, c, d, e, i + 3);
+            ROUND(e, f, g, h, a, b, c, d, i + 4);
+            ROUND(d, e, f, g, h, a, b, c, i + 5);
+            ROUND(c, d, e, f, g, h, a, b, i + 6);
+            ROUND(b, c, d, e, f, g, h, a, i + 7);
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        p += SHA256_BLOCK_SIZE;
+    }
+}
+
+void sha256_init(sha256_ctx_t *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    for (int i = 0; i < 8; i++) ctx->state[i] = iv[i];
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+void sha256_update(sha256_ctx_t *ctx, const void *data, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    ctx->length += len;
+
+    if (ctx->used) {
+        uint32_t n = SHA256_BLOCK_SIZE - ctx->used;
+        if (n > len) n = len;
+        memcpy(ctx->buffer + ctx->used, p, n);
+        ctx->used += n;
+        p += n;
+        len -= n;
+        if (ctx->used < SHA256_BLOCK_SIZE) return;
+        sha256_blocks(ctx->state, ctx->buffer, 1);
+        ctx->used = 0;
+    }
+
+    uint32_t blocks = len / SHA256_BLOCK_SIZE;
+    if (blocks) {
+        sha256_blocks(ctx->state, p, blocks);
+        p += blocks * SHA256_BLOCK_SIZE;
+        len -= blocks * SHA256_BLOCK_SIZE;
+    }
+
+    if (len) {
+        memcpy(ctx->buffer, p, len);
+        ctx->used = len;
+    }
+}
+
+void sha256_final(sha256_ctx_t *ctx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bits = ctx->length * 8;
+    uint32_t used = ctx->used;
+
+    ctx->buffer[used++] = 0x80;
+    if (used > SHA256_BLOCK_SIZE - 8) {
+        memset(ctx->buffer + used, 0, SHA256_BLOCK_SIZE - used);
+        sha256_blocks(ctx->state, ctx->buffer, 1);
+        used = 0;
+    }
+    memset(ctx->buffer + used, 0, SHA256_BLOCK_SIZE - 8 - used);
+    for (int i = 0; i < 8; i++) {
+        ctx->buffer[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (i * 8));
+    }
+    sha256_blocks(ctx->state, ctx->buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+void sha256(const void *data, uint32_t len, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+}
@@ -0,0 +1,428 @@
+#include "shell.h"
+#include "blockdev.h"
+#include "crc32.h"
+#include "format.h"
+#include "memory.h"
+#include "timer.h"
+#include "uart.h"
+
+#define SHELL_PROMPT    "> "
+#define SHELL_DUMP_ROW  16              // Bytes per dump line
+#define SHELL_MD_BYTES  256             // Default md length
+
+static const shell_command_t *shell_commands;
+static uint32_t shell_count;
+
+static char history[SHELL_HISTORY][SHELL_LINE_MAX];
+static uint32_t history_added;          // Lines ever added
+
+static uint32_t md_addr;                // Where a bare md carries on
+
+int shell_parse_uint(const char *s, uint32_t *value) {
+    uint32_t v = 0;
+    int digits = 0;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        for (s += 2; *s; s++, digits++) {
+            uint32_t d;
+            if (*s >= '0' && *s <= '9') d = (uint32_t)(*s - '0');
+            else if (*s >= 'a' && *s <= 'f') d = (uint32_t)(*s - 'a' + 10);
+            else if (*s >= 'A' && *s <= 'F') d = (uint32_t)(*s - 'A' + 10);
+            else return 0;
+            v = (v << 4) | d;
+        }
+    } else {
+        for (; *s; s++, digits++) {
+            if (*s < '0' || *s > '9') return 0;
+            v = v * 10 + (uint32_t)(*s - '0');
+        }
+    }
+    if (digits == 0) return 0;
+
+    *value = v;
+    return 1;
+}
+
+// Access size from a ".b", ".w" or ".l" suffix on the command word
+static uint32_t shell_access_size(const char *word) {
+    while (*word && *word != '.') word++;
+    if (!*word) return 4;
+    if (word[2]) return 0;
+    switch (word[1]) {
+        case 'b': return 1;
+        case 'w': return 2;
+        case 'l': return 4;
+        default:  return 0;
+    }
+}
+
+static uint32_t mem_read(uint32_t addr, uint32_t size) {
+    switch (size) {
+        case 1:  return *(volatile uint8_t *)addr;
+        case 2:  return *(volatile uint16_t *)addr;
+        default: return *(volatile uint32_t *)addr;
+    }
+}
+
+// Verified boot builds leave out mw: writing memory could patch a checked
+// image before it runs
+#ifndef VERIFIED_BOOT
+static void mem_write(uint32_t addr, uint32_t size, uint32_t value) {
+    switch (size) {
+        case 1:  *(volatile uint8_t *)addr = (uint8_t)value; break;
+        case 2:  *(volatile uint16_t *)addr = (uint16_t)value; break;
+        default: *(volatile uint32_t *)addr = value; break;
+    }
+}
+#endif
+
+// Ctrl-C typed while a long command runs
+static int shell_interrupted(void) {
+    int c;
+    while ((c = uart_try_getc()) >= 0) {
+        if (c == 0x03) {
+            uart_puts("^C\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Dump len bytes read at addr in size-byte units, labelling lines from
+// label. Each unit is read once (registers may not like more), and each
+// line goes out in a single call.
+static void shell_dump(uint32_t addr, uint32_t label, uint32_t len, uint32_t size) {
+    char line[16 + SHELL_DUMP_ROW * 3 + SHELL_DUMP_ROW + 4];
+
+    for (uint32_t off = 0; off < len; off += SHELL_DUMP_ROW) {
+        uint8_t bytes[SHELL_DUMP_ROW];
+        uint32_t row = len - off < SHELL_DUMP_ROW ? len - off : SHELL_DUMP_ROW;
+        int n = snprintf(line, sizeof(line), "%08x:", label + off);
+
+        for (uint32_t i = 0; i < row; i += size) {
+            uint32_t v = mem_read(addr + off + i, size);
+            memcpy(&bytes[i], &v, size);
+            n += snprintf(line + n, sizeof(line) - n, " %0*x", (int)size * 2, v);
+        }
+
+        // Line the text column up under a full row
+        uint32_t units = (row + size - 1) / size;
+        n += snprintf(line + n, sizeof(line) - n, "%*s  ",
+                      (int)((SHELL_DUMP_ROW / size - units) * (size * 2 + 1)), "");
+        for (uint32_t i = 0; i < row; i++) {
+            line[n++] = bytes[i] >= 32 && bytes[i] < 127 ? (char)bytes[i] : '.';
+        }
+        line[n++] = '\n';
+        line[n] = '\0';
+        uart_puts(line);
+
+        if (shell_interrupted()) return;
+    }
+}
+
+static int cmd_md(int argc, char **argv) {
+    uint32_t size = shell_access_size(argv[0]);
+    uint32_t count = SHELL_MD_BYTES / (size ? size : 1);
+
+    if (!size || argc > 3) return SHELL_ERR_USAGE;
+    if (argc > 1 && !shell_parse_uint(argv[1], &md_addr)) return SHELL_ERR_USAGE;
+    if (argc > 2 && !shell_parse_uint(argv[2], &count)) return SHELL_ERR_USAGE;
+
+    md_addr &= ~(size - 1);
+    shell_dump(md_addr, md_addr, count * size, size);
+    md_addr += count * size;
+    return 0;
+}
+
+#ifndef VERIFIED_BOOT
+static int cmd_mw(int argc, char **argv) {
+    uint32_t size = shell_access_size(argv[0]);
+    uint32_t addr, value, count = 1;
+
+    if (!size || argc < 3 || argc > 4) return SHELL_ERR_USAGE;
+    if (!shell_parse_uint(argv[1], &addr) || !shell_parse_uint(argv[2], &value)) {
+        return SHELL_ERR_USAGE;
+    }
+    if (argc > 3 && !shell_parse_uint(argv[3], &count)) return SHELL_ERR_USAGE;
+
+    addr &= ~(size - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        mem_write(addr + i * size, size, value);
+    }
+    return 0;
+}
+#endif
+
+static int cmd_sd(int argc, char **argv) {
+    static uint8_t block[BLOCKDEV_BLOCK_SIZE] __attribute__((aligned(64)));
+    uint32_t lba, count = 1;
+
+    if (argc < 2 || argc > 3 || !shell_parse_uint(argv[1], &lba)) return SHELL_ERR_USAGE;
+    if (argc > 2 && !shell_parse_uint(argv[2], &count)) return SHELL_ERR_USAGE;
+
+    int rc = blockdev_get_sd() ? BLK_OK : blockdev_init();
+    for (uint32_t i = 0; rc == BLK_OK && i < count; i++) {
+        rc = blockdev_read(blockdev_get_sd(), lba + i, 1, block);
+        if (rc != BLK_OK) break;
+        uart_printf("Block %u:\n", lba + i);
+        shell_dump((uint32_t)block, 0, BLOCKDEV_BLOCK_SIZE, 1);
+    }
+    if (rc != BLK_OK) uart_printf("sd: %s\n", blockdev_strerror(rc));
+    return 0;
+}
+
+static int cmd_crc(int argc, char **argv) {
+    uint32_t addr, len;
+
+    if (argc != 3 || !shell_parse_uint(argv[1], &addr) || !shell_parse_uint(argv[2], &len)) {
+        return SHELL_ERR_USAGE;
+    }
+
+    uint64_t start = timer_get_ticks();
+    uint32_t crc = crc32(0, (const void *)addr, len);
+    uint32_t us = (uint32_t)(timer_get_ticks() - start);
+
+    uart_printf("CRC-32 0x%08X over %u bytes at 0x%08X (%u us, %u MB/s)\n",
+                crc, len, addr, us, us ? len / us : 0);
+    return 0;
+}
+
+static int shell_dispatch(int argc, char **argv);
+
+static int cmd_time(int argc, char **argv) {
+    if (argc < 2) return SHELL_ERR_USAGE;
+
+    uint64_t start = timer_get_ticks();
+    shell_dispatch(argc - 1, argv + 1);
+    uint32_t us = (uint32_t)(timer_get_ticks() - start);
+
+    uart_printf("%s: %u.%03u ms\n", argv[1], us / 1000, us % 1000);
+    return 0;
+}
+
+static void help_list(const shell_command_t *cmds, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        char usage[32];
+        snprintf(usage, sizeof(usage), "%s %s", cmds[i].name, cmds[i].args);
+        uart_printf("  %-28s %s\n", usage, cmds[i].help);
+    }
+}
+
+static int cmd_help(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    uart_puts("Available commands:\n");
+    help_list(shell_commands, shell_count);
+    uint32_t count;
+    const shell_command_t *tools = shell_builtins(&count);
+    help_list(tools, count);
+    uart_puts("Numbers are decimal or 0x hex; Tab completes, Up/Down recall.\n");
+    return 0;
+}
+
+static const shell_command_t builtins[] = {
+    { "md",   "[addr] [count]",     "Dump memory (md.b, md.w: 8/16-bit)",  cmd_md },
+#ifndef VERIFIED_BOOT
+    { "mw",   "addr value [count]", "Write memory (mw.b, mw.w: 8/16-bit)", cmd_mw },
+#endif
+    { "sd",   "lba [count]",        "Dump SD card blocks",                 cmd_sd },
+    { "crc",  "addr len",           "CRC-32 of a memory range",            cmd_crc },
+    { "time", "command ...",        "Time a command",                      cmd_time },
+    { "help", "",                   "Show this help",                      cmd_help },
+};
+
+const shell_command_t *shell_builtins(uint32_t *count) {
+    *count = sizeof(builtins) / sizeof(builtins[0]);
+    return builtins;
+}
+
+// Does word (up to any ".size" suffix) name cmd?
+static int shell_matches(const shell_command_t *cmd, const char *word) {
+    uint32_t n = 0;
+    while (word[n] && word[n] != '.') n++;
+    return strncmp(cmd->name, word, n) == 0 && cmd->name[n] == '\0';
+}
+
+static const shell_command_t *shell_find(const char *word) {
+    for (uint32_t i = 0; i < shell_count; i++) {
+        if (shell_matches(&shell_commands[i], word)) return &shell_commands[i];
+    }
+    for (uint32_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (shell_matches(&builtins[i], word)) return &builtins[i];
+    }
+    return 0;
+}
+
+static int shell_dispatch(int argc, char **argv) {
+    const shell_command_t *cmd = shell_find(argv[0]);
+    if (!cmd) {
+        uart_printf("Unknown command: %s\nType 'help' for available commands.\n", argv[0]);
+        return SHELL_ERR_UNKNOWN;
+    }
+
+    int rc = cmd->run(argc, argv);
+    if (rc == SHELL_ERR_USAGE) uart_printf("usage: %s %s\n", cmd->name, cmd->args);
+    return rc;
+}
+
+int shell_execute(char *line) {
+    char *argv[SHELL_MAX_ARGS];
+    int argc = 0;
+
+    while (*line) {
+        while (*line == ' ') *line++ = '\0';
+        if (!*line) break;
+        if (argc == SHELL_MAX_ARGS) {
+            uart_puts("Too many arguments\n");
+            return SHELL_ERR_USAGE;
+        }
+        argv[argc++] = line;
+        while (*line && *line != ' ') line++;
+    }
+    if (argc == 0) return 0;
+    return shell_dispatch(argc, argv);
+}
+
+// Put back the prompt and the line being edited
+static void shell_redraw(const char *line) {
+    uart_puts("\r\033[K" SHELL_PROMPT);
+    uart_puts(line);
+}
+
+// Complete the command name being typed: fully if only one command
+// fits, else as far as all of them agree; a second Tab lists them
+static uint32_t shell_complete(char *line, uint32_t len, int list) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (line[i] == ' ') return len;
+    }
+
+    const shell_command_t *tables[2];
+    uint32_t counts[2];
+    tables[0] = shell_commands;
+    counts[0] = shell_count;
+    tables[1] = shell_builtins(&counts[1]);
+
+    const char *first = 0;
+    uint32_t common = 0, matches = 0;
+    for (int t = 0; t < 2; t++) {
+        for (uint32_t i = 0; i < counts[t]; i++) {
+            const char *name = tables[t][i].name;
+            if (strncmp(name, line, len) != 0) continue;
+            if (!first) {
+                first = name;
+                common = strlen(name);
+            } else {
+                uint32_t n = 0;
+                while (n < common && name[n] == first[n]) n++;
+                common = n;
+            }
+            matches++;
+            if (list) uart_printf("%s%s", matches == 1 ? "\n" : "  ", name);
+        }
+    }
+    if (!matches) return len;
+    if (list) {
+        uart_puts("\n");
+        shell_redraw(line);
+        return len;
+    }
+
+    while (len < common && len < SHELL_LINE_MAX - 2) {
+        line[len] = first[len];
+        uart_putc(line[len++]);
+    }
+    if (matches == 1) {
+        line[len++] = ' ';
+        uart_putc(' ');
+    }
+    line[len] = '\0';
+    return len;
+}
+
+static void history_add(const char *line) {
+    if (!*line) return;
+    if (history_added && strcmp(history[(history_added - 1) % SHELL_HISTORY], line) == 0) return;
+    strcpy(history[history_added % SHELL_HISTORY], line);
+    history_added++;
+}
+
+// Read one line with editing, history and completion
+static void shell_readline(char *line) {
+    uint32_t len = 0;
+    uint32_t back = 0;          // How far Up has gone into the history
+    int esc = 0;                // 1 after ESC, 2 after ESC [
+    int tabs = 0;
+
+    line[0] = '\0';
+    uart_puts(SHELL_PROMPT);
+
+    while (1) {
+        char c = uart_getc();
+
+        if (esc == 1) {
+            esc = c == '[' ? 2 : 0;
+            continue;
+        }
+        if (esc == 2) {
+            esc = 0;
+            uint32_t kept = history_added < SHELL_HISTORY ? history_added : SHELL_HISTORY;
+            if (c == 'A' && back < kept) {
+                back++;
+            } else if (c == 'B' && back > 0) {
+                back--;
+            } else {
+                continue;
+            }
+            if (back) {
+                strcpy(line, history[(history_added - back) % SHELL_HISTORY]);
+            } else {
+                line[0] = '\0';
+            }
+            len = strlen(line);
+            shell_redraw(line);
+            continue;
+        }
+
+        tabs = c == '\t' ? tabs + 1 : 0;
+        if (c == '\r' || c == '\n') {
+            uart_puts("\n");
+            return;
+        } else if (c == 0x1B) {
+            esc = 1;
+        } else if (c == '\t') {
+            len = shell_complete(line, len, tabs > 1);
+        } else if (c == 0x03) {             // Ctrl-C
+            uart_puts("^C\n");
+            len = 0;
+            line[0] = '\0';
+            back = 0;
+            uart_puts(SHELL_PROMPT);
+        } else if (c == 0x15) {             // Ctrl-U
+            len = 0;
+            line[0] = '\0';
+            shell_redraw(line);
+        } else if (c == 127 || c == 8) {    // Backspace
+            if (len > 0) {
+                line[--len] = '\0';
+                uart_puts("\b \b");
+            }
+        } else if (len < SHELL_LINE_MAX - 1 && c >= 32 && c <= 126) {
+            line[len++] = c;
+            line[len] = '\0';
+            uart_putc(c);
+        }
+    }
+}
+
+void shell_run(const shell_command_t *commands, uint32_t count) {
+    char line[SHELL_LINE_MAX];
+
+    shell_commands = commands;
+    shell_count = count;
+
+    while (1) {
+        shell_readline(line);
+        history_add(line);
+        shell_execute(line);
+    }
+}
@@ -0,0 +1,263 @@
+#include "splash.h"
+#include "framebuffer.h"
+#include "timer.h"
+
+// Streaming splash decoder
+// The stream is consumed through a fixed input window and written straight
+// into the destination surface, so memory use does not depend on the image
+// size and the decode time is linear in the number of pixels.
+
+typedef struct {
+    const splash_reader_t *reader;
+    uint32_t pos;
+    uint32_t len;
+    uint8_t window[SPLASH_WINDOW_SIZE] __attribute__((aligned(4)));
+    uint32_t palette[SPLASH_MAX_COLORS];
+    uint32_t colors;
+
+    // Output cursor (image coordinates)
+    uint32_t width, height;
+    uint32_t x, y;
+
+    // Visible part of the image and where it lands on the surface
+    uint32_t vx0, vx1, vy0, vy1;
+    uint32_t *dst_origin;
+    uint32_t stride;
+    uint32_t *row;          // Surface pixel for image (vx0, y), or 0 if hidden
+
+    uint64_t deadline;      // 0 = no budget
+} splash_state_t;
+
+static splash_state_t state;
+
+static int splash_refill(splash_state_t *st) {
+    int n = st->reader->fill(st->reader->ctx, st->window, SPLASH_WINDOW_SIZE);
+    if (n <= 0) return -1;
+    st->pos = 0;
+    st->len = (uint32_t)n;
+    return 0;
+}
+
+static inline int splash_byte(splash_state_t *st) {
+    if (st->pos == st->len && splash_refill(st) != 0) {
+        return -1;
+    }
+    return st->window[st->pos++];
+}
+
+static int splash_u16(splash_state_t *st, uint32_t *out) {
+    int lo = splash_byte(st);
+    int hi = splash_byte(st);
+    if (lo < 0 || hi < 0) return SPLASH_ERR_IO;
+    *out = (uint32_t)lo | ((uint32_t)hi << 8);
+    return SPLASH_OK;
+}
+
+static void splash_start_row(splash_state_t *st) {
+    if (st->y >= st->vy0 && st->y < st->vy1) {
+        st->row = st->dst_origin + (st->y - st->vy0) * st->stride;
+    } else {
+        st->row = 0;
+    }
+}
+
+// Advance to the next row; checks the time budget once per row
+static int splash_next_row(splash_state_t *st) {
+    st->x = 0;
+    st->y++;
+    splash_start_row(st);
+
+    if (st->deadline && st->y < st->height && timer_get_ticks() > st->deadline) {
+        return SPLASH_ERR_BUDGET;
+    }
+    return SPLASH_OK;
+}
+
+// Write count pixels of one color, wrapping across rows
+static int splash_run(splash_state_t *st, uint32_t count, uint32_t color) {
+    while (count) {
+        if (st->y >= st->height) return SPLASH_ERR_FORMAT;
+
+        uint32_t n = st->width - st->x;
+        if (n > count) n = count;
+
+        if (st->row) {
+            uint32_t a = st->x > st->vx0 ? st->x : st->vx0;
+            uint32_t b = st->x + n < st->vx1 ? st->x + n : st->vx1;
+            uint32_t *p = st->row + (a - st->vx0);
+            for (uint32_t i = a; i < b; i++) {
+                *p++ = color;
+            }
+        }
+
+        st->x += n;
+        count -= n;
+        if (st->x == st->width) {
+            int rc = splash_next_row(st);
+            if (rc != SPLASH_OK) return rc;
+        }
+    }
+    return SPLASH_OK;
+}
+
+static int splash_literal(splash_state_t *st, uint32_t count) {
+    while (count--) {
+        int idx = splash_byte(st);
+        if (idx < 0) return SPLASH_ERR_IO;
+        if ((uint32_t)idx >= st->colors || st->y >= st->height) return SPLASH_ERR_FORMAT;
+
+        if (st->row && st->x >= st->vx0 && st->x < st->vx1) {
+            st->row[st->x - st->vx0] = st->palette[idx];
+        }
+
+        if (++st->x == st->width) {
+            int rc = splash_next_row(st);
+            if (rc != SPLASH_OK) return rc;
+        }
+    }
+    return SPLASH_OK;
+}
+
+// Center the image on the surface, clipping whichever side is larger
+static void splash_place(splash_state_t *st, const splash_surface_t *surface) {
+    uint32_t dx = 0, dy = 0;
+
+    st->vx0 = 0;
+    st->vx1 = st->width;
+    if (st->width > surface->width) {
+        st->vx0 = (st->width - surface->width) / 2;
+        st->vx1 = st->vx0 + surface->width;
+    } else {
+        dx = (surface->width - st->width) / 2;
+    }
+
+    st->vy0 = 0;
+    st->vy1 = st->height;
+    if (st->height > surface->height) {
+        st->vy0 = (st->height - surface->height) / 2;
+        st->vy1 = st->vy0 + surface->height;
+    } else {
+        dy = (surface->height - st->height) / 2;
+    }
+
+    st->stride = surface->stride;
+    st->dst_origin = surface->base + dy * surface->stride + dx;
+}
+
+int splash_decode(const splash_reader_t *reader, const splash_surface_t *surface,
+                  uint32_t budget_us) {
+    splash_state_t *st = &state;
+    st->reader = reader;
+    st->pos = 0;
+    st->len = 0;
+    st->deadline = budget_us ? timer_get_ticks() + budget_us : 0;
+
+    // Header
+    uint32_t magic = 0;
+    for (int i = 0; i < 4; i++) {
+        int b = splash_byte(st);
+        if (b < 0) return SPLASH_ERR_IO;
+        magic |= (uint32_t)b << (i * 8);
+    }
+
+    uint32_t version, flags, reserved;
+    if (magic != SPLASH_MAGIC) return SPLASH_ERR_FORMAT;
+    if (splash_u16(st, &version) || splash_u16(st, &flags) ||
+        splash_u16(st, &st->width) || splash_u16(st, &st->height) ||
+        splash_u16(st, &st->colors) || splash_u16(st, &reserved)) {
+        return SPLASH_ERR_IO;
+    }
+    if (version != SPLASH_VERSION || st->colors == 0 ||
+        st->colors > SPLASH_MAX_COLORS || st->width == 0 || st->height == 0) {
+        return SPLASH_ERR_FORMAT;
+    }
+
+    // Palette
+    for (uint32_t i = 0; i < st->colors; i++) {
+        uint32_t color = 0;
+        for (int j = 0; j < 4; j++) {
+            int b = splash_byte(st);
+            if (b < 0) return SPLASH_ERR_IO;
+            color |= (uint32_t)b << (j * 8);
+        }
+        st->palette[i] = color & 0x00FFFFFF;
+    }
+
+    splash_place(st, surface);
+    st->x = 0;
+    st->y = 0;
+    splash_start_row(st);
+
+    // Pixel stream
+    while (st->y < st->height) {
+        int op = splash_byte(st);
+        if (op < 0) return SPLASH_ERR_IO;
+
+        int rc;
+        if (op < 0x80) {
+            rc = splash_literal(st, (uint32_t)op + 1);
+        } else {
+            uint32_t count = (uint32_t)(op & 0x3F);
+            if (op >= 0xC0) {
+                int lo = splash_byte(st);
+                if (lo < 0) return SPLASH_ERR_IO;
+                count = (count << 8) | (uint32_t)lo;
+            }
+            int idx = splash_byte(st);
+            if (idx < 0) return SPLASH_ERR_IO;
+            if ((uint32_t)idx >= st->colors) return SPLASH_ERR_FORMAT;
+            rc = splash_run(st, count + 2, st->palette[idx]);
+        }
+        if (rc != SPLASH_OK) return rc;
+    }
+
+    return SPLASH_OK;
+}
+
+static void splash_fb_surface(splash_surface_t *surface) {
+    framebuffer_t *fb = fb_get_info();
+    surface->base = fb->buffer;
+    surface->width = fb->width;
+    surface->height = fb->height;
+    surface->stride = fb->pitch / 4;
+}
+
+// Reader over an in-memory image
+typedef struct {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t offset;
+} splash_mem_ctx_t;
+
+static int splash_mem_fill(void *ctx, uint8_t *buf, uint32_t max) {
+    splash_mem_ctx_t *mem = (splash_mem_ctx_t *)ctx;
+    uint32_t n = mem->size - mem->offset;
+    if (n > max) n = max;
+    for (uint32_t i = 0; i < n; i++) {
+        buf[i] = mem->data[mem->offset + i];
+    }
+    mem->offset += n;
+    return (int)n;
+}
+
+int splash_draw_mem(const uint8_t *data, uint32_t size, uint32_t budget_us) {
+    splash_mem_ctx_t ctx = { data, size, 0 };
+    splash_reader_t reader = { splash_mem_fill, &ctx };
+    splash_surface_t surface;
+
+    splash_fb_surface(&surface);
+    return splash_decode(&reader, &surface, budget_us);
+}
+
+// Reader over a file, through the block cache
+static int splash_file_fill(void *ctx, uint8_t *buf, uint32_t max) {
+    return fat_read((fat_file_t *)ctx, buf, max);
+}
+
+int splash_draw_file(fat_file_t *file, uint32_t budget_us) {
+    splash_reader_t reader = { splash_file_fill, file };
+    splash_surface_t surface;
+
+    splash_fb_surface(&surface);
+    return splash_decode(&reader, &surface, budget_us);
+}
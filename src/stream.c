@@ -0,0 +1,41 @@
+#include "stream.h"
+#include "memory.h"
+
+int stream_read(stream_t *s, uint8_t *dst, uint32_t len) {
+    while (len) {
+        int rc = stream_need(s);
+        if (rc) return rc;
+
+        uint32_t n = (uint32_t)(s->end - s->ptr);
+        if (n > len) n = len;
+        memcpy(dst, s->ptr, n);
+        s->ptr += n;
+        dst += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int stream_skip(stream_t *s, uint32_t len) {
+    while (len) {
+        int rc = stream_need(s);
+        if (rc) return rc;
+
+        uint32_t n = (uint32_t)(s->end - s->ptr);
+        if (n > len) n = len;
+        s->ptr += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int stream_le32(stream_t *s, uint32_t *value) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        int b = stream_byte(s);
+        if (b < 0) return b;
+        v |= (uint32_t)b << (i * 8);
+    }
+    *value = v;
+    return 0;
+}
@@ -12,10 +12,33 @@
 
 static uint64_t boot_time = 0;
 
+// Start the CPU cycle counter (reset and enable)
+static void timer_cycles_init(void) {
+#if defined(BCM2836) || defined(BCM2837)
+    // PMCR: E | C, then PMCNTENSET: cycle counter
+    asm volatile("mcr p15, 0, %0, c9, c12, 0" : : "r"(0x5));
+    asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r"(0x80000000));
+#else
+    // ARM1176 PMNC: E | C
+    asm volatile("mcr p15, 0, %0, c15, c12, 0" : : "r"(0x5));
+#endif
+}
+
 void timer_init(void) {
     // System timer runs at 1 MHz
     // Record boot time
     boot_time = timer_get_ticks();
+    timer_cycles_init();
+}
+
+uint32_t timer_get_cycles(void) {
+    uint32_t cycles;
+#if defined(BCM2836) || defined(BCM2837)
+    asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(cycles));
+#else
+    asm volatile("mrc p15, 0, %0, c15, c12, 1" : "=r"(cycles));
+#endif
+    return cycles;
 }
 
 uint64_t timer_get_ticks(void) {
@@ -1,6 +1,141 @@
 #include "uart.h"
+#include "format.h"
 #include "hardware.h"
-#include <stdarg.h>
+#include "irq.h"
+#include "mailbox.h"
+#include "memory.h"
+#include "timer.h"
+
+// Flag register bits
+#define UART_FR_BUSY    (1 << 3)
+#define UART_FR_RXFE    (1 << 4)
+#define UART_FR_TXFF    (1 << 5)
+
+// Interrupt bits (IMSC, MIS, ICR)
+#define UART_INT_RX     (1 << 4)
+#define UART_INT_TX     (1 << 5)
+#define UART_INT_RT     (1 << 6)
+#define UART_INT_OE     (1 << 10)
+
+#define UART_DR_OE      (1 << 11)   // Overrun, flagged on the next byte read
+
+// Control register bits
+#define UART_CR_UARTEN  (1 << 0)
+#define UART_CR_LBE     (1 << 7)
+#define UART_CR_TXE     (1 << 8)
+#define UART_CR_RXE     (1 << 9)
+#define UART_CR_ON      (UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE)
+
+// FIFOs on, 8 data bits, no parity, 1 stop bit
+#define UART_LCRH_8N1   ((1 << 4) | (1 << 5) | (1 << 6))
+
+#define UART_LOOPBACK_BYTES 256
+
+// FIFO levels: TX interrupt at 1/8 full, RX at 1/2 full
+#define UART_IFLS_TX_1_8    (0 << 0)
+#define UART_IFLS_RX_1_2    (2 << 3)
+
+// Rings: the producer only moves head and the consumer only moves tail,
+// both counting up and masked on access
+static uint8_t tx_ring[UART_TX_RING];
+static volatile uint32_t tx_head, tx_tail;
+static uint8_t rx_ring[UART_RX_RING];
+static volatile uint32_t rx_head, rx_tail;
+
+static uint32_t uart_clock = UART_CLOCK_HZ;
+static uint32_t uart_divisor;       // In 1/64ths, as IBRD:FBRD
+
+static int uart_irq_mode;           // Rings in use (else polled)
+static int uart_blocking;
+static uart_stats_t uart_stats;
+
+// One character of pushback: a polled uart_peek has to read the FIFO head
+// to see it and keeps it here
+static int uart_pushback = -1;
+
+static void uart_poll_putc(char c) {
+    while (MMIO_READ(UART0_FR) & UART_FR_TXFF) { }
+    MMIO_WRITE(UART0_DR, c);
+}
+
+// Move queued output into the TX FIFO until it fills (IRQs blocked). The
+// TX interrupt only fires when the FIFO drains past its level, so it is
+// left enabled just while the ring still holds something.
+static void uart_tx_fill(void) {
+    while (tx_tail != tx_head && !(MMIO_READ(UART0_FR) & UART_FR_TXFF)) {
+        MMIO_WRITE(UART0_DR, tx_ring[tx_tail & (UART_TX_RING - 1)]);
+        tx_tail++;
+    }
+
+    uint32_t imsc = MMIO_READ(UART0_IMSC);
+    if (tx_tail != tx_head) {
+        imsc |= UART_INT_TX;
+    } else {
+        imsc &= ~UART_INT_TX;
+    }
+    MMIO_WRITE(UART0_IMSC, imsc);
+}
+
+static void uart_tx_kick(void) {
+    uint32_t state = irq_save();
+    uart_tx_fill();
+    irq_restore(state);
+}
+
+static int uart_tx_push(char c) {
+    if (tx_head - tx_tail >= UART_TX_RING) {
+        // The FIFO may have room the interrupt has not claimed yet
+        uart_tx_kick();
+        while (uart_blocking && tx_head - tx_tail >= UART_TX_RING) uart_tx_kick();
+        if (tx_head - tx_tail >= UART_TX_RING) {
+            uart_stats.tx_dropped++;
+            return -1;
+        }
+    }
+    tx_ring[tx_head & (UART_TX_RING - 1)] = (uint8_t)c;
+    tx_head++;
+    return 0;
+}
+
+// Queue (or, before the rings are up, send) one character; callers kick
+// the transmitter once they are done
+static void uart_out(char c) {
+    if (uart_irq_mode) {
+        uart_tx_push(c);
+    } else {
+        uart_poll_putc(c);
+    }
+}
+
+static void uart_out_str(const char *str) {
+    while (*str) {
+        if (*str == '\n') {
+            uart_out('\r');
+        }
+        uart_out(*str++);
+    }
+}
+
+static void uart_rx_drain(void) {
+    while (!(MMIO_READ(UART0_FR) & UART_FR_RXFE)) {
+        uint32_t dr = MMIO_READ(UART0_DR);
+        if (dr & UART_DR_OE) uart_stats.rx_overruns++;
+        if (rx_head - rx_tail >= UART_RX_RING) {
+            uart_stats.rx_dropped++;
+            continue;
+        }
+        rx_ring[rx_head & (UART_RX_RING - 1)] = (uint8_t)dr;
+        rx_head++;
+    }
+}
+
+static void uart_irq(void) {
+    uint32_t mis = MMIO_READ(UART0_MIS);
+    MMIO_WRITE(UART0_ICR, mis);
+
+    if (mis & (UART_INT_RX | UART_INT_RT | UART_INT_OE)) uart_rx_drain();
+    if (mis & UART_INT_TX) uart_tx_fill();
+}
 
 void uart_init(void) {
     // Disable UART0
@@ -24,122 +159,310 @@ void uart_init(void) {
     // Clear pending interrupts
     MMIO_WRITE(UART0_ICR, 0x7FF);
 
-    // Set baud rate to 115200
-    // Assuming 3MHz UART clock: divider = 3000000 / (16 * 115200) = 1.627
-    MMIO_WRITE(UART0_IBRD, 1);
-    MMIO_WRITE(UART0_FBRD, 40);
+    // Set baud rate to 115200 from whatever clock the firmware gave the UART
+    uint32_t clock = mailbox_get_clock_rate(MBOX_CLOCK_UART);
+    if (clock) uart_clock = clock;
+    uart_divisor = (uart_clock * 4 + 115200 / 2) / 115200;
+    MMIO_WRITE(UART0_IBRD, uart_divisor >> 6);
+    MMIO_WRITE(UART0_FBRD, uart_divisor & 63);
 
     // Enable FIFO & 8 bit data transmission (1 stop bit, no parity)
-    MMIO_WRITE(UART0_LCRH, (1 << 4) | (1 << 5) | (1 << 6));
+    MMIO_WRITE(UART0_LCRH, UART_LCRH_8N1);
 
     // Enable UART0, receive & transfer
-    MMIO_WRITE(UART0_CR, (1 << 0) | (1 << 8) | (1 << 9));
+    MMIO_WRITE(UART0_CR, UART_CR_ON);
+
+    // Receive through the RX ring; TX is enabled while output is queued
+    tx_head = tx_tail = 0;
+    rx_head = rx_tail = 0;
+    MMIO_WRITE(UART0_IFLS, UART_IFLS_TX_1_8 | UART_IFLS_RX_1_2);
+    MMIO_WRITE(UART0_IMSC, UART_INT_RX | UART_INT_RT | UART_INT_OE);
+    irq_register(IRQ_UART0, uart_irq);
+    uart_irq_mode = 1;
+}
+
+// Divisor in 1/64ths for a rate, rounded: clock / (16 * baud) * 64;
+// 0 if it is out of range or the rate it gives is off by too much
+static uint32_t uart_divisor_for(uint32_t clock, uint32_t baud) {
+    if (baud == 0 || baud > clock / 16) return 0;
+    uint32_t div = (uint32_t)(((uint64_t)clock * 4 + baud / 2) / baud);
+    if ((div >> 6) > 0xFFFF) return 0;
+
+    uint32_t actual = (uint32_t)((uint64_t)clock * 4 / div);
+    uint32_t error = actual > baud ? actual - baud : baud - actual;
+    if ((uint64_t)error * 1000 > (uint64_t)baud * UART_BAUD_TOLERANCE) return 0;
+    return div;
+}
+
+// Program a divisor; the UART must be idle
+static void uart_apply_divisor(uint32_t div) {
+    uart_divisor = div;
+    MMIO_WRITE(UART0_CR, 0);
+    MMIO_WRITE(UART0_IBRD, div >> 6);
+    MMIO_WRITE(UART0_FBRD, div & 63);
+    // The divisor takes effect on the LCRH write
+    MMIO_WRITE(UART0_LCRH, UART_LCRH_8N1);
+    MMIO_WRITE(UART0_CR, UART_CR_ON);
+}
+
+int uart_set_baud(uint32_t baud) {
+    uint32_t clock = uart_clock;
+    uint32_t div = uart_divisor_for(clock, baud);
+
+    // Fast rates need a faster clock, which only the firmware can set
+    if (!div && baud > clock / 16 && baud <= UART_BAUD_MAX) {
+        uart_flush();
+        uint32_t raised = mailbox_set_clock_rate(MBOX_CLOCK_UART, UART_CLOCK_MAX_HZ);
+        if (raised && raised != clock) {
+            // Keep the current rate on the new clock in case this one fails
+            uint32_t keep = uart_divisor_for(raised, uart_get_baud());
+            uart_clock = clock = raised;
+            if (keep) uart_apply_divisor(keep);
+            div = uart_divisor_for(clock, baud);
+        }
+    }
+    if (!div) return UART_ERR_BAUD;
+
+    // Let the transmitter finish before the line changes speed
+    uart_flush();
+    uart_apply_divisor(div);
+    return 0;
+}
+
+uint32_t uart_get_baud(void) {
+    return uart_divisor ? (uint32_t)((uint64_t)uart_clock * 4 / uart_divisor) : 0;
+}
+
+uint32_t uart_get_clock(void) {
+    return uart_clock;
+}
+
+int uart_loopback_test(uint32_t *measured) {
+    *measured = 0;
+    uart_flush();
+
+    // Polled, with the interrupt held off so the handler cannot take the
+    // echoed bytes; input already waiting goes to the ring first
+    uint32_t state = irq_save();
+    uart_rx_drain();
+    MMIO_WRITE(UART0_CR, UART_CR_ON | UART_CR_LBE);
+
+    uint32_t sent = 0, received = 0, bad = 0;
+    uint64_t start = timer_get_ticks();
+    uint64_t limit = start + 1000 + (uint64_t)UART_LOOPBACK_BYTES * 10 * 2000000 /
+                                    (uart_get_baud() ? uart_get_baud() : 1);
+    while (received < UART_LOOPBACK_BYTES && timer_get_ticks() < limit) {
+        if (sent < UART_LOOPBACK_BYTES && !(MMIO_READ(UART0_FR) & UART_FR_TXFF)) {
+            MMIO_WRITE(UART0_DR, (sent * 37 + 11) & 0xFF);
+            sent++;
+        }
+        if (!(MMIO_READ(UART0_FR) & UART_FR_RXFE)) {
+            uint32_t dr = MMIO_READ(UART0_DR);
+            if ((dr & 0xFFF) != ((received * 37 + 11) & 0xFF)) bad++;
+            received++;
+        }
+    }
+    uint64_t us = timer_get_ticks() - start;
+
+    // Anything still in flight is discarded
+    while (MMIO_READ(UART0_FR) & UART_FR_BUSY) { }
+    while (!(MMIO_READ(UART0_FR) & UART_FR_RXFE)) (void)MMIO_READ(UART0_DR);
+    MMIO_WRITE(UART0_CR, UART_CR_ON);
+    MMIO_WRITE(UART0_ICR, 0x7FF);
+    irq_restore(state);
+
+    if (received < UART_LOOPBACK_BYTES || bad || us == 0) return UART_ERR_LOOPBACK;
+
+    // 10 bits a byte (start, 8 data, stop); the transmitter never idles
+    // since the FIFO is kept topped up
+    *measured = (uint32_t)((uint64_t)UART_LOOPBACK_BYTES * 10 * 1000000 / us);
+    uint32_t baud = uart_get_baud();
+    uint32_t error = *measured > baud ? *measured - baud : baud - *measured;
+    if ((uint64_t)error * 1000 > (uint64_t)baud * UART_BAUD_TOLERANCE) return UART_ERR_LOOPBACK;
+    return 0;
+}
+
+const char *uart_strerror(int err) {
+    switch (err) {
+        case UART_ERR_BAUD:         return "rate not available from the UART clock";
+        case UART_ERR_LOOPBACK:     return "loopback test failed";
+        default:                    return "unknown error";
+    }
 }
 
 void uart_putc(char c) {
-    // Wait for UART to become ready to transmit
-    while (MMIO_READ(UART0_FR) & (1 << 5)) { }
-    MMIO_WRITE(UART0_DR, c);
+    uart_out(c);
+    if (uart_irq_mode) uart_tx_kick();
 }
 
 void uart_puts(const char *str) {
-    while (*str) {
-        if (*str == '\n') {
-            uart_putc('\r');
-        }
-        uart_putc(*str++);
+    uart_out_str(str);
+    if (uart_irq_mode) uart_tx_kick();
+}
+
+int uart_try_putc(char c) {
+    if (!uart_irq_mode) {
+        uart_poll_putc(c);
+        return 0;
+    }
+    int blocking = uart_blocking;
+    uart_blocking = 0;
+    int rc = uart_tx_push(c);
+    uart_blocking = blocking;
+    uart_tx_kick();
+    return rc;
+}
+
+int uart_try_getc(void) {
+    if (uart_pushback >= 0) {
+        int c = uart_pushback;
+        uart_pushback = -1;
+        return c;
     }
+    if (!uart_irq_mode) {
+        if (MMIO_READ(UART0_FR) & UART_FR_RXFE) return -1;
+        return MMIO_READ(UART0_DR) & 0xFF;
+    }
+    if (rx_tail == rx_head) return -1;
+    int c = rx_ring[rx_tail & (UART_RX_RING - 1)];
+    rx_tail++;
+    return c;
+}
+
+uint32_t uart_read(void *buffer, uint32_t len) {
+    uint8_t *out = buffer;
+    uint32_t n = 0;
+
+    if (!uart_irq_mode || uart_pushback >= 0) {
+        int c;
+        while (n < len && (c = uart_try_getc()) >= 0) out[n++] = (uint8_t)c;
+        return n;
+    }
+
+    // Straight from the ring, in at most two runs
+    uint32_t tail = rx_tail;
+    uint32_t avail = rx_head - tail;
+    if (avail > len) avail = len;
+    while (n < avail) {
+        uint32_t at = (tail + n) & (UART_RX_RING - 1);
+        uint32_t run = UART_RX_RING - at;
+        if (run > avail - n) run = avail - n;
+        memcpy(out + n, &rx_ring[at], run);
+        n += run;
+    }
+    rx_tail = tail + n;
+    return n;
 }
 
 char uart_getc(void) {
-    // Wait for UART to have received something
-    while (MMIO_READ(UART0_FR) & (1 << 4)) { }
-    return MMIO_READ(UART0_DR) & 0xFF;
+    if (!uart_irq_mode) {
+        int c;
+        while ((c = uart_try_getc()) < 0) { }
+        return (char)c;
+    }
+
+    // Sleep until the receive interrupt has something; checking with IRQs
+    // blocked means one arriving just before the WFI still wakes it
+    uint32_t state = irq_save();
+    while (uart_pushback < 0 && rx_tail == rx_head) {
+        asm volatile("wfi");
+        irq_restore(state);
+        state = irq_save();
+    }
+    irq_restore(state);
+    return (char)uart_try_getc();
 }
 
 int uart_data_available(void) {
-    return !(MMIO_READ(UART0_FR) & (1 << 4));
+    if (uart_pushback >= 0) return 1;
+    if (!uart_irq_mode) return !(MMIO_READ(UART0_FR) & UART_FR_RXFE);
+    return rx_tail != rx_head;
 }
 
-// Simple printf implementation
-static void uart_print_int(int val) {
-    if (val == 0) {
-        uart_putc('0');
-        return;
+int uart_peek(uint32_t n) {
+    if (uart_pushback >= 0) {
+        if (n == 0) return uart_pushback;
+        n--;
     }
+    if (!uart_irq_mode) {
+        if (n > 0 || uart_pushback >= 0 || (MMIO_READ(UART0_FR) & UART_FR_RXFE)) return -1;
+        uart_pushback = MMIO_READ(UART0_DR) & 0xFF;
+        return uart_pushback;
+    }
+    if (n >= rx_head - rx_tail) return -1;
+    return rx_ring[(rx_tail + n) & (UART_RX_RING - 1)];
+}
 
-    char buffer[12];
-    int i = 0;
-    int is_negative = 0;
-
-    if (val < 0) {
-        is_negative = 1;
-        // Handle INT_MIN edge case safely
-        if (val == -2147483648) {
-            uart_puts("-2147483648");
+void uart_remove(uint32_t n) {
+    if (uart_pushback >= 0) {
+        if (n == 0) {
+            uart_pushback = -1;
             return;
         }
-        val = -val;
+        n--;
     }
+    if (!uart_irq_mode || n >= rx_head - rx_tail) return;
 
-    while (val > 0) {
-        buffer[i++] = '0' + (val % 10);
-        val /= 10;
+    // Close the gap by moving the bytes in front of it back one place; the
+    // interrupt only appends at the head, so the tail end is ours
+    uint32_t tail = rx_tail;
+    for (uint32_t i = tail + n; i != tail; i--) {
+        rx_ring[i & (UART_RX_RING - 1)] = rx_ring[(i - 1) & (UART_RX_RING - 1)];
     }
+    rx_tail = tail + 1;
+}
 
-    if (is_negative) {
-        uart_putc('-');
-    }
+void uart_set_blocking(int on) {
+    uart_blocking = on;
+}
 
-    while (i > 0) {
-        uart_putc(buffer[--i]);
-    }
+// Push the whole ring out by polling (IRQs blocked)
+static void uart_tx_drain(void) {
+    while (tx_tail != tx_head) uart_tx_fill();
+}
+
+void uart_flush(void) {
+    uint32_t state = irq_save();
+    uart_tx_drain();
+    while (MMIO_READ(UART0_FR) & UART_FR_BUSY) { }
+    irq_restore(state);
 }
 
-static void uart_print_hex(uint32_t val) {
-    uart_puts("0x");
-    for (int i = 7; i >= 0; i--) {
-        uint32_t nibble = (val >> (i * 4)) & 0xF;
-        uart_putc(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
+void uart_puts_sync(const char *str) {
+    uint32_t state = irq_save();
+    uart_tx_drain();
+    while (*str) {
+        if (*str == '\n') {
+            uart_poll_putc('\r');
+        }
+        uart_poll_putc(*str++);
     }
+    irq_restore(state);
+}
+
+void uart_shutdown(void) {
+    uart_flush();
+    MMIO_WRITE(UART0_IMSC, 0);
+    MMIO_WRITE(UART0_ICR, 0x7FF);
+    irq_unregister(IRQ_UART0);
+    uart_irq_mode = 0;
+}
+
+const uart_stats_t *uart_get_stats(void) {
+    return &uart_stats;
+}
+
+// Format into a stack buffer and queue the result in one go
+void uart_vprintf(const char *fmt, va_list args) {
+    char buffer[UART_PRINTF_MAX];
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    uart_out_str(buffer);
+    if (uart_irq_mode) uart_tx_kick();
 }
 
 void uart_printf(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-
-    while (*fmt) {
-        if (*fmt == '%') {
-            fmt++;
-            switch (*fmt) {
-                case 'd':
-                    uart_print_int(va_arg(args, int));
-                    break;
-                case 'x':
-                    uart_print_hex(va_arg(args, uint32_t));
-                    break;
-                case 's':
-                    uart_puts(va_arg(args, char*));
-                    break;
-                case 'c':
-                    uart_putc((char)va_arg(args, int));
-                    break;
-                case '%':
-                    uart_putc('%');
-                    break;
-                default:
-                    uart_putc('%');
-                    uart_putc(*fmt);
-                    break;
-            }
-        } else {
-            if (*fmt == '\n') {
-                uart_putc('\r');
-            }
-            uart_putc(*fmt);
-        }
-        fmt++;
-    }
-
+    uart_vprintf(fmt, args);
     va_end(args);
 }
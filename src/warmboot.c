@@ -0,0 +1,102 @@
+#include "warmboot.h"
+#include "hardware.h"
+#include "cache.h"
+#include "crc32.h"
+#include "memory.h"
+#include "timer.h"
+
+// PM register fields
+#define PM_RSTC_WRCFG_MASK  0x00000030
+#define PM_RSTC_FULL_RESET  0x00000020
+#define PM_WDOG_TICKS       10          // 16 us each
+
+#define warm_block ((warmboot_block_t *)WARMBOOT_BLOCK_ADDR)
+#define warm_cache ((uint8_t *)WARMBOOT_CACHE_ADDR)
+
+static uint32_t warmboot_block_crc(void) {
+    warmboot_block_t block = *warm_block;
+    block.crc = 0;
+    return crc32(0, &block, sizeof(block));
+}
+
+static void warmboot_seal(void) {
+    warm_block->crc = warmboot_block_crc();
+    cache_clean_range(warm_block, sizeof(warmboot_block_t));
+}
+
+int warmboot_save(uint32_t load_addr, const loader_stats_t *st, uint32_t handoff_addr,
+                  uint32_t handoff_size, const char *name, uint32_t bios_us) {
+    uint32_t image_size = st->top - load_addr;
+    if (image_size > WARMBOOT_CACHE_MAX || handoff_size > WARMBOOT_CACHE_MAX - image_size) {
+        warmboot_invalidate();
+        return WARMBOOT_ERR_TOOBIG;
+    }
+
+    memcpy(warm_cache, (const void *)load_addr, image_size);
+    if (handoff_size) memcpy(warm_cache + image_size, (const void *)handoff_addr, handoff_size);
+    cache_clean_range(warm_cache, image_size + handoff_size);
+
+    warmboot_block_t *b = warm_block;
+    memset(b, 0, sizeof(*b));
+    b->magic = WARMBOOT_MAGIC;
+    b->size = sizeof(*b);
+    b->load_addr = load_addr;
+    b->image_size = image_size;
+    b->image_crc = crc32(0, warm_cache, image_size + handoff_size);
+    b->entry = st->entry;
+    b->handoff_addr = handoff_size ? handoff_addr : 0;
+    b->handoff_size = handoff_size;
+    b->sig = st->sig;
+    b->cold_us = (uint32_t)timer_get_ticks();
+    b->cold_bios_us = bios_us;
+    strncpy(b->name, name, WARMBOOT_NAME_MAX - 1);
+    warmboot_seal();
+    return 0;
+}
+
+int warmboot_find(void) {
+    const warmboot_block_t *b = warm_block;
+    if (b->magic != WARMBOOT_MAGIC || b->size != sizeof(*b) || b->crc != warmboot_block_crc()) {
+        return 0;
+    }
+    if (b->image_size > WARMBOOT_CACHE_MAX ||
+        b->handoff_size > WARMBOOT_CACHE_MAX - b->image_size ||
+        crc32(0, warm_cache, b->image_size + b->handoff_size) != b->image_crc) {
+        return WARMBOOT_ERR_CHANGED;
+    }
+    return 1;
+}
+
+const warmboot_block_t *warmboot_restore(void) {
+    warmboot_block_t *b = warm_block;
+    memcpy((void *)b->load_addr, warm_cache, b->image_size);
+    if (b->handoff_size) {
+        memcpy((void *)b->handoff_addr, warm_cache + b->image_size, b->handoff_size);
+    }
+    b->warm_boots++;
+    warmboot_seal();
+    return b;
+}
+
+void warmboot_invalidate(void) {
+    warm_block->magic = 0;
+    cache_clean_range(warm_block, sizeof(warmboot_block_t));
+}
+
+void warmboot_reset(void) {
+    // Arm the watchdog for a full reset a few ticks from now
+    MMIO_WRITE(PM_WDOG, PM_PASSWORD | PM_WDOG_TICKS);
+    uint32_t rstc = MMIO_READ(PM_RSTC) & ~PM_RSTC_WRCFG_MASK;
+    MMIO_WRITE(PM_RSTC, PM_PASSWORD | (rstc & 0x00FFFFFF) | PM_RSTC_FULL_RESET);
+    while (1) {
+        asm volatile("wfi");
+    }
+}
+
+const char *warmboot_strerror(int err) {
+    switch (err) {
+        case WARMBOOT_ERR_TOOBIG:   return "image too large for the warm boot cache";
+        case WARMBOOT_ERR_CHANGED:  return "cached image changed";
+        default:                    return "unknown error";
+    }
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Host test harness for RETROS-BIOS unit tests
+Compiles BIOS sources from src/ together with a test main() and runs the
+result on the build machine
+"""
+
+import os
+import subprocess
+import tempfile
+
+REPO_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# The BIOS has its own libc subset, so the test program must not pull in
+# <string.h> or <stdio.h>: memory.h and format.h declare the same names
+# with 32-bit sizes. The memory functions below stand in for src/memory.c,
+# whose heap needs the linker script.
+PRELUDE = """
+#include <stdint.h>
+#include <stdarg.h>
+#include <assert.h>
+
+int printf(const char *fmt, ...);
+
+void *memset(void *s, int c, uint32_t n) {
+    uint8_t *p = (uint8_t *)s;
+    while (n--) *p++ = (uint8_t)c;
+    return s;
+}
+
+void *memcpy(void *dest, const void *src, uint32_t n) {
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    while (n--) *d++ = *s++;
+    return dest;
+}
+
+int memcmp(const void *s1, const void *s2, uint32_t n) {
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+    for (; n--; p1++, p2++) {
+        if (*p1 != *p2) return *p1 - *p2;
+    }
+    return 0;
+}
+
+uint32_t strlen(const char *s) {
+    uint32_t len = 0;
+    while (s[len]) len++;
+    return len;
+}
+
+int strcmp(const char *s1, const char *s2) {
+    while (*s1 && *s1 == *s2) {
+        s1++;
+        s2++;
+    }
+    return *(const uint8_t *)s1 - *(const uint8_t *)s2;
+}
+"""
+
+
+def c_array(name, data):
+    """C definition of a const byte array holding data"""
+    body = ",".join("0x%02x" % b for b in data)
+    return "static const uint8_t %s[%d] = {%s};\n" % (name, max(len(data), 1), body)
+
+
+def create_test_program(support, test_code):
+    """Create a test program around the BIOS sources under test"""
+    return f"""{PRELUDE}
+{support}
+
+int main(void) {{
+{test_code}
+    return 0;
+}}
+"""
+
+
+def run_test(test_name, sources, test_code, support=""):
+    """Compile test_code with sources (paths relative to the repo) and run it"""
+    print(f"Running {test_name}...", end=" ", flush=True)
+
+    with tempfile.NamedTemporaryFile(mode='w', suffix='.c', delete=False) as f:
+        f.write(create_test_program(support, test_code))
+        source_file = f.name
+    output_file = source_file[:-2]
+
+    try:
+        # -fno-builtin: the BIOS declarations differ from the libc builtins
+        result = subprocess.run(
+            ['gcc', '-std=gnu99', '-O2', '-fno-builtin',
+             '-I', os.path.join(REPO_DIR, 'include'),
+             '-o', output_file, source_file] +
+            [os.path.join(REPO_DIR, s) for s in sources],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print("FAIL (compilation)")
+            print(result.stderr)
+            return False
+
+        result = subprocess.run([output_file], capture_output=True, text=True)
+
+        if result.returncode != 0:
+            print("FAIL (runtime)")
+            print(result.stdout + result.stderr)
+            return False
+
+        print("PASS")
+        return True
+
+    finally:
+        for path in (source_file, output_file):
+            try:
+                os.unlink(path)
+            except OSError:
+                pass
+
+
+def run_suite(title, sources, tests, support=""):
+    """Run (name, code) tests against sources; returns the exit status"""
+    print("=" * 50)
+    print(f"RETROS-BIOS {title}")
+    print("=" * 50)
+    print()
+
+    tests_passed = 0
+    tests_failed = 0
+    for name, code in tests:
+        if run_test(name, sources, code, support):
+            tests_passed += 1
+        else:
+            tests_failed += 1
+
+    print()
+    print("=" * 50)
+    print(f"Passed: {tests_passed}")
+    print(f"Failed: {tests_failed}")
+    print("=" * 50)
+
+    return 0 if tests_failed == 0 else 1
@@ -0,0 +1,40 @@
+#!/bin/bash
+# SD card integration test under QEMU
+# Boots the BIOS on an emulated Raspberry Pi with a generated disk image
+# and checks the UART log for card identification and the boot sector read.
+# Skipped when the matching qemu-system-arm is not installed.
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+cd "$SCRIPT_DIR/.."
+
+TARGET=${TARGET:-BCM2836}
+TIMEOUT=${TIMEOUT:-30}
+LOG=build/qemu_sd.log
+
+if ! command -v qemu-system-arm &> /dev/null; then
+    echo "SKIP: qemu-system-arm not installed"
+    exit 0
+fi
+
+make TARGET="$TARGET" disk all > /dev/null || exit 1
+
+timeout "$TIMEOUT" make -s TARGET="$TARGET" qemu QEMU_FLAGS="-display none" \
+    < /dev/null > "$LOG" 2>&1
+
+FAILED=0
+# Log lines look like "[    0.412733] I sd: SDHC/SDXC, 64 MB, ..."
+for pattern in "I sd: " "Kernel image found"; do
+    if grep -q "$pattern" "$LOG"; then
+        echo "PASS: $pattern"
+    else
+        echo "FAIL: $pattern"
+        FAILED=1
+    fi
+done
+
+if grep -q "^\[.*\] E " "$LOG"; then
+    grep "^\[.*\] E " "$LOG"
+    FAILED=1
+fi
+
+exit $FAILED
@@ -53,10 +53,11 @@ if make clean > /dev/null 2>&1 && make TARGET=BCM2835 > /dev/null 2>&1; then
     print_test "BCM2835 build" "PASS"
     SIZE=$(stat -f%z build/kernel.img 2>/dev/null || stat -c%s build/kernel.img 2>/dev/null)
     echo "  Binary size: $SIZE bytes"
-    if [ "$SIZE" -lt 100000 ]; then
-        print_test "BCM2835 binary size reasonable (<100KB)" "PASS"
+    # Budget: 192 KB (see FEATURES.md, Memory Usage)
+    if [ "$SIZE" -le 196608 ]; then
+        print_test "BCM2835 binary size within budget (<=192KB)" "PASS"
     else
-        print_test "BCM2835 binary size reasonable (<100KB)" "FAIL"
+        print_test "BCM2835 binary size within budget (<=192KB)" "FAIL"
     fi
 else
     print_test "BCM2835 build" "FAIL"
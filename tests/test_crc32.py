@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+"""
+Unit tests for RETROS-BIOS CRC-32 (src/crc32.c)
+Checks the slice-by-8 code against the standard CRC-32 on the host
+"""
+
+import zlib
+
+from hosttest import c_array, run_suite
+
+SOURCES = ["src/crc32.c"]
+
+DATA = bytes((i * 7 + 3) & 0xFF for i in range(1000))
+
+TESTS = [
+    ("CRC-32 check value", """
+    assert(crc32(0, "123456789", 9) == 0xCBF43926u);
+    assert(crc32(0, "", 0) == 0);
+    assert(crc32(0xCBF43926u, "", 0) == 0xCBF43926u);
+"""),
+
+    ("CRC-32 continued and unaligned", "    " + c_array("data", DATA) + """
+    static const uint32_t splits[] = { 0, 1, 3, 4, 5, 63, 500, 999, 1000 };
+    for (int i = 0; i < 9; i++) {
+        uint32_t crc = crc32(0, data, splits[i]);
+        assert(crc32(crc, data + splits[i], 1000 - splits[i]) == 0x%08Xu);
+    }
+    for (int i = 1; i < 8; i++) {
+        assert(crc32(0, data + i, 1000 - i) == crc32(crc32(0, data + i, 1), data + i + 1, 999 - i));
+    }
+    assert(crc32(0, data + 1, 999) == 0x%08Xu);
+""" % (zlib.crc32(DATA), zlib.crc32(DATA[1:]))),
+]
+
+
+def main():
+    return run_suite("CRC-32 Tests", SOURCES, TESTS)
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+Unit tests for RETROS-BIOS verified boot hashing and signatures
+(src/sha256.c, src/sha512.c, src/ed25519.c)
+Checks known-answer vectors on the host
+"""
+
+import hashlib
+import os
+import sys
+
+from hosttest import REPO_DIR, c_array, run_suite
+
+sys.path.insert(0, os.path.join(REPO_DIR, "tools"))
+import sign_image  # noqa: E402  (reference Ed25519 signer)
+
+SOURCES = ["src/sha256.c", "src/sha512.c", "src/ed25519.c"]
+
+SUPPORT = """
+#include "sha256.h"
+#include "sha512.h"
+#include "ed25519.h"
+
+// Hash data fed to update() in pieces of the given sizes, cycling
+static void sha256_pieces(const uint8_t *data, uint32_t len, uint8_t *digest) {
+    static const uint32_t sizes[] = { 1, 63, 64, 65, 3, 128, 7 };
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    for (uint32_t i = 0, n; len; i++, data += n, len -= n) {
+        n = sizes[i % 7] < len ? sizes[i % 7] : len;
+        sha256_update(&ctx, data, n);
+    }
+    sha256_final(&ctx, digest);
+}
+
+static void sha512_pieces(const uint8_t *data, uint32_t len, uint8_t *digest) {
+    static const uint32_t sizes[] = { 1, 127, 128, 129, 3, 256, 7 };
+    sha512_ctx_t ctx;
+    sha512_init(&ctx);
+    for (uint32_t i = 0, n; len; i++, data += n, len -= n) {
+        n = sizes[i % 7] < len ? sizes[i % 7] : len;
+        sha512_update(&ctx, data, n);
+    }
+    sha512_final(&ctx, digest);
+}
+"""
+
+DATA = bytes((i * 7 + 3) & 0xFF for i in range(1000))
+
+# RFC 8032 section 7.1, tests 1-3: public key, message, signature
+ED25519_VECTORS = [
+    ("d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+     "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bac"
+     "c61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"),
+    ("3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+     "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e"
+     "458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"),
+    ("fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025", "af82",
+     "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290"
+     "ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"),
+]
+
+# Signature over DATA from the signer used for boot images
+SEED = bytes(range(32))
+PUB = sign_image.public_key(SEED)
+SIG = sign_image.sign(SEED, DATA)
+
+
+def flip(data, index):
+    data = bytearray(data)
+    data[index] ^= 1
+    return bytes(data)
+
+
+def non_canonical(sig):
+    """Same signature with S replaced by S + L, which must be rejected"""
+    s = int.from_bytes(sig[32:], "little") + sign_image.L
+    return sig[:32] + s.to_bytes(32, "little")
+
+
+def verify(sig, msg, pub, result):
+    return ("    {\n" +
+            "        " + c_array("sig", sig) +
+            "        " + c_array("msg", msg) +
+            "        " + c_array("pub", pub) +
+            "        if (ed25519_verify(sig, msg, %d, pub) != %d) return 1;\n" % (len(msg), result) +
+            "    }\n")
+
+
+def rfc8032_vectors():
+    code = ""
+    for pub, msg, sig in ED25519_VECTORS:
+        code += verify(bytes.fromhex(sig), bytes.fromhex(msg), bytes.fromhex(pub), 0)
+    return code
+
+
+TESTS = [
+    ("SHA-256 vectors", "    uint8_t digest[SHA256_DIGEST_SIZE];\n" + "".join(
+        "    " + c_array("want%d" % i, hashlib.sha256(m).digest()) +
+        "    sha256(\"%s\", %d, digest);\n" % (m.decode(), len(m)) +
+        "    assert(memcmp(digest, want%d, sizeof(digest)) == 0);\n" % i
+        for i, m in enumerate([b"", b"abc",
+                               b"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"])) + """
+    static uint8_t a[1000];
+    memset(a, 'a', sizeof(a));
+    sha256_ctx_t ctx;
+    sha256_init(&ctx);
+    for (int i = 0; i < 1000; i++) sha256_update(&ctx, a, sizeof(a));
+    sha256_final(&ctx, digest);
+""" + "    " + c_array("million", hashlib.sha256(b"a" * 1000000).digest()) + """
+    assert(memcmp(digest, million, sizeof(digest)) == 0);
+"""),
+
+    ("SHA-256 split updates", "    " + c_array("data", DATA) +
+     "    " + c_array("want", hashlib.sha256(DATA).digest()) + """
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_pieces(data, sizeof(data), digest);
+    assert(memcmp(digest, want, sizeof(digest)) == 0);
+    sha256(data, sizeof(data), digest);
+    assert(memcmp(digest, want, sizeof(digest)) == 0);
+"""),
+
+    ("SHA-512 vectors", "    " + c_array("data", DATA) +
+     "    " + c_array("abc", hashlib.sha512(b"abc").digest()) +
+     "    " + c_array("want", hashlib.sha512(DATA).digest()) + """
+    uint8_t digest[SHA512_DIGEST_SIZE];
+    sha512_pieces((const uint8_t *)"abc", 3, digest);
+    assert(memcmp(digest, abc, sizeof(digest)) == 0);
+    sha512_pieces(data, sizeof(data), digest);
+    assert(memcmp(digest, want, sizeof(digest)) == 0);
+"""),
+
+    ("Ed25519 RFC 8032 vectors", rfc8032_vectors()),
+
+    ("Ed25519 image-sized message", verify(SIG, DATA, PUB, 0)),
+
+    ("Ed25519 rejects forgeries",
+     verify(flip(SIG, 0), DATA, PUB, -1) +         # R changed
+     verify(flip(SIG, 40), DATA, PUB, -1) +        # S changed
+     verify(SIG, flip(DATA, 999), PUB, -1) +       # Message changed
+     verify(SIG, DATA, flip(PUB, 5), -1) +         # Other key
+     verify(non_canonical(SIG), DATA, PUB, -1)),   # S + L
+]
+
+
+def main():
+    return run_suite("Verified Boot Crypto Tests", SOURCES, TESTS, SUPPORT)
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+Unit tests for RETROS-BIOS image decoders (src/lz4.c, src/inflate.c)
+Decodes known LZ4 and gzip/DEFLATE streams on the host
+"""
+
+import gzip
+import io
+import struct
+import zlib
+
+from hosttest import c_array, run_suite
+
+SOURCES = ["src/lz4.c", "src/inflate.c", "src/stream.c", "src/crc32.c"]
+
+# Every stream is decoded several times, handed out in chunks of 1, 3 and
+# 64 bytes and in one piece, so headers, lengths and matches straddle
+# fill() calls the way they do when reading from the card
+SUPPORT = """
+#include "lz4.h"
+#include "inflate.h"
+
+typedef int (*decode_fn)(stream_t *s, uint8_t *dst, uint32_t max, uint32_t *out_len);
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t offset;
+    uint32_t chunk;
+} chunk_input_t;
+
+static int chunk_fill(stream_t *s) {
+    chunk_input_t *in = (chunk_input_t *)s->ctx;
+    uint32_t n = in->size - in->offset;
+    if (n > in->chunk) n = in->chunk;
+    s->ptr = in->data + in->offset;
+    s->end = s->ptr + n;
+    in->offset += n;
+    return (int)n;
+}
+
+static uint8_t out[16384];
+
+// Decode with every chunk size; returns the result, or 1 if they disagree
+static int decode(decode_fn fn, const uint8_t *data, uint32_t size, uint32_t max,
+                  uint32_t *out_len) {
+    const uint32_t chunks[] = { 1, 3, 64, size };
+    int first = 0;
+    for (int i = 0; i < 4; i++) {
+        chunk_input_t in = { data, size, 0, chunks[i] ? chunks[i] : 1 };
+        stream_t s = { 0, 0, chunk_fill, &in };
+        memset(out, 0xEE, sizeof(out));
+        int rc = fn(&s, out, max, out_len);
+        if (i == 0) {
+            first = rc;
+        } else if (rc != first) {
+            printf("chunk size %u: %d, chunk size 1: %d\\n", chunks[i], rc, first);
+            return 1;
+        }
+    }
+    return first;
+}
+
+// Expect the stream to decode to plain
+static int expect(decode_fn fn, const uint8_t *data, uint32_t size,
+                  const uint8_t *plain, uint32_t plain_size) {
+    uint32_t len = 0;
+    int rc = decode(fn, data, size, sizeof(out), &len);
+    if (rc != 0 || len != plain_size || memcmp(out, plain, plain_size) != 0) {
+        printf("rc %d, %u bytes, expected %u\\n", rc, len, plain_size);
+        return 1;
+    }
+    return 0;
+}
+
+// Expect decoding into max bytes to fail with error
+static int expect_error(decode_fn fn, const uint8_t *data, uint32_t size,
+                        uint32_t max, int error) {
+    uint32_t len = 0;
+    int rc = decode(fn, data, size, max, &len);
+    if (rc != error || len > max) {
+        printf("rc %d (%u bytes), expected %d\\n", rc, len, error);
+        return 1;
+    }
+    return 0;
+}
+"""
+
+PLAIN = b"RETROS-BIOS " * 8 + bytes(range(0, 256, 3)) + b"a" * 300 + b"end\n"
+
+TEXT = "".join("[%5u.%06u] I boot: block %u of %s read\n" % (i, i * 7919 % 1000000, i, n)
+               for i, n in zip(range(160), ["kernel.img", "initrd", "retros.cfg"] * 60)).encode()
+
+# PLAIN compressed by the reference lz4 tool: "lz4" (frame, content
+# checksum), "lz4 -BX --content-size" (block checksums and content size)
+# and "lz4 -l" (legacy, as used for kernels)
+LZ4_FRAME = bytes.fromhex(
+    "04224d186440a774000000cf524554524f532d42494f53200c0041ff4900"
+    "0306090c0f1215181b1e2124272a2d303336393c3f4245484b4e5154575a"
+    "5d606366696c6f7275787b7e8184878a8d909396999c9fa2a5a8abaeb1b4"
+    "b7babdc0c3c6c9cccfd2d5d8dbdee1e4e7eaedf0f3f6f9fcff61610200ff"
+    "175061656e640a000000004744ca9d")
+
+LZ4_FRAME_CHECKED = bytes.fromhex(
+    "04224d187c40e601000000000000fc74000000cf524554524f532d42494f"
+    "53200c0041ff49000306090c0f1215181b1e2124272a2d303336393c3f42"
+    "45484b4e5154575a5d606366696c6f7275787b7e8184878a8d909396999c"
+    "9fa2a5a8abaeb1b4b7babdc0c3c6c9cccfd2d5d8dbdee1e4e7eaedf0f3f6"
+    "f9fcff61610200ff175061656e640a9a88953e000000004744ca9d")
+
+LZ4_LEGACY = bytes.fromhex(
+    "02214c1874000000cf524554524f532d42494f53200c0041ff4900030609"
+    "0c0f1215181b1e2124272a2d303336393c3f4245484b4e5154575a5d6063"
+    "66696c6f7275787b7e8184878a8d909396999c9fa2a5a8abaeb1b4b7babd"
+    "c0c3c6c9cccfd2d5d8dbdee1e4e7eaedf0f3f6f9fcff61610200ff175061"
+    "656e640a")
+
+# Frame holding one stored (uncompressed) block
+LZ4_STORED = (struct.pack("<IBBB", 0x184D2204, 0x60, 0x40, 0) +
+              struct.pack("<I", 0x80000000 | 5) + b"hello" + struct.pack("<I", 0))
+
+LZ4_SKIPPABLE = struct.pack("<II", 0x184D2A53, 5) + b"skip!"
+
+
+def gzip_member(data, level=9, strategy=zlib.Z_DEFAULT_STRATEGY):
+    c = zlib.compressobj(level, zlib.DEFLATED, 31, 9, strategy)
+    return c.compress(data) + c.flush()
+
+
+def gzip_named(data):
+    buf = io.BytesIO()
+    with gzip.GzipFile(filename="kernel.img", mode="wb", fileobj=buf, mtime=0) as f:
+        f.write(data)
+    return buf.getvalue()
+
+
+def deflate_raw(data):
+    c = zlib.compressobj(9, zlib.DEFLATED, -15)
+    return c.compress(data) + c.flush()
+
+
+def flip(data, index):
+    data = bytearray(data)
+    data[index] ^= 1
+    return bytes(data)
+
+
+def decodes(fn, data, plain):
+    return ("    " + c_array("in", data) + "    " + c_array("plain", plain) +
+            "    if (expect(%s, in, %d, plain, %d)) return 1;\n" % (fn, len(data), len(plain)))
+
+
+def fails(fn, data, error, max_size=None):
+    max_arg = "sizeof(out)" if max_size is None else str(max_size)
+    return ("    " + c_array("in", data) +
+            "    if (expect_error(%s, in, %d, %s, %s)) return 1;\n" % (fn, len(data), max_arg, error))
+
+
+TESTS = [
+    ("LZ4 frame", decodes("lz4_decode", LZ4_FRAME, PLAIN)),
+    ("LZ4 frame with checksums and content size",
+     decodes("lz4_decode", LZ4_FRAME_CHECKED, PLAIN)),
+    ("LZ4 legacy", decodes("lz4_decode", LZ4_LEGACY, PLAIN)),
+    ("LZ4 stored block", decodes("lz4_decode", LZ4_STORED, b"hello")),
+    ("LZ4 concatenated and skippable frames",
+     decodes("lz4_decode", LZ4_FRAME + LZ4_SKIPPABLE + LZ4_STORED + LZ4_FRAME_CHECKED,
+             PLAIN + b"hello" + PLAIN)),
+    ("LZ4 truncated", fails("lz4_decode", LZ4_FRAME[:-20], "STREAM_ERR_EOF")),
+    ("LZ4 bad magic", fails("lz4_decode", flip(LZ4_FRAME, 0), "STREAM_ERR_FORMAT")),
+    ("LZ4 match before start of output",
+     fails("lz4_decode", struct.pack("<II", 0x184C2102, 3) + b"\x00\x01\x00",
+           "STREAM_ERR_FORMAT")),
+    ("LZ4 output overflow",
+     fails("lz4_decode", LZ4_LEGACY, "STREAM_ERR_OVERFLOW", len(PLAIN) - 1)),
+
+    ("gzip stored blocks", decodes("gzip_decode", gzip_member(PLAIN, 0), PLAIN)),
+    ("gzip fixed Huffman",
+     decodes("gzip_decode", gzip_member(TEXT, 9, zlib.Z_FIXED), TEXT)),
+    ("gzip dynamic Huffman", decodes("gzip_decode", gzip_member(TEXT), TEXT)),
+    ("gzip with file name", decodes("gzip_decode", gzip_named(PLAIN), PLAIN)),
+    ("gzip multiple members",
+     decodes("gzip_decode", gzip_member(TEXT) + gzip_member(PLAIN, 1), TEXT + PLAIN)),
+    ("Raw DEFLATE", decodes("inflate_raw", deflate_raw(TEXT), TEXT)),
+    ("gzip CRC-32 mismatch",
+     fails("gzip_decode", flip(gzip_member(TEXT), -8), "STREAM_ERR_CHECK")),
+    ("gzip length mismatch",
+     fails("gzip_decode", flip(gzip_member(TEXT), -4), "STREAM_ERR_CHECK")),
+    ("gzip truncated", fails("gzip_decode", gzip_member(TEXT)[:-30], "STREAM_ERR_EOF")),
+    ("gzip bad magic", fails("gzip_decode", flip(gzip_member(TEXT), 1), "STREAM_ERR_FORMAT")),
+    ("DEFLATE reserved block type", fails("inflate_raw", b"\x07\x00", "STREAM_ERR_FORMAT")),
+    ("gzip output overflow",
+     fails("gzip_decode", gzip_member(TEXT), "STREAM_ERR_OVERFLOW", len(TEXT) - 1)),
+]
+
+
+def main():
+    return run_suite("Decoder Tests", SOURCES, TESTS, SUPPORT)
+
+
+if __name__ == "__main__":
+    exit(main())
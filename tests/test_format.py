@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+Unit tests for RETROS-BIOS formatted output (src/format.c)
+Runs vsnprintf/snprintf on the host against known output
+"""
+
+from hosttest import run_suite
+
+SOURCES = ["src/format.c"]
+
+# check() formats through vsnprintf into a roomy buffer and compares both
+# the text and the returned length
+SUPPORT = """
+#include "format.h"
+
+static int failures;
+
+static void check(const char *expect, const char *fmt, ...) {
+    char buf[128];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n != (int)strlen(expect) || strcmp(buf, expect) != 0) {
+        printf("\\n  \\"%s\\": got \\"%s\\" (%d), expected \\"%s\\"", fmt, buf, n, expect);
+        failures++;
+    }
+}
+"""
+
+TESTS = [
+    ("%d and %i", """
+    check("0", "%d", 0);
+    check("42 -7", "%i %i", 42, -7);
+    check("-2147483648", "%d", (int32_t)0x80000000);
+    check("2147483647", "%d", 2147483647);
+    if (failures) return 1;
+"""),
+
+    ("%u", """
+    check("0", "%u", 0u);
+    check("4294967295", "%u", 4294967295u);
+    check("-1 4294967295", "%d %u", -1, -1);
+    if (failures) return 1;
+"""),
+
+    ("%x and %X", """
+    check("deadbeef", "%x", 0xdeadbeefu);
+    check("ABC", "%X", 0xabcu);
+    check("0", "%x", 0u);
+    check("0xff 0XFF", "%#x %#X", 255u, 255u);
+    check("0x%08X", "0x%%08X", 0u);
+    check("0x0000BEEF", "0x%08X", 0xbeefu);
+    if (failures) return 1;
+"""),
+
+    ("64-bit (ll)", """
+    check("18446744073709551615", "%llu", 18446744073709551615ull);
+    check("-9223372036854775808", "%lld", (long long)0x8000000000000000ull);
+    check("4294967296", "%llu", 4294967296ull);
+    check("123456789abcdef", "%llx", 0x123456789abcdefull);
+    if (failures) return 1;
+"""),
+
+    ("Width and flags", """
+    check("   42|42   |00042", "%5d|%-5d|%05d", 42, 42, 42);
+    check("  -42|-0042", "%5d|%05d", -42, -42);
+    check("+5  5", "%+d % d", 5, 5);
+    check("    -3|-3    ", "%*d|%-*d", 6, -3, 6, -3);
+    check("    1234|00001234|1234    ", "%8x|%08x|%-8x", 0x1234u, 0x1234u, 0x1234u);
+    check("2", "%1d", 2);
+    if (failures) return 1;
+"""),
+
+    ("Precision", """
+    check("007|     007|007     ", "%.3d|%8.3d|%-8.3d", 7, 7, 7);
+    check("-007", "%.3d", -7);
+    check("|", "%.0d|", 0);
+    check("00012", "%.*d", 5, 12);
+    check("00001234", "%.8x", 0x1234u);
+    if (failures) return 1;
+"""),
+
+    ("%s", """
+    check("hi", "%s", "hi");
+    check("        hi|hi        ", "%10s|%-10s", "hi", "hi");
+    check("he|hello", "%.2s|%.9s", "hello", "hello");
+    check("   x|y   ", "%*s|%-*s", 4, "x", 4, "y");
+    check("(null)", "%s", (const char *)0);
+    check("", "%s", "");
+    if (failures) return 1;
+"""),
+
+    ("%c, %% and %p", """
+    check("ab    c|d  |", "%c%c%5c|%-3c|", 'a', 'b', 'c', 'd');
+    check("100%", "%d%%", 100);
+    check("0x00001234", "%p", (void *)0x1234);
+    check("0xdeadbeef", "%p", (void *)0xdeadbeef);
+    if (failures) return 1;
+"""),
+
+    ("Truncation and return value", """
+    char buf[8];
+
+    // Cut short: NUL-terminated within size, returns the full length
+    memset(buf, '#', sizeof(buf));
+    assert(snprintf(buf, sizeof(buf), "%s", "0123456789") == 10);
+    assert(strcmp(buf, "0123456") == 0);
+
+    memset(buf, '#', sizeof(buf));
+    assert(snprintf(buf, 4, "%d", -123456) == 7);
+    assert(strcmp(buf, "-12") == 0);
+    assert(buf[4] == '#');
+
+    // Exactly fitting output
+    assert(snprintf(buf, sizeof(buf), "%07u", 42u) == 7);
+    assert(strcmp(buf, "0000042") == 0);
+
+    // Size 1 leaves just the terminator, size 0 writes nothing
+    memset(buf, '#', sizeof(buf));
+    assert(snprintf(buf, 1, "abc") == 3);
+    assert(buf[0] == 0 && buf[1] == '#');
+    memset(buf, '#', sizeof(buf));
+    assert(snprintf(buf, 0, "abc%d", 12) == 5);
+    assert(buf[0] == '#');
+    assert(snprintf((char *)0, 0, "%x", 0xabcdu) == 4);
+"""),
+]
+
+
+def main():
+    return run_suite("Format Tests", SOURCES, TESTS, SUPPORT)
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""
+Generate integer-scaled glyph atlases from src/font.c
+
+Each glyph row of the 8x16 font is expanded horizontally so the
+framebuffer blitter can write a whole scaled row from a single lookup:
+  2x -> 16-bit rows, 3x -> 24-bit rows (stored in uint32_t)
+The most significant used bit is the leftmost pixel.
+
+Usage: mkatlas.py src/font.c build/font_atlas.c
+"""
+
+import re
+import sys
+
+FIRST = 0x20
+COUNT = 0x7F - FIRST  # printable ASCII
+SCALES = {2: "uint16_t", 3: "uint32_t"}
+
+
+def parse_font(path):
+    text = open(path).read()
+    body = text[text.index("font8x16"):]
+    glyphs = []
+    for match in re.finditer(r"\{([^{}]*)\}", body):
+        values = [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", match.group(1))]
+        if len(values) == 16:
+            glyphs.append(values)
+    if len(glyphs) < FIRST + COUNT:
+        raise SystemExit("mkatlas: only %d glyphs found in %s" % (len(glyphs), path))
+    return glyphs
+
+
+def expand(row, scale):
+    out = 0
+    for col in range(8):
+        bit = (row >> (7 - col)) & 1
+        for _ in range(scale):
+            out = (out << 1) | bit
+    return out
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit(__doc__)
+    glyphs = parse_font(sys.argv[1])
+
+    lines = [
+        "// Generated by tools/mkatlas.py from src/font.c - do not edit",
+        "#include \"font.h\"",
+        "",
+    ]
+    for scale, ctype in SCALES.items():
+        digits = (8 * scale + 3) // 4
+        lines.append("const %s font_atlas_%dx[FONT_ATLAS_COUNT][16] = {" % (ctype, scale))
+        for code in range(FIRST, FIRST + COUNT):
+            rows = ", ".join("0x%0*X" % (digits, expand(r, scale)) for r in glyphs[code])
+            lines.append("    {%s}," % rows)
+        lines.append("};")
+        lines.append("")
+
+    with open(sys.argv[2], "w") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+Generate a raw SD card image for testing under QEMU
+
+Block 0 is a boot sector carrying the given signature string and the
+0x55AA marker; every following block is filled with its own LBA as
+little-endian 32-bit words, so reads can be checked for the right
+block in the right place. QEMU's SD emulation needs a power-of-two size.
+
+With -k the image is written from block 2048 (1 MiB) and the boot sector
+records its first block and size after the signature (bytes 24 and 28),
+which the BIOS loads when no FAT volume is found.
+
+Usage: mkdisk.py [-s SIZE_MB] [-t SIGNATURE] [-k IMAGE] output.img
+"""
+
+import argparse
+import struct
+import sys
+
+BLOCK = 512
+IMAGE_LBA = 2048
+
+
+def boot_sector(signature, image_size):
+    sector = bytearray(BLOCK)
+    sig = signature.encode("ascii")
+    if len(sig) > 8:
+        sys.exit("mkdisk: signature longer than 8 characters")
+    sector[16:16 + len(sig)] = sig
+    if image_size:
+        sector[24:32] = struct.pack("<II", IMAGE_LBA, image_size)
+    sector[510] = 0x55
+    sector[511] = 0xAA
+    return bytes(sector)
+
+
+def pattern_block(lba):
+    return struct.pack("<I", lba) * (BLOCK // 4)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("-s", "--size", type=int, default=64,
+                        help="image size in MiB (power of two, default 64)")
+    parser.add_argument("-t", "--signature", default="KERNEL",
+                        help="signature string placed in block 0")
+    parser.add_argument("-k", "--kernel",
+                        help="image to store from block %d" % IMAGE_LBA)
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    if args.size <= 0 or args.size & (args.size - 1):
+        sys.exit("mkdisk: size must be a power of two")
+
+    blocks = args.size * 1024 * 1024 // BLOCK
+    image = b""
+    if args.kernel:
+        with open(args.kernel, "rb") as f:
+            image = f.read()
+        if IMAGE_LBA + (len(image) + BLOCK - 1) // BLOCK > blocks:
+            sys.exit("mkdisk: image does not fit on the disk")
+    image_blocks = (len(image) + BLOCK - 1) // BLOCK
+
+    with open(args.output, "wb") as out:
+        out.write(boot_sector(args.signature, len(image)))
+        lba = 1
+        while lba < blocks:
+            if image and lba == IMAGE_LBA:
+                out.write(image.ljust(image_blocks * BLOCK, b"\0"))
+                lba += image_blocks
+            else:
+                out.write(pattern_block(lba))
+                lba += 1
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+Pack an ELF executable into a RETROS boot image (see include/rimg.h)
+
+Usage:
+  mkimage.py [-c none|gzip|lz4] [-f flat.bin] input.elf output.rimg
+
+Each PT_LOAD segment becomes one image segment at its physical address.
+Segments are stored compressed when that makes them smaller (LZ4 needs
+the python lz4 module); bss is not stored, the loader zero fills it.
+-f also writes the equivalent flat binary (as objcopy -O binary would)
+for load time comparisons.
+"""
+
+import gzip
+import struct
+import sys
+import zlib
+
+MAGIC = 0x474D4952
+VERSION = 1
+HEADER_SIZE = 512
+MAX_SEGMENTS = 15
+BLOCK = 512
+
+COMP_NONE, COMP_LZ4, COMP_GZIP = 0, 1, 2
+COMPRESSION = {"none": COMP_NONE, "lz4": COMP_LZ4, "gzip": COMP_GZIP}
+
+SEG_EXEC = 0x01
+
+PT_LOAD = 1
+PF_X = 1
+EM_ARM = 40
+
+
+def read_elf(path):
+    data = open(path, "rb").read()
+    if data[:4] != b"\x7fELF":
+        raise SystemExit("mkimage: %s is not an ELF file" % path)
+    if data[4] != 1 or data[5] != 1:
+        raise SystemExit("mkimage: %s is not a 32-bit little-endian ELF" % path)
+
+    (_, machine, _, entry, phoff, _, _, _, phentsize,
+     phnum) = struct.unpack("<HHIIIIIHHH", data[16:46])
+    if machine != EM_ARM:
+        raise SystemExit("mkimage: %s is not an ARM executable" % path)
+
+    segments = []
+    for i in range(phnum):
+        off = phoff + i * phentsize
+        (ptype, offset, _, paddr, filesz, memsz,
+         flags, _) = struct.unpack("<IIIIIIII", data[off:off + 32])
+        if ptype != PT_LOAD or memsz == 0:
+            continue
+        segments.append((paddr, data[offset:offset + filesz], memsz, flags))
+    segments.sort()
+    return entry, segments
+
+
+def compress(data, method):
+    if method == COMP_GZIP:
+        return gzip.compress(data, 9, mtime=0)
+    if method == COMP_LZ4:
+        try:
+            import lz4.frame
+        except ImportError:
+            raise SystemExit("mkimage: -c lz4 needs the python lz4 module")
+        return lz4.frame.compress(data, compression_level=9)
+    return data
+
+
+def build(entry, segments, method):
+    if len(segments) > MAX_SEGMENTS:
+        raise SystemExit("mkimage: %d segments, at most %d supported" %
+                         (len(segments), MAX_SEGMENTS))
+
+    table = b""
+    body = b""
+    for addr, data, memsz, flags in segments:
+        comp = COMP_NONE
+        stored = data
+        if data and method != COMP_NONE:
+            packed = compress(data, method)
+            if len(packed) < len(data):
+                comp, stored = method, packed
+
+        offset = HEADER_SIZE + len(body) if stored else 0
+        seg_flags = SEG_EXEC if flags & PF_X else 0
+        table += struct.pack("<IIIIB3xIII", offset, len(stored), addr, memsz, comp,
+                             zlib.crc32(stored), seg_flags, 0)
+        if stored:
+            body += stored + bytes(-len(stored) % BLOCK)
+
+    head = struct.pack("<IHHIIIIII", MAGIC, VERSION, HEADER_SIZE, entry, 0,
+                       len(segments), 0, 0, 0)
+    head += table
+    head += bytes(HEADER_SIZE - len(head))
+    crc = zlib.crc32(head)
+    head = head[:20] + struct.pack("<I", crc) + head[24:]
+    return head + body
+
+
+def flat_binary(segments):
+    stored = [(addr, data) for addr, data, _, _ in segments if data]
+    if not stored:
+        return b""
+    base = stored[0][0]
+    out = bytearray()
+    for addr, data in stored:
+        out += bytes(addr - base - len(out))
+        out += data
+    return bytes(out)
+
+
+def main():
+    args = sys.argv[1:]
+    method = COMP_NONE
+    flat = None
+    while len(args) > 2 and args[0].startswith("-"):
+        opt = args.pop(0)
+        if opt == "-c" and args[0] in COMPRESSION:
+            method = COMPRESSION[args.pop(0)]
+        elif opt == "-f":
+            flat = args.pop(0)
+        else:
+            raise SystemExit(__doc__)
+    if len(args) != 2:
+        raise SystemExit(__doc__)
+
+    entry, segments = read_elf(args[0])
+    with open(args[1], "wb") as f:
+        f.write(build(entry, segments, method))
+    if flat:
+        with open(flat, "wb") as f:
+            f.write(flat_binary(segments))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+Convert a PNG file into a RETROS splash image (see include/splash.h)
+
+Usage:
+  png2splash.py input.png output.rspl        # raw image, e.g. /splash.rspl on SD
+  png2splash.py -c NAME input.png output.c   # C array for embedding
+
+Images with more than 256 colors are reduced to the 256 most frequent
+colors, remapping the rest to the nearest palette entry. Transparent
+pixels are composited over black.
+"""
+
+import struct
+import sys
+import zlib
+
+MAGIC = b"RSPL"
+VERSION = 1
+
+
+def read_png(path):
+    data = open(path, "rb").read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise SystemExit("png2splash: %s is not a PNG file" % path)
+
+    pos = 8
+    idat = b""
+    palette = []
+    trns = b""
+    width = height = depth = ctype = interlace = None
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, ctype, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif kind == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b"tRNS":
+            trns = body
+        elif kind == b"IDAT":
+            idat += body
+        elif kind == b"IEND":
+            break
+
+    if interlace:
+        raise SystemExit("png2splash: interlaced PNG files are not supported")
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[ctype]
+    if depth != 8 and not (ctype == 3 and depth in (1, 2, 4)):
+        raise SystemExit("png2splash: unsupported bit depth %d" % depth)
+
+    raw = zlib.decompress(idat)
+    bpp = max(1, channels * depth // 8)
+    row_bytes = (width * channels * depth + 7) // 8
+    rows = []
+    prev = bytearray(row_bytes)
+    offset = 0
+    for _ in range(height):
+        ftype = raw[offset]
+        line = bytearray(raw[offset + 1:offset + 1 + row_bytes])
+        offset += 1 + row_bytes
+        for i in range(row_bytes):
+            a = line[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif ftype == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+                line[i] = (line[i] + pred) & 0xFF
+        rows.append(line)
+        prev = line
+
+    pixels = []
+    for line in rows:
+        for x in range(width):
+            if ctype == 3:
+                bit = x * depth
+                idx = (line[bit // 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1)
+                r, g, b = palette[idx]
+                alpha = trns[idx] if idx < len(trns) else 255
+            elif ctype in (0, 4):
+                r = g = b = line[x * channels]
+                alpha = line[x * channels + 1] if ctype == 4 else 255
+            else:
+                r, g, b = line[x * channels:x * channels + 3]
+                alpha = line[x * channels + 3] if ctype == 6 else 255
+            if alpha != 255:
+                r, g, b = (r * alpha // 255, g * alpha // 255, b * alpha // 255)
+            pixels.append((r << 16) | (g << 8) | b)
+    return width, height, pixels
+
+
+def quantize(pixels):
+    counts = {}
+    for p in pixels:
+        counts[p] = counts.get(p, 0) + 1
+    palette = sorted(counts, key=lambda c: -counts[c])[:256]
+    index = {c: i for i, c in enumerate(palette)}
+
+    def nearest(c):
+        r, g, b = c >> 16, (c >> 8) & 0xFF, c & 0xFF
+        best = min(palette, key=lambda p: ((p >> 16) - r) ** 2 +
+                   (((p >> 8) & 0xFF) - g) ** 2 + ((p & 0xFF) - b) ** 2)
+        return index[best]
+
+    for c in counts:
+        if c not in index:
+            index[c] = nearest(c)
+    return palette, bytes(index[p] for p in pixels)
+
+
+def encode(indexes):
+    out = bytearray()
+    literal = bytearray()
+
+    def flush():
+        while literal:
+            chunk = literal[:128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literal[:128]
+
+    i = 0
+    n = len(indexes)
+    while i < n:
+        j = i
+        while j < n and indexes[j] == indexes[i] and j - i < 0x3FFF + 2:
+            j += 1
+        run = j - i
+        if run >= 3:
+            flush()
+            if run <= 0x3F + 2:
+                out.append(0x80 | (run - 2))
+            else:
+                out.append(0xC0 | ((run - 2) >> 8))
+                out.append((run - 2) & 0xFF)
+            out.append(indexes[i])
+            i = j
+        else:
+            literal.append(indexes[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def build(path):
+    width, height, pixels = read_png(path)
+    if width > 0xFFFF or height > 0xFFFF:
+        raise SystemExit("png2splash: image too large")
+    palette, indexes = quantize(pixels)
+    header = MAGIC + struct.pack("<HHHHHH", VERSION, 0, width, height, len(palette), 0)
+    return header + b"".join(struct.pack("<I", c) for c in palette) + encode(indexes)
+
+
+def write_c(name, blob, path):
+    lines = ["// Generated by tools/png2splash.py - do not edit",
+             "#include <stdint.h>",
+             "",
+             "const uint8_t %s[] __attribute__((aligned(4))) = {" % name]
+    for i in range(0, len(blob), 12):
+        lines.append("    " + ", ".join("0x%02X" % b for b in blob[i:i + 12]) + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("const uint32_t %s_size = %d;" % (name, len(blob)))
+    lines.append("")
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    args = sys.argv[1:]
+    name = None
+    if len(args) == 4 and args[0] == "-c":
+        name = args[1]
+        args = args[2:]
+    if len(args) != 2:
+        raise SystemExit(__doc__)
+
+    blob = build(args[0])
+    if name:
+        write_c(name, blob, args[1])
+    else:
+        with open(args[1], "wb") as f:
+            f.write(blob)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+"""
+Send an image to the BIOS over serial (the 'load' command, see
+include/serial_load.h)
+
+Usage:
+  serial_load.py [options] port image.bin
+
+port is a serial device (/dev/ttyUSB0) or tcp:HOST:PORT for QEMU, e.g.
+  make qemu QEMU_SERIAL=tcp::5555,server
+  serial_load.py tcp:localhost:5555 kernel.bin
+
+Options:
+  -b BAUD     Serial device rate (default 115200); for tcp, the nominal
+              line rate used in the throughput report
+  -a ADDR     Load address (default 0x04000000)
+  -e ADDR     Entry point (default: the load address)
+  -c BYTES    Chunk size (default 1024, at most 4096)
+  -w COUNT    Chunks in flight (default 8)
+  -n          Load only, do not run the image
+  -q          Do not type 'load' first (the BIOS is already waiting)
+  -m          Stay attached afterwards and show the console
+
+An interrupted transfer resumes where it stopped when the same image is
+sent again.
+"""
+
+import os
+import select
+import socket
+import struct
+import sys
+import time
+import zlib
+
+PACKET_MAGIC = 0x504C5352
+REPLY_MAGIC = b"RSLA"
+CHUNK_MAX = 4096
+
+PKT_HEADER, PKT_DATA, PKT_DONE = 1, 2, 3
+REPLY_ACK, REPLY_NAK, REPLY_ERROR, REPLY_READY = 0, 1, 2, 3
+FLAG_RUN = 0x01
+
+LOAD_ADDRESS = 0x04000000
+REPLY_TIMEOUT = 1.0
+RETRIES = 10
+
+
+class Link:
+    """A serial device in raw mode, or a TCP socket"""
+
+    def __init__(self, port, baud):
+        self.sock = None
+        if port.startswith("tcp:"):
+            host, _, tcp_port = port[4:].rpartition(":")
+            self.sock = socket.create_connection((host or "localhost", int(tcp_port)))
+            self.fd = self.sock.fileno()
+        else:
+            import termios
+            import tty
+            self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(self.fd)
+            attrs = termios.tcgetattr(self.fd)
+            speed = getattr(termios, "B%d" % baud, None)
+            if speed is None:
+                raise SystemExit("serial_load: %d baud not supported by termios" % baud)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+            termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.pending = b""
+
+    def write(self, data):
+        while data:
+            n = os.write(self.fd, data)
+            data = data[n:]
+
+    def read(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return b""
+        data = os.read(self.fd, 65536)
+        if not data:
+            raise SystemExit("serial_load: connection closed")
+        return data
+
+    def reply(self, timeout):
+        """Next (code, value) reply, skipping console text; None on timeout"""
+        deadline = time.monotonic() + timeout
+        while True:
+            at = self.pending.find(REPLY_MAGIC)
+            if at >= 0 and len(self.pending) >= at + 12:
+                code, value = struct.unpack("<II", self.pending[at + 4:at + 12])
+                self.pending = self.pending[at + 12:]
+                return code, value
+            if at < 0:
+                self.pending = self.pending[-3:]
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            self.pending += self.read(left)
+
+
+def packet(ptype, offset, payload):
+    head = struct.pack("<IBBHI", PACKET_MAGIC, ptype, 0, len(payload), offset)
+    crc = zlib.crc32(payload, zlib.crc32(head))
+    return head + struct.pack("<I", crc) + payload
+
+
+def error_text(value):
+    code = struct.unpack("<i", struct.pack("<I", value))[0]
+    return {-193: "image outside the load area",
+            -194: "image CRC mismatch"}.get(code, "error %d" % code)
+
+
+def exchange(link, data, want):
+    """Send a packet until a reply of the wanted kind comes back"""
+    for _ in range(RETRIES):
+        link.write(data)
+        while True:
+            r = link.reply(REPLY_TIMEOUT)
+            if r is None:
+                break
+            if r[0] == REPLY_ERROR:
+                raise SystemExit("serial_load: BIOS refused the image: %s" % error_text(r[1]))
+            if r[0] in want:
+                return r
+    raise SystemExit("serial_load: no reply from the BIOS")
+
+
+def send(link, image, addr, entry, flags, chunk, window):
+    size = len(image)
+    header = struct.pack("<IIIII", addr, size, zlib.crc32(image), entry, flags)
+    _, base = exchange(link, packet(PKT_HEADER, 0, header), (REPLY_ACK,))
+    if base:
+        print("Resuming at byte %d" % base)
+
+    start = time.monotonic()
+    resumed = base
+    sent = naks = timeouts = 0
+    shown = -1
+    nxt = base
+    while base < size:
+        # Keep the window full; ACKs are cumulative
+        while nxt < size and nxt - base < window * chunk:
+            link.write(packet(PKT_DATA, nxt, image[nxt:nxt + chunk]))
+            nxt += min(chunk, size - nxt)
+            sent += 1
+
+        r = link.reply(REPLY_TIMEOUT)
+        if r is None:
+            timeouts += 1
+            if timeouts > RETRIES:
+                raise SystemExit("serial_load: transfer stalled at byte %d" % base)
+            nxt = base
+            continue
+        code, value = r
+        if code == REPLY_ERROR:
+            raise SystemExit("serial_load: BIOS refused the image: %s" % error_text(value))
+        if code == REPLY_ACK and value > base:
+            base = value
+            timeouts = 0
+        elif code == REPLY_NAK:
+            naks += 1
+            base = nxt = value
+
+        percent = base * 100 // size
+        if percent != shown:
+            shown = percent
+            sys.stdout.write("\r[%-40s] %d%%" % ("#" * (percent * 40 // 100), percent))
+            sys.stdout.flush()
+
+    exchange(link, packet(PKT_DONE, size, b""), (REPLY_ACK,))
+    elapsed = time.monotonic() - start
+    print()
+    return size - resumed, elapsed, sent, naks
+
+
+def main():
+    args = sys.argv[1:]
+    baud = 115200
+    addr = LOAD_ADDRESS
+    entry = None
+    chunk = 1024
+    window = 8
+    run = True
+    command = True
+    monitor = False
+    while len(args) > 2 and args[0].startswith("-"):
+        opt = args.pop(0)
+        if opt == "-b":
+            baud = int(args.pop(0))
+        elif opt == "-a":
+            addr = int(args.pop(0), 0)
+        elif opt == "-e":
+            entry = int(args.pop(0), 0)
+        elif opt == "-c":
+            chunk = int(args.pop(0))
+        elif opt == "-w":
+            window = int(args.pop(0))
+        elif opt == "-n":
+            run = False
+        elif opt == "-q":
+            command = False
+        elif opt == "-m":
+            monitor = True
+        else:
+            raise SystemExit(__doc__)
+    if len(args) != 2 or not 0 < chunk <= CHUNK_MAX or window < 1:
+        raise SystemExit(__doc__)
+
+    image = open(args[1], "rb").read()
+    if not image:
+        raise SystemExit("serial_load: %s is empty" % args[1])
+    link = Link(args[0], baud)
+
+    if command:
+        link.write(b"\rload\r")
+    r = link.reply(10.0)
+    while r is not None and r[0] != REPLY_READY:
+        r = link.reply(10.0)
+    if r is None:
+        raise SystemExit("serial_load: the BIOS is not waiting for an image")
+
+    print("Sending %s: %d bytes to 0x%08X" % (args[1], len(image), addr))
+    nbytes, elapsed, sent, naks = send(link, image, addr, entry or addr,
+                                       FLAG_RUN if run else 0, chunk, window)
+
+    rate = nbytes / elapsed if elapsed else 0
+    line = baud / 10
+    print("%d bytes in %.2f s: %.1f kB/s, %d%% of the %.1f kB/s line rate" %
+          (nbytes, elapsed, rate / 1000, rate * 100 / line, line / 1000))
+    print("%d packets, %d NAKs" % (sent, naks))
+
+    if monitor:
+        sys.stdout.buffer.write(link.pending)
+        try:
+            while True:
+                sys.stdout.buffer.write(link.read(None))
+                sys.stdout.flush()
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()
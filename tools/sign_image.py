@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""
+Sign boot images for RETROS verified boot (see include/loader.h)
+
+Usage:
+  sign_image.py genkey KEY                    # writes KEY and KEY.pub
+  sign_image.py sign KEY input output         # prepend a signed header
+  sign_image.py verify KEY.pub image          # check a signed image
+  sign_image.py pubkey -c NAME KEY.pub out.c  # C array for embedding
+
+Keys are Ed25519 (RFC 8032) and stored as hex: KEY holds the 32-byte
+secret seed, KEY.pub the 32-byte public key. The payload may be a raw,
+LZ4 or gzip image; it is signed as stored, so the BIOS hashes exactly the
+bytes it reads.
+"""
+
+import hashlib
+import os
+import struct
+import sys
+
+MAGIC = b"RSIG"
+VERSION = 1
+HEADER_SIZE = 512
+SIGNED_BYTES = 64
+
+# Ed25519 over the twisted Edwards curve -x^2 + y^2 = 1 + d x^2 y^2
+P = 2 ** 255 - 19
+L = 2 ** 252 + 27742317777372353535851937790883648493
+D = -121665 * pow(121666, P - 2, P) % P
+SQRT_M1 = pow(2, (P - 1) // 4, P)
+
+
+def inv(x):
+    return pow(x, P - 2, P)
+
+
+def recover_x(y, sign):
+    xx = (y * y - 1) * inv(D * y * y + 1) % P
+    x = pow(xx, (P + 3) // 8, P)
+    if (x * x - xx) % P:
+        x = x * SQRT_M1 % P
+    if (x * x - xx) % P:
+        return None
+    if x & 1 != sign:
+        x = P - x
+    return x
+
+
+BY = 4 * inv(5) % P
+BX = recover_x(BY, 0)
+BASE = (BX, BY, 1, BX * BY % P)
+IDENTITY = (0, 1, 1, 0)
+
+
+def point_add(p, q):
+    a = (p[1] - p[0]) * (q[1] - q[0]) % P
+    b = (p[1] + p[0]) * (q[1] + q[0]) % P
+    c = 2 * p[3] * q[3] * D % P
+    d = 2 * p[2] * q[2] % P
+    e, f, g, h = b - a, d - c, d + c, b + a
+    return (e * f % P, g * h % P, f * g % P, e * h % P)
+
+
+def point_mul(s, p):
+    q = IDENTITY
+    while s:
+        if s & 1:
+            q = point_add(q, p)
+        p = point_add(p, p)
+        s >>= 1
+    return q
+
+
+def point_equal(p, q):
+    return ((p[0] * q[2] - q[0] * p[2]) % P == 0 and
+            (p[1] * q[2] - q[1] * p[2]) % P == 0)
+
+
+def point_encode(p):
+    zi = inv(p[2])
+    x, y = p[0] * zi % P, p[1] * zi % P
+    return (y | ((x & 1) << 255)).to_bytes(32, "little")
+
+
+def point_decode(data):
+    y = int.from_bytes(data, "little")
+    sign = y >> 255
+    y &= (1 << 255) - 1
+    if y >= P:
+        return None
+    x = recover_x(y, sign)
+    if x is None:
+        return None
+    return (x, y, 1, x * y % P)
+
+
+def sha512_int(data):
+    return int.from_bytes(hashlib.sha512(data).digest(), "little")
+
+
+def expand_seed(seed):
+    h = hashlib.sha512(seed).digest()
+    a = int.from_bytes(h[:32], "little")
+    a &= (1 << 254) - 8
+    a |= 1 << 254
+    return a, h[32:]
+
+
+def public_key(seed):
+    return point_encode(point_mul(expand_seed(seed)[0], BASE))
+
+
+def sign(seed, msg):
+    a, prefix = expand_seed(seed)
+    pub = point_encode(point_mul(a, BASE))
+    r = sha512_int(prefix + msg) % L
+    rs = point_encode(point_mul(r, BASE))
+    k = sha512_int(rs + pub + msg) % L
+    return rs + ((r + k * a) % L).to_bytes(32, "little")
+
+
+def verify(pub, msg, sig):
+    a = point_decode(pub)
+    r = point_decode(sig[:32])
+    s = int.from_bytes(sig[32:], "little")
+    if a is None or r is None or s >= L:
+        return False
+    k = sha512_int(sig[:32] + pub + msg) % L
+    return point_equal(point_mul(s, BASE), point_add(r, point_mul(k, a)))
+
+
+def read_key(path):
+    key = bytes.fromhex(open(path).read().strip())
+    if len(key) != 32:
+        raise SystemExit("sign_image: %s is not a 32-byte hex key" % path)
+    return key
+
+
+def build_header(payload, seed):
+    head = struct.pack("<4sHHII", MAGIC, VERSION, HEADER_SIZE, len(payload), 0)
+    head += hashlib.sha256(payload).digest()
+    head += bytes(SIGNED_BYTES - len(head))
+    head += sign(seed, head)
+    return head + bytes(HEADER_SIZE - len(head))
+
+
+def check_image(pub, image):
+    if len(image) < HEADER_SIZE or image[:4] != MAGIC:
+        return "not a signed image"
+    _, version, size, length, _ = struct.unpack("<4sHHII", image[:16])
+    if version != VERSION or size != HEADER_SIZE or length != len(image) - HEADER_SIZE:
+        return "bad header"
+    if hashlib.sha256(image[HEADER_SIZE:]).digest() != image[16:48]:
+        return "digest mismatch"
+    if not verify(pub, image[:SIGNED_BYTES], image[SIGNED_BYTES:2 * SIGNED_BYTES]):
+        return "signature invalid"
+    return None
+
+
+def write_c(name, key, path):
+    lines = ["// Generated by tools/sign_image.py - do not edit",
+             "#include <stdint.h>",
+             "",
+             "const uint8_t %s[32] = {" % name]
+    for i in range(0, 32, 8):
+        lines.append("    " + ", ".join("0x%02X" % b for b in key[i:i + 8]) + ",")
+    lines.append("};")
+    lines.append("")
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    args = sys.argv[1:]
+    cmd = args.pop(0) if args else None
+    if cmd == "genkey" and len(args) == 1:
+        seed = os.urandom(32)
+        with open(args[0], "w") as f:
+            f.write(seed.hex() + "\n")
+        with open(args[0] + ".pub", "w") as f:
+            f.write(public_key(seed).hex() + "\n")
+    elif cmd == "sign" and len(args) == 3:
+        seed = read_key(args[0])
+        payload = open(args[1], "rb").read()
+        if payload[:4] == MAGIC:
+            raise SystemExit("sign_image: %s is already signed" % args[1])
+        with open(args[2], "wb") as f:
+            f.write(build_header(payload, seed) + payload)
+    elif cmd == "verify" and len(args) == 2:
+        error = check_image(read_key(args[0]), open(args[1], "rb").read())
+        if error:
+            raise SystemExit("sign_image: %s: %s" % (args[1], error))
+        print("%s: signature OK" % args[1])
+    elif cmd == "pubkey" and len(args) == 4 and args[0] == "-c":
+        write_c(args[1], read_key(args[2]), args[3])
+    else:
+        raise SystemExit(__doc__)
+
+
+if __name__ == "__main__":
+    main()